@@ -0,0 +1,76 @@
+/***************************************************************************/
+/*                                                                         */
+/* Copyright 2022 INTERSEC SA                                              */
+/*                                                                         */
+/* Licensed under the Apache License, Version 2.0 (the "License");         */
+/* you may not use this file except in compliance with the License.        */
+/* You may obtain a copy of the License at                                 */
+/*                                                                         */
+/*     http://www.apache.org/licenses/LICENSE-2.0                          */
+/*                                                                         */
+/* Unless required by applicable law or agreed to in writing, software     */
+/* distributed under the License is distributed on an "AS IS" BASIS,       */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*/
+/* See the License for the specific language governing permissions and     */
+/* limitations under the License.                                          */
+/*                                                                         */
+/***************************************************************************/
+
+/* Formatting and parsing of doubles: "%.17g" against dtoa_shortest(), and
+ * strtod() against the exact fast path of strtod_allow_subnormal(), on
+ * typical metric values.
+ */
+
+#include <lib-common/zbenchmark.h>
+
+#define DTOA_BENCH_VALUES  1024
+#define DTOA_BENCH_ROUNDS  64
+
+static struct {
+    double values[DTOA_BENCH_VALUES];
+    char strs[DTOA_BENCH_VALUES][DTOA_SHORTEST_LEN];
+    double sink;
+} z_dtoa_g;
+#define _G  z_dtoa_g
+
+static void z_dtoa_init_values(void)
+{
+    for (int i = 0; i < DTOA_BENCH_VALUES; i++) {
+        /* Mix of ratios, latencies in seconds and large counters. */
+        switch (i % 3) {
+          case 0: _G.values[i] = (double)rand() / RAND_MAX; break;
+          case 1: _G.values[i] = (rand() % 100000) / 1000.; break;
+          default: _G.values[i] = (double)rand() * 1024.5; break;
+        }
+        dtoa_shortest(_G.strs[i], _G.values[i]);
+    }
+}
+
+#define ZBENCH_DTOA(_name, _descr, ...)                                      \
+    ZBENCH(_name, _descr) {                                                  \
+        ZBENCH_LOOP() {                                                      \
+            ZBENCH_MEASURE() {                                               \
+                for (int r = 0; r < DTOA_BENCH_ROUNDS; r++) {                \
+                    for (int i = 0; i < DTOA_BENCH_VALUES; i++) {            \
+                        __VA_ARGS__;                                         \
+                    }                                                        \
+                }                                                            \
+            } ZBENCH_MEASURE_END                                             \
+        } ZBENCH_LOOP_END                                                    \
+    } ZBENCH_END
+
+ZBENCH_GROUP_EXPORT(dtoa) {
+    char buf[64];
+
+    z_dtoa_init_values();
+
+    ZBENCH_DTOA(format_17g, "64k doubles formatted with \"%.17g\"",
+                snprintf(buf, sizeof(buf), "%.17g", _G.values[i]));
+    ZBENCH_DTOA(format_shortest, "64k doubles formatted with dtoa_shortest",
+                dtoa_shortest(buf, _G.values[i]));
+    ZBENCH_DTOA(parse_strtod, "64k doubles parsed with strtod",
+                _G.sink += strtod(_G.strs[i], NULL));
+    ZBENCH_DTOA(parse_fast_path, "64k doubles parsed with "
+                "strtod_allow_subnormal",
+                _G.sink += strtod_allow_subnormal(_G.strs[i], NULL));
+} ZBENCH_GROUP_END
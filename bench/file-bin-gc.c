@@ -0,0 +1,150 @@
+/***************************************************************************/
+/*                                                                         */
+/* Copyright 2022 INTERSEC SA                                              */
+/*                                                                         */
+/* Licensed under the Apache License, Version 2.0 (the "License");         */
+/* you may not use this file except in compliance with the License.        */
+/* You may obtain a copy of the License at                                 */
+/*                                                                         */
+/*     http://www.apache.org/licenses/LICENSE-2.0                          */
+/*                                                                         */
+/* Unless required by applicable law or agreed to in writing, software     */
+/* distributed under the License is distributed on an "AS IS" BASIS,       */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*/
+/* See the License for the specific language governing permissions and     */
+/* limitations under the License.                                          */
+/*                                                                         */
+/***************************************************************************/
+
+/* Durable appends to a binary file from several writer threads: each record
+ * synced on its own under a lock, or handed to the group commit writer,
+ * with and without fdatasync(2). The latency is measured from the put to
+ * the durability of the record.
+ */
+
+#include <pthread.h>
+
+#include <lib-common/file-bin.h>
+#include <lib-common/sort.h>
+#include <lib-common/zbenchmark.h>
+
+#define FILE_BIN_GC_BENCH_WRITERS  4
+#define FILE_BIN_GC_BENCH_RECORDS  (4 << 10)
+#define FILE_BIN_GC_BENCH_LEN      256
+#define FILE_BIN_GC_BENCH_TOTAL \
+    (FILE_BIN_GC_BENCH_WRITERS * FILE_BIN_GC_BENCH_RECORDS)
+
+static struct {
+    file_bin_t *file;
+    bool group_commit;
+    pthread_mutex_t lock;
+    uint64_t start[FILE_BIN_GC_BENCH_TOTAL];
+    uint64_t lat[FILE_BIN_GC_BENCH_TOTAL];
+    uint64_t total;
+} z_file_bin_gc_g = {
+#define _G  z_file_bin_gc_g
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static uint64_t z_file_bin_gc_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void z_file_bin_gc_on_durable(int res, data_t priv)
+{
+    e_assert(panic, res >= 0, "cannot write record");
+    _G.lat[priv.u32] = z_file_bin_gc_now() - _G.start[priv.u32];
+}
+
+static void *z_file_bin_gc_writer(void *arg)
+{
+    uint32_t first = (uintptr_t)arg * FILE_BIN_GC_BENCH_RECORDS;
+    char data[FILE_BIN_GC_BENCH_LEN];
+
+    p_clear(data, 1);
+    for (uint32_t i = first; i < first + FILE_BIN_GC_BENCH_RECORDS; i++) {
+        _G.start[i] = z_file_bin_gc_now();
+        if (_G.group_commit) {
+            e_assert(panic, file_bin_put_record_cb(_G.file, data,
+                                                   sizeof(data),
+                                                   &z_file_bin_gc_on_durable,
+                                                   DATA_U32(i)) >= 0,
+                     "cannot put record");
+        } else {
+            int res;
+
+            pthread_mutex_lock(&_G.lock);
+            res = file_bin_put_record(_G.file, data, sizeof(data));
+            if (res >= 0) {
+                res = file_bin_sync(_G.file);
+            }
+            pthread_mutex_unlock(&_G.lock);
+            z_file_bin_gc_on_durable(res, DATA_U32(i));
+        }
+    }
+    return NULL;
+}
+
+static void z_file_bin_gc_setup(bool group_commit, file_bin_gc_sync_t sync)
+{
+    _G.file = file_bin_create(LSTR("file-bin-gc.bin"), 1 << 20, true);
+    e_assert(panic, _G.file, "cannot create file-bin-gc.bin");
+    _G.group_commit = group_commit;
+    if (group_commit) {
+        e_assert(panic, file_bin_start_group_commit(_G.file, sync,
+                                                    4 << 20) >= 0,
+                 "cannot start the group commit");
+    }
+}
+
+static void z_file_bin_gc_run(void)
+{
+    pthread_t threads[FILE_BIN_GC_BENCH_WRITERS];
+    uint64_t start = z_file_bin_gc_now();
+
+    for (uintptr_t i = 0; i < FILE_BIN_GC_BENCH_WRITERS; i++) {
+        pthread_create(&threads[i], NULL, &z_file_bin_gc_writer, (void *)i);
+    }
+    for (int i = 0; i < FILE_BIN_GC_BENCH_WRITERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    e_assert(panic, file_bin_flush(_G.file) >= 0, "cannot flush");
+    _G.total = z_file_bin_gc_now() - start;
+}
+
+static void z_file_bin_gc_teardown(const char *name)
+{
+    e_assert(panic, file_bin_close(&_G.file) >= 0, "cannot close");
+    unlink("file-bin-gc.bin");
+
+    dsort64(_G.lat, FILE_BIN_GC_BENCH_TOTAL);
+    e_info("%s: %.0f records/s, p50 latency %ju ns, p99 latency %ju ns",
+           name, FILE_BIN_GC_BENCH_TOTAL * 1e9 / MAX(_G.total, 1),
+           _G.lat[FILE_BIN_GC_BENCH_TOTAL / 2],
+           _G.lat[FILE_BIN_GC_BENCH_TOTAL * 99 / 100]);
+}
+
+#define ZBENCH_FILE_BIN_GC(_name, _gc, _sync, _descr)                        \
+    ZBENCH(_name, _descr) {                                                  \
+        z_file_bin_gc_setup(_gc, _sync);                                     \
+        ZBENCH_LOOP() {                                                      \
+            ZBENCH_MEASURE() {                                               \
+                z_file_bin_gc_run();                                         \
+            } ZBENCH_MEASURE_END                                             \
+        } ZBENCH_LOOP_END                                                    \
+        z_file_bin_gc_teardown(#_name);                                      \
+    } ZBENCH_END
+
+ZBENCH_GROUP_EXPORT(file_bin_gc) {
+    ZBENCH_FILE_BIN_GC(sync_each, false, FILE_BIN_GC_FDATASYNC,
+                       "16k records from 4 threads, synced one by one");
+    ZBENCH_FILE_BIN_GC(group_nosync, true, FILE_BIN_GC_NOSYNC,
+                       "16k records from 4 threads, group commit, no sync");
+    ZBENCH_FILE_BIN_GC(group_fdatasync, true, FILE_BIN_GC_FDATASYNC,
+                       "16k records from 4 threads, group commit, "
+                       "fdatasync");
+} ZBENCH_GROUP_END
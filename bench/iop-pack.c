@@ -19,6 +19,7 @@
 #include <lib-common/iop-json.h>
 #include <lib-common/xmlr.h>
 #include <lib-common/iop-yaml.h>
+#include <lib-common/thr.h>
 #include <lib-common/zbenchmark.h>
 
 
@@ -142,6 +143,99 @@ ZBENCH_GROUP_EXPORT(iop_pack) {
             } ZBENCH_LOOP_END
         } ZBENCH_END
     }
+    /* json, large payload */
+    {
+        t_scope;
+        const iop_struct_t *st_sf;
+        SB_1k(out);
+        int res = 0;
+
+        st_sf = iop_env_get_struct(iop_env, LSTR("tstiop.MyStructF"));
+
+        /* Strings without escapes, a few strings with escapes and arrays
+         * of plain decimal integers. */
+        sb_adds(&out, "{\"a\":[");
+        for (int i = 0; i < 10000; i++) {
+            sb_addf(&out, "%s\"string number %d of a large JSON payload%s\"",
+                    i ? "," : "", i, i % 100 ? "" : " with \\\"escapes\\\"");
+        }
+        sb_adds(&out, "],\"c\":[");
+        for (int i = 0; i < 1000; i++) {
+            sb_addf(&out, "%s{\"a\":%d,\"b\":[", i ? "," : "", i);
+            for (int j = 0; j < 100; j++) {
+                sb_addf(&out, "%s%d", j ? "," : "", i * 100000 + j);
+            }
+            sb_adds(&out, "]}");
+        }
+        sb_adds(&out, "]}");
+
+        ZBENCH(jpack_large) {
+            sb_t packed;
+            pstream_t ps = ps_initsb(&out);
+            void *sf = NULL;
+
+            if (t_iop_junpack_ptr_ps(iop_env, &ps, st_sf, &sf, 0, NULL) < 0)
+            {
+                e_panic("KO");
+            }
+            sb_init(&packed);
+
+            ZBENCH_LOOP() {
+                sb_reset(&packed);
+
+                ZBENCH_MEASURE() {
+                    res = iop_sb_jpack(&packed, st_sf, sf, IOP_JPACK_MINIMAL);
+                } ZBENCH_MEASURE_END
+
+                if (res < 0) {
+                    e_panic("KO");
+                }
+            } ZBENCH_LOOP_END
+            sb_wipe(&packed);
+        } ZBENCH_END
+
+        ZBENCH(jpack_large_cb) {
+            sb_t packed;
+            pstream_t ps = ps_initsb(&out);
+            void *sf = NULL;
+
+            if (t_iop_junpack_ptr_ps(iop_env, &ps, st_sf, &sf, 0, NULL) < 0)
+            {
+                e_panic("KO");
+            }
+            sb_init(&packed);
+
+            ZBENCH_LOOP() {
+                sb_reset(&packed);
+
+                ZBENCH_MEASURE() {
+                    res = iop_jpack(st_sf, sf, &iop_sb_write, &packed, 0);
+                } ZBENCH_MEASURE_END
+
+                if (res < 0) {
+                    e_panic("KO");
+                }
+            } ZBENCH_LOOP_END
+            sb_wipe(&packed);
+        } ZBENCH_END
+
+        ZBENCH(junpack_large) {
+            ZBENCH_LOOP() {
+                t_scope;
+                pstream_t ps = ps_initsb(&out);
+                void *sf = NULL;
+
+                ZBENCH_MEASURE() {
+                    res = t_iop_junpack_ptr_ps(iop_env, &ps, st_sf, &sf, 0,
+                                               NULL);
+                } ZBENCH_MEASURE_END
+
+                if (res < 0) {
+                    e_panic("KO");
+                }
+            } ZBENCH_LOOP_END
+        } ZBENCH_END
+    }
     /* bin */
     {
         t_scope;
@@ -253,3 +347,92 @@ ZBENCH_GROUP_EXPORT(iop_pack) {
     iop_dso_close(&dso);
     iop_env_delete(&iop_env);
 } ZBENCH_GROUP_END
+
+ZBENCH_GROUP_EXPORT(iop_sort) {
+    iop_env_t *iop_env;
+    iop_dso_t *dso;
+    const iop_struct_t *st_sn;
+    tstiop__my_struct_n__t *vec;
+    tstiop__my_struct_n__t *work;
+    int len = 1 << 20;
+    int res = 0;
+
+    MODULE_REQUIRE(thr);
+    iop_env = iop_env_new();
+    dso = z_dso_open(iop_env, "tests/iop/zchk-tstiop-plugin" SO_FILEEXT);
+    st_sn = iop_env_get_struct(iop_env, LSTR("tstiop.MyStructN"));
+
+    vec = p_new_raw(tstiop__my_struct_n__t, len);
+    work = p_new_raw(tstiop__my_struct_n__t, len);
+    for (int i = 0; i < len; i++) {
+        vec[i].u = rand() % 1000;
+        vec[i].i = ((int64_t)rand() << 32 | rand()) - (INT64_C(1) << 62);
+    }
+
+    ZBENCH(sort_1m) {
+        ZBENCH_LOOP() {
+            p_copy(work, vec, len);
+
+            ZBENCH_MEASURE() {
+                res = iop_sort_desc(iop_env, st_sn, work, len, LSTR("i"), 0,
+                                    NULL);
+            } ZBENCH_MEASURE_END
+
+            if (res < 0) {
+                e_panic("KO");
+            }
+        } ZBENCH_LOOP_END
+    } ZBENCH_END
+
+    ZBENCH(msort_1m) {
+        t_scope;
+        qv_t(iop_sort) params;
+
+        t_qv_init(&params, 2);
+        qv_append(&params, ((iop_sort_t){ .field_path = LSTR("u") }));
+        qv_append(&params, ((iop_sort_t){
+            .field_path = LSTR("i"),
+            .flags = IOP_SORT_REVERSE,
+        }));
+
+        ZBENCH_LOOP() {
+            p_copy(work, vec, len);
+
+            ZBENCH_MEASURE() {
+                res = iop_msort_desc(iop_env, st_sn, work, len, &params,
+                                     NULL);
+            } ZBENCH_MEASURE_END
+
+            if (res < 0) {
+                e_panic("KO");
+            }
+        } ZBENCH_LOOP_END
+    } ZBENCH_END
+
+    ZBENCH(filter_1m) {
+        uint64_t u1 = 1;
+        uint64_t u2 = 42;
+        void *values[] = { &u1, &u2 };
+
+        ZBENCH_LOOP() {
+            int work_len = len;
+
+            p_copy(work, vec, len);
+
+            ZBENCH_MEASURE() {
+                res = iop_filter(iop_env, st_sn, work, &work_len, LSTR("u"),
+                                 values, countof(values), 0, NULL);
+            } ZBENCH_MEASURE_END
+
+            if (res < 0) {
+                e_panic("KO");
+            }
+        } ZBENCH_LOOP_END
+    } ZBENCH_END
+
+    p_delete(&work);
+    p_delete(&vec);
+    iop_dso_close(&dso);
+    iop_env_delete(&iop_env);
+    MODULE_RELEASE(thr);
+} ZBENCH_GROUP_END
@@ -17,6 +17,8 @@
 /***************************************************************************/
 
 #include <lib-common/iop.h>
+#include <lib-common/iop-json.h>
+#include <lib-common/hash.h>
 #include "../tests/iop/tstiop.iop.h"
 
 /* {{{ Now removed implementation of iop_class_for_each_field. */
@@ -47,14 +49,26 @@ _iop_class_get_next_field(const iop_struct_t **st, int *it)
 /* }}} */
 
 /* This bench helps evaluating the cost of field iteration methods through IOP
- * structs and classes.
+ * structs and classes, and the cost of the generic descriptor-driven
+ * helpers (dup, equals, hash).
  *
  * Launch bench:
  *
- *     ./iop-struct-for-each-bench <struct-name> <nb-loop> (0|1)(*)
+ *     ./iop-struct-for-each-bench <struct-name> <nb-loop> <mode>(*) [json]
  *
  *     (*) 0: old way
  *         1: new way
+ *         dup: iop_dup
+ *         equals: iop_equals
+ *         hash: iop_hash_sha1
+ *
+ * For the dup, equals and hash modes, the value is unpacked from the json
+ * argument if given, or default-initialized otherwise. Flat structs (see
+ * IOP_STRUCT_IS_FLAT), like tstiop.MyStructN, or arrays of them, take the
+ * memcpy/memcmp fast paths, e.g.:
+ *
+ *     ./iop-struct-for-each-bench tstiop.MyStructN 10000000 equals \
+ *         '{ "u": 1, "i": -1 }'
  */
 
 uint64_t cnt_g;
@@ -88,6 +102,73 @@ static void new_loop(const iop_struct_t *st)
     }
 }
 
+/* {{{ Dup/equals/hash */
+
+static void run_dup(const iop_struct_t *st, const void *v, int nb_loops)
+{
+    for (int i = 0; i < nb_loops; i++) {
+        t_scope;
+        const void *res = mp_iop_dup_desc_sz(t_pool(), st, v, NULL);
+
+        cnt_g += (uintptr_t)res & 0xf;
+    }
+}
+
+static void run_equals(const iop_struct_t *st, const void *v, int nb_loops)
+{
+    t_scope;
+    const void *v2 = mp_iop_dup_desc_sz(t_pool(), st, v, NULL);
+
+    for (int i = 0; i < nb_loops; i++) {
+        cnt_g += iop_equals_desc(st, v, v2);
+    }
+}
+
+static void run_hash(const iop_struct_t *st, const void *v, int nb_loops)
+{
+    for (int i = 0; i < nb_loops; i++) {
+        uint8_t buf[20];
+
+        iop_hash_sha1(st, v, buf, 0);
+        cnt_g += buf[0];
+    }
+}
+
+static void run_value_bench(const iop_env_t *iop_env,
+                            const iop_struct_t *st, int nb_loops,
+                            const char *mode, const char *json)
+{
+    t_scope;
+    void *v = NULL;
+
+    if (json) {
+        pstream_t ps = ps_initstr(json);
+        SB_1k(err);
+
+        if (t_iop_junpack_ptr_ps(iop_env, &ps, st, &v, 0, &err) < 0) {
+            fprintf(stderr, "cannot unpack value: %s\n", err.data);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        v = t_iop_new_desc(st);
+    }
+
+    if (strequal(mode, "dup")) {
+        run_dup(st, v, nb_loops);
+    } else
+    if (strequal(mode, "equals")) {
+        run_equals(st, v, nb_loops);
+    } else
+    if (strequal(mode, "hash")) {
+        run_hash(st, v, nb_loops);
+    } else {
+        fprintf(stderr, "unknown mode `%s'\n", mode);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* }}} */
+
 typedef void (*loop_f)(const iop_struct_t *st);
 
 static void run_loops(const iop_struct_t *st, int nb_loops, bool new_way)
@@ -116,7 +197,8 @@ int main(int argc, char **argv)
     bool new_way;
 
     if (argc <= 3) {
-        fprintf(stderr, "usage: %s st_name nb_loops (0|1)\n", argv[0]);
+        fprintf(stderr, "usage: %s st_name nb_loops (0|1|dup|equals|hash) "
+                "[json]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
@@ -129,8 +211,13 @@ int main(int argc, char **argv)
     }
 
     nb_loops = atoi(argv[2]);
-    new_way = atoi(argv[3]);
-    run_loops(st, nb_loops, new_way);
+    if (isdigit(argv[3][0])) {
+        new_way = atoi(argv[3]);
+        run_loops(st, nb_loops, new_way);
+    } else {
+        run_value_bench(iop_env, st, nb_loops, argv[3],
+                        argc > 4 ? argv[4] : NULL);
+    }
 
     iop_env_delete(&iop_env);
     return 0;
@@ -49,6 +49,39 @@ static long snprintf_event(const mcms_event_t *event)
                     event->remote_id, event->payload_len);
 }
 
+static long snprintf_event_lit(const mcms_event_t *event)
+{
+    char buf[BUFSIZ];
+
+    return isnprintf_lit(buf, sizeof(buf),
+                         "%d|%c|%lld|%d|%d|%u|%d|\n",
+                         event->stamp, event->type,
+                         (long long)event->msisdn,
+                         event->camp_lineno, event->camp_id,
+                         event->remote_id, event->payload_len);
+}
+
+/* Typical log line, as formatted by the stderr log handler. */
+static long snprintf_log(int i)
+{
+    char buf[BUFSIZ];
+
+    return isnprintf(buf, sizeof(buf),
+                     "%s[%d]: info:  {%*pM} query %s on %s took %u ms (%d)",
+                     "bench", 4242, 4, "http", "GET", "/index.html",
+                     i & 1023, i);
+}
+
+static long snprintf_log_lit(int i)
+{
+    char buf[BUFSIZ];
+
+    return isnprintf_lit(buf, sizeof(buf),
+                         "%s[%d]: info:  {%*pM} query %s on %s took %u ms "
+                         "(%d)", "bench", 4242, 4, "http", "GET",
+                         "/index.html", i & 1023, i);
+}
+
 ZBENCH_GROUP_EXPORT(iprintf_bench) {
     ZBENCH(snprintf) {
         int i = 0;
@@ -72,4 +105,47 @@ ZBENCH_GROUP_EXPORT(iprintf_bench) {
             } ZBENCH_MEASURE_END
         } ZBENCH_LOOP_END
     } ZBENCH_END
+
+    ZBENCH(snprintf_lit) {
+        int i = 0;
+        mcms_event_t ev, *event = &ev;
+
+        p_clear(event, 1);
+        ZBENCH_LOOP() {
+            event->stamp = 1178096605;
+            event->type = "ABDG"[i & 3];
+            event->msisdn = 33612345678LL + i + (i ^ 4321);
+            event->camp_lineno = i & 16383;
+            event->camp_id = i >> 14;
+            event->remote_id = 1;
+            event->payload_len = 0;
+            i++;
+
+            ZBENCH_MEASURE() {
+                for (int j = 0; j < 1000; j++) {
+                    snprintf_event_lit(event);
+                }
+            } ZBENCH_MEASURE_END
+        } ZBENCH_LOOP_END
+    } ZBENCH_END
+
+    ZBENCH(log) {
+        ZBENCH_LOOP() {
+            ZBENCH_MEASURE() {
+                for (int j = 0; j < 1000; j++) {
+                    snprintf_log(j);
+                }
+            } ZBENCH_MEASURE_END
+        } ZBENCH_LOOP_END
+    } ZBENCH_END
+
+    ZBENCH(log_lit) {
+        ZBENCH_LOOP() {
+            ZBENCH_MEASURE() {
+                for (int j = 0; j < 1000; j++) {
+                    snprintf_log_lit(j);
+                }
+            } ZBENCH_MEASURE_END
+        } ZBENCH_LOOP_END
+    } ZBENCH_END
 } ZBENCH_GROUP_END
@@ -0,0 +1,133 @@
+/***************************************************************************/
+/*                                                                         */
+/* Copyright 2022 INTERSEC SA                                              */
+/*                                                                         */
+/* Licensed under the Apache License, Version 2.0 (the "License");         */
+/* you may not use this file except in compliance with the License.        */
+/* You may obtain a copy of the License at                                 */
+/*                                                                         */
+/*     http://www.apache.org/licenses/LICENSE-2.0                          */
+/*                                                                         */
+/* Unless required by applicable law or agreed to in writing, software     */
+/* distributed under the License is distributed on an "AS IS" BASIS,       */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*/
+/* See the License for the specific language governing permissions and     */
+/* limitations under the License.                                          */
+/*                                                                         */
+/***************************************************************************/
+
+/* Base64, hex and escaping functions of str-buf-quoting.c, with the scalar
+ * loops and with each set of vectorized loops, on short and multi-MB text
+ * inputs.
+ */
+
+#include <lib-common/zbenchmark.h>
+
+#define QUOTING_SHORT_LEN     64
+#define QUOTING_SHORT_ROUNDS  (64 << 10)
+#define QUOTING_BIG_LEN       (4 << 20)
+
+static struct {
+    byte data[QUOTING_BIG_LEN];
+    sb_t b64;
+    sb_t b64_short;
+    sb_t hex;
+    sb_t out;
+} z_quoting_g;
+#define _G  z_quoting_g
+
+static void z_quoting_init(void)
+{
+    /* Text with a few characters to escape in each format */
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789-_.";
+
+    for (int i = 0; i < QUOTING_BIG_LEN; i++) {
+        _G.data[i] = i % 1000 ? chars[rand() % (countof(chars) - 1)]
+                              : "&\"<;"[rand() % 4];
+    }
+    sb_init(&_G.b64);
+    sb_init(&_G.b64_short);
+    sb_init(&_G.hex);
+    sb_init(&_G.out);
+    sb_add_b64(&_G.b64, _G.data, QUOTING_BIG_LEN, 0);
+    sb_add_b64(&_G.b64_short, _G.data, QUOTING_SHORT_LEN, -1);
+    sb_add_hex(&_G.hex, _G.data, QUOTING_BIG_LEN);
+}
+
+static void z_quoting_wipe(void)
+{
+    sb_wipe(&_G.b64);
+    sb_wipe(&_G.b64_short);
+    sb_wipe(&_G.hex);
+    sb_wipe(&_G.out);
+}
+
+/* The short benchmarks work on the start of the inputs, so the rounds give
+ * the cost of each call on small strings. */
+#define ZBENCH_QUOTING_SIMD(_name, _simd, _rounds, ...)                      \
+    ZBENCH(_name) {                                                          \
+        sb_quoting_set_simd(_simd);                                          \
+        ZBENCH_LOOP() {                                                      \
+            ZBENCH_MEASURE() {                                               \
+                for (int r = 0; r < _rounds; r++) {                          \
+                    sb_reset(&_G.out);                                       \
+                    __VA_ARGS__;                                             \
+                }                                                            \
+            } ZBENCH_MEASURE_END                                             \
+        } ZBENCH_LOOP_END                                                    \
+    } ZBENCH_END
+
+#define ZBENCH_QUOTING(_name, _rounds, ...)                                  \
+    ZBENCH_QUOTING_SIMD(_name##_scalar, SB_QUOTING_SIMD_NONE, _rounds,       \
+                        __VA_ARGS__);                                        \
+    ZBENCH_QUOTING_SIMD(_name##_ssse3, SB_QUOTING_SIMD_SSSE3, _rounds,       \
+                        __VA_ARGS__);                                        \
+    ZBENCH_QUOTING_SIMD(_name##_avx2, SB_QUOTING_SIMD_AVX2, _rounds,         \
+                        __VA_ARGS__)
+
+ZBENCH_GROUP_EXPORT(str_quoting) {
+    z_quoting_init();
+
+    /* {{{ Short inputs */
+
+    ZBENCH_QUOTING(b64_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_b64(&_G.out, _G.data, QUOTING_SHORT_LEN, -1));
+    ZBENCH_QUOTING(unb64_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_unb64(&_G.out, _G.b64_short.data,
+                                _G.b64_short.len));
+    ZBENCH_QUOTING(hex_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_hex(&_G.out, _G.data, QUOTING_SHORT_LEN));
+    ZBENCH_QUOTING(unhex_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_unhex(&_G.out, _G.hex.data, 2 * QUOTING_SHORT_LEN));
+    ZBENCH_QUOTING(urlencode_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_urlencode(&_G.out, _G.data, QUOTING_SHORT_LEN));
+    ZBENCH_QUOTING(xmlescape_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_xmlescape(&_G.out, _G.data, QUOTING_SHORT_LEN));
+    ZBENCH_QUOTING(csvescape_short, QUOTING_SHORT_ROUNDS,
+                   sb_add_csvescape(&_G.out, ',', _G.data, QUOTING_SHORT_LEN));
+
+    /* }}} */
+    /* {{{ Multi-MB inputs */
+
+    ZBENCH_QUOTING(b64_big, 1,
+                   sb_add_b64(&_G.out, _G.data, QUOTING_BIG_LEN, 0));
+    ZBENCH_QUOTING(b64_big_no_lines, 1,
+                   sb_add_b64(&_G.out, _G.data, QUOTING_BIG_LEN, -1));
+    ZBENCH_QUOTING(unb64_big, 1,
+                   sb_add_unb64(&_G.out, _G.b64.data, _G.b64.len));
+    ZBENCH_QUOTING(hex_big, 1,
+                   sb_add_hex(&_G.out, _G.data, QUOTING_BIG_LEN));
+    ZBENCH_QUOTING(unhex_big, 1,
+                   sb_add_unhex(&_G.out, _G.hex.data, _G.hex.len));
+    ZBENCH_QUOTING(urlencode_big, 1,
+                   sb_add_urlencode(&_G.out, _G.data, QUOTING_BIG_LEN));
+    ZBENCH_QUOTING(xmlescape_big, 1,
+                   sb_add_xmlescape(&_G.out, _G.data, QUOTING_BIG_LEN));
+    ZBENCH_QUOTING(csvescape_big, 1,
+                   sb_add_csvescape(&_G.out, ',', _G.data, QUOTING_BIG_LEN));
+
+    /* }}} */
+
+    sb_quoting_set_simd(SB_QUOTING_SIMD_AVX2);
+    z_quoting_wipe();
+} ZBENCH_GROUP_END
@@ -0,0 +1,258 @@
+/***************************************************************************/
+/*                                                                         */
+/* Copyright 2022 INTERSEC SA                                              */
+/*                                                                         */
+/* Licensed under the Apache License, Version 2.0 (the "License");         */
+/* you may not use this file except in compliance with the License.        */
+/* You may obtain a copy of the License at                                 */
+/*                                                                         */
+/*     http://www.apache.org/licenses/LICENSE-2.0                          */
+/*                                                                         */
+/* Unless required by applicable law or agreed to in writing, software     */
+/* distributed under the License is distributed on an "AS IS" BASIS,       */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*/
+/* See the License for the specific language governing permissions and     */
+/* limitations under the License.                                          */
+/*                                                                         */
+/***************************************************************************/
+
+/* Differential fuzzing of the UTF-8 functions of str-conv.c and of the GSM
+ * conversions of str-buf-gsm.c: the results with the vectorized loops must
+ * be the ones of the scalar loops, and the batched GSM 7 bits packing must
+ * decode to the same text as the unpacked conversions.
+ *
+ * Built with the fuzzing feature, this is a libFuzzer target; otherwise it
+ * runs on random inputs and aborts on the first difference.
+ */
+
+#include <sysexits.h>
+
+#include <lib-common/core.h>
+#include <lib-common/parseopt.h>
+
+static struct {
+    sb_t ref;
+    sb_t res;
+    sb_t tmp;
+
+    int opt_iterations;
+    int opt_max_len;
+    bool opt_help;
+} utf8_fuzz_g = {
+    .opt_iterations = 100000,
+    .opt_max_len    = 4096,
+};
+#define _G  utf8_fuzz_g
+
+/* {{{ Checks */
+
+static ssize_t utf8_fuzz_strnlen(const char *s, int len)
+{
+    const char *end = s + len;
+    ssize_t res = 0;
+
+    while (s < end) {
+        uint8_t charlen = utf8_charlen(s, end - s);
+
+        if (!charlen) {
+            return -1;
+        }
+        res++;
+        s += charlen;
+    }
+    return res;
+}
+
+static void utf8_fuzz_run(sb_t *out, const char *s, int len)
+{
+    int half = len / 2;
+
+    sb_addf(out, "%zd|%td|", utf8_strnlen(s, len),
+            utf8_skip_valid(s, s + len) - s);
+    sb_conv_from_latin1(out, s, len);
+    sb_addf(out, "|%d|", sb_conv_to_latin1(out, s, len, '?'));
+    sb_addf(out, "|%d|", sb_conv_to_ucs2le(out, s, len));
+    sb_addf(out, "|%d|", sb_conv_to_ucs2be(out, s, len));
+    sb_conv_to_gsm(out, s, len);
+    sb_conv_to_gsm_hex(out, s, len);
+    sb_addf(out, "|%d|", sb_conv_to_gsm_isok(s, len, GSM_DEFAULT_PLAN));
+    sb_addf(out, "|%d|", sb_conv_from_gsm_plan(out, s, len,
+                                               GSM_EXTENSION_PLAN));
+
+    /* The case conversions and comparisons are only defined on valid
+     * text. */
+    if (utf8_strnlen(s, len) < 0) {
+        return;
+    }
+    sb_addf(out, "|%d|", sb_add_utf8_tolower(out, s, len));
+    sb_addf(out, "|%d|", sb_add_utf8_toupper(out, s, len));
+    sb_addf(out, "|%d|", sb_normalize_utf8(out, s, len, true));
+    sb_addf(out, "|%d|", sb_normalize_utf8(out, s, len, false));
+    sb_addf(out, "|%d %d %d %d %d|",
+            utf8_strcmp(s, len, s + half, len - half, false),
+            utf8_stricmp(s, len, s + half, len - half, true),
+            utf8_stricmp(s, half, s + half, half, false),
+            utf8_str_startswith(s, len, s, half),
+            utf8_str_istartswith(s + half, len - half, s, half));
+}
+
+static void utf8_fuzz_check_gsm7(const char *s, int len)
+{
+    const char *p = s, *end = s + len;
+    int gsmlen;
+
+    /* sb_conv_to_gsm7() works on NUL terminated strings, and stops at
+     * invalid or NUL (even overlong) characters */
+    for (const char *next; p < end && utf8_ngetc(p, end - p, &next) > 0; ) {
+        p = next;
+    }
+    len = p - s;
+    s = t_dupz(s, len);
+
+    sb_reset(&_G.tmp);
+    gsmlen = sb_conv_to_gsm7(&_G.tmp, 0, s, '.', GSM_EXTENSION_PLAN, -1);
+    if (gsmlen < 0) {
+        e_panic("unable to pack %*pX in GSM 7 bits", len, s);
+    }
+    sb_reset(&_G.res);
+    if (sb_conv_from_gsm7(&_G.res, _G.tmp.data, gsmlen, 0) < 0) {
+        e_panic("unable to unpack the GSM 7 bits packing of %*pX",
+                len, s);
+    }
+
+    sb_reset(&_G.tmp);
+    sb_reset(&_G.ref);
+    sb_conv_to_gsm(&_G.tmp, s, len);
+    sb_conv_from_gsm(&_G.ref, _G.tmp.data, _G.tmp.len);
+    if (!lstr_equal(LSTR_SB_V(&_G.ref), LSTR_SB_V(&_G.res))) {
+        e_panic("GSM 7 bits packing differs for %*pX", len, s);
+    }
+}
+
+static void utf8_fuzz_check(const char *s, int len)
+{
+    t_scope;
+
+    if (utf8_strnlen(s, len) != utf8_fuzz_strnlen(s, len)) {
+        e_panic("utf8_strnlen() differs for %*pX", len, s);
+    }
+
+    utf8_set_simd(UTF8_SIMD_NONE);
+    sb_reset(&_G.ref);
+    utf8_fuzz_run(&_G.ref, s, len);
+
+    for (int simd = UTF8_SIMD_SSE2; simd <= UTF8_SIMD_AVX2; simd++) {
+        if (utf8_set_simd(simd) != (utf8_simd_t)simd) {
+            break;
+        }
+        sb_reset(&_G.res);
+        utf8_fuzz_run(&_G.res, s, len);
+        if (!lstr_equal(LSTR_SB_V(&_G.ref), LSTR_SB_V(&_G.res))) {
+            e_panic("simd level %d differs for %*pX", simd, len, s);
+        }
+    }
+
+    utf8_fuzz_check_gsm7(s, len);
+}
+
+/* }}} */
+
+#ifdef __fuzzing__
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t sz);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t sz)
+{
+    static bool init = false;
+
+    if (!init) {
+        sb_init(&_G.ref);
+        sb_init(&_G.res);
+        sb_init(&_G.tmp);
+        init = true;
+    }
+    utf8_fuzz_check((const char *)data, MIN(sz, INT_MAX));
+    return 0;
+}
+
+#else /* ! __fuzzing__ */
+
+/* {{{ Random inputs */
+
+/* Runs of ASCII text, valid characters of 2, 3 and 4 bytes, truncated
+ * sequences and stray bytes. */
+static int utf8_fuzz_fill(char *s, int size)
+{
+    static const char ascii[] = "abcdefXYZ0123 ,.;?\n\r@$_{}";
+    static const char * const chars[] = {
+        "\xc3\xa9", "\xc3\x89", "\xc5\x93", "\xe2\x82\xac", "\xce\xa3",
+        "\xf0\x9f\x98\x80", "\xc3", "\xe2\x82", "\x80", "\xf8", "\xff",
+    };
+    int len = 0;
+
+    while (len < size - 4) {
+        const char *chr = chars[rand() % countof(chars)];
+
+        if (rand() % 4) {
+            for (int n = rand() % 80; n-- > 0 && len < size; ) {
+                s[len++] = ascii[rand() % (countof(ascii) - 1)];
+            }
+            continue;
+        }
+        if (rand() % 64 == 0) {
+            s[len++] = rand();
+            continue;
+        }
+        while (*chr) {
+            s[len++] = *chr++;
+        }
+    }
+    return len;
+}
+
+/* }}} */
+
+static const char *utf8_fuzz_usage_g = "\n\n"
+"Check the vectorized UTF-8 functions against the scalar ones on random "
+"inputs,\nand abort on the first difference.\n\n"
+"Options:\n"
+"--------";
+
+static popt_t utf8_fuzz_popt_g[] = {
+    OPT_FLAG('h', "help", &_G.opt_help, "show this help"),
+    OPT_INT('n', "iterations", &_G.opt_iterations,
+            "number of random inputs (default: 100000)"),
+    OPT_INT('l', "max-len", &_G.opt_max_len,
+            "maximum length of the inputs (default: 4096)"),
+    OPT_END(),
+};
+
+int main(int argc, char **argv)
+{
+    const char *arg0 = NEXTARG(argc, argv);
+    char *buf;
+
+    argc = parseopt(argc, argv, utf8_fuzz_popt_g, 0);
+    if (argc != 0 || _G.opt_help || _G.opt_max_len <= 0) {
+        makeusage(_G.opt_help ? EX_OK : EX_USAGE, arg0, utf8_fuzz_usage_g,
+                  NULL, utf8_fuzz_popt_g);
+    }
+
+    sb_init(&_G.ref);
+    sb_init(&_G.res);
+    sb_init(&_G.tmp);
+    buf = p_new_raw(char, _G.opt_max_len);
+
+    for (int i = 0; i < _G.opt_iterations; i++) {
+        int size = rand() % (_G.opt_max_len + 1);
+
+        utf8_fuzz_check(buf, utf8_fuzz_fill(buf, size));
+    }
+
+    p_delete(&buf);
+    sb_wipe(&_G.ref);
+    sb_wipe(&_G.res);
+    sb_wipe(&_G.tmp);
+    return 0;
+}
+
+#endif /* ! __fuzzing__ */
@@ -0,0 +1,137 @@
+/***************************************************************************/
+/*                                                                         */
+/* Copyright 2022 INTERSEC SA                                              */
+/*                                                                         */
+/* Licensed under the Apache License, Version 2.0 (the "License");         */
+/* you may not use this file except in compliance with the License.        */
+/* You may obtain a copy of the License at                                 */
+/*                                                                         */
+/*     http://www.apache.org/licenses/LICENSE-2.0                          */
+/*                                                                         */
+/* Unless required by applicable law or agreed to in writing, software     */
+/* distributed under the License is distributed on an "AS IS" BASIS,       */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.*/
+/* See the License for the specific language governing permissions and     */
+/* limitations under the License.                                          */
+/*                                                                         */
+/***************************************************************************/
+
+/* UTF-8 functions of str-conv.c and GSM conversions of str-buf-gsm.c, with
+ * the scalar loops and with each set of vectorized loops, on short and
+ * multi-MB inputs of ASCII text and of text with a few accented letters.
+ */
+
+#include <lib-common/zbenchmark.h>
+
+#define UTF8_SHORT_LEN     64
+#define UTF8_SHORT_ROUNDS  (64 << 10)
+#define UTF8_BIG_LEN       (4 << 20)
+
+static struct {
+    char ascii[UTF8_BIG_LEN + 1];
+    char accents[UTF8_BIG_LEN + 1];
+    char ascii_copy[UTF8_BIG_LEN + 1];
+    sb_t gsm7;
+    int gsm7_len;
+    sb_t out;
+} z_utf8_g;
+#define _G  z_utf8_g
+
+static void z_utf8_init(void)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz ABCXYZ0123,.\n";
+
+    for (int i = 0; i < UTF8_BIG_LEN; i++) {
+        _G.ascii[i] = chars[rand() % (countof(chars) - 1)];
+    }
+
+    /* About one accented letter every 40 bytes, like in French text */
+    for (int i = 0; i < UTF8_BIG_LEN; ) {
+        if (rand() % 40 || i + 2 > UTF8_BIG_LEN) {
+            _G.accents[i++] = chars[rand() % (countof(chars) - 1)];
+        } else {
+            _G.accents[i++] = 0xc3;
+            _G.accents[i++] = 0xa9;
+        }
+    }
+    memcpy(_G.ascii_copy, _G.ascii, UTF8_BIG_LEN);
+
+    sb_init(&_G.gsm7);
+    sb_init(&_G.out);
+    _G.gsm7_len = sb_conv_to_gsm7(&_G.gsm7, 0, _G.ascii, '.',
+                                  GSM_EXTENSION_PLAN, -1);
+}
+
+static void z_utf8_wipe(void)
+{
+    sb_wipe(&_G.gsm7);
+    sb_wipe(&_G.out);
+}
+
+/* The short benchmarks work on the start of the inputs, so the rounds give
+ * the cost of each call on small strings. */
+#define ZBENCH_UTF8_SIMD(_name, _simd, _rounds, ...)                         \
+    ZBENCH(_name) {                                                          \
+        utf8_set_simd(_simd);                                                \
+        ZBENCH_LOOP() {                                                      \
+            ZBENCH_MEASURE() {                                               \
+                for (int r = 0; r < _rounds; r++) {                          \
+                    sb_reset(&_G.out);                                       \
+                    __VA_ARGS__;                                             \
+                }                                                            \
+            } ZBENCH_MEASURE_END                                             \
+        } ZBENCH_LOOP_END                                                    \
+    } ZBENCH_END
+
+#define ZBENCH_UTF8(_name, _rounds, ...)                                     \
+    ZBENCH_UTF8_SIMD(_name##_scalar, UTF8_SIMD_NONE, _rounds,                \
+                     __VA_ARGS__);                                           \
+    ZBENCH_UTF8_SIMD(_name##_sse2, UTF8_SIMD_SSE2, _rounds, __VA_ARGS__);    \
+    ZBENCH_UTF8_SIMD(_name##_avx2, UTF8_SIMD_AVX2, _rounds, __VA_ARGS__)
+
+/* The input is the ascii or the accents buffer. */
+#define ZBENCH_UTF8_INPUTS(_name, _len, _rounds, _in, ...)                   \
+    ZBENCH_UTF8(_name##_##_in, _rounds, ({                                   \
+        const char *in = _G._in;                                             \
+        int len = _len;                                                      \
+                                                                             \
+        __VA_ARGS__;                                                         \
+    }))
+
+#define ZBENCH_UTF8_ALL(_name, ...)                                          \
+    ZBENCH_UTF8_INPUTS(_name##_short, UTF8_SHORT_LEN, UTF8_SHORT_ROUNDS,     \
+                       ascii, __VA_ARGS__);                                  \
+    ZBENCH_UTF8_INPUTS(_name##_short, UTF8_SHORT_LEN, UTF8_SHORT_ROUNDS,     \
+                       accents, __VA_ARGS__);                                \
+    ZBENCH_UTF8_INPUTS(_name##_big, UTF8_BIG_LEN, 1, ascii, __VA_ARGS__);    \
+    ZBENCH_UTF8_INPUTS(_name##_big, UTF8_BIG_LEN, 1, accents, __VA_ARGS__)
+
+ZBENCH_GROUP_EXPORT(utf8) {
+    z_utf8_init();
+
+    ZBENCH_UTF8_ALL(strnlen, utf8_strnlen(in, len));
+    ZBENCH_UTF8_ALL(tolower, sb_add_utf8_tolower(&_G.out, in, len));
+    ZBENCH_UTF8_ALL(normalize_ci, sb_normalize_utf8(&_G.out, in, len, true));
+    ZBENCH_UTF8_ALL(to_latin1, sb_conv_to_latin1(&_G.out, in, len, '?'));
+    ZBENCH_UTF8_ALL(to_ucs2le, sb_conv_to_ucs2le(&_G.out, in, len));
+    ZBENCH_UTF8_ALL(to_gsm, sb_conv_to_gsm(&_G.out, in, len));
+
+    /* Comparisons of identical strings, up to their last character */
+    ZBENCH_UTF8(stricmp_short, UTF8_SHORT_ROUNDS,
+                utf8_stricmp(_G.ascii, UTF8_SHORT_LEN,
+                             _G.ascii_copy, UTF8_SHORT_LEN, false));
+    ZBENCH_UTF8(stricmp_big, 1,
+                utf8_stricmp(_G.ascii, UTF8_BIG_LEN,
+                             _G.ascii_copy, UTF8_BIG_LEN, false));
+
+    /* GSM 7 bits packing does not depend on the vectorized loops */
+    ZBENCH_UTF8_SIMD(to_gsm7_big, UTF8_SIMD_AVX2, 1,
+                     sb_conv_to_gsm7(&_G.out, 0, _G.ascii, '.',
+                                     GSM_EXTENSION_PLAN, -1));
+    ZBENCH_UTF8_SIMD(from_gsm7_big, UTF8_SIMD_AVX2, 1,
+                     sb_conv_from_gsm7(&_G.out, _G.gsm7.data,
+                                       _G.gsm7_len, 0));
+
+    utf8_set_simd(UTF8_SIMD_AVX2);
+    z_utf8_wipe();
+} ZBENCH_GROUP_END
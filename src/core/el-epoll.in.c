@@ -96,6 +96,34 @@ short el_fd_set_mask(ev_t *ev, short events)
     return old;
 }
 
+int el_fd_set_exclusive(ev_t *ev)
+{
+#ifdef EPOLLEXCLUSIVE
+    struct epoll_event event = {
+        .data.ptr = ev,
+        .events   = ev->events_wanted | EPOLLEXCLUSIVE,
+    };
+
+    CHECK_EV_TYPE(ev, EV_FD);
+    assert (ev->fd.generation == el_epoll_g.generation);
+
+    /* EPOLLEXCLUSIVE can only be set when the file is added. */
+    epoll_ctl(el_epoll_g.fd, EPOLL_CTL_DEL, ev->fd.fd, NULL);
+    if (epoll_ctl(el_epoll_g.fd, EPOLL_CTL_ADD, ev->fd.fd, &event) == 0) {
+        return 0;
+    }
+    event.events = ev->events_wanted;
+    if (epoll_ctl(el_epoll_g.fd, EPOLL_CTL_ADD, ev->fd.fd, &event)) {
+        e_panic("epoll_ctl(el_epoll_g.fd=%d, EPOLL_CTL_ADD, fd=%d, &event): "
+                "%m", el_epoll_g.fd, ev->fd.fd);
+    }
+    return -1;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 data_t el_fd_unregister(ev_t **evp)
 {
     if (*evp) {
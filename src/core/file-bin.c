@@ -16,10 +16,14 @@
 /*                                                                         */
 /***************************************************************************/
 
+#include <pthread.h>
+
 #include <lib-common/arith.h>
 #include <lib-common/log.h>
 #include <lib-common/file-bin.h>
+#include <lib-common/thr.h>
 #include <lib-common/unix.h>
+#include <lib-common/zlib-wrapper.h>
 
 /* File header */
 #define CURRENT_VERSION  1
@@ -47,6 +51,38 @@ typedef le32_t slot_hdr_t;
 typedef le32_t rc_hdr_t;
 #define RC_HDR_SIZE  ssizeof(rc_hdr_t)
 
+/* Group commit context */
+typedef struct file_bin_gc_cb_t {
+    file_bin_gc_cb_f *cb;
+    data_t            priv;
+} file_bin_gc_cb_t;
+qvector_t(file_bin_gc_cb, file_bin_gc_cb_t);
+
+typedef struct file_bin_gc_t {
+    file_bin_t        *file;
+    file_bin_gc_sync_t sync;
+    size_t             max_pending;
+
+    /* The next batch, protected by the lock. */
+    spinlock_t lock;
+    sb_t       buf;
+    off_t      buf_pos; /* offset of buf in the file */
+    uint64_t   seq;     /* number of records put */
+    qv_t(file_bin_gc_cb) cbs;
+    bool       stopping;
+
+    /* Updated by the writer thread after each batch. The error of the
+     * first failed batch is kept: the offsets of the next ones are not
+     * known anymore, so they are not written. */
+    atomic_uint64_t durable_seq;
+    atomic_size_t   pending;
+    atomic_int      err;
+
+    thr_evc_t ec;         /* records to write */
+    thr_evc_t durable_ec; /* a batch was written */
+    pthread_t thread;
+} file_bin_gc_t;
+
 static struct {
     logger_t logger;
 } file_bin_g = {
@@ -173,6 +209,10 @@ int file_bin_refresh(file_bin_t *file)
 
     assert (file->read_mode);
 
+    if (file->compressed) {
+        return 0;
+    }
+
     if (fstat(fileno(file->f), &st) < 0) {
         return logger_error(&_G.logger, "cannot stat file '%*pM': %m",
                             LSTR_FMT_ARG(file->path));
@@ -261,7 +301,7 @@ static int _file_bin_get_next_record(file_bin_t *file, lstr_t *rec)
     off_t prev_off = file->cur;
     off_t rec_end_off;
     uint32_t sz;
-    uint32_t check_slot_hdr;
+    off_t check_slot_hdr;
     bool is_spanning = false;
 
     if (file_bin_is_finished(file)) {
@@ -468,11 +508,39 @@ int t_file_bin_get_last_records(file_bin_t *file, int count, qv_t(lstr) *out)
     return 0;
 }
 
+static bool file_bin_is_compressed(const void *data, size_t len)
+{
+    return len >= 2 && memcmp(data, "\x1f\x8b", 2) == 0;
+}
+
+/* Replace the mapping of a gzip compressed file by its uncompressed
+ * content. */
+static int file_bin_uncompress(lstr_t path, void **map, off_t *len)
+{
+    sb_t sb;
+    ssize_t res;
+
+    sb_init(&sb);
+    res = sb_add_uncompressed(&sb, *map, *len);
+    munmap(*map, *len);
+    *map = NULL;
+    if (res < 0) {
+        sb_wipe(&sb);
+        return logger_error(&_G.logger, "cannot uncompress file '%*pM': %s",
+                            LSTR_FMT_ARG(path), zError(res));
+    }
+    *len = sb.len;
+    *map = sb_detach(&sb, NULL);
+
+    return 0;
+}
+
 file_bin_t *file_bin_open(lstr_t path)
 {
     file_bin_t *res;
     struct stat st;
     void *mapping = NULL;
+    bool compressed = false;
     uint16_t version = 0;
     uint32_t slot_size = 0;
     lstr_t r_path = lstr_dup(path);
@@ -505,6 +573,13 @@ file_bin_t *file_bin_open(lstr_t path)
             goto error;
         }
 
+        if (file_bin_is_compressed(mapping, st.st_size)) {
+            if (file_bin_uncompress(path, &mapping, &st.st_size) < 0) {
+                goto error;
+            }
+            compressed = true;
+        }
+
         if (file_bin_parse_header(path, mapping, st.st_size,
                                   &version, &slot_size) < 0)
         {
@@ -518,6 +593,7 @@ file_bin_t *file_bin_open(lstr_t path)
     res->path = r_path;
     res->length = st.st_size;
     res->map = mapping;
+    res->compressed = compressed;
     res->version = version;
     res->slot_size = slot_size;
     res->cur = HEADER_SIZE(res);
@@ -525,16 +601,228 @@ file_bin_t *file_bin_open(lstr_t path)
     return res;
 
   error:
+    if (compressed) {
+        p_delete(&mapping);
+    }
     p_fclose(&file);
     lstr_wipe(&r_path);
     return NULL;
 }
 
+/* }}} */
+/* {{{ Parallel reading */
+
+void file_bin_split(file_bin_t *file, int nb_ranges,
+                    qv_t(file_bin_range) *out)
+{
+    off_t nb_slots = DIV_ROUND_UP(file->length, file->slot_size);
+    int nb = MIN(MAX(nb_ranges, 1), MAX(nb_slots, 1));
+
+    assert (file->read_mode);
+
+    for (int i = 0; i < nb; i++) {
+        file_bin_range_t *range = qv_growlen(out, 1);
+
+        range->start = (nb_slots * i / nb) * file->slot_size;
+        range->end = MIN((nb_slots * (i + 1) / nb) * file->slot_size,
+                         file->length);
+        range->reader = *file;
+        range->reader.f = NULL;
+        range->reader.gc = NULL;
+        range->reader.cur = range->start;
+        sb_init(&range->reader.record_buf);
+    }
+}
+
+/* Move to the beginning of the next record of the range, skipping the slot
+ * headers and the end of the record spanning from the previous slot. */
+static int file_bin_range_skip_to_record(file_bin_range_t *range)
+{
+    file_bin_t *file = &range->reader;
+    uint32_t remaining;
+
+    file->cur = MAX(file->cur, HEADER_SIZE(file));
+    remaining = file_bin_remaining_space_in_slot(file);
+    if (remaining < RC_HDR_SIZE) {
+        file->cur += remaining;
+    }
+
+    if (file->version > 0) {
+        while (file->cur < range->end && is_at_slot_start(file)) {
+            uint32_t sz;
+
+            RETHROW(file_bin_get_cpu32(file, &sz));
+            RETHROW(_file_bin_skip(file, sz));
+        }
+    }
+
+    return file->cur < range->end ? 0 : -1;
+}
+
+lstr_t file_bin_range_get_next_record(file_bin_range_t *range)
+{
+    lstr_t rec = LSTR_NULL_V;
+
+    do {
+        if (file_bin_range_skip_to_record(range) < 0
+        ||  _file_bin_get_next_record(&range->reader, &rec) < 0)
+        {
+            return LSTR_NULL_V;
+        }
+    } while (!rec.s);
+
+    return rec;
+}
+
+/* }}} */
+/* {{{ Record index */
+
+/* Should always be 16 characters long */
+#define INDEX_SIG  "IS_binidx/v01.0\0"
+
+int file_bin_index_update(file_bin_t *file, file_bin_index_t *index)
+{
+    off_t save_cur = file->cur;
+
+    assert (file->read_mode);
+
+    RETHROW(file_bin_refresh(file));
+    if (index->end > file->length) {
+        return logger_error(&_G.logger, "index of file '%*pM' does not "
+                            "match the file", LSTR_FMT_ARG(file->path));
+    }
+
+    file->cur = MAX(index->end, HEADER_SIZE(file));
+    for (;;) {
+        off_t pos = file->cur;
+
+        if (!file_bin_get_next_record(file).s) {
+            break;
+        }
+        if (index->nb_records % index->stride == 0) {
+            qv_append(&index->offsets, pos);
+        }
+        index->nb_records++;
+        index->end = file->cur;
+    }
+    file->cur = save_cur;
+
+    return 0;
+}
+
+lstr_t file_bin_get_record(file_bin_t *file, const file_bin_index_t *index,
+                           uint64_t n)
+{
+    assert (file->read_mode);
+
+    if (n >= index->nb_records) {
+        return LSTR_NULL_V;
+    }
+
+    file->cur = index->offsets.tab[n / index->stride];
+    for (uint32_t i = n % index->stride; i-- > 0; ) {
+        if (!file_bin_get_next_record(file).s) {
+            return LSTR_NULL_V;
+        }
+    }
+
+    return file_bin_get_next_record(file);
+}
+
+int file_bin_index_save(const file_bin_t *file,
+                        const file_bin_index_t *index, const char *path)
+{
+    sb_t sb;
+    int res = 0;
+
+    sb_init(&sb);
+    sb_add(&sb, INDEX_SIG, HEADER_VERSION_SIZE);
+    sb_add_le32(&sb, file->slot_size);
+    sb_add_le32(&sb, index->stride);
+    sb_add_le64(&sb, index->nb_records);
+    sb_add_le64(&sb, index->end);
+    tab_for_each_entry(offset, &index->offsets) {
+        sb_add_le64(&sb, offset);
+    }
+
+    if (xwrite_file(path, sb.data, sb.len) < 0) {
+        res = logger_error(&_G.logger, "cannot write index '%s': %m", path);
+    }
+    sb_wipe(&sb);
+
+    return res;
+}
+
+int file_bin_index_load(const file_bin_t *file, const char *path,
+                        file_bin_index_t *index)
+{
+    lstr_t data;
+    pstream_t ps;
+    uint32_t slot_size;
+    uint32_t stride;
+    uint64_t end;
+    uint64_t nb_offsets;
+
+    if (lstr_init_from_file(&data, path, PROT_READ, MAP_SHARED) < 0) {
+        return logger_error(&_G.logger, "cannot read index '%s': %m", path);
+    }
+
+    ps = ps_initlstr(&data);
+    file_bin_index_init(index, 1);
+    if (ps_skipdata(&ps, INDEX_SIG, HEADER_VERSION_SIZE) < 0
+    ||  ps_get_le32(&ps, &slot_size) < 0
+    ||  ps_get_le32(&ps, &stride) < 0
+    ||  ps_get_le64(&ps, &index->nb_records) < 0
+    ||  ps_get_le64(&ps, &end) < 0)
+    {
+        logger_error(&_G.logger, "invalid index '%s'", path);
+        goto error;
+    }
+
+    /* Derive the number of offsets from the file size and check it against
+     * the header: a forged nb_records must not overflow nor drive the
+     * allocation. */
+    nb_offsets = ps_len(&ps) / sizeof(uint64_t);
+    if (stride == 0 || ps_len(&ps) % sizeof(uint64_t)
+    ||  nb_offsets != index->nb_records / stride
+                    + (index->nb_records % stride != 0))
+    {
+        logger_error(&_G.logger, "invalid index '%s'", path);
+        goto error;
+    }
+    if (slot_size != file->slot_size || end > (uint64_t)file->length) {
+        logger_error(&_G.logger, "index '%s' does not match file '%*pM'",
+                     path, LSTR_FMT_ARG(file->path));
+        goto error;
+    }
+
+    index->stride = stride;
+    index->end = end;
+    qv_grow(&index->offsets, nb_offsets);
+    while (!ps_done(&ps)) {
+        qv_append(&index->offsets, __ps_get_le64(&ps));
+    }
+    lstr_wipe(&data);
+
+    return 0;
+
+  error:
+    file_bin_index_wipe(index);
+    lstr_wipe(&data);
+    return -1;
+}
+
 /* }}} */
 /* {{{ Writing */
 
+static int file_bin_gc_wait_durable(file_bin_gc_t *gc);
+
 int file_bin_flush(file_bin_t *file)
 {
+    if (file->gc) {
+        return file_bin_gc_wait_durable(file->gc);
+    }
+
     if (fflush(file->f) < 0) {
         return logger_error(&_G.logger, "cannot flush file '%*pM': %m",
                             LSTR_FMT_ARG(file->path));
@@ -566,6 +854,12 @@ int file_bin_truncate(file_bin_t *file, off_t pos)
     }
 
     file->cur = MIN(file->cur, pos);
+    if (file->gc) {
+        /* The batch is empty as there are no concurrent writers. */
+        spin_lock(&file->gc->lock);
+        file->gc->buf_pos = file->cur;
+        spin_unlock(&file->gc->lock);
+    }
 
     RETHROW(file_bin_seek(file, file->cur, SEEK_SET));
 
@@ -574,8 +868,17 @@ int file_bin_truncate(file_bin_t *file, off_t pos)
 
 static int file_bin_pad(file_bin_t *file, off_t new_pos)
 {
-    off_t real_cur = ftell(file->f);
+    off_t real_cur;
 
+    if (file->gc) {
+        /* Called with the lock of the group commit held. */
+        real_cur = file->gc->buf_pos + file->gc->buf.len;
+        THROW_ERR_UNLESS(expect(real_cur <= new_pos));
+        sb_addnc(&file->gc->buf, new_pos - real_cur, '\0');
+        return 0;
+    }
+
+    real_cur = ftell(file->f);
     if (real_cur < 0) {
         return logger_error(&_G.logger, "cannot use ftell on file '%*pM': %m",
                             LSTR_FMT_ARG(file->path));
@@ -603,6 +906,12 @@ static int _write_file_bin(file_bin_t *file, const void *data, uint32_t len)
 
     RETHROW(file_bin_pad(file, file->cur));
 
+    if (file->gc) {
+        sb_add(&file->gc->buf, data, len);
+        file->cur += len;
+        return 0;
+    }
+
     res = fwrite(data, 1, len, file->f);
 
     if (res < len) {
@@ -665,7 +974,8 @@ static int file_bin_write_data(file_bin_t *f, const void *data, uint32_t len,
     return 0;
 }
 
-int file_bin_put_record(file_bin_t *file, const void *data, uint32_t len)
+static int file_bin_put_record_(file_bin_t *file, const void *data,
+                                uint32_t len)
 {
     rc_hdr_t rec_len_le32 = cpu_to_le32(len);
     uint32_t total_size = len + RC_HDR_SIZE;
@@ -693,6 +1003,231 @@ int file_bin_put_record(file_bin_t *file, const void *data, uint32_t len)
     return 0;
 }
 
+int file_bin_put_record(file_bin_t *file, const void *data, uint32_t len)
+{
+    if (file->gc) {
+        return file_bin_put_record_cb(file, data, len, NULL, (data_t){ });
+    }
+    return file_bin_put_record_(file, data, len);
+}
+
+/* }}} */
+/* {{{ Group commit */
+
+static void file_bin_gc_delete(file_bin_gc_t **gcp)
+{
+    file_bin_gc_t *gc = *gcp;
+
+    if (gc) {
+        sb_wipe(&gc->buf);
+        qv_wipe(&gc->cbs);
+        thr_ec_wipe(&gc->ec);
+        thr_ec_wipe(&gc->durable_ec);
+        p_delete(gcp);
+    }
+}
+
+static int file_bin_gc_write(file_bin_gc_t *gc, const sb_t *batch)
+{
+    int fd = fileno(gc->file->f);
+
+    /* The batches are contiguous and written in order: the offset of the
+     * descriptor is always the end of the previous one. */
+    if (xwrite(fd, batch->data, batch->len) < 0) {
+        return logger_error(&_G.logger, "cannot write in file '%*pM': %m",
+                            LSTR_FMT_ARG(gc->file->path));
+    }
+    if (gc->sync == FILE_BIN_GC_FDATASYNC && fdatasync(fd) < 0) {
+        return logger_error(&_G.logger, "cannot sync file '%*pM': %m",
+                            LSTR_FMT_ARG(gc->file->path));
+    }
+    return 0;
+}
+
+static void *file_bin_gc_thread(void *arg)
+{
+    file_bin_gc_t *gc = arg;
+    qv_t(file_bin_gc_cb) cbs;
+    sb_t batch;
+
+    sb_init(&batch);
+    qv_init(&cbs);
+
+    for (;;) {
+        uint64_t key = thr_ec_get(&gc->ec);
+        uint64_t seq;
+        size_t size;
+        bool stopping;
+        int res;
+
+        spin_lock(&gc->lock);
+        SWAP(sb_t, gc->buf, batch);
+        SWAP(qv_t(file_bin_gc_cb), gc->cbs, cbs);
+        gc->buf_pos += batch.len;
+        seq = gc->seq;
+        stopping = gc->stopping;
+        spin_unlock(&gc->lock);
+
+        size = batch.len;
+        if (!size) {
+            if (stopping) {
+                break;
+            }
+            thr_ec_timedwait(&gc->ec, key, 100);
+            continue;
+        }
+
+        res = atomic_load(&gc->err);
+        if (res >= 0) {
+            res = file_bin_gc_write(gc, &batch);
+            if (res < 0) {
+                atomic_store(&gc->err, res);
+            }
+        }
+        sb_reset(&batch);
+        tab_for_each_ptr(cb, &cbs) {
+            (*cb->cb)(res, cb->priv);
+        }
+        qv_clear(&cbs);
+
+        /* Flushes return once the callbacks of their records are called. */
+        atomic_fetch_sub(&gc->pending, size);
+        atomic_store(&gc->durable_seq, seq);
+        thr_ec_broadcast(&gc->durable_ec);
+    }
+
+    qv_wipe(&cbs);
+    sb_wipe(&batch);
+    return NULL;
+}
+
+static int file_bin_gc_wait_durable(file_bin_gc_t *gc)
+{
+    uint64_t seq;
+
+    /* The batch of the callback is only durable once it returns. */
+    assert (!pthread_equal(pthread_self(), gc->thread));
+
+    spin_lock(&gc->lock);
+    seq = gc->seq;
+    spin_unlock(&gc->lock);
+
+    while (atomic_load(&gc->durable_seq) < seq) {
+        uint64_t key = thr_ec_get(&gc->durable_ec);
+
+        if (atomic_load(&gc->durable_seq) >= seq) {
+            break;
+        }
+        thr_ec_timedwait(&gc->durable_ec, key, 10);
+    }
+
+    return atomic_load(&gc->err) < 0 ? -1 : 0;
+}
+
+static void file_bin_gc_wait_space(file_bin_gc_t *gc)
+{
+    assert (!pthread_equal(pthread_self(), gc->thread));
+
+    while (atomic_load(&gc->pending) >= gc->max_pending) {
+        uint64_t key = thr_ec_get(&gc->durable_ec);
+
+        if (atomic_load(&gc->pending) < gc->max_pending) {
+            break;
+        }
+        thr_ec_timedwait(&gc->durable_ec, key, 10);
+    }
+}
+
+int file_bin_put_record_cb(file_bin_t *file, const void *data, uint32_t len,
+                           file_bin_gc_cb_f *cb, data_t priv)
+{
+    file_bin_gc_t *gc = file->gc;
+    size_t orig_len;
+    int res;
+
+    assert (gc);
+    if (gc->max_pending) {
+        file_bin_gc_wait_space(gc);
+    }
+
+    /* The error was logged by the writer thread. */
+    THROW_ERR_IF(atomic_load(&gc->err) < 0);
+
+    spin_lock(&gc->lock);
+    orig_len = gc->buf.len;
+    res = file_bin_put_record_(file, data, len);
+    if (res >= 0) {
+        gc->seq++;
+        if (cb) {
+            qv_append(&gc->cbs, ((file_bin_gc_cb_t){ .cb = cb,
+                                                     .priv = priv }));
+        }
+    }
+    atomic_fetch_add(&gc->pending, gc->buf.len - orig_len);
+    spin_unlock(&gc->lock);
+
+    if (!orig_len) {
+        thr_ec_signal(&gc->ec);
+    }
+    return res;
+}
+
+int file_bin_start_group_commit(file_bin_t *file, file_bin_gc_sync_t sync,
+                                size_t max_pending)
+{
+    file_bin_gc_t *gc;
+    off_t pos;
+
+    assert (!file->read_mode && !file->gc);
+
+    RETHROW(file_bin_flush(file));
+    pos = RETHROW(file_bin_tell(file));
+
+    gc = p_new(file_bin_gc_t, 1);
+    gc->file = file;
+    gc->sync = sync;
+    gc->max_pending = max_pending;
+    gc->buf_pos = pos;
+    sb_init(&gc->buf);
+    qv_init(&gc->cbs);
+    thr_ec_init(&gc->ec);
+    thr_ec_init(&gc->durable_ec);
+
+    if (pthread_create(&gc->thread, NULL, &file_bin_gc_thread, gc)) {
+        file_bin_gc_delete(&gc);
+        return logger_error(&_G.logger, "cannot start the writer thread of "
+                            "file '%*pM': %m", LSTR_FMT_ARG(file->path));
+    }
+    file->gc = gc;
+
+    return 0;
+}
+
+int file_bin_stop_group_commit(file_bin_t *file)
+{
+    file_bin_gc_t *gc = file->gc;
+    int res;
+
+    if (!gc) {
+        return 0;
+    }
+
+    spin_lock(&gc->lock);
+    gc->stopping = true;
+    spin_unlock(&gc->lock);
+    thr_ec_signal(&gc->ec);
+    pthread_join(gc->thread, NULL);
+
+    res = atomic_load(&gc->err) < 0 ? -1 : 0;
+    file->gc = NULL;
+    file_bin_gc_delete(&gc);
+
+    /* The stream did not see the writes done on the descriptor. */
+    RETHROW(file_bin_seek(file, 0, SEEK_END));
+
+    return res;
+}
+
 file_bin_t *file_bin_create(lstr_t path, uint32_t slot_size, bool trunc)
 {
     file_bin_t *res;
@@ -775,6 +1310,13 @@ int file_bin_close(file_bin_t **file_ptr)
         return 0;
     }
 
+    if (file_bin_stop_group_commit(file) < 0) {
+        res = -1;
+    }
+
+    if (file->compressed) {
+        p_delete(&file->map);
+    } else
     if (file->map) {
         if (munmap(file->map, file->length) < 0) {
             res = logger_error(&_G.logger, "cannot unmap file '%*pM': %m",
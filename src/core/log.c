@@ -48,6 +48,21 @@ typedef struct buffer_instance_t {
 
 qvector_t(buffer_instance, buffer_instance_t);
 
+typedef struct log_async_msg_t {
+    uint32_t len;
+    char data[];
+} log_async_msg_t;
+spsc_queue_ptr_t(log_async, log_async_msg_t);
+
+/* Messages pushed by a thread for the logging thread. The queue is released
+ * by the logging thread once the thread exited and the queue is empty.
+ */
+typedef struct log_async_queue_t {
+    spsc_t(log_async) q;
+    dlist_t link;
+    atomic_bool dead;
+} log_async_queue_t;
+
 #ifndef NDEBUG
 #define LOG_DEFAULT  LOG_TRACE
 #else
@@ -76,6 +91,23 @@ static struct {
     spinlock_t update_lock;
 
     bool log_timestamp : 1;
+
+    struct {
+        atomic_bool enabled;
+        atomic_bool stopping;
+        log_async_policy_t policy;
+        size_t max_pending;
+        atomic_size_t pending;
+        atomic_uint dropped;
+        /* threads between their check of enabled and their push */
+        atomic_uint producers;
+
+        spinlock_t lock;
+        dlist_t queues;
+        thr_evc_t ec;
+        thr_evc_t space_ec;
+        pthread_t thread;
+    } async;
 } log_g = {
 #define _G  log_g
     .root_logger = {
@@ -90,6 +122,7 @@ static struct {
     },
     .pending_levels = QM_INIT(level, _G.pending_levels),
     .handler        = &log_stderr_raw_handler,
+    .async.queues   = DLIST_INIT(_G.async.queues),
 };
 
 static __thread struct {
@@ -105,6 +138,10 @@ static __thread struct {
     qv_t(buffer_instance) vec_buff_stack;
     mem_stack_pool_t mp_stack;
     int nb_buffer_started;
+
+    /* asynchronous writes */
+    log_async_queue_t *async_q;
+    bool async_writer;
 } log_thr_g;
 
 __thread log_thr_ml_t log_thr_ml_g;
@@ -791,6 +828,228 @@ void __logger_end_fatal(void)
     logger_do_fatal();
 }
 
+/* }}} */
+/* Asynchronous writes {{{ */
+
+static log_async_queue_t *log_async_get_queue(void)
+{
+    log_async_queue_t *q = log_thr_g.async_q;
+
+    if (unlikely(!q)) {
+        q = p_new(log_async_queue_t, 1);
+        spsc_init(log_async, &q->q);
+        spin_lock(&_G.async.lock);
+        dlist_add_tail(&_G.async.queues, &q->link);
+        spin_unlock(&_G.async.lock);
+        log_thr_g.async_q = q;
+    }
+    return q;
+}
+
+static void log_async_queue_delete(log_async_queue_t **qp)
+{
+    log_async_queue_t *q = *qp;
+    log_async_msg_t *msg;
+
+    while ((msg = spsc_pop2(log_async, &q->q))) {
+        p_delete(&msg);
+    }
+    dlist_remove(&q->link);
+    spsc_wipe(log_async, &q->q);
+    p_delete(qp);
+}
+
+/* Gather the pending messages of all the threads in sb, and release the
+ * queues of the exited threads. Returns the amount of memory released.
+ */
+static size_t log_async_drain(sb_t *sb)
+{
+    size_t size = 0;
+
+    spin_lock(&_G.async.lock);
+    dlist_for_each_entry(log_async_queue_t, q, &_G.async.queues, link) {
+        bool dead = atomic_load(&q->dead);
+        log_async_msg_t *msg;
+
+        while ((msg = spsc_pop2(log_async, &q->q))) {
+            sb_add(sb, msg->data, msg->len);
+            size += sizeof(*msg) + msg->len;
+            p_delete(&msg);
+        }
+        if (dead) {
+            log_async_queue_delete(&q);
+        }
+    }
+    spin_unlock(&_G.async.lock);
+    return size;
+}
+
+static void log_async_write(sb_t *sb)
+{
+    fputs(sb->data, stderr);
+    if (log_stderr_handler_teefd_g >= 0) {
+        IGNORE(xwrite(log_stderr_handler_teefd_g, sb->data, sb->len));
+    }
+    sb_reset(sb);
+}
+
+static void *log_async_thread(void *arg)
+{
+    sb_t sb;
+
+    /* Whatever the logging thread logs is written synchronously. */
+    log_thr_g.async_writer = true;
+    sb_init(&sb);
+
+    for (;;) {
+        uint64_t key = thr_ec_get(&_G.async.ec);
+        bool stopping = atomic_load(&_G.async.stopping);
+        size_t size = log_async_drain(&sb);
+        unsigned dropped;
+
+        if (sb.len) {
+            log_async_write(&sb);
+            atomic_fetch_sub(&_G.async.pending, size);
+            thr_ec_broadcast_relaxed(&_G.async.space_ec);
+        }
+        dropped = atomic_exchange(&_G.async.dropped, 0);
+        if (dropped) {
+            e_warning("log: %u messages dropped, the log queues were full",
+                      dropped);
+        }
+        if (size) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        thr_ec_timedwait(&_G.async.ec, key, 100);
+    }
+
+    sb_wipe(&sb);
+    return NULL;
+}
+
+/* Wait (for a while) for the logging thread to write everything. */
+static void log_async_wait_flushed(void)
+{
+    for (int i = 0; i < 100; i++) {
+        uint64_t key = thr_ec_get(&_G.async.space_ec);
+
+        if (!atomic_load(&_G.async.pending)) {
+            return;
+        }
+        thr_ec_timedwait(&_G.async.space_ec, key, 10);
+    }
+}
+
+/* Returns false when the message must be written synchronously. */
+static bool log_async_push(const log_ctx_t *ctx, const sb_t *sb)
+{
+    log_async_msg_t *msg;
+    size_t size = sizeof(*msg) + sb->len;
+
+    if (log_thr_g.async_writer) {
+        return false;
+    }
+    if (ctx->level <= LOG_CRIT) {
+        log_async_wait_flushed();
+        return false;
+    }
+
+    for (;;) {
+        size_t pending = atomic_load_explicit(&_G.async.pending,
+                                              memory_order_relaxed);
+        uint64_t key;
+
+        if (!pending || pending + size <= _G.async.max_pending) {
+            break;
+        }
+        if (_G.async.policy == LOG_ASYNC_DROP) {
+            atomic_fetch_add_explicit(&_G.async.dropped, 1,
+                                      memory_order_relaxed);
+            return true;
+        }
+        key = thr_ec_get(&_G.async.space_ec);
+        if (!atomic_load(&_G.async.enabled)) {
+            return false;
+        }
+        thr_ec_timedwait(&_G.async.space_ec, key, 10);
+    }
+
+    msg = p_new_extra_raw(log_async_msg_t, sb->len);
+    msg->len = sb->len;
+    memcpy(msg->data, sb->data, sb->len);
+    atomic_fetch_add(&_G.async.pending, size);
+    spsc_push(log_async, &log_async_get_queue()->q, msg);
+    thr_ec_signal_relaxed(&_G.async.ec);
+    return true;
+}
+
+/* Common tail of the stderr handlers. */
+static void log_stderr_write(const log_ctx_t *ctx, sb_t *sb)
+{
+    bool pushed = false;
+
+    if (atomic_load_explicit(&_G.async.enabled, memory_order_relaxed)) {
+        /* Register as a producer before checking enabled again, so that
+         * log_stop_async() either sees us or we see it disabled. */
+        atomic_fetch_add(&_G.async.producers, 1);
+        if (atomic_load(&_G.async.enabled)) {
+            pushed = log_async_push(ctx, sb);
+        }
+        atomic_fetch_sub(&_G.async.producers, 1);
+    }
+    if (!pushed) {
+        fputs(sb->data, stderr);
+        if (log_stderr_handler_teefd_g >= 0) {
+            IGNORE(xwrite(log_stderr_handler_teefd_g, sb->data, sb->len));
+        }
+    }
+    sb_reset(sb);
+}
+
+int log_start_async(size_t max_pending, log_async_policy_t policy)
+{
+    log_stop_async();
+
+    _G.async.max_pending = max_pending;
+    _G.async.policy = policy;
+    atomic_store(&_G.async.stopping, false);
+    if (pthread_create(&_G.async.thread, NULL, &log_async_thread, NULL)) {
+        return -1;
+    }
+    atomic_store(&_G.async.enabled, true);
+    return 0;
+}
+
+void log_stop_async(void)
+{
+    SB_8k(sb);
+
+    if (!atomic_exchange(&_G.async.enabled, false)) {
+        return;
+    }
+
+    /* Wait for the threads that are pushing a message, the blocked ones
+     * give up as soon as they are woken up. */
+    while (atomic_load(&_G.async.producers)) {
+        thr_ec_broadcast(&_G.async.space_ec);
+        sched_yield();
+    }
+
+    atomic_store(&_G.async.stopping, true);
+    thr_ec_signal(&_G.async.ec);
+    pthread_join(_G.async.thread, NULL);
+
+    /* Catch the messages pushed while the logging thread was stopping. */
+    atomic_fetch_sub(&_G.async.pending, log_async_drain(&sb));
+    if (sb.len) {
+        log_async_write(&sb);
+    }
+    thr_ec_broadcast(&_G.async.space_ec);
+}
+
 /* }}} */
 /* Handlers {{{ */
 
@@ -826,7 +1085,7 @@ static void log_add_timestamp(sb_t *sb)
         struct timeval tv;
 
         lp_gettv(&tv);
-        sb_addf(sb, "%ld.%02ld ", tv.tv_sec, (long)tv.tv_usec / 10000);
+        sb_addf_lit(sb, "%ld.%02ld ", tv.tv_sec, (long)tv.tv_usec / 10000);
     }
 }
 
@@ -888,8 +1147,8 @@ static void log_stderr_fancy_handler(const log_ctx_t *ctx, const char *fmt,
         }
     }
     if (ctx->logger_name.len) {
-        sb_addf(sb, TERM_COLOR_SET(LOG_COLOR_LOGGER_NAME) "{%*pM} ",
-                LSTR_FMT_ARG(ctx->logger_name));
+        sb_addf_lit(sb, TERM_COLOR_SET(LOG_COLOR_LOGGER_NAME) "{%*pM} ",
+                    LSTR_FMT_ARG(ctx->logger_name));
     }
     switch (ctx->level) {
       case LOG_DEBUG:
@@ -914,11 +1173,7 @@ static void log_stderr_fancy_handler(const log_ctx_t *ctx, const char *fmt,
     sb_addvf(sb, fmt, va);
     sb_adds(sb, TERM_COLOR_RESET "\n");
 
-    fputs(sb->data, stderr);
-    if (log_stderr_handler_teefd_g >= 0) {
-        IGNORE(xwrite(log_stderr_handler_teefd_g, sb->data, sb->len));
-    }
-    sb_reset(sb);
+    log_stderr_write(ctx, sb);
 }
 
 static void log_initialize_thread(void);
@@ -948,23 +1203,19 @@ static void log_stderr_raw_handler(const log_ctx_t *ctx, const char *fmt,
     }
 
     log_add_timestamp(sb);
-    sb_addf(sb, "%s[%d]: ", ctx->prog_name, ctx->pid);
+    sb_addf_lit(sb, "%s[%d]: ", ctx->prog_name, ctx->pid);
     if (ctx->level >= LOG_TRACE && ctx->func) {
-        sb_addf(sb, "%s:%d:%s: ", ctx->file, ctx->line, ctx->func);
+        sb_addf_lit(sb, "%s:%d:%s: ", ctx->file, ctx->line, ctx->func);
     } else {
         sb_adds(sb, prefixes[MIN(LOG_TRACE, ctx->level)]);
     }
     if (ctx->logger_name.len) {
-        sb_addf(sb, "{%*pM} ", LSTR_FMT_ARG(ctx->logger_name));
+        sb_addf_lit(sb, "{%*pM} ", LSTR_FMT_ARG(ctx->logger_name));
     }
     sb_addvf(sb, fmt, va);
     sb_addc(sb, '\n');
 
-    fputs(sb->data, stderr);
-    if (log_stderr_handler_teefd_g >= 0) {
-        IGNORE(xwrite(log_stderr_handler_teefd_g, sb->data, sb->len));
-    }
-    sb_reset(sb);
+    log_stderr_write(ctx, sb);
 }
 
 log_handler_f *log_set_handler(log_handler_f *handler)
@@ -1138,12 +1389,22 @@ static void log_shutdown_thread(void)
 
         log_thr_g.inited = false;
     }
+    if (log_thr_g.async_q) {
+        atomic_store(&log_thr_g.async_q->dead, true);
+        log_thr_g.async_q = NULL;
+    }
 }
 thr_hooks(log_initialize_thread, log_shutdown_thread);
 
 static void log_atfork(void)
 {
     _G.pid = getpid();
+
+    /* The logging thread does not survive the fork. */
+    atomic_store(&_G.async.enabled, false);
+    atomic_store(&_G.async.pending, 0);
+    atomic_store(&_G.async.producers, 0);
+    _G.async.lock = 0;
 }
 
 /** Parse the content of the IS_DEBUG environment variable.
@@ -1217,6 +1478,8 @@ static int log_initialize(void* args)
     char *env;
 
     qv_init(&_G.specs);
+    thr_ec_init(&_G.async.ec);
+    thr_ec_init(&_G.async.space_ec);
     _G.fancy = is_fancy_fd(STDERR_FILENO);
     _G.pid   = getpid();
     log_stderr_handler_g = &log_stderr_raw_handler;
@@ -1252,6 +1515,9 @@ static int log_initialize(void* args)
 
 static int log_shutdown(void)
 {
+    log_stop_async();
+    thr_ec_wipe(&_G.async.ec);
+    thr_ec_wipe(&_G.async.space_ec);
     logger_wipe(&_G.root_logger);
     qm_deep_wipe(level, &_G.pending_levels, lstr_wipe, IGNORE);
     qv_wipe(&_G.specs);
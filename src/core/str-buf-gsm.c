@@ -551,12 +551,25 @@ int sb_conv_from_gsm_hex(sb_t *sb, const void *data, int slen)
 int sb_conv_from_gsm_plan(sb_t *sb, const void *data, int slen, int plan)
 {
     const byte *p = data, *end = p + slen;
+    bool try_simd = plan != GSM_CIMD_PLAN;
     int nb_invalid = 0;
 
     sb_grow(sb, slen + 4);
 
     while (p < end) {
-        int c = *p++;
+        int c;
+
+        if (try_simd) {
+            size_t n = __gsm7_ascii_span((const char *)p, end - p);
+
+            if (n) {
+                sb_add(sb, p, n);
+                p += n;
+                try_simd = false;
+                continue;
+            }
+        }
+        c = *p++;
 
         if (plan == GSM_CIMD_PLAN) {
             if (c == '_') {
@@ -572,6 +585,7 @@ int sb_conv_from_gsm_plan(sb_t *sb, const void *data, int slen, int plan)
         if (c & 0x80)
             goto invalid;
 
+        try_simd = true;
         if (c == 0x1b) {
             if (unlikely(plan != GSM_EXTENSION_PLAN))
                 goto invalid;
@@ -604,12 +618,21 @@ int gsm7_charlen(int c)
 bool sb_conv_to_gsm_isok(const void *data, int len, gsm_conv_plan_t plan)
 {
     const char *p = data, *end = p + len;
+    bool try_simd = true;
 
     assert (plan != GSM_CIMD_PLAN);
 
     while (p < end) {
-        int c = (unsigned char)*p++;
+        int c;
+
+        if (try_simd) {
+            p += __gsm7_ascii_span(p, end - p);
+            try_simd = false;
+            continue;
+        }
 
+        c = (unsigned char)*p++;
+        try_simd = c < 0x80;
         if (c & 0x80) {
             int u = utf8_ngetc(p - 1, end - p + 1, &p);
             if (u >= 0)
@@ -630,11 +653,25 @@ bool sb_conv_to_gsm_isok(const void *data, int len, gsm_conv_plan_t plan)
 void sb_conv_to_gsm(sb_t *sb, const void *data, int len)
 {
     const char *p = data, *end = p + len;
+    bool try_simd = true;
 
     sb_grow(sb, 2 * len + 2);
     while (p < end) {
-        int c = (unsigned char)*p++;
+        int c;
+
+        if (try_simd) {
+            size_t n = __gsm7_ascii_span(p, end - p);
+
+            if (n) {
+                sb_add(sb, p, n);
+                p += n;
+                try_simd = false;
+                continue;
+            }
+        }
 
+        c = (unsigned char)*p++;
+        try_simd = c < 0x80;
         if (c & 0x80) {
             int u = utf8_ngetc(p - 1, end - p + 1, &p);
             if (u >= 0)
@@ -652,11 +689,25 @@ void sb_conv_to_gsm(sb_t *sb, const void *data, int len)
 void sb_conv_to_gsm_hex(sb_t *sb, const void *data, int len)
 {
     const char *p = data, *end = p + len;
+    bool try_simd = true;
 
     sb_grow(sb, 4 * len + 4);
     while (p < end) {
-        int c = (unsigned char)*p++;
+        int c;
+
+        if (try_simd) {
+            size_t n = __gsm7_ascii_span(p, end - p);
 
+            if (n) {
+                sb_add_hex(sb, p, n);
+                p += n;
+                try_simd = false;
+                continue;
+            }
+        }
+
+        c = (unsigned char)*p++;
+        try_simd = c < 0x80;
         if (c & 0x80) {
             int u = utf8_ngetc(p - 1, end - p + 1, &p);
             if (u >= 0)
@@ -698,6 +749,62 @@ static uint64_t get_gsm7_pack(const void *src, int len)
     return pack;
 }
 
+/*
+ * Runs of 8 characters encoded the same way in ASCII and in the default
+ * alphabet (\n, \r, space to ?, but $, A to Z and a to z) are packed and
+ * unpacked at once: the 8 characters are the 8 bytes of a 64 bits word, least
+ * significant first, like the septets of a pack.
+ */
+static ALWAYS_INLINE bool gsm7_is_ascii(uint8_t c)
+{
+    static uint64_t const ascii[2] = {
+        0xffffffef00002400, 0x07fffffe07fffffe,
+    };
+
+    return c < 0x80 && ((ascii[c >> 6] >> (c & 0x3f)) & 1);
+}
+
+static bool gsm7_get_ascii8(const char *s, uint64_t *chars)
+{
+    uint64_t res = 0;
+
+    /* s is NUL terminated, and NUL is not in the set */
+    for (int i = 0; i < 8; i++) {
+        if (!gsm7_is_ascii(s[i])) {
+            return false;
+        }
+        res |= (uint64_t)(uint8_t)s[i] << (8 * i);
+    }
+    *chars = res;
+    return true;
+}
+
+static bool gsm7_is_ascii8(uint64_t chars)
+{
+    for (int i = 0; i < 8; i++) {
+        if (!gsm7_is_ascii(chars >> (8 * i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t gsm7_pack8(uint64_t x)
+{
+    x = ((x & 0x7f007f007f007f00) >> 1) | (x & 0x007f007f007f007f);
+    x = ((x & 0x3fff00003fff0000) >> 2) | (x & 0x00003fff00003fff);
+    x = ((x & 0x0fffffff00000000) >> 4) | (x & 0x000000000fffffff);
+    return x;
+}
+
+static uint64_t gsm7_unpack8(uint64_t x)
+{
+    x = ((x & 0x00fffffff0000000) << 4) | (x & 0x000000000fffffff);
+    x = ((x & 0x0fffc0000fffc000) << 2) | (x & 0x00003fff00003fff);
+    x = ((x & 0x3f803f803f803f80) << 1) | (x & 0x007f007f007f007f);
+    return x;
+}
+
 /*
  * gsm_start points to the first octet of out->data holding 7-bits packed GSM
  * data. sb_conv_to_gsm7 is not able to be restartable, it assumes the
@@ -730,8 +837,20 @@ int sb_conv_to_gsm7(sb_t *out, int gsm_start, const char *utf8, int unknown,
     }
 
     for (;;) {
-        int c = utf8_getc(utf8, &utf8);
+        uint64_t chars;
+        int c;
 
+        if (septet == 0 && gsm7_get_ascii8(utf8, &chars)) {
+            current_len += 7;
+            if (max_len >= 0 && current_len > max_len) {
+                return -1;
+            }
+            put_gsm_pack(out, gsm7_pack8(chars), 7);
+            utf8 += 8;
+            continue;
+        }
+
+        c = utf8_getc(utf8, &utf8);
         if (c <= 0) {
             int len = 8 * (out->len - gsm_start) / 7;
 
@@ -824,7 +943,14 @@ int sb_conv_from_gsm7(sb_t *out, const void *_src, int gsmlen, int udhlen)
     }
 
     for (; gsmlen >= 8; src += 7, gsmlen -= 8) {
-        c = decode_gsm7_pack(out, get_gsm7_pack(src, 7), 8, c);
+        uint64_t pack = get_gsm7_pack(src, 7);
+        uint64_t chars = gsm7_unpack8(pack);
+
+        if (c == 0 && gsm7_is_ascii8(chars)) {
+            put_gsm_pack(out, chars, 8);
+        } else {
+            c = decode_gsm7_pack(out, pack, 8, c);
+        }
     }
     if (gsmlen) {
         c = decode_gsm7_pack(out, get_gsm7_pack(src, gsmlen), gsmlen, c);
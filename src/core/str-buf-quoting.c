@@ -111,6 +111,684 @@ static int test_xml_printable(int x) {
 #undef QP
 #undef XP
 
+/* {{{ Vectorized loops */
+
+/* The hot loops of the base64, hex, URL, XML and CSV functions have SSSE3
+ * and AVX2 variants, selected at runtime. They only process whole blocks of
+ * their input and return how much they did, the scalar loops below finish
+ * the job: the output does not depend on the variant.
+ */
+typedef struct sb_quoting_impl_t {
+    /* Encode up to nb_packs packs of 3 bytes, and leave at least one of
+     * them to the caller. Returns the number of packs encoded. */
+    int (*b64_encode)(char *dst, const byte *src, int nb_packs,
+                      const char table[64]);
+
+    /* Decode the blocks of base64 characters (without any space or padding)
+     * at the start of src. Returns the number of characters decoded, a
+     * multiple of 4, and may write up to 8 bytes past the decoded data. */
+    int (*b64_decode)(char *dst, const byte *src, int len, bool url);
+
+    /* Returns the number of bytes encoded, or of characters decoded. The
+     * decoding stops at the first block with an invalid character. */
+    int (*hex_encode)(char *dst, const byte *src, int len);
+    int (*hex_decode)(char *dst, const byte *src, int len);
+
+    /* Returns the length of the span of characters without any character
+     * to escape at the start of src; the scalar loops go on from there. */
+    int (*url_span)(const byte *src, int len);
+    int (*xml_span)(const byte *src, int len);
+    int (*csv_span)(const byte *src, int len, int sep);
+} sb_quoting_impl_t;
+
+static int b64_encode_naive(char *dst, const byte *src, int nb_packs,
+                            const char table[64])
+{
+    return 0;
+}
+
+static int b64_decode_naive(char *dst, const byte *src, int len, bool url)
+{
+    return 0;
+}
+
+static int hex_naive(char *dst, const byte *src, int len)
+{
+    return 0;
+}
+
+static int span_naive(const byte *src, int len)
+{
+    return 0;
+}
+
+static int csv_span_naive(const byte *src, int len, int sep)
+{
+    return 0;
+}
+
+static sb_quoting_impl_t const sb_quoting_naive = {
+    .b64_encode = &b64_encode_naive,
+    .b64_decode = &b64_decode_naive,
+    .hex_encode = &hex_naive,
+    .hex_decode = &hex_naive,
+    .url_span   = &span_naive,
+    .xml_span   = &span_naive,
+    .csv_span   = &csv_span_naive,
+};
+
+/* Intrinsics of instruction sets that are not enabled for the whole file
+ * need GCC 4.9. */
+#if defined(__HAS_CPUID) && (__GNUC_PREREQ(4, 9) || __CLANG_PREREQ(3, 8))
+#define SB_QUOTING_HAS_SIMD
+
+#pragma push_macro("__leaf")
+#undef __leaf
+#include <cpuid.h>
+#include <x86intrin.h>
+#pragma pop_macro("__leaf")
+
+/* {{{ SSSE3 */
+
+/* Byte ranges checks work on signed bytes: bytes >= 0x80 are never in the
+ * ASCII ranges. */
+#define SSE_IN_RANGE(c, lo, hi)                                              \
+    _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8((lo) - 1)),                \
+                  _mm_cmpgt_epi8(_mm_set1_epi8((hi) + 1), c))
+
+/* Split 4 packs of 3 bytes into 16 indexes of 6 bits, see
+ * http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html */
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE __m128i b64_ssse3_unpack(__m128i in)
+{
+    __m128i t0, t1;
+
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                            7, 6, 8, 7, 10, 9, 11, 10));
+    t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    t0 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    t1 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    t1 = _mm_mullo_epi16(t1, _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t0, t1);
+}
+
+/* Offsets from the indexes to the characters: 0 for 26..51, 1 to 10 for
+ * 52..61, 11 and 12 for 62 and 63, 13 for 0..25. */
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE __m128i b64_ssse3_offsets(const char table[64])
+{
+    return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                         '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                         '0' - 52, table[62] - 62, table[63] - 63, 'A', 0, 0);
+}
+
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE __m128i b64_ssse3_lookup(__m128i idx, __m128i offsets)
+{
+    __m128i res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+
+    res = _mm_or_si128(res, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, res), idx);
+}
+
+__attribute__((target("ssse3")))
+static int b64_encode_ssse3(char *dst, const byte *src, int nb_packs,
+                            const char table[64])
+{
+    __m128i offsets = b64_ssse3_offsets(table);
+    int done = 0;
+
+    /* 16 bytes are loaded for 4 packs */
+    for (; done + 6 <= nb_packs; done += 4) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + 3 * done));
+
+        in = b64_ssse3_unpack(in);
+        _mm_storeu_si128((__m128i *)(dst + 4 * done),
+                         b64_ssse3_lookup(in, offsets));
+    }
+    return done;
+}
+
+/* Translate base64 characters to their values, returns false if there is
+ * another character in the block. */
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE bool b64_ssse3_values(__m128i *c, bool url)
+{
+    int c62 = url ? '-' : '+';
+    int c63 = url ? '_' : '/';
+    __m128i upper = SSE_IN_RANGE(*c, 'A', 'Z');
+    __m128i lower = SSE_IN_RANGE(*c, 'a', 'z');
+    __m128i digit = SSE_IN_RANGE(*c, '0', '9');
+    __m128i is62 = _mm_cmpeq_epi8(*c, _mm_set1_epi8(c62));
+    __m128i is63 = _mm_cmpeq_epi8(*c, _mm_set1_epi8(c63));
+    __m128i valid, delta;
+
+    valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                         _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+        return false;
+    }
+
+    delta = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    delta = _mm_or_si128(delta, _mm_and_si128(lower,
+                                              _mm_set1_epi8(26 - 'a')));
+    delta = _mm_or_si128(delta, _mm_and_si128(digit,
+                                              _mm_set1_epi8(52 - '0')));
+    delta = _mm_or_si128(delta, _mm_and_si128(is62,
+                                              _mm_set1_epi8(62 - c62)));
+    delta = _mm_or_si128(delta, _mm_and_si128(is63,
+                                              _mm_set1_epi8(63 - c63)));
+    *c = _mm_add_epi8(*c, delta);
+    return true;
+}
+
+/* Pack 16 values of 6 bits into 12 bytes at the start of the block. */
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE __m128i b64_ssse3_pack(__m128i values)
+{
+    values = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    values = _mm_madd_epi16(values, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(values, _mm_setr_epi8(2, 1, 0, 6, 5, 4,
+                                                  10, 9, 8, 14, 13, 12,
+                                                  -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3")))
+static int b64_decode_ssse3(char *dst, const byte *src, int len, bool url)
+{
+    int done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + done));
+
+        if (!b64_ssse3_values(&c, url)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + done / 4 * 3),
+                         b64_ssse3_pack(c));
+    }
+    return done;
+}
+
+__attribute__((target("ssse3")))
+static int hex_encode_ssse3(char *dst, const byte *src, int len)
+{
+    const __m128i digits = _mm_loadu_si128((const __m128i *)
+                                           __str_digits_upper);
+    const __m128i lo_4bits = _mm_set1_epi8(0x0f);
+    int done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + done));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), lo_4bits);
+        __m128i lo = _mm_and_si128(in, lo_4bits);
+
+        hi = _mm_shuffle_epi8(digits, hi);
+        lo = _mm_shuffle_epi8(digits, lo);
+        _mm_storeu_si128((__m128i *)(dst + 2 * done),
+                         _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(dst + 2 * done + 16),
+                         _mm_unpackhi_epi8(hi, lo));
+    }
+    return done;
+}
+
+/* Translate hex digits to their values in 16 bits words made of two
+ * digits, returns false if there is another character in the block. */
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE bool hex_ssse3_values(__m128i *c)
+{
+    __m128i lower = _mm_or_si128(*c, _mm_set1_epi8(0x20));
+    __m128i digit = SSE_IN_RANGE(*c, '0', '9');
+    __m128i alpha = SSE_IN_RANGE(lower, 'a', 'f');
+
+    if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) {
+        return false;
+    }
+    *c = _mm_or_si128(_mm_and_si128(digit,
+                                    _mm_sub_epi8(*c, _mm_set1_epi8('0'))),
+                      _mm_and_si128(alpha,
+                                    _mm_sub_epi8(lower,
+                                                 _mm_set1_epi8('a' - 10))));
+    *c = _mm_maddubs_epi16(*c, _mm_set1_epi16(0x0110));
+    return true;
+}
+
+__attribute__((target("ssse3")))
+static int hex_decode_ssse3(char *dst, const byte *src, int len)
+{
+    int done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m128i c0 = _mm_loadu_si128((const __m128i *)(src + done));
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(src + done + 16));
+
+        if (!hex_ssse3_values(&c0) || !hex_ssse3_values(&c1)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + done / 2),
+                         _mm_packus_epi16(c0, c1));
+    }
+    return done;
+}
+
+/* Returns the length of the span at the start of a block, given the mask of
+ * the characters it is made of. */
+#define SSE_SPAN_END(done, mask)                                             \
+    if ((mask) != 0xffff) {                                                  \
+        return (done) + __builtin_ctz(~(mask));                              \
+    }
+
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE unsigned url_ssse3_mask(__m128i c)
+{
+    __m128i ok;
+
+    ok = _mm_or_si128(SSE_IN_RANGE(c, '-', '9'), SSE_IN_RANGE(c, 'A', 'Z'));
+    ok = _mm_or_si128(ok, SSE_IN_RANGE(c, 'a', 'z'));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+    return _mm_movemask_epi8(ok);
+}
+
+__attribute__((target("ssse3")))
+static int url_span_ssse3(const byte *src, int len)
+{
+    int done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + done));
+        unsigned mask = url_ssse3_mask(c);
+
+        SSE_SPAN_END(done, mask);
+    }
+    return done;
+}
+
+/* XML: control characters but \t \n \r, and "&'<> are escaped */
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE unsigned xml_ssse3_mask(__m128i c)
+{
+    __m128i esc = SSE_IN_RANGE(c, 0x00, 0x1f);
+
+    esc = _mm_andnot_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\t')), esc);
+    esc = _mm_andnot_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')), esc);
+    esc = _mm_andnot_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\r')), esc);
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('"')));
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('&')));
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('\'')));
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('<')));
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('>')));
+    return ~_mm_movemask_epi8(esc) & 0xffff;
+}
+
+__attribute__((target("ssse3")))
+static int xml_span_ssse3(const byte *src, int len)
+{
+    int done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + done));
+        unsigned mask = xml_ssse3_mask(c);
+
+        SSE_SPAN_END(done, mask);
+    }
+    return done;
+}
+
+__attribute__((target("ssse3")))
+static ALWAYS_INLINE unsigned csv_ssse3_mask(__m128i c, int sep)
+{
+    __m128i esc = _mm_cmpeq_epi8(c, _mm_set1_epi8('"'));
+
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('\n')));
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8('\r')));
+    esc = _mm_or_si128(esc, _mm_cmpeq_epi8(c, _mm_set1_epi8(sep)));
+    return ~_mm_movemask_epi8(esc) & 0xffff;
+}
+
+__attribute__((target("ssse3")))
+static int csv_span_ssse3(const byte *src, int len, int sep)
+{
+    int done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + done));
+        unsigned mask = csv_ssse3_mask(c, sep);
+
+        SSE_SPAN_END(done, mask);
+    }
+    return done;
+}
+
+static sb_quoting_impl_t const sb_quoting_ssse3 = {
+    .b64_encode = &b64_encode_ssse3,
+    .b64_decode = &b64_decode_ssse3,
+    .hex_encode = &hex_encode_ssse3,
+    .hex_decode = &hex_decode_ssse3,
+    .url_span   = &url_span_ssse3,
+    .xml_span   = &xml_span_ssse3,
+    .csv_span   = &csv_span_ssse3,
+};
+
+/* }}} */
+/* {{{ AVX2 */
+
+/* The AVX2 variants do the same as the SSSE3 ones on two lanes, and leave
+ * the last blocks to them. */
+
+#define AVX_IN_RANGE(c, lo, hi)                                              \
+    _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8((lo) - 1)),       \
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), c))
+
+#define AVX_SPAN_END(done, mask)                                             \
+    if ((mask) != 0xffffffff) {                                              \
+        return (done) + __builtin_ctz(~(mask));                              \
+    }
+
+__attribute__((target("avx2")))
+static int b64_encode_avx2(char *dst, const byte *src, int nb_packs,
+                           const char table[64])
+{
+    __m256i offsets = _mm256_broadcastsi128_si256(b64_ssse3_offsets(table));
+    int done = 0;
+
+    /* Each lane loads 16 bytes for 4 packs */
+    for (; done + 10 <= nb_packs; done += 8) {
+        const byte *p = src + 3 * done;
+        __m256i in, idx, res, upper, t0, t1;
+
+        in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+            _mm_loadu_si128((const __m128i *)(p + 12)), 1);
+
+        in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+        t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        t0 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        t1 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        t1 = _mm256_mullo_epi16(t1, _mm256_set1_epi32(0x01000010));
+        idx = _mm256_or_si256(t0, t1);
+
+        res = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+        res = _mm256_or_si256(res,
+                              _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        res = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, res), idx);
+        _mm256_storeu_si256((__m256i *)(dst + 4 * done), res);
+    }
+    return done + b64_encode_ssse3(dst + 4 * done, src + 3 * done,
+                                   nb_packs - done, table);
+}
+
+__attribute__((target("avx2")))
+static int b64_decode_avx2(char *dst, const byte *src, int len, bool url)
+{
+    int c62 = url ? '-' : '+';
+    int c63 = url ? '_' : '/';
+    int done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + done));
+        __m256i upper = AVX_IN_RANGE(c, 'A', 'Z');
+        __m256i lower = AVX_IN_RANGE(c, 'a', 'z');
+        __m256i digit = AVX_IN_RANGE(c, '0', '9');
+        __m256i is62 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(c62));
+        __m256i is63 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(c63));
+        __m256i valid, delta;
+
+        valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                _mm256_or_si256(digit,
+                                                _mm256_or_si256(is62, is63)));
+        if ((unsigned)_mm256_movemask_epi8(valid) != 0xffffffff) {
+            break;
+        }
+
+        delta = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+        delta = _mm256_or_si256(delta,
+            _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+        delta = _mm256_or_si256(delta,
+            _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+        delta = _mm256_or_si256(delta,
+            _mm256_and_si256(is62, _mm256_set1_epi8(62 - c62)));
+        delta = _mm256_or_si256(delta,
+            _mm256_and_si256(is63, _mm256_set1_epi8(63 - c63)));
+        c = _mm256_add_epi8(c, delta);
+
+        c = _mm256_maddubs_epi16(c, _mm256_set1_epi32(0x01400140));
+        c = _mm256_madd_epi16(c, _mm256_set1_epi32(0x00011000));
+        c = _mm256_shuffle_epi8(c, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        /* Put the 12 bytes of each lane next to each other */
+        c = _mm256_permutevar8x32_epi32(c, _mm256_setr_epi32(0, 1, 2, 4, 5,
+                                                             6, 3, 7));
+        _mm256_storeu_si256((__m256i *)(dst + done / 4 * 3), c);
+    }
+    if (done + 32 <= len) {
+        /* Stopped on an invalid block */
+        return done + b64_decode_ssse3(dst + done / 4 * 3, src + done,
+                                       32, url);
+    }
+    return done + b64_decode_ssse3(dst + done / 4 * 3, src + done,
+                                   len - done, url);
+}
+
+__attribute__((target("avx2")))
+static int hex_encode_avx2(char *dst, const byte *src, int len)
+{
+    const __m256i digits = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)__str_digits_upper));
+    const __m256i lo_4bits = _mm256_set1_epi8(0x0f);
+    int done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(src + done));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 4), lo_4bits);
+        __m256i lo = _mm256_and_si256(in, lo_4bits);
+        __m256i r0, r1;
+
+        hi = _mm256_shuffle_epi8(digits, hi);
+        lo = _mm256_shuffle_epi8(digits, lo);
+        r0 = _mm256_unpacklo_epi8(hi, lo);
+        r1 = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(dst + 2 * done),
+                            _mm256_permute2x128_si256(r0, r1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + 2 * done + 32),
+                            _mm256_permute2x128_si256(r0, r1, 0x31));
+    }
+    return done + hex_encode_ssse3(dst + 2 * done, src + done, len - done);
+}
+
+__attribute__((target("avx2")))
+static ALWAYS_INLINE bool hex_avx2_values(__m256i *c)
+{
+    __m256i lower = _mm256_or_si256(*c, _mm256_set1_epi8(0x20));
+    __m256i digit = AVX_IN_RANGE(*c, '0', '9');
+    __m256i alpha = AVX_IN_RANGE(lower, 'a', 'f');
+
+    if ((unsigned)_mm256_movemask_epi8(_mm256_or_si256(digit, alpha))
+        != 0xffffffff)
+    {
+        return false;
+    }
+    *c = _mm256_or_si256(
+        _mm256_and_si256(digit, _mm256_sub_epi8(*c, _mm256_set1_epi8('0'))),
+        _mm256_and_si256(alpha, _mm256_sub_epi8(lower,
+                                                _mm256_set1_epi8('a' - 10))));
+    *c = _mm256_maddubs_epi16(*c, _mm256_set1_epi16(0x0110));
+    return true;
+}
+
+__attribute__((target("avx2")))
+static int hex_decode_avx2(char *dst, const byte *src, int len)
+{
+    int done = 0;
+
+    for (; done + 64 <= len; done += 64) {
+        __m256i c0 = _mm256_loadu_si256((const __m256i *)(src + done));
+        __m256i c1 = _mm256_loadu_si256((const __m256i *)(src + done + 32));
+
+        if (!hex_avx2_values(&c0) || !hex_avx2_values(&c1)) {
+            break;
+        }
+        c0 = _mm256_packus_epi16(c0, c1);
+        _mm256_storeu_si256((__m256i *)(dst + done / 2),
+                            _mm256_permute4x64_epi64(c0, 0xd8));
+    }
+    return done + hex_decode_ssse3(dst + done / 2, src + done,
+                                   MIN(len - done, 64));
+}
+
+__attribute__((target("avx2")))
+static int url_span_avx2(const byte *src, int len)
+{
+    int done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + done));
+        __m256i ok;
+        unsigned mask;
+
+        ok = _mm256_or_si256(AVX_IN_RANGE(c, '-', '9'),
+                             AVX_IN_RANGE(c, 'A', 'Z'));
+        ok = _mm256_or_si256(ok, AVX_IN_RANGE(c, 'a', 'z'));
+        ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c,
+                                                   _mm256_set1_epi8('_')));
+        mask = _mm256_movemask_epi8(ok);
+        AVX_SPAN_END(done, mask);
+    }
+    return done + url_span_ssse3(src + done, len - done);
+}
+
+__attribute__((target("avx2")))
+static int xml_span_avx2(const byte *src, int len)
+{
+    int done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + done));
+        __m256i esc = AVX_IN_RANGE(c, 0x00, 0x1f);
+        unsigned mask;
+
+#define AVX_IS(c, chr)  _mm256_cmpeq_epi8(c, _mm256_set1_epi8(chr))
+        esc = _mm256_andnot_si256(AVX_IS(c, '\t'), esc);
+        esc = _mm256_andnot_si256(AVX_IS(c, '\n'), esc);
+        esc = _mm256_andnot_si256(AVX_IS(c, '\r'), esc);
+        esc = _mm256_or_si256(esc, AVX_IS(c, '"'));
+        esc = _mm256_or_si256(esc, AVX_IS(c, '&'));
+        esc = _mm256_or_si256(esc, AVX_IS(c, '\''));
+        esc = _mm256_or_si256(esc, AVX_IS(c, '<'));
+        esc = _mm256_or_si256(esc, AVX_IS(c, '>'));
+#undef AVX_IS
+        mask = ~_mm256_movemask_epi8(esc);
+        AVX_SPAN_END(done, mask);
+    }
+    return done + xml_span_ssse3(src + done, len - done);
+}
+
+__attribute__((target("avx2")))
+static int csv_span_avx2(const byte *src, int len, int sep)
+{
+    int done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + done));
+        __m256i esc = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('"'));
+        unsigned mask;
+
+        esc = _mm256_or_si256(esc, _mm256_cmpeq_epi8(c,
+                                                     _mm256_set1_epi8('\n')));
+        esc = _mm256_or_si256(esc, _mm256_cmpeq_epi8(c,
+                                                     _mm256_set1_epi8('\r')));
+        esc = _mm256_or_si256(esc, _mm256_cmpeq_epi8(c,
+                                                     _mm256_set1_epi8(sep)));
+        mask = ~_mm256_movemask_epi8(esc);
+        AVX_SPAN_END(done, mask);
+    }
+    return done + csv_span_ssse3(src + done, len - done, sep);
+}
+
+static sb_quoting_impl_t const sb_quoting_avx2 = {
+    .b64_encode = &b64_encode_avx2,
+    .b64_decode = &b64_decode_avx2,
+    .hex_encode = &hex_encode_avx2,
+    .hex_decode = &hex_decode_avx2,
+    .url_span   = &url_span_avx2,
+    .xml_span   = &xml_span_avx2,
+    .csv_span   = &csv_span_avx2,
+};
+
+/* }}} */
+
+static sb_quoting_simd_t sb_quoting_cpu_simd(void)
+{
+    unsigned eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & bit_SSSE3)) {
+        return SB_QUOTING_SIMD_NONE;
+    }
+
+    /* AVX2 also needs the OS to save the YMM registers */
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+        return SB_QUOTING_SIMD_SSSE3;
+    }
+    __asm__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+    if ((xcr0_lo & 6) != 6 || __get_cpuid_max(0, NULL) < 7) {
+        return SB_QUOTING_SIMD_SSSE3;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (!(ebx & bit_AVX2)) {
+        return SB_QUOTING_SIMD_SSSE3;
+    }
+
+    return SB_QUOTING_SIMD_AVX2;
+}
+
+#else
+
+static sb_quoting_simd_t sb_quoting_cpu_simd(void)
+{
+    return SB_QUOTING_SIMD_NONE;
+}
+
+#endif
+
+static sb_quoting_impl_t const *sb_quoting_impl_g;
+
+sb_quoting_simd_t sb_quoting_set_simd(sb_quoting_simd_t simd)
+{
+    simd = MIN(simd, sb_quoting_cpu_simd());
+
+    switch (simd) {
+#ifdef SB_QUOTING_HAS_SIMD
+      case SB_QUOTING_SIMD_AVX2:
+        sb_quoting_impl_g = &sb_quoting_avx2;
+        break;
+      case SB_QUOTING_SIMD_SSSE3:
+        sb_quoting_impl_g = &sb_quoting_ssse3;
+        break;
+#endif
+      default:
+        sb_quoting_impl_g = &sb_quoting_naive;
+        break;
+    }
+    return simd;
+}
+
+static ALWAYS_INLINE sb_quoting_impl_t const *sb_quoting_impl(void)
+{
+    if (unlikely(!sb_quoting_impl_g)) {
+        sb_quoting_set_simd(SB_QUOTING_SIMD_AVX2);
+    }
+    return sb_quoting_impl_g;
+}
+
+/* }}} */
+
 
 void sb_add_slashes(sb_t *sb, const void *_data, int len,
                     const char *toesc, const char *esc)
@@ -339,12 +1017,14 @@ SB_DEFINE_ADDS(unquoted);
 
 void sb_add_urlencode(sb_t *sb, const void *_data, int len)
 {
+    const sb_quoting_impl_t *impl = sb_quoting_impl();
     const byte *p = _data, *end = p + len;
 
     sb_grow(sb, len);
     while (p < end) {
         const byte *q = p;
 
+        p += (*impl->url_span)(p, end - p);
         while (p < end && __str_url_invalid[*p] != 255)
             p++;
         sb_add(sb, q, p - q);
@@ -428,9 +1108,12 @@ void sb_urldecode(sb_t *sb)
 
 void sb_add_hex(sb_t *sb, const void *data, int len)
 {
+    const byte *p = data, *end = p + len;
     char *s = sb_growlen(sb, len * 2);
+    int done = (*sb_quoting_impl()->hex_encode)(s, p, len);
 
-    for (const byte *p = data, *end = p + len; p < end; p++) {
+    s += 2 * done;
+    for (p += done; p < end; p++) {
         *s++ = __str_digits_upper[(*p >> 4) & 0x0f];
         *s++ = __str_digits_upper[(*p >> 0) & 0x0f];
     }
@@ -439,6 +1122,7 @@ SB_DEFINE_ADDS(hex);
 
 int sb_add_unhex(sb_t *sb, const void *data, int len)
 {
+    const char *p = data, *end = p + len;
     sb_t orig = *sb;
     char *s;
 
@@ -446,7 +1130,9 @@ int sb_add_unhex(sb_t *sb, const void *data, int len)
         return -1;
 
     s = sb_growlen(sb, len / 2);
-    for (const char *p = data, *end = p + len; p < end; p += 2) {
+    p += (*sb_quoting_impl()->hex_decode)(s, data, len);
+    s += (p - (const char *)data) / 2;
+    for (; p < end; p += 2) {
         int c = hexdecode(p);
 
         if (unlikely(c < 0))
@@ -459,12 +1145,14 @@ SB_DEFINE_ADDS_ERR(unhex);
 
 void sb_add_xmlescape(sb_t *sb, const void *data, int len)
 {
+    const sb_quoting_impl_t *impl = sb_quoting_impl();
     const byte *p = data, *end = p + len;
 
     sb_grow(sb, len);
     while (p < end) {
         const byte *q = p;
 
+        p += (*impl->xml_span)(p, end - p);
         while (p < end && test_xml_printable(*p))
             p++;
         sb_add(sb, q, p - q);
@@ -741,10 +1429,12 @@ void sb_add_b64_start(sb_t *dst, int len, int width, sb_b64_ctx_t *ctx)
 static void _sb_add_b64_update(sb_t *dst, const void *src0, int len,
                                sb_b64_ctx_t *ctx, const char table[64])
 {
+    const sb_quoting_impl_t *impl = sb_quoting_impl();
     short ppline    = ctx->packs_per_line;
     short pack_num  = ctx->pack_num;
     const byte *src = src0;
     const byte *end = src + len;
+    bool try_simd   = true;
     unsigned pack;
     char *data;
 
@@ -764,6 +1454,24 @@ static void _sb_add_b64_update(sb_t *dst, const void *src0, int len,
     }
 
     do {
+        if (try_simd) {
+            /* Encode the rest of the line with the vectorized loop, it
+             * leaves the last pack of the line to the scalar one. */
+            int nb_packs = (end - src) / 3;
+            int done;
+
+            if (ppline > 0) {
+                nb_packs = MIN(nb_packs, ppline - pack_num);
+            }
+            done  = (*impl->b64_encode)(data, src, nb_packs, table);
+            src  += 3 * done;
+            data += 4 * done;
+            if (ppline > 0) {
+                pack_num += done;
+            }
+            try_simd = false;
+        }
+
         pack  = *src++ << 16;
         pack |= *src++ <<  8;
         pack |= *src++ <<  0;
@@ -778,6 +1486,7 @@ static void _sb_add_b64_update(sb_t *dst, const void *src0, int len,
             pack_num = 0;
             *data++ = '\r';
             *data++ = '\n';
+            try_simd = true;
         }
     } while (src + 3 <= end);
 
@@ -865,7 +1574,10 @@ void sb_add_lstr_b64url(sb_t * nonnull sb, lstr_t data, int width)
 static int _sb_add_unb64(sb_t *sb, const void *data, int len,
                          const unsigned char table[256])
 {
+    const sb_quoting_impl_t *impl = sb_quoting_impl();
     const byte *src = data, *end = src + len;
+    bool url = table == __decode_base64url;
+    bool try_simd = true;
     sb_t orig = *sb;
 
     while (src < end) {
@@ -873,11 +1585,25 @@ static int _sb_add_unb64(sb_t *sb, const void *data, int len,
         int ilen = 0;
         char *s;
 
+        /* Decode the blocks without spaces nor padding with the vectorized
+         * loop, until the next space. */
+        if (try_simd && end - src >= 16) {
+            int done;
+
+            s = sb_grow(sb, (end - src) / 4 * 3 + 32);
+            done = (*impl->b64_decode)(s, src, end - src, url);
+            __sb_fixlen(sb, sb->len + done / 4 * 3);
+            src += done;
+            try_simd = false;
+        }
+
         while (ilen < 4 && src < end) {
             int c = *src++;
 
-            if (isspace(c))
+            if (isspace(c)) {
+                try_simd = true;
                 continue;
+            }
 
             /*
              * '=' must be at the end, they can only be 1 or 2 of them
@@ -942,16 +1668,23 @@ int sb_add_unb64url(sb_t *sb, const void *data, int len)
 }
 SB_DEFINE_ADDS_ERR(unb64url);
 
+static bool csv_needs_escape(byte c, int sep)
+{
+    return c == '"' || c == '\n' || c == '\r' || c == (byte)sep;
+}
+
 void sb_add_csvescape(sb_t *sb, int sep, const void *data, int len)
 {
-    static ctype_desc_t ctype_needs_escape;
-    pstream_t ps = ps_init(data, len);
+    const byte *p = data, *end = p + len;
+    pstream_t ps;
     pstream_t cspan;
 
-    ctype_desc_build(&ctype_needs_escape, "\"\n\r");
-    SET_BIT(ctype_needs_escape.tab, sep);
-
-    cspan = ps_get_cspan(&ps, &ctype_needs_escape);
+    p += (*sb_quoting_impl()->csv_span)(p, len, sep);
+    while (p < end && !csv_needs_escape(*p, sep)) {
+        p++;
+    }
+    cspan = ps_initptr(data, p);
+    ps = ps_initptr(p, end);
     if (ps_done(&ps)) {
         /* No caracter needing escaping was found, just copy the input
          * string. */
@@ -253,6 +253,42 @@ int sb_addf(sb_t *sb, const char *fmt, ...)
     return res;
 }
 
+int sb_addvf_cached(sb_t *sb, iprintf_fmt_cache_t *cache, const char *fmt,
+                    va_list ap)
+{
+    va_list ap2;
+    int len;
+
+    len = sb_avail(sb);
+    if (len != 0) {
+        len = len + 1;
+    }
+
+    va_copy(ap2, ap);
+    len = ivsnprintf_cached(cache, sb_end(sb), len, fmt, ap2);
+    va_end(ap2);
+
+    if (len <= sb_avail(sb)) {
+        __sb_fixlen(sb, sb->len + len);
+    } else {
+        ivsnprintf_cached(cache, sb_growlen(sb, len), len + 1, fmt, ap);
+    }
+    return len;
+}
+
+int sb_addf_cached(sb_t *sb, iprintf_fmt_cache_t *cache, const char *fmt,
+                   ...)
+{
+    int res;
+    va_list args;
+
+    va_start(args, fmt);
+    res = sb_addvf_cached(sb, cache, fmt, args);
+    va_end(args);
+
+    return res;
+}
+
 int sb_prependvf(sb_t *sb, const char *fmt, va_list ap)
 {
     char buf[BUFSIZ];
@@ -497,6 +497,23 @@ int sb_addvf(sb_t * nonnull sb, const char * nonnull fmt, va_list ap)
     __leaf __attr_printf__(2, 0);
 int sb_addf(sb_t * nonnull sb, const char * nonnull fmt, ...)
     __leaf __attr_printf__(2, 3);
+int sb_addvf_cached(sb_t * nonnull sb, iprintf_fmt_cache_t * nonnull cache,
+                    const char * nonnull fmt, va_list ap)
+    __leaf __attr_printf__(3, 0);
+int sb_addf_cached(sb_t * nonnull sb, iprintf_fmt_cache_t * nonnull cache,
+                   const char * nonnull fmt, ...)
+    __leaf __attr_printf__(3, 4);
+
+/** sb_addf() with a format literal, parsed on the first call.
+ *
+ * See isnprintf_lit().
+ */
+#define sb_addf_lit(sb, fmt, ...)                                            \
+    ({                                                                       \
+        static iprintf_fmt_cache_t __cache;                                  \
+                                                                             \
+        sb_addf_cached((sb), &__cache, "" fmt "", ##__VA_ARGS__);            \
+    })
 
 /** Reset and optimize a string buffer for sb_prepend().
  *
@@ -947,6 +964,28 @@ static inline void sb_add_lstr_csvescape(sb_t * nonnull sb, int sep, lstr_t s)
     sb_add_csvescape(sb, sep, s.s, s.len);
 }
 
+/** Instruction sets used by the quoting functions.
+ *
+ * The base64, hex, URL, XML and CSV functions use SSSE3 or AVX2 loops when
+ * the CPU supports them, and give the same results without them.
+ */
+typedef enum sb_quoting_simd_t {
+    SB_QUOTING_SIMD_NONE,
+    SB_QUOTING_SIMD_SSSE3,
+    SB_QUOTING_SIMD_AVX2,
+} sb_quoting_simd_t;
+
+/** Select the instruction set used by the quoting functions.
+ *
+ * The best one supported by the CPU is used by default; this is meant for
+ * tests and benchmarks.
+ *
+ * \param[in] simd  the wanted instruction set.
+ * \return the instruction set actually used, which can be lower than \p simd
+ *         if the CPU does not support it.
+ */
+sb_quoting_simd_t sb_quoting_set_simd(sb_quoting_simd_t simd);
+
 /** Append the Punycode-encoded string corresponding to the input code points
  *  in the given sb.
  *
@@ -454,6 +454,583 @@ int strconv_hexencode(char *dest, int size, const void *src, int len)
     return len * 2;
 }
 
+/****************************************************************************/
+/* Vectorized loops                                                         */
+/****************************************************************************/
+
+/* The UTF-8 functions run SSE2 or AVX2 loops on whole blocks of ASCII text
+ * or valid UTF-8, and leave the rest (invalid sequences, blocks with other
+ * characters, the last bytes of the input) to the scalar loops, so that the
+ * results do not depend on the loops used.
+ */
+
+/* ASCII letters conversion of the case loop */
+typedef enum utf8_ascii_case_t {
+    UTF8_ASCII_KEEP,
+    UTF8_ASCII_LOWER,
+    UTF8_ASCII_UPPER,
+} utf8_ascii_case_t;
+
+typedef struct utf8_impl_t {
+    /* Returns the length of a prefix of complete and valid UTF-8 characters
+     * of s, and their number in *nb_chars. */
+    size_t (*valid_prefix)(const char *s, size_t len, size_t *nb_chars);
+
+    /* Return the length of the prefix of s made of ASCII characters. */
+    size_t (*ascii_span)(const char *s, size_t len);
+
+    /* Copy the ASCII prefix of s to dst, converting the case of letters,
+     * and return its length. The len bytes of dst can be overwritten. */
+    size_t (*ascii_case)(char *dst, const char *s, size_t len,
+                         utf8_ascii_case_t ascii_case);
+
+    /* Return the length of the common ASCII prefix of s1 and s2. */
+    size_t (*ascii_common_prefix)(const char *s1, const char *s2,
+                                  size_t len);
+
+    /* Write the ASCII prefix of s to dst in UCS-2, and return its length.
+     * The 2 * len bytes of dst can be overwritten. */
+    size_t (*ucs2_widen)(char *dst, const char *s, size_t len, bool be);
+
+    /* Return the length of the prefix of s made of ASCII characters that
+     * are encoded the same way in the GSM 7 bits default alphabet:
+     * \n \r, space to ?, A to Z and a to z, but $ and @. */
+    size_t (*gsm7_span)(const char *s, size_t len);
+} utf8_impl_t;
+
+static size_t utf8_valid_prefix_naive(const char *s, size_t len,
+                                      size_t *nb_chars)
+{
+    *nb_chars = 0;
+    return 0;
+}
+
+static size_t utf8_span_naive(const char *s, size_t len)
+{
+    return 0;
+}
+
+static size_t utf8_ascii_case_naive(char *dst, const char *s, size_t len,
+                                    utf8_ascii_case_t ascii_case)
+{
+    return 0;
+}
+
+static size_t utf8_ascii_common_prefix_naive(const char *s1, const char *s2,
+                                             size_t len)
+{
+    return 0;
+}
+
+static size_t utf8_ucs2_widen_naive(char *dst, const char *s, size_t len,
+                                    bool be)
+{
+    return 0;
+}
+
+static utf8_impl_t const utf8_naive = {
+    .valid_prefix        = &utf8_valid_prefix_naive,
+    .ascii_span          = &utf8_span_naive,
+    .ascii_case          = &utf8_ascii_case_naive,
+    .ascii_common_prefix = &utf8_ascii_common_prefix_naive,
+    .ucs2_widen          = &utf8_ucs2_widen_naive,
+    .gsm7_span           = &utf8_span_naive,
+};
+
+/* The valid prefix ends at the last character boundary before the end of
+ * the checked blocks: a character starting in the last three bytes of
+ * these blocks can go on after them. */
+static size_t utf8_valid_prefix_end(const char *s, size_t done,
+                                    size_t *nb_chars)
+{
+    for (size_t k = 1; k <= 3 && k <= done; k++) {
+        uint8_t charlen = __utf8_char_len[(unsigned char)s[done - k] >> 3];
+
+        if (charlen) {
+            if (charlen > k) {
+                (*nb_chars)--;
+                return done - k;
+            }
+            break;
+        }
+    }
+    return done;
+}
+
+#ifdef __SSE2__
+#define UTF8_HAS_SIMD
+
+#pragma push_macro("__leaf")
+#undef __leaf
+#include <x86intrin.h>
+#pragma pop_macro("__leaf")
+
+/* {{{ SSE2 */
+
+/* Byte ranges checks work on signed bytes: bytes >= 0x80 are never in the
+ * ASCII ranges. */
+#define SSE_IN_RANGE(c, lo, hi)                                              \
+    _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8((lo) - 1)),                \
+                  _mm_cmpgt_epi8(_mm_set1_epi8((hi) + 1), c))
+
+/* Bytes above x, x being >= 0x80 */
+#define SSE_ABOVE(c, x)  _mm_cmpgt_epi8(c, _mm_set1_epi8((char)(x)))
+
+/* Bytes of x shifted by k positions, with the last ones of prev before. */
+#define SSE_SHIFT_IN(x, prev, k)                                             \
+    _mm_or_si128(_mm_slli_si128(x, k), _mm_srli_si128(prev, 16 - (k)))
+
+/* A block is valid when its continuation bytes are exactly the ones that
+ * follow the lead bytes, in the block or in the previous one.
+ */
+static size_t utf8_valid_prefix_sse2(const char *s, size_t len,
+                                     size_t *nb_chars)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i prev_l2 = zero, prev_l3 = zero, prev_l4 = zero;
+    unsigned pending = 0;
+    size_t chars = 0;
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + done));
+        __m128i high, l2, l3, l4, bad, cont, req;
+        unsigned m2, m3, m4;
+
+        if (!_mm_movemask_epi8(c) && !pending) {
+            prev_l2 = prev_l3 = prev_l4 = zero;
+            chars += 16;
+            continue;
+        }
+
+        /* l2, l3 and l4 are the lead bytes of at least 2, 3 and 4 bytes */
+        high = _mm_cmpgt_epi8(zero, c);
+        l2   = _mm_and_si128(high, SSE_ABOVE(c, 0xbf));
+        l3   = _mm_and_si128(high, SSE_ABOVE(c, 0xdf));
+        l4   = _mm_and_si128(high, SSE_ABOVE(c, 0xef));
+        bad  = _mm_and_si128(high, SSE_ABOVE(c, 0xf7));
+        cont = _mm_andnot_si128(l2, high);
+
+        req = _mm_or_si128(SSE_SHIFT_IN(l2, prev_l2, 1),
+                           SSE_SHIFT_IN(l3, prev_l3, 2));
+        req = _mm_or_si128(req, SSE_SHIFT_IN(l4, prev_l4, 3));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_xor_si128(cont, req), bad))) {
+            break;
+        }
+
+        m2 = _mm_movemask_epi8(l2);
+        m3 = _mm_movemask_epi8(l3);
+        m4 = _mm_movemask_epi8(l4);
+        pending = (m2 >> 15) | (m3 >> 14) | (m4 >> 13);
+        chars += 16 - bitcount16(_mm_movemask_epi8(cont));
+        prev_l2 = l2;
+        prev_l3 = l3;
+        prev_l4 = l4;
+    }
+
+    *nb_chars = chars;
+    return utf8_valid_prefix_end(s, done, nb_chars);
+}
+
+static size_t utf8_ascii_span_sse2(const char *s, size_t len)
+{
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + done));
+        unsigned mask = _mm_movemask_epi8(c);
+
+        if (mask) {
+            return done + __builtin_ctz(mask);
+        }
+    }
+    return done;
+}
+
+static size_t utf8_ascii_case_sse2(char *dst, const char *s, size_t len,
+                                   utf8_ascii_case_t ascii_case)
+{
+    __m128i flip = _mm_set1_epi8(ascii_case == UTF8_ASCII_KEEP ? 0 : 0x20);
+    int from = ascii_case == UTF8_ASCII_UPPER ? 'a' : 'A';
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + done));
+        __m128i letters = SSE_IN_RANGE(c, from, from + 25);
+        unsigned mask = _mm_movemask_epi8(c);
+
+        c = _mm_xor_si128(c, _mm_and_si128(letters, flip));
+        _mm_storeu_si128((__m128i *)(dst + done), c);
+        if (mask) {
+            return done + __builtin_ctz(mask);
+        }
+    }
+    return done;
+}
+
+static size_t utf8_ascii_common_prefix_sse2(const char *s1, const char *s2,
+                                            size_t len)
+{
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(s1 + done));
+        __m128i c2 = _mm_loadu_si128((const __m128i *)(s2 + done));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(c1, c2))
+                      & ~_mm_movemask_epi8(c1);
+
+        if (mask != 0xffff) {
+            return done + __builtin_ctz(~mask);
+        }
+    }
+    return done;
+}
+
+static size_t utf8_ucs2_widen_sse2(char *dst, const char *s, size_t len,
+                                   bool be)
+{
+    __m128i zero = _mm_setzero_si128();
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + done));
+        unsigned mask = _mm_movemask_epi8(c);
+        __m128i lo, hi;
+
+        if (be) {
+            lo = _mm_unpacklo_epi8(zero, c);
+            hi = _mm_unpackhi_epi8(zero, c);
+        } else {
+            lo = _mm_unpacklo_epi8(c, zero);
+            hi = _mm_unpackhi_epi8(c, zero);
+        }
+        _mm_storeu_si128((__m128i *)(dst + 2 * done), lo);
+        _mm_storeu_si128((__m128i *)(dst + 2 * done + 16), hi);
+        if (mask) {
+            return done + __builtin_ctz(mask);
+        }
+    }
+    return done;
+}
+
+static size_t utf8_gsm7_span_sse2(const char *s, size_t len)
+{
+    size_t done = 0;
+
+    for (; done + 16 <= len; done += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + done));
+        __m128i ok = SSE_IN_RANGE(c, ' ', '?');
+        unsigned mask;
+
+        ok = _mm_andnot_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('$')), ok);
+        ok = _mm_or_si128(ok, SSE_IN_RANGE(c, 'A', 'Z'));
+        ok = _mm_or_si128(ok, SSE_IN_RANGE(c, 'a', 'z'));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('\n')));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('\r')));
+        mask = _mm_movemask_epi8(ok);
+        if (mask != 0xffff) {
+            return done + __builtin_ctz(~mask);
+        }
+    }
+    return done;
+}
+
+static utf8_impl_t const utf8_sse2 = {
+    .valid_prefix        = &utf8_valid_prefix_sse2,
+    .ascii_span          = &utf8_ascii_span_sse2,
+    .ascii_case          = &utf8_ascii_case_sse2,
+    .ascii_common_prefix = &utf8_ascii_common_prefix_sse2,
+    .ucs2_widen          = &utf8_ucs2_widen_sse2,
+    .gsm7_span           = &utf8_gsm7_span_sse2,
+};
+
+/* }}} */
+
+/* Intrinsics of instruction sets that are not enabled for the whole file
+ * need GCC 4.9. */
+#if defined(__HAS_CPUID) && (__GNUC_PREREQ(4, 9) || __CLANG_PREREQ(3, 8))
+#define UTF8_HAS_AVX2
+
+#pragma push_macro("__leaf")
+#undef __leaf
+#include <cpuid.h>
+#pragma pop_macro("__leaf")
+
+/* {{{ AVX2 */
+
+#define AVX_IN_RANGE(c, lo, hi)                                              \
+    _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8((lo) - 1)),       \
+                     _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), c))
+
+#define AVX_ABOVE(c, x)  _mm256_cmpgt_epi8(c, _mm256_set1_epi8((char)(x)))
+
+/* The lanes of AVX2 registers are shifted separately: the bytes entering
+ * the lower lane come from the upper lane of prev. */
+#define AVX_SHIFT_IN(x, prev, k)                                             \
+    _mm256_alignr_epi8(x, _mm256_permute2x128_si256(prev, x, 0x21), 16 - (k))
+
+__attribute__((target("avx2,popcnt")))
+static size_t utf8_valid_prefix_avx2(const char *s, size_t len,
+                                     size_t *nb_chars)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i prev_l2 = zero, prev_l3 = zero, prev_l4 = zero;
+    unsigned pending = 0;
+    size_t chars = 0;
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + done));
+        __m256i high, l2, l3, l4, bad, cont, req;
+        unsigned m2, m3, m4;
+
+        if (!_mm256_movemask_epi8(c) && !pending) {
+            prev_l2 = prev_l3 = prev_l4 = zero;
+            chars += 32;
+            continue;
+        }
+
+        high = _mm256_cmpgt_epi8(zero, c);
+        l2   = _mm256_and_si256(high, AVX_ABOVE(c, 0xbf));
+        l3   = _mm256_and_si256(high, AVX_ABOVE(c, 0xdf));
+        l4   = _mm256_and_si256(high, AVX_ABOVE(c, 0xef));
+        bad  = _mm256_and_si256(high, AVX_ABOVE(c, 0xf7));
+        cont = _mm256_andnot_si256(l2, high);
+
+        req = _mm256_or_si256(AVX_SHIFT_IN(l2, prev_l2, 1),
+                              AVX_SHIFT_IN(l3, prev_l3, 2));
+        req = _mm256_or_si256(req, AVX_SHIFT_IN(l4, prev_l4, 3));
+        req = _mm256_or_si256(_mm256_xor_si256(cont, req), bad);
+        if (_mm256_movemask_epi8(req)) {
+            break;
+        }
+
+        m2 = _mm256_movemask_epi8(l2);
+        m3 = _mm256_movemask_epi8(l3);
+        m4 = _mm256_movemask_epi8(l4);
+        pending = (m2 >> 31) | (m3 >> 30) | (m4 >> 29);
+        chars += 32 - __builtin_popcount(_mm256_movemask_epi8(cont));
+        prev_l2 = l2;
+        prev_l3 = l3;
+        prev_l4 = l4;
+    }
+
+    *nb_chars = chars;
+    return utf8_valid_prefix_end(s, done, nb_chars);
+}
+
+__attribute__((target("avx2")))
+static size_t utf8_ascii_span_avx2(const char *s, size_t len)
+{
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + done));
+        unsigned mask = _mm256_movemask_epi8(c);
+
+        if (mask) {
+            return done + __builtin_ctz(mask);
+        }
+    }
+    return done + utf8_ascii_span_sse2(s + done, len - done);
+}
+
+__attribute__((target("avx2")))
+static size_t utf8_ascii_case_avx2(char *dst, const char *s, size_t len,
+                                   utf8_ascii_case_t ascii_case)
+{
+    __m256i flip = _mm256_set1_epi8(ascii_case == UTF8_ASCII_KEEP ? 0 : 0x20);
+    int from = ascii_case == UTF8_ASCII_UPPER ? 'a' : 'A';
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + done));
+        __m256i letters = AVX_IN_RANGE(c, from, from + 25);
+        unsigned mask = _mm256_movemask_epi8(c);
+
+        c = _mm256_xor_si256(c, _mm256_and_si256(letters, flip));
+        _mm256_storeu_si256((__m256i *)(dst + done), c);
+        if (mask) {
+            return done + __builtin_ctz(mask);
+        }
+    }
+    return done + utf8_ascii_case_sse2(dst + done, s + done, len - done,
+                                       ascii_case);
+}
+
+__attribute__((target("avx2")))
+static size_t utf8_ascii_common_prefix_avx2(const char *s1, const char *s2,
+                                            size_t len)
+{
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c1 = _mm256_loadu_si256((const __m256i *)(s1 + done));
+        __m256i c2 = _mm256_loadu_si256((const __m256i *)(s2 + done));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, c2))
+                      & ~_mm256_movemask_epi8(c1);
+
+        if (mask != 0xffffffff) {
+            return done + __builtin_ctz(~mask);
+        }
+    }
+    return done + utf8_ascii_common_prefix_sse2(s1 + done, s2 + done,
+                                                len - done);
+}
+
+__attribute__((target("avx2")))
+static size_t utf8_ucs2_widen_avx2(char *dst, const char *s, size_t len,
+                                   bool be)
+{
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + done));
+        unsigned mask = _mm256_movemask_epi8(c);
+        __m256i lo, hi;
+
+        /* Widen each half of the block, in order */
+        lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(c));
+        hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(c, 1));
+        if (be) {
+            lo = _mm256_slli_epi16(lo, 8);
+            hi = _mm256_slli_epi16(hi, 8);
+        }
+        _mm256_storeu_si256((__m256i *)(dst + 2 * done), lo);
+        _mm256_storeu_si256((__m256i *)(dst + 2 * done + 32), hi);
+        if (mask) {
+            return done + __builtin_ctz(mask);
+        }
+    }
+    return done + utf8_ucs2_widen_sse2(dst + 2 * done, s + done, len - done,
+                                       be);
+}
+
+__attribute__((target("avx2")))
+static size_t utf8_gsm7_span_avx2(const char *s, size_t len)
+{
+    size_t done = 0;
+
+    for (; done + 32 <= len; done += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + done));
+        __m256i ok = AVX_IN_RANGE(c, ' ', '?');
+        unsigned mask;
+
+#define AVX_IS(c, chr)  _mm256_cmpeq_epi8(c, _mm256_set1_epi8(chr))
+        ok = _mm256_andnot_si256(AVX_IS(c, '$'), ok);
+        ok = _mm256_or_si256(ok, AVX_IN_RANGE(c, 'A', 'Z'));
+        ok = _mm256_or_si256(ok, AVX_IN_RANGE(c, 'a', 'z'));
+        ok = _mm256_or_si256(ok, AVX_IS(c, '\n'));
+        ok = _mm256_or_si256(ok, AVX_IS(c, '\r'));
+#undef AVX_IS
+        mask = _mm256_movemask_epi8(ok);
+        if (mask != 0xffffffff) {
+            return done + __builtin_ctz(~mask);
+        }
+    }
+    return done + utf8_gsm7_span_sse2(s + done, len - done);
+}
+
+static utf8_impl_t const utf8_avx2 = {
+    .valid_prefix        = &utf8_valid_prefix_avx2,
+    .ascii_span          = &utf8_ascii_span_avx2,
+    .ascii_case          = &utf8_ascii_case_avx2,
+    .ascii_common_prefix = &utf8_ascii_common_prefix_avx2,
+    .ucs2_widen          = &utf8_ucs2_widen_avx2,
+    .gsm7_span           = &utf8_gsm7_span_avx2,
+};
+
+/* }}} */
+
+static bool utf8_cpu_has_avx2(void)
+{
+    unsigned eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & bit_POPCNT) || !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+        return false;
+    }
+
+    /* The OS must save the YMM registers */
+    __asm__ ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+    if ((xcr0_lo & 6) != 6 || __get_cpuid_max(0, NULL) < 7) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return ebx & bit_AVX2;
+}
+
+#endif /* AVX2 */
+#endif /* __SSE2__ */
+
+static utf8_impl_t const *utf8_impl_g;
+
+utf8_simd_t utf8_set_simd(utf8_simd_t simd)
+{
+#ifdef UTF8_HAS_AVX2
+    if (simd == UTF8_SIMD_AVX2 && utf8_cpu_has_avx2()) {
+        utf8_impl_g = &utf8_avx2;
+        return UTF8_SIMD_AVX2;
+    }
+#endif
+#ifdef UTF8_HAS_SIMD
+    if (simd >= UTF8_SIMD_SSE2) {
+        utf8_impl_g = &utf8_sse2;
+        return UTF8_SIMD_SSE2;
+    }
+#endif
+    utf8_impl_g = &utf8_naive;
+    return UTF8_SIMD_NONE;
+}
+
+static ALWAYS_INLINE utf8_impl_t const *utf8_impl(void)
+{
+    if (unlikely(!utf8_impl_g)) {
+        utf8_set_simd(UTF8_SIMD_AVX2);
+    }
+    return utf8_impl_g;
+}
+
+size_t __gsm7_ascii_span(const char *s, size_t len)
+{
+    return (*utf8_impl()->gsm7_span)(s, len);
+}
+
+/****************************************************************************/
+/* UTF-8 validation and comparisons                                         */
+/****************************************************************************/
+
+ssize_t utf8_strnlen(const char *s, size_t len)
+{
+    const char *end = s + len;
+    size_t nb_chars;
+
+    s += (*utf8_impl()->valid_prefix)(s, len, &nb_chars);
+    while (s < end) {
+        uint8_t charlen = utf8_charlen(s, end - s);
+
+        if (unlikely(charlen == 0)) {
+            return -1;
+        }
+        nb_chars++;
+        s += charlen;
+    }
+
+    return nb_chars;
+}
+
+const char *utf8_skip_valid(const char *s, const char *end)
+{
+    size_t nb_chars;
+
+    s += (*utf8_impl()->valid_prefix)(s, end - s, &nb_chars);
+    while (s < end) {
+        if (utf8_ngetc(s, end - s, &s) < 0)
+            return s;
+    }
+    return end;
+}
+
 static int utf8_strcmp_(const char *str1, int len1, const char *str2, int len2,
                         bool strip, bool starts_with,
                         uint32_t const str_conv[], int str_conv_len)
@@ -461,6 +1038,12 @@ static int utf8_strcmp_(const char *str1, int len1, const char *str2, int len2,
     int c1, c2, cc1, cc2;
     int off1 = 0, off2 = 0;
 
+    /* Identical ASCII characters compare equal whatever the collation */
+    if (len1 > 0 && len2 > 0) {
+        off1 = off2 = (*utf8_impl()->ascii_common_prefix)(str1, str2,
+                                                          MIN(len1, len2));
+    }
+
     /* GET_CHAR decodes invalid byte sequences as latin1
      * characters.
      */
@@ -649,6 +1232,7 @@ int sb_conv_to_latin1(sb_t *sb, const void *data, int len, int rep)
     while (s < end) {
         const char *p = s;
 
+        s += (*utf8_impl()->ascii_span)(s, end - s);
         while (s < end && !(*s & 0x80))
             s++;
         sb_add(sb, p, s - p);
@@ -682,6 +1266,13 @@ int sb_conv_to_ucs2le(sb_t *sb, const void *data, int len)
     while (s < end) {
         const char *p = s;
         char *buf;
+        size_t n;
+
+        /* sb_grow() above leaves room for the whole input */
+        n = (*utf8_impl()->ucs2_widen)(sb_end(sb), s, end - s, false);
+        __sb_fixlen(sb, sb->len + 2 * n);
+        s += n;
+        p += n;
 
         while (s < end && !(*s & 0x80))
             s++;
@@ -717,6 +1308,13 @@ int sb_conv_to_ucs2be(sb_t *sb, const void *data, int len)
     while (s < end) {
         const char *p = s;
         char *buf;
+        size_t n;
+
+        /* sb_grow() above leaves room for the whole input */
+        n = (*utf8_impl()->ucs2_widen)(sb_end(sb), s, end - s, true);
+        __sb_fixlen(sb, sb->len + 2 * n);
+        s += n;
+        p += n;
 
         while (s < end && !(*s & 0x80))
             s++;
@@ -833,9 +1431,11 @@ int sb_conv_from_ucs2le_hex(sb_t *sb, const void *s, int slen)
 /****************************************************************************/
 
 static int sb_normalize_utf8_(sb_t *sb, const char *s, int len,
-                              uint32_t const str_conv[], int str_conv_len)
+                              uint32_t const str_conv[], int str_conv_len,
+                              utf8_ascii_case_t ascii_case)
 {
     sb_t orig = *sb;
+    bool try_simd = len > 0;
     int off = 0;
     char *pos;
     char *end;
@@ -844,11 +1444,21 @@ static int sb_normalize_utf8_(sb_t *sb, const char *s, int len,
     end = pos + sb_avail(sb);
 
     for (;;) {
-        int c = utf8_ngetc_at(s, len, &off);
+        int c;
         uint32_t conv;
         uint32_t hconv;
         int bytes;
 
+        if (try_simd) {
+            int n = (*utf8_impl()->ascii_case)(pos, s + off,
+                                               MIN(len - off, end - pos),
+                                               ascii_case);
+
+            pos += n;
+            off += n;
+        }
+
+        c = utf8_ngetc_at(s, len, &off);
         if (c < 0) {
             if (likely(off >= len)) {
                 break;
@@ -859,6 +1469,7 @@ static int sb_normalize_utf8_(sb_t *sb, const char *s, int len,
             return __sb_rewind_adds(sb, &orig);
         }
 
+        try_simd = c < 0x80;
         if (c < str_conv_len) {
             conv = str_conv[c];
         } else {
@@ -887,9 +1498,11 @@ static int sb_normalize_utf8_(sb_t *sb, const char *s, int len,
 }
 
 static int sb_utf8_transform(sb_t *sb, const char *s, int len,
-                             uint16_t const str_conv[], int str_conv_len)
+                             uint16_t const str_conv[], int str_conv_len,
+                             utf8_ascii_case_t ascii_case)
 {
     sb_t orig = *sb;
+    bool try_simd = len > 0;
     int off = 0;
     char *pos;
     char *end;
@@ -898,9 +1511,19 @@ static int sb_utf8_transform(sb_t *sb, const char *s, int len,
     end = pos + sb_avail(sb);
 
     for (;;) {
-        int c = utf8_ngetc_at(s, len, &off);
+        int c;
         int bytes;
 
+        if (try_simd) {
+            int n = (*utf8_impl()->ascii_case)(pos, s + off,
+                                               MIN(len - off, end - pos),
+                                               ascii_case);
+
+            pos += n;
+            off += n;
+        }
+
+        c = utf8_ngetc_at(s, len, &off);
         if (c < 0) {
             if (likely(off >= len)) {
                 break;
@@ -911,6 +1534,7 @@ static int sb_utf8_transform(sb_t *sb, const char *s, int len,
             return __sb_rewind_adds(sb, &orig);
         }
 
+        try_simd = c < 0x80;
         if (c < str_conv_len) {
             c = str_conv[c];
         } else {
@@ -934,21 +1558,23 @@ int sb_normalize_utf8(sb_t *sb, const char *s, int len, bool ci)
 {
     if (ci) {
         return sb_normalize_utf8_(sb, s, len, __str_unicode_general_ci,
-                                  countof(__str_unicode_general_ci));
+                                  countof(__str_unicode_general_ci),
+                                  UTF8_ASCII_UPPER);
     } else {
         return sb_normalize_utf8_(sb, s, len, __str_unicode_general_cs,
-                                  countof(__str_unicode_general_cs));
+                                  countof(__str_unicode_general_cs),
+                                  UTF8_ASCII_KEEP);
     }
 }
 
 int sb_add_utf8_tolower(sb_t *sb, const char *s, int len)
 {
     return sb_utf8_transform(sb, s, len, __str_unicode_lower,
-                             countof(__str_unicode_lower));
+                             countof(__str_unicode_lower), UTF8_ASCII_LOWER);
 }
 
 int sb_add_utf8_toupper(sb_t *sb, const char *s, int len)
 {
     return sb_utf8_transform(sb, s, len, __str_unicode_upper,
-                             countof(__str_unicode_upper));
+                             countof(__str_unicode_upper), UTF8_ASCII_UPPER);
 }
@@ -156,23 +156,7 @@ static inline uint8_t utf8_charlen(const char * nonnull s, int len)
  *
  * \return -1 in case of invalid UTF8.
  */
-static inline ssize_t utf8_strnlen(const char * nonnull s, size_t len)
-{
-    const char *end = s + len;
-
-    len = 0;
-    while (s < end) {
-        uint8_t charlen = utf8_charlen(s, end - s);
-
-        if (unlikely(charlen == 0)) {
-            return -1;
-        }
-        len++;
-        s += charlen;
-    }
-
-    return len;
-}
+ssize_t utf8_strnlen(const char * nonnull s, size_t len) __leaf;
 
 /** Get the number of UTF8 characters contained in a string.
  *
@@ -258,15 +242,10 @@ static inline int utf8_vgetc(char * nonnull s, char * nullable * nullable out)
 {
     return utf8_getc(s, (const char **)out);
 }
-static inline const char * nonnull utf8_skip_valid(const char * nonnull s,
-                                                   const char * nonnull end)
-{
-    while (s < end) {
-        if (utf8_ngetc(s, end - s, &s) < 0)
-            return s;
-    }
-    return end;
-}
+
+/** Return the end of the longest valid UTF8 prefix of [s, end[. */
+const char * nonnull utf8_skip_valid(const char * nonnull s,
+                                     const char * nonnull end) __leaf;
 
 /** Return utf8 case-insensitive collating comparison as -1, 0, 1.
  *
@@ -306,4 +285,31 @@ bool utf8_strequal(const char * nonnull str1, int len1,
     return utf8_strcmp(str1, len1, str2, len2, strip) == 0;
 }
 
+/** Instruction sets usable by the UTF8 functions.
+ *
+ * The validation, the ASCII case conversions, the comparisons and the
+ * conversions to latin1, UCS-2 and GSM process whole blocks of 16 (SSE2) or
+ * 32 (AVX2) bytes of ASCII or valid UTF8 text at once.
+ */
+typedef enum utf8_simd_t {
+    UTF8_SIMD_NONE,
+    UTF8_SIMD_SSE2,
+    UTF8_SIMD_AVX2,
+} utf8_simd_t;
+
+/** Select the instruction set used by the UTF8 functions.
+ *
+ * The best one supported by the CPU is used by default, this is meant for
+ * tests and benchmarks. The results do not depend on the instruction set.
+ *
+ * \param[in] simd  the wanted instruction set.
+ * \return the instruction set actually used, which can be lower than \p simd
+ *         if it is not supported by the CPU.
+ */
+utf8_simd_t utf8_set_simd(utf8_simd_t simd);
+
+/* Length of the prefix of s made of characters encoded the same way in ASCII
+ * and in the GSM 7 bits default alphabet, used by str-buf-gsm.c. */
+size_t __gsm7_ascii_span(const char * nonnull s, size_t len);
+
 #endif /* IS_LIB_COMMON_STR_CONV_H */
@@ -1424,6 +1424,525 @@ static int fmt_output(FILE *stream, char *str, size_t size,
     return count;
 }
 
+/*---------------- pre-parsed formats ----------------*/
+
+enum {
+    FMT_OP_LITERAL,
+    FMT_OP_STR,         /* %s */
+    FMT_OP_STR_PREC,    /* %.*s */
+    FMT_OP_INT,         /* %d, %i, %u, %x, %X with width, '-' and '0' */
+    FMT_OP_CHAR,        /* %c */
+    FMT_OP_ERRNO,       /* %m */
+    FMT_OP_MEMORY,      /* %*p<modifier> */
+    FMT_OP_POINTER,     /* %p<modifier> */
+    FMT_OP_GENERIC,     /* anything else, formatted by fmt_output() */
+};
+
+/* Types of the arguments consumed by a FMT_OP_GENERIC. */
+enum {
+    FMT_ARG_INT,
+    FMT_ARG_LONG,
+    FMT_ARG_LLONG,
+    FMT_ARG_PTR,
+    FMT_ARG_DOUBLE,
+    FMT_ARG_LDOUBLE,
+};
+
+typedef struct fmt_op_t {
+    uint8_t kind;
+    /* formatter of FMT_OP_MEMORY/FMT_OP_POINTER, base of FMT_OP_INT */
+    uint8_t modifier;
+    uint8_t type_flags;
+    bool    is_signed;
+    uint8_t nb_args;
+    uint8_t args[3];
+    int     flags;
+    int     width;
+
+    /* literal, or NUL terminated conversion of a FMT_OP_GENERIC */
+    const char *s;
+    int len;
+} fmt_op_t;
+
+struct iprintf_fmt_t {
+    int nb_ops;
+    fmt_op_t ops[];
+};
+
+/* Cached for the formats that cannot be pre-parsed. */
+static const iprintf_fmt_t fmt_unsupported_g = { .nb_ops = -1 };
+
+static int fmt_int_arg(int type_flags)
+{
+    switch (type_flags) {
+      case TYPE_long:
+        return FMT_ARG_LONG;
+#ifdef WANT_llong
+      case TYPE_llong:
+        return FMT_ARG_LLONG;
+#endif
+      default:
+        return FMT_ARG_INT;
+    }
+}
+
+/* Parse the conversion starting after the '%' at *formatp. */
+static int fmt_parse_conversion(const char **formatp, fmt_op_t *op)
+{
+    const char *start = *formatp - 1;
+    const char *format = *formatp;
+    const struct formatter_t *formatter;
+    bool has_prec = false;
+    bool star_width = false;
+    int flags = 0;
+    int type_flags = 0;
+    int c;
+
+    p_clear(op, 1);
+
+    if (format[0] == '.' && format[1] == '*' && format[2] == 's') {
+        op->kind = FMT_OP_STR_PREC;
+        *formatp = format + 3;
+        return 0;
+    }
+    if (format[0] == '*' && format[1] == 'p') {
+        formatter = &put_memory_fmt_g[(unsigned char)format[2]];
+        if (formatter->is_raw && formatter->raw_formatter) {
+            op->kind = FMT_OP_MEMORY;
+            op->modifier = format[2];
+            *formatp = format + 3;
+            return 0;
+        }
+    }
+    if (format[0] == 'p') {
+        formatter = &put_memory_fmt_g[(unsigned char)format[1]];
+        if (!formatter->is_raw && formatter->ptr_formatter) {
+            op->kind = FMT_OP_POINTER;
+            op->modifier = format[1];
+            *formatp = format + 2;
+            return 0;
+        }
+    }
+
+    for (;; format++) {
+        switch (*format) {
+          case '-':  flags |= FLAG_MINUS;  continue;
+          case '+':  flags |= FLAG_PLUS;   continue;
+          case '#':  flags |= FLAG_ALT;    continue;
+          case '\'': flags |= FLAG_QUOTE;  continue;
+          case ' ':  flags |= FLAG_SPACE;  continue;
+          case '0':  flags |= FLAG_ZERO;   continue;
+          case 'I':                        continue;
+        }
+        break;
+    }
+    if (*format == '*') {
+        format++;
+        star_width = true;
+        op->args[op->nb_args++] = FMT_ARG_INT;
+    } else {
+        while (*format >= '0' && *format <= '9') {
+            op->width = op->width * 10 + *format++ - '0';
+        }
+    }
+    if (*format == '.') {
+        format++;
+        has_prec = true;
+        if (*format == '*') {
+            format++;
+            op->args[op->nb_args++] = FMT_ARG_INT;
+        } else {
+            while (*format >= '0' && *format <= '9') {
+                format++;
+            }
+        }
+    }
+    switch (*format) {
+      case 'l':
+        if (format[1] == 'l') {
+            format++;
+            type_flags = TYPE_llong;
+        } else {
+            type_flags = TYPE_long;
+        }
+        format++;
+        break;
+      case 'h':
+        if (format[1] == 'h') {
+            format++;
+            type_flags = TYPE_char;
+        } else {
+            type_flags = TYPE_short;
+        }
+        format++;
+        break;
+      case 'j': type_flags = TYPE_intmax_t;  format++; break;
+      case 'z': type_flags = TYPE_size_t;    format++; break;
+      case 't': type_flags = TYPE_ptrdiff_t; format++; break;
+      case 'L': type_flags = TYPE_ldouble;   format++; break;
+    }
+
+    switch (c = *format++) {
+      case '\0':
+      case 'n':
+        return -1;
+
+      case 's':
+        op->args[op->nb_args++] = FMT_ARG_PTR;
+        if (format == start + 2) {
+            op->kind = FMT_OP_STR;
+            *formatp = format;
+            return 0;
+        }
+        break;
+
+      case 'c':
+        op->args[op->nb_args++] = FMT_ARG_INT;
+        if (format == start + 2) {
+            op->kind = FMT_OP_CHAR;
+            *formatp = format;
+            return 0;
+        }
+        break;
+
+      case 'm':
+        if (format == start + 2) {
+            op->kind = FMT_OP_ERRNO;
+            *formatp = format;
+            return 0;
+        }
+        break;
+
+      case 'd': case 'i': case 'u': case 'x': case 'X':
+        op->args[op->nb_args++] = fmt_int_arg(type_flags);
+        if (!star_width && !has_prec
+        &&  !(flags & ~(FLAG_MINUS | FLAG_ZERO)))
+        {
+            op->kind = FMT_OP_INT;
+            op->modifier = (c == 'x' || c == 'X') ? 16 : 10;
+            op->is_signed = c == 'd' || c == 'i';
+            op->type_flags = type_flags;
+            op->flags = flags | (c == 'X' ? FLAG_UPPER : 0);
+            *formatp = format;
+            return 0;
+        }
+        break;
+
+      case 'o':
+        op->args[op->nb_args++] = fmt_int_arg(type_flags);
+        break;
+
+      case 'p': case 'P':
+        op->args[op->nb_args++] = FMT_ARG_PTR;
+        while (isalnum((unsigned char)*format)) {
+            format++;
+        }
+        break;
+
+      case 'e': case 'E': case 'f': case 'F':
+      case 'g': case 'G': case 'a': case 'A':
+        op->args[op->nb_args++] = type_flags == TYPE_ldouble
+                                ? FMT_ARG_LDOUBLE : FMT_ARG_DOUBLE;
+        break;
+
+      default:
+        break;
+    }
+
+    op->kind = FMT_OP_GENERIC;
+    op->s = p_dupz(start, format - start);
+    op->len = format - start;
+    *formatp = format;
+    return 0;
+}
+
+static void iprintf_fmt_delete(iprintf_fmt_t **fmtp)
+{
+    iprintf_fmt_t *fmt = *fmtp;
+
+    if (fmt) {
+        for (int i = 0; i < fmt->nb_ops; i++) {
+            if (fmt->ops[i].kind == FMT_OP_GENERIC) {
+                p_delete((char **)&fmt->ops[i].s);
+            }
+        }
+        p_delete(fmtp);
+    }
+}
+
+static iprintf_fmt_t *iprintf_fmt_parse(const char *format)
+{
+    iprintf_fmt_t *fmt;
+    int max_ops = 1;
+
+    for (const char *p = format; *p; p++) {
+        max_ops += 2 * (*p == '%');
+    }
+    fmt = p_new_extra(iprintf_fmt_t, max_ops * sizeof(fmt_op_t));
+
+    for (;;) {
+        const char *lp = format;
+        fmt_op_t *op;
+
+        while (*format && *format != '%') {
+            format++;
+        }
+        if (format > lp) {
+            op = &fmt->ops[fmt->nb_ops++];
+            op->kind = FMT_OP_LITERAL;
+            op->s = lp;
+            op->len = format - lp;
+        }
+        if (!*format++) {
+            return fmt;
+        }
+        if (*format == '%') {
+            op = &fmt->ops[fmt->nb_ops++];
+            op->kind = FMT_OP_LITERAL;
+            op->s = format++;
+            op->len = 1;
+            continue;
+        }
+        if (fmt_parse_conversion(&format, &fmt->ops[fmt->nb_ops]) < 0) {
+            iprintf_fmt_delete(&fmt);
+            return NULL;
+        }
+        fmt->nb_ops++;
+    }
+}
+
+static const iprintf_fmt_t *iprintf_fmt_get(iprintf_fmt_cache_t *cache,
+                                            const char *format)
+{
+    const iprintf_fmt_t *fmt = atomic_load_explicit(cache,
+                                                    memory_order_acquire);
+
+    if (unlikely(!fmt)) {
+        iprintf_fmt_t *parsed = iprintf_fmt_parse(format);
+        const iprintf_fmt_t *expected = NULL;
+
+        fmt = parsed ?: &fmt_unsupported_g;
+        if (!atomic_compare_exchange_strong(cache, &expected, fmt)) {
+            /* another thread was faster */
+            iprintf_fmt_delete(&parsed);
+            fmt = expected;
+        }
+    }
+    return fmt;
+}
+
+static int fmt_output_ops(FILE *stream, char *str, size_t size,
+                          const iprintf_fmt_t *fmt, va_list ap)
+{
+    char buf[64];
+    int count = 0;
+    int save_errno = errno;
+
+    if (size > INT_MAX) {
+        size = 0;
+    }
+
+    for (const fmt_op_t *op = fmt->ops; op < fmt->ops + fmt->nb_ops; op++) {
+        const char *lp;
+        int len;
+        int modifier = 'M';
+        int right_pad = 0;
+
+        switch (op->kind) {
+          case FMT_OP_LITERAL:
+            lp  = op->s;
+            len = op->len;
+            break;
+
+          case FMT_OP_STR:
+            lp = va_arg(ap, const char *);
+            if (lp == NULL) {
+                lp = "(null)";
+            }
+            len = strlen(lp);
+            break;
+
+          case FMT_OP_STR_PREC:
+            len = va_arg(ap, int);
+            lp  = va_arg(ap, const char *);
+            if (lp == NULL) {
+                lp = "(null)";
+                len = 6;
+            }
+            len = strnlen(lp, len);
+            break;
+
+          case FMT_OP_CHAR:
+            buf[0] = (unsigned char)va_arg(ap, int);
+            lp  = buf;
+            len = 1;
+            break;
+
+          case FMT_OP_ERRNO:
+            lp  = strerror(save_errno);
+            len = strlen(lp);
+            break;
+
+          case FMT_OP_MEMORY:
+            modifier = op->modifier;
+            len = va_arg(ap, int);
+            lp  = va_arg(ap, const char *);
+            break;
+
+          case FMT_OP_POINTER:
+            modifier = op->modifier;
+            len = 0;
+            lp  = va_arg(ap, const char *);
+            break;
+
+          case FMT_OP_INT: {
+            unsigned long long num;
+            bool negative = false;
+            int pad;
+
+            if (op->is_signed) {
+                long long value;
+
+                switch (op->type_flags) {
+                  case TYPE_char:  value = (char)va_arg(ap, int);  break;
+                  case TYPE_short: value = (short)va_arg(ap, int); break;
+                  case TYPE_long:  value = va_arg(ap, long);       break;
+#ifdef WANT_llong
+                  case TYPE_llong: value = va_arg(ap, long long);  break;
+#endif
+                  default:         value = va_arg(ap, int);        break;
+                }
+                negative = value < 0;
+                num = negative ? -(unsigned long long)value : value;
+            } else {
+                switch (op->type_flags) {
+                  case TYPE_char:
+                    num = (unsigned char)va_arg(ap, unsigned int);
+                    break;
+                  case TYPE_short:
+                    num = (unsigned short)va_arg(ap, unsigned int);
+                    break;
+                  case TYPE_long:
+                    num = va_arg(ap, unsigned long);
+                    break;
+#ifdef WANT_llong
+                  case TYPE_llong:
+                    num = va_arg(ap, unsigned long long);
+                    break;
+#endif
+                  default:
+                    num = va_arg(ap, unsigned int);
+                    break;
+                }
+            }
+
+            lp = convert_ullong(buf + sizeof(buf), num, op->modifier);
+            if (lp == buf + sizeof(buf)) {
+                *(char *)--lp = '0';
+            } else
+            if (op->modifier == 16) {
+                do_alpha_shift((char *)lp, buf + sizeof(buf), op->flags);
+            }
+            len = buf + sizeof(buf) - lp;
+
+            pad = op->width - len - negative;
+            if (op->flags & FLAG_MINUS) {
+                right_pad = pad;
+            } else
+            if (pad > 0 && !(op->flags & FLAG_ZERO)) {
+                count = fmt_output_chars(stream, str, size, count, ' ', pad);
+            }
+            if (negative) {
+                count = RETHROW(fmt_output_chunk(stream, str, size, count,
+                                                 "-", 1, 'M'));
+            }
+            if (pad > 0 && (op->flags & (FLAG_MINUS | FLAG_ZERO))
+                           == FLAG_ZERO)
+            {
+                count = fmt_output_chars(stream, str, size, count, '0', pad);
+            }
+            break;
+          }
+
+          case FMT_OP_GENERIC: {
+            va_list ap2;
+
+            va_copy(ap2, ap);
+            errno = save_errno;
+            if (stream) {
+                len = fmt_output(stream, NULL, 0, op->s, ap2);
+            } else
+            if ((size_t)count < size) {
+                len = fmt_output(NULL, str + count, size - count, op->s,
+                                 ap2);
+            } else {
+                len = fmt_output(NULL, str, 0, op->s, ap2);
+            }
+            va_end(ap2);
+            count += RETHROW(len);
+
+            /* skip the arguments consumed by fmt_output() */
+            for (int i = 0; i < op->nb_args; i++) {
+                switch (op->args[i]) {
+                  case FMT_ARG_INT:     (void)va_arg(ap, int);         break;
+                  case FMT_ARG_LONG:    (void)va_arg(ap, long);        break;
+                  case FMT_ARG_LLONG:   (void)va_arg(ap, long long);   break;
+                  case FMT_ARG_PTR:     (void)va_arg(ap, void *);      break;
+                  case FMT_ARG_DOUBLE:  (void)va_arg(ap, double);      break;
+                  case FMT_ARG_LDOUBLE: (void)va_arg(ap, long double); break;
+                }
+            }
+            continue;
+          }
+
+          default:
+            e_panic("unexpected format operation %d", op->kind);
+        }
+
+        count = RETHROW(fmt_output_chunk(stream, str, size, count, lp, len,
+                                         modifier));
+        if (right_pad > 0) {
+            count = fmt_output_chars(stream, str, size, count, ' ',
+                                     right_pad);
+        }
+    }
+
+    if (!stream) {
+        if (count < (int)size) {
+            str[count] = '\0';
+        } else
+        if (size > 0) {
+            str[size - 1] = '\0';
+        }
+    }
+    errno = save_errno;
+    return count;
+}
+
+int ivsnprintf_cached(iprintf_fmt_cache_t *cache, char *str, size_t size,
+                      const char *format, va_list arglist)
+{
+    const iprintf_fmt_t *fmt = iprintf_fmt_get(cache, format);
+
+    if (unlikely(fmt == &fmt_unsupported_g)) {
+        return fmt_output(NULL, str, size, format, arglist);
+    }
+    return fmt_output_ops(NULL, str, size, fmt, arglist);
+}
+
+int isnprintf_cached(iprintf_fmt_cache_t *cache, char *str, size_t size,
+                     const char *format, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, format);
+    n = ivsnprintf_cached(cache, str, size, format, ap);
+    va_end(ap);
+
+    return n;
+}
+
 /*---------------- printf functions ----------------*/
 
 int iprintf(const char *format, ...)
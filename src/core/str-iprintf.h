@@ -112,6 +112,40 @@ static inline char * nonnull iasprintf(const char * nonnull fmt, ...)
     return s;
 }
 
+/* {{{ Pre-parsed formats */
+
+/* Formats parsed once into a list of operations, to avoid parsing them again
+ * on each call.
+ *
+ * The cache is meant to be a static variable of the call site, and the
+ * format a string literal (the pre-parsed format points to it): use the
+ * isnprintf_lit() and sb_addf_lit() macros that do both.
+ *
+ * Formats that cannot be pre-parsed (%n, incomplete conversions) are
+ * formatted with the regular functions.
+ */
+typedef struct iprintf_fmt_t iprintf_fmt_t;
+typedef _Atomic(const iprintf_fmt_t *) iprintf_fmt_cache_t;
+
+int ivsnprintf_cached(iprintf_fmt_cache_t * nonnull cache,
+                      char * nullable str, size_t size,
+                      const char * nonnull format, va_list arglist)
+        __leaf __attr_printf__(4, 0);
+int isnprintf_cached(iprintf_fmt_cache_t * nonnull cache,
+                     char * nullable str, size_t size,
+                     const char * nonnull format, ...)
+        __leaf __attr_printf__(4, 5);
+
+/** isnprintf() with a format literal, parsed on the first call. */
+#define isnprintf_lit(str, size, format, ...)                                \
+    ({                                                                       \
+        static iprintf_fmt_cache_t __cache;                                  \
+                                                                             \
+        isnprintf_cached(&__cache, (str), (size), "" format "",              \
+                         ##__VA_ARGS__);                                     \
+    })
+
+/* }}} */
 /* {{{ Formatter registration */
 
 /** Formatter function type.
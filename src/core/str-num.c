@@ -284,6 +284,396 @@ int strtolp(const char *p, const char **endp, int base, long *res,
     return 0;
 }
 
+/*{{{ Double formatting and parsing */
+
+/* Shortest round-trip formatting of doubles, with the Grisu2 algorithm of
+ * Florian Loitsch ("Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers", PLDI 2010).
+ *
+ * The digits always read back to the same double. They are the shortest
+ * such digits for more than 99.9% of the doubles, and have at most one
+ * extra digit otherwise.
+ */
+
+typedef struct diyfp_t {
+    uint64_t f;
+    int e;
+} diyfp_t;
+
+static ALWAYS_INLINE diyfp_t diyfp_mul(diyfp_t x, diyfp_t y)
+{
+    uint128_t p = (uint128_t)x.f * y.f;
+    uint64_t h = p >> 64;
+
+    /* round to nearest */
+    h += ((uint64_t)p >> 63);
+    return (diyfp_t){ h, x.e + y.e + 64 };
+}
+
+static ALWAYS_INLINE diyfp_t diyfp_normalize(diyfp_t x)
+{
+    int shift = __builtin_clzll(x.f);
+
+    return (diyfp_t){ x.f << shift, x.e - shift };
+}
+
+/* Normalized 64-bits approximations of 10^k, for k in -300, -292..., 340
+ * (f * 2^e ~= 10^k).
+ */
+static const struct {
+    uint64_t f;
+    int16_t  e;
+    int16_t  k;
+} grisu_cached_powers_g[] = {
+    { 0xAB70FE17C79AC6CA, -1060, -300 },
+    { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+    { 0xBE5691EF416BD60C, -1007, -284 },
+    { 0x8DD01FAD907FFC3C,  -980, -276 },
+    { 0xD3515C2831559A83,  -954, -268 },
+    { 0x9D71AC8FADA6C9B5,  -927, -260 },
+    { 0xEA9C227723EE8BCB,  -901, -252 },
+    { 0xAECC49914078536D,  -874, -244 },
+    { 0x823C12795DB6CE57,  -847, -236 },
+    { 0xC21094364DFB5637,  -821, -228 },
+    { 0x9096EA6F3848984F,  -794, -220 },
+    { 0xD77485CB25823AC7,  -768, -212 },
+    { 0xA086CFCD97BF97F4,  -741, -204 },
+    { 0xEF340A98172AACE5,  -715, -196 },
+    { 0xB23867FB2A35B28E,  -688, -188 },
+    { 0x84C8D4DFD2C63F3B,  -661, -180 },
+    { 0xC5DD44271AD3CDBA,  -635, -172 },
+    { 0x936B9FCEBB25C996,  -608, -164 },
+    { 0xDBAC6C247D62A584,  -582, -156 },
+    { 0xA3AB66580D5FDAF6,  -555, -148 },
+    { 0xF3E2F893DEC3F126,  -529, -140 },
+    { 0xB5B5ADA8AAFF80B8,  -502, -132 },
+    { 0x87625F056C7C4A8B,  -475, -124 },
+    { 0xC9BCFF6034C13053,  -449, -116 },
+    { 0x964E858C91BA2655,  -422, -108 },
+    { 0xDFF9772470297EBD,  -396, -100 },
+    { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+    { 0xF8A95FCF88747D94,  -343,  -84 },
+    { 0xB94470938FA89BCF,  -316,  -76 },
+    { 0x8A08F0F8BF0F156B,  -289,  -68 },
+    { 0xCDB02555653131B6,  -263,  -60 },
+    { 0x993FE2C6D07B7FAC,  -236,  -52 },
+    { 0xE45C10C42A2B3B06,  -210,  -44 },
+    { 0xAA242499697392D3,  -183,  -36 },
+    { 0xFD87B5F28300CA0E,  -157,  -28 },
+    { 0xBCE5086492111AEB,  -130,  -20 },
+    { 0x8CBCCC096F5088CC,  -103,  -12 },
+    { 0xD1B71758E219652C,   -77,   -4 },
+    { 0x9C40000000000000,   -50,    4 },
+    { 0xE8D4A51000000000,   -24,   12 },
+    { 0xAD78EBC5AC620000,     3,   20 },
+    { 0x813F3978F8940984,    30,   28 },
+    { 0xC097CE7BC90715B3,    56,   36 },
+    { 0x8F7E32CE7BEA5C70,    83,   44 },
+    { 0xD5D238A4ABE98068,   109,   52 },
+    { 0x9F4F2726179A2245,   136,   60 },
+    { 0xED63A231D4C4FB27,   162,   68 },
+    { 0xB0DE65388CC8ADA8,   189,   76 },
+    { 0x83C7088E1AAB65DB,   216,   84 },
+    { 0xC45D1DF942711D9A,   242,   92 },
+    { 0x924D692CA61BE758,   269,  100 },
+    { 0xDA01EE641A708DEA,   295,  108 },
+    { 0xA26DA3999AEF774A,   322,  116 },
+    { 0xF209787BB47D6B85,   348,  124 },
+    { 0xB454E4A179DD1877,   375,  132 },
+    { 0x865B86925B9BC5C2,   402,  140 },
+    { 0xC83553C5C8965D3D,   428,  148 },
+    { 0x952AB45CFA97A0B3,   455,  156 },
+    { 0xDE469FBD99A05FE3,   481,  164 },
+    { 0xA59BC234DB398C25,   508,  172 },
+    { 0xF6C69A72A3989F5C,   534,  180 },
+    { 0xB7DCBF5354E9BECE,   561,  188 },
+    { 0x88FCF317F22241E2,   588,  196 },
+    { 0xCC20CE9BD35C78A5,   614,  204 },
+    { 0x98165AF37B2153DF,   641,  212 },
+    { 0xE2A0B5DC971F303A,   667,  220 },
+    { 0xA8D9D1535CE3B396,   694,  228 },
+    { 0xFB9B7CD9A4A7443C,   720,  236 },
+    { 0xBB764C4CA7A44410,   747,  244 },
+    { 0x8BAB8EEFB6409C1A,   774,  252 },
+    { 0xD01FEF10A657842C,   800,  260 },
+    { 0x9B10A4E5E9913129,   827,  268 },
+    { 0xE7109BFBA19C0C9D,   853,  276 },
+    { 0xAC2820D9623BF429,   880,  284 },
+    { 0x80444B5E7AA7CF85,   907,  292 },
+    { 0xBF21E44003ACDD2D,   933,  300 },
+    { 0x8E679C2F5E44FF8F,   960,  308 },
+    { 0xD433179D9C8CB841,   986,  316 },
+    { 0x9E19DB92B4E31BA9,  1013,  324 },
+    { 0xEB96BF6EBADF77D9,  1039,  332 },
+    { 0xAF87023B9BF0EE6B,  1066,  340 },
+};
+
+/* Digits of a double, and the associated decimal exponent:
+ * d = 0.digits * 10^exp10.
+ */
+static int grisu2_digits(double d, char digits[static 18], int *exp10)
+{
+    /* Range in which the binary exponent of the scaled boundaries must lie,
+     * so that the integral part fits in 32 bits. */
+    enum { GRISU_ALPHA = -60 };
+    uint64_t bits;
+    uint64_t frac;
+    int bexp;
+    diyfp_t v, m_plus, m_minus, one, w, w_plus, w_minus, c;
+    uint64_t delta, dist, p2, ten_k;
+    uint32_t p1, pow10;
+    int len = 0, n, k, idx;
+
+    memcpy(&bits, &d, sizeof(bits));
+    frac = bits & BITMASK_LT(uint64_t, 52);
+    bexp = (bits >> 52) & 0x7ff;
+    if (bexp) {
+        v = (diyfp_t){ frac | (1ULL << 52), bexp - 1075 };
+    } else {
+        v = (diyfp_t){ frac, -1074 };
+    }
+
+    /* Boundaries between d and its neighbours. */
+    m_plus = diyfp_normalize((diyfp_t){ 2 * v.f + 1, v.e - 1 });
+    if (frac == 0 && bexp > 1) {
+        m_minus = (diyfp_t){ 4 * v.f - 1, v.e - 2 };
+    } else {
+        m_minus = (diyfp_t){ 2 * v.f - 1, v.e - 1 };
+    }
+    m_minus.f <<= m_minus.e - m_plus.e;
+    m_minus.e = m_plus.e;
+
+    /* Scale by the cached power of ten that brings the exponent in the
+     * [alpha, alpha + 28] range. */
+    k = (GRISU_ALPHA - m_plus.e - 1) * 78913 / (1 << 18)
+      + (GRISU_ALPHA - m_plus.e - 1 > 0);
+    idx = (300 + k + 7) / 8;
+    c = (diyfp_t){ grisu_cached_powers_g[idx].f,
+                   grisu_cached_powers_g[idx].e };
+
+    w       = diyfp_mul(diyfp_normalize(v), c);
+    w_plus  = diyfp_mul(m_plus, c);
+    w_minus = diyfp_mul(m_minus, c);
+    w_plus.f--;
+    w_minus.f++;
+    *exp10 = -grisu_cached_powers_g[idx].k;
+
+    /* Generate the digits of w_plus until they are in the safe interval. */
+    delta = w_plus.f - w_minus.f;
+    dist  = w_plus.f - w.f;
+    one   = (diyfp_t){ 1ULL << -w_plus.e, w_plus.e };
+    p1    = w_plus.f >> -one.e;
+    p2    = w_plus.f & (one.f - 1);
+
+    for (n = 10, pow10 = 1000000000; n > 1 && p1 < pow10; n--) {
+        pow10 /= 10;
+    }
+
+    for (;;) {
+        if (n > 0) {
+            uint64_t rest;
+
+            digits[len++] = '0' + p1 / pow10;
+            p1 %= pow10;
+            n--;
+            rest = ((uint64_t)p1 << -one.e) + p2;
+            if (rest <= delta) {
+                *exp10 += n;
+                ten_k = (uint64_t)pow10 << -one.e;
+                p2 = rest;
+                break;
+            }
+            pow10 /= 10;
+        } else {
+            p2    *= 10;
+            delta *= 10;
+            dist  *= 10;
+            digits[len++] = '0' + (p2 >> -one.e);
+            p2 &= one.f - 1;
+            (*exp10)--;
+            if (p2 <= delta) {
+                ten_k = one.f;
+                break;
+            }
+        }
+    }
+
+    /* Round the last digit towards w. */
+    while (p2 < dist && delta - p2 >= ten_k
+    &&     (p2 + ten_k < dist || dist - p2 > p2 + ten_k - dist))
+    {
+        digits[len - 1]--;
+        p2 += ten_k;
+    }
+
+    /* 0.digits * 10^exp10 */
+    *exp10 += len;
+    return len;
+}
+
+int dtoa_shortest(char buf[static DTOA_SHORTEST_LEN], double d)
+{
+    char digits[18];
+    char *p = buf;
+    int len, exp10;
+
+    if (signbit(d)) {
+        *p++ = '-';
+        d = -d;
+    }
+    if (unlikely(!isfinite(d))) {
+        p = mempcpy(p, isnan(d) ? "nan" : "inf", 3);
+        *p = '\0';
+        return p - buf;
+    }
+    if (d == 0) {
+        *p++ = '0';
+        *p = '\0';
+        return p - buf;
+    }
+
+    len = grisu2_digits(d, digits, &exp10);
+
+    /* Same layout as "%.17g". */
+    if (exp10 < -3 || exp10 > 17) {
+        int e = exp10 - 1;
+
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            p = mempcpy(p, digits + 1, len - 1);
+        }
+        *p++ = 'e';
+        if (e < 0) {
+            *p++ = '-';
+            e = -e;
+        } else {
+            *p++ = '+';
+        }
+        if (e >= 100) {
+            *p++ = '0' + e / 100;
+            e %= 100;
+        }
+        *p++ = '0' + e / 10;
+        *p++ = '0' + e % 10;
+    } else
+    if (exp10 <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -exp10);
+        p = mempcpy(p - exp10, digits, len);
+    } else
+    if (exp10 < len) {
+        p = mempcpy(p, digits, exp10);
+        *p++ = '.';
+        p = mempcpy(p, digits + exp10, len - exp10);
+    } else {
+        p = mempcpy(p, digits, len);
+        memset(p, '0', exp10 - len);
+        p += exp10 - len;
+    }
+    *p = '\0';
+    return p - buf;
+}
+
+/* Exact powers of ten representable as doubles. */
+static const double exact_pow10_g[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* Clinger's fast path: when the decimal mantissa and the power of ten are
+ * both exactly representable, a single multiplication or division is
+ * correctly rounded. Returns false for anything else (including inf, nan
+ * and hexadecimal numbers), that is parsed by strtod().
+ */
+static bool strtod_fast_path(const char *s, double *res, const char **endp)
+{
+    const char *p = s;
+    bool negative = false;
+    bool has_digits = false;
+    uint64_t mantissa = 0;
+    int nb_digits = 0;
+    int exp10 = 0;
+
+    if (*p == '-' || *p == '+') {
+        negative = *p++ == '-';
+    }
+    if (p[0] == '0' && (p[1] | 0x20) == 'x') {
+        return false;
+    }
+    for (; *p >= '0' && *p <= '9'; p++) {
+        if ((nb_digits || *p != '0') && ++nb_digits > 19) {
+            return false;
+        }
+        mantissa = mantissa * 10 + (*p - '0');
+        has_digits = true;
+    }
+    if (*p == '.') {
+        for (p++; *p >= '0' && *p <= '9'; p++) {
+            if ((nb_digits || *p != '0') && ++nb_digits > 19) {
+                return false;
+            }
+            mantissa = mantissa * 10 + (*p - '0');
+            exp10--;
+            has_digits = true;
+        }
+    }
+    if (!has_digits) {
+        return false;
+    }
+    if ((*p | 0x20) == 'e') {
+        const char *e = p + 1;
+        bool exp_negative = false;
+        int exp = 0;
+
+        if (*e == '-' || *e == '+') {
+            exp_negative = *e++ == '-';
+        }
+        if (*e >= '0' && *e <= '9') {
+            for (; *e >= '0' && *e <= '9'; e++) {
+                if (exp > 1000) {
+                    return false;
+                }
+                exp = exp * 10 + (*e - '0');
+            }
+            exp10 += exp_negative ? -exp : exp;
+            p = e;
+        }
+    }
+
+    if (mantissa > (1ULL << 53)) {
+        return false;
+    }
+    if (exp10 < 0) {
+        if (exp10 < -22) {
+            return false;
+        }
+        *res = (double)mantissa / exact_pow10_g[-exp10];
+    } else {
+        if (exp10 > 22) {
+            /* 15e29 = 150000000e22: move the extra zeros in the mantissa */
+            if (exp10 > 22 + 15 || mantissa == 0) {
+                return false;
+            }
+            for (; exp10 > 22; exp10--) {
+                mantissa *= 10;
+                if (mantissa > (1ULL << 53)) {
+                    return false;
+                }
+            }
+        }
+        *res = (double)mantissa * exact_pow10_g[exp10];
+    }
+    if (negative) {
+        *res = -*res;
+    }
+    *endp = p;
+    return true;
+}
+
+/*}}} */
+
 /*{{{ integer extraction with iop extensions */
 
 static
@@ -476,8 +866,15 @@ int strtoull_ext(const char *s, uint64_t *out, const char **tail, int base)
 double strtod_allow_subnormal(const char *nptr, char **endptr)
 {
     double res = 0.;
+    const char *end;
 
     errno = 0;
+    if (strtod_fast_path(nptr, &res, &end)) {
+        if (endptr) {
+            *endptr = (char *)end;
+        }
+        return res;
+    }
     res = strtod(nptr, endptr);
 
     if (errno) {
@@ -142,6 +142,21 @@ int strtoll_ext(const char * nonnull s, int64_t * nonnull out,
 int strtoull_ext(const char * nonnull s, uint64_t * nonnull out,
                  const char * nullable * nullable tail, int base);
 
+/** Maximum length of the output of dtoa_shortest(), including the NUL. */
+#define DTOA_SHORTEST_LEN  25
+
+/** Format a double with the shortest digits that read back to it.
+ *
+ * The output uses the same layout as "%.17g" (decimal notation for the
+ * exponents in [-4, 17[, scientific notation otherwise, "nan" and "inf"),
+ * but with as few digits as possible: 0.1 is written "0.1", not
+ * "0.10000000000000001".
+ *
+ * \return the length of the output, which is NUL terminated.
+ */
+int dtoa_shortest(char buf[static DTOA_SHORTEST_LEN], double d)
+    __leaf;
+
 /** Wrapper around strtod that do not consider subnormal values as errors.
  *
  * As defined in the C standard, subnormal values are "too small to be
@@ -152,6 +167,9 @@ int strtoull_ext(const char * nonnull s, uint64_t * nonnull out,
  *
  * This helper wraps strtod to not set errno to ERANGE in the case of
  * subnormal values.
+ *
+ * Decimal numbers with at most 19 significant digits and a small exponent
+ * (the usual case) are parsed without calling strtod.
  */
 double strtod_allow_subnormal(const char * nonnull nptr,
                               char * nullable * nullable endptr);
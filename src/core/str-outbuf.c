@@ -16,6 +16,8 @@
 /*                                                                         */
 /***************************************************************************/
 
+#include <sys/sendfile.h>
+
 #include <lib-common/unix.h>
 #include <lib-common/str-outbuf.h>
 
@@ -44,6 +46,12 @@ void ob_chunk_wipe(outbuf_chunk_t *obc)
       case OUTBUF_DO_MUNMAP:
         munmap(obc->u.vp, obc->length);
         break;
+      case OUTBUF_DO_CLOSE:
+        close(obc->file_fd);
+        break;
+      case OUTBUF_DO_RELEASE:
+        (*obc->on_release)(obc->release_priv);
+        break;
     }
 }
 
@@ -132,22 +140,39 @@ int ob_add_file(outbuf_t *ob, const char *file, int size)
         }
         size = st.st_size;
     }
+    return ob_add_file_range(ob, fd, 0, size, true);
+}
+
+int ob_add_file_range(outbuf_t *ob, int fd, off_t off, int len, bool own_fd)
+{
+    outbuf_chunk_t *obc;
+
+    if (len <= OUTBUF_CHUNK_MIN_SIZE) {
+        void *p = sb_grow(&ob->sb, len);
+        int res = xpread(fd, p, len, off);
 
-    if (size <= OUTBUF_CHUNK_MIN_SIZE) {
-        if (ob_xread(ob, fd, size)) {
+        if (own_fd) {
             PROTECT_ERRNO(close(fd));
-            return -1;
         }
-        close(fd);
-    } else {
-        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        RETHROW(res);
+        __sb_fixlen(&ob->sb, ob->sb.len + len);
+        ob->sb_trailing += len;
+        ob->length      += len;
+        return 0;
+    }
 
-        PROTECT_ERRNO(close(fd));
-        if (map == MAP_FAILED)
-            return -1;
-        madvise(map, size, MADV_SEQUENTIAL);
-        ob_add_memmap(ob, map, size);
+    /* The range is read sequentially, let the kernel read ahead. */
+    posix_fadvise(fd, off, len, POSIX_FADV_SEQUENTIAL);
+
+    obc = p_new(outbuf_chunk_t, 1);
+    obc->is_file  = true;
+    obc->file_fd  = fd;
+    obc->file_off = off;
+    obc->length   = len;
+    if (own_fd) {
+        obc->on_wipe = OUTBUF_DO_CLOSE;
     }
+    ob_add_chunk(ob, obc);
     return 0;
 }
 
@@ -186,6 +211,41 @@ static int ob_consume(outbuf_t *ob, int len)
     return 0;
 }
 
+/* Send the head of a file range chunk. The file goes through a bounce
+ * buffer when a custom writer is used, as it cannot be given to
+ * sendfile(2). */
+static ssize_t
+ob_send_file_chunk(outbuf_chunk_t *obc, int fd,
+                   ssize_t (*writerv)(int, const struct iovec *, int, void *),
+                   void *priv)
+{
+#define BOUNCE_SIZE  (64U << 10)
+    off_t  off = obc->file_off + obc->offset;
+    size_t len = obc->length - obc->offset;
+    ssize_t res;
+
+    if (writerv) {
+        t_scope;
+        char *buf = t_new_raw(char, MIN(len, BOUNCE_SIZE));
+        struct iovec iov;
+
+        res = RETHROW(pread(obc->file_fd, buf, MIN(len, BOUNCE_SIZE), off));
+        if (res > 0) {
+            iov = MAKE_IOVEC(buf, res);
+            res = (*writerv)(fd, &iov, 1, priv);
+        }
+    } else {
+        res = RETHROW(sendfile(fd, obc->file_fd, &off, len));
+    }
+    if (res == 0) {
+        /* The file was truncated. */
+        errno = EIO;
+        return -1;
+    }
+    return res;
+#undef BOUNCE_SIZE
+}
+
 int ob_write_with(outbuf_t *ob, int fd,
                   ssize_t (*writerv)(int, const struct iovec *, int, void *),
                   void *priv)
@@ -208,6 +268,15 @@ int ob_write_with(outbuf_t *ob, int fd,
             iov_size += len;
         }
 
+        if (obc->is_file) {
+            /* Flush what precedes the file before sending it. */
+            if (iovcnt) {
+                goto doit;
+            }
+            return ob_consume(ob, RETHROW(ob_send_file_chunk(obc, fd, writerv,
+                                                             priv)));
+        }
+
         len = obc->length - obc->offset;
         iov[iovcnt++] = MAKE_IOVEC(obc->u.b + obc->offset, len);
         iov_size += len;
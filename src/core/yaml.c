@@ -388,7 +388,9 @@ t_yaml_scalar_to_string(const yaml_scalar_t * nonnull scalar)
         if (isnan(scalar->d)) {
             return LSTR(".NaN");
         } else {
-            return t_lstr_fmt("%.17g", scalar->d);
+            char *buf = t_new_raw(char, DTOA_SHORTEST_LEN);
+
+            return LSTR_INIT_V(buf, dtoa_shortest(buf, scalar->d));
         }
       } break;
 
@@ -4023,7 +4025,7 @@ yaml_pack_scalar(yaml_pack_env_t * nonnull env,
         if (isnan(scalar->d)) {
             PUTS(".NaN");
         } else {
-            WRITE(ibuf, sprintf(ibuf, "%.17g", scalar->d));
+            WRITE(ibuf, dtoa_shortest(ibuf, scalar->d));
         }
       } break;
 
@@ -10620,7 +10622,7 @@ Z_GROUP_EXPORT(yaml)
             "- 0.66666666666666666667\n",
 
             "- 12000\n"
-            "- 0.66666666666666663"
+            "- 0.6666666666666666"
         ));
     } Z_TEST_END;
 
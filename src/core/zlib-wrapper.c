@@ -52,3 +52,89 @@ ssize_t sb_add_compressed(sb_t *out, const void *data, size_t dlen,
         }
     }
 }
+
+ssize_t sb_add_deflate(sb_t *out, z_stream *stream, const void *data,
+                       size_t dlen, int flush)
+{
+    int err;
+    sb_t orig = *out;
+
+    stream->next_in  = (Bytef *)data;
+    stream->avail_in = dlen;
+
+    for (;;) {
+        stream->next_out  = (Bytef *)sb_grow(out, MAX(stream->avail_in / 2,
+                                                      128));
+        stream->avail_out = sb_avail(out);
+
+        err = deflate(stream, flush);
+        __sb_fixlen(out, (char *)stream->next_out - out->data);
+
+        switch (err) {
+          case Z_OK:
+            /* The output space was filled, or the stream is not finished:
+             * more output is pending. */
+            if (stream->avail_out == 0 || flush == Z_FINISH) {
+                break;
+            }
+            return out->len - orig.len;
+          case Z_STREAM_END:
+          case Z_BUF_ERROR:
+            /* Z_BUF_ERROR: no progress possible, everything was already
+             * output. */
+            return out->len - orig.len;
+          default:
+            __sb_rewind_adds(out, &orig);
+            return err;
+        }
+    }
+}
+
+ssize_t sb_add_uncompressed(sb_t *out, const void *data, size_t dlen)
+{
+    int err;
+    sb_t orig = *out;
+    z_stream stream = {
+        .next_in   = (Bytef *)data,
+        .avail_in  = dlen,
+    };
+
+    /* 32 enables the automatic detection of the zlib or gzip header. */
+    RETHROW(inflateInit2(&stream, MAX_WBITS + 32));
+
+    for (;;) {
+        stream.next_out  = (Bytef *)sb_grow(out, MAX(stream.avail_in * 2,
+                                                     1024));
+        stream.avail_out = sb_avail(out);
+
+        err = inflate(&stream, Z_NO_FLUSH);
+        __sb_fixlen(out, (char *)stream.next_out - out->data);
+
+        switch (err) {
+          case Z_STREAM_END:
+            if (stream.avail_in == 0) {
+                IGNORE(inflateEnd(&stream));
+                return out->len - orig.len;
+            }
+            /* Another gzip member follows */
+            if ((err = inflateReset(&stream)) != Z_OK) {
+                goto error;
+            }
+            break;
+          case Z_OK:
+            break;
+          case Z_BUF_ERROR:
+            /* No progress possible with free output space: the compressed
+             * data is truncated. */
+            err = Z_DATA_ERROR;
+            goto error;
+          default:
+            goto error;
+        }
+    }
+
+  error:
+    __sb_rewind_adds(out, &orig);
+    IGNORE(inflateEnd(&stream));
+    return err;
+}
@@ -271,6 +271,17 @@ int   el_fds_loop(el_t nonnull * nonnull els, int el_count, int timeout,
 
 short el_fd_get_mask(el_t nonnull) __leaf __attribute__((pure));
 short el_fd_set_mask(el_t nonnull, short events) __leaf;
+
+/** Make the wake-ups on a file descriptor exclusive.
+ *
+ * When several processes poll the same file, typically a listening socket
+ * shared by forked workers, an event wakes up only one of them instead of
+ * all of them (EPOLLEXCLUSIVE). The mask of events of the el_t must not be
+ * changed afterwards.
+ *
+ * \return -1 if exclusive wake-ups are not supported by the kernel.
+ */
+int   el_fd_set_exclusive(el_t nonnull) __leaf;
 int   el_fd_get_fd(el_t nonnull) __leaf __attribute__((pure));
 void  el_fd_mark_fired(el_t nonnull) __leaf;
 
@@ -64,20 +64,27 @@
 
 #define FILE_BIN_DEFAULT_SLOT_SIZE  (1 << 20) /* 1 Megabyte */
 
+struct file_bin_gc_t;
+
 typedef struct file_bin_t {
     bool read_mode;
 
     /* Read/Write mode common fields. */
     FILE     *f;
+    struct file_bin_gc_t *gc; /* group commit context, see below */
     off_t     cur;
     lstr_t    path;
     uint32_t  slot_size;
     uint16_t  version;
 
     /* Read mode fields. */
-    uint32_t  length;
+    off_t     length;
     byte     *map;
     sb_t      record_buf;
+
+    /* Gzip compressed file, uncompressed in memory: map is not a mapping
+     * of the file. */
+    bool      compressed;
 } file_bin_t;
 static inline file_bin_t *file_bin_init(file_bin_t *var)
 {
@@ -140,6 +147,69 @@ int file_bin_flush(file_bin_t *file);
 __must_check__
 int file_bin_sync(file_bin_t *file);
 
+/* }}} */
+/* {{{ Group commit */
+
+/* In group commit mode, the records are formatted in a buffer shared by the
+ * writers, and a dedicated thread writes them by batches: each batch is
+ * written with a single write(2), followed by a single fdatasync(2) when
+ * requested. Records put while a batch is written are part of the next
+ * one, so that the cost of the synchronization is shared by all the
+ * records of a batch.
+ *
+ * file_bin_put_record() can then be called from several threads, and
+ * file_bin_flush() waits until every record put before the call is written
+ * (and synced). file_bin_truncate() must not be called concurrently with
+ * other writers.
+ *
+ * When a batch cannot be written, the records of the next ones are dropped
+ * and their callbacks get the error, as well as the following puts and
+ * flushes, until the group commit mode is left.
+ */
+
+typedef enum file_bin_gc_sync_t {
+    FILE_BIN_GC_NOSYNC,    /* batches are written, but not synced */
+    FILE_BIN_GC_FDATASYNC, /* each batch is followed by a fdatasync(2) */
+} file_bin_gc_sync_t;
+
+/** Callback called when a record is durable (or failed to be written).
+ *
+ * It is called from the writer thread, with a negative \p res on error.
+ * It must not call file_bin_flush() (or anything waiting for the writer
+ * thread, such as a put blocked by \p max_pending), which would deadlock.
+ */
+typedef void (file_bin_gc_cb_f)(int res, data_t priv);
+
+/** Switch a binary file opened for writing to group commit mode.
+ *
+ * \param[in]  file         The binary file, created with file_bin_create.
+ * \param[in]  sync         The durability of the batches.
+ * \param[in]  max_pending  Maximum amount of data waiting to be written:
+ *                          writers block when it is reached. 0 means no
+ *                          limit.
+ *
+ * \return  0 on success, negative value otherwise.
+ */
+__must_check__
+int file_bin_start_group_commit(file_bin_t *file, file_bin_gc_sync_t sync,
+                                size_t max_pending);
+
+/** Leave the group commit mode, after all the records are written.
+ *
+ * This is done by file_bin_close().
+ */
+__must_check__
+int file_bin_stop_group_commit(file_bin_t *file);
+
+/** Put a record in a binary file in group commit mode.
+ *
+ * Same as file_bin_put_record(), but \p cb is called once the record is
+ * durable.
+ */
+__must_check__
+int file_bin_put_record_cb(file_bin_t *file, const void *data, uint32_t len,
+                           file_bin_gc_cb_f *cb, data_t priv);
+
 /* }}} */
 /* {{{ Reading */
 
@@ -148,6 +218,9 @@ int file_bin_sync(file_bin_t *file);
  * This function will do a read-only opening on the binary file specified,
  * making it ready to be parsed.
  *
+ * Gzip compressed files (such as compressed rotated log files) are
+ * supported: they are uncompressed in memory, and cannot be refreshed.
+ *
  * \param[in] path  The path to the binary file to read.
  *
  * \return the newly created file_bin_t on success, NULL otherwise.
@@ -156,7 +229,8 @@ file_bin_t *file_bin_open(lstr_t path);
 
 /** Refresh the mapping of a binary file if needed.
  *
- * If binary file has changed, its content will be reloaded in memory.
+ * If binary file has changed, its content will be reloaded in memory. This
+ * is a no-op for compressed files.
  *
  * \param[in] file  The binary file to refresh.
  *
@@ -246,6 +320,133 @@ static inline bool file_bin_has(file_bin_t *file, off_t len)
 __must_check__
 int _file_bin_seek(file_bin_t *file, off_t pos);
 
+/* }}} */
+/* {{{ Parallel reading */
+
+/* A binary file opened for reading can be split in ranges of whole slots
+ * that are read independently, for example with thr_for_each():
+ *
+ *     qv_t(file_bin_range) ranges;
+ *
+ *     qv_init(&ranges);
+ *     file_bin_split(file, thr_parallelism_g, &ranges);
+ *     thr_for_each(ranges.len, ^(size_t pos) {
+ *         file_bin_range_for_each_entry(&ranges.tab[pos], entry) {
+ *             ...
+ *         }
+ *     });
+ *     qv_deep_wipe(&ranges, file_bin_range_wipe);
+ *
+ * A record is read from the range in which it starts, so that each record
+ * of the file is read exactly once. The ranges share the mapping of the
+ * file, which must not be refreshed nor closed while they are in use.
+ */
+
+typedef struct file_bin_range_t {
+    off_t start; /* beginning of the first slot of the range */
+    off_t end;   /* end of the last slot of the range */
+
+    /* Copy of the file, with its own reading position. */
+    file_bin_t reader;
+} file_bin_range_t;
+qvector_t(file_bin_range, file_bin_range_t);
+
+static inline void file_bin_range_wipe(file_bin_range_t *range)
+{
+    sb_wipe(&range->reader.record_buf);
+}
+
+/** Split a binary file in ranges of slots.
+ *
+ * \param[in]  file       The binary file, opened for reading.
+ * \param[in]  nb_ranges  The number of ranges wanted; less ranges are
+ *                        created when the file does not have enough slots.
+ * \param[out] out        The vector to which the ranges are appended.
+ */
+void file_bin_split(file_bin_t *file, int nb_ranges,
+                    qv_t(file_bin_range) *out);
+
+/** Get next record from a range.
+ *
+ * Same as file_bin_get_next_record(), but stops at the end of the range.
+ */
+lstr_t file_bin_range_get_next_record(file_bin_range_t *range);
+
+/** Iterates on each record of a range, see file_bin_for_each_entry(). */
+#define file_bin_range_for_each_entry(range, entry)                          \
+    for (lstr_t entry = file_bin_range_get_next_record(range);               \
+         entry.s; entry = file_bin_range_get_next_record(range))
+
+/* }}} */
+/* {{{ Record index */
+
+/* A sparse index of the records of a binary file: the reading position of
+ * one record every \p stride records is kept, so that a record can be
+ * fetched by its number by parsing at most \p stride records.
+ *
+ * The index is built incrementally by file_bin_index_update(), and can be
+ * saved next to the file to avoid parsing the whole file again.
+ */
+
+typedef struct file_bin_index_t {
+    uint32_t  stride;
+    uint64_t  nb_records;
+    off_t     end;     /* reading position after the last indexed record */
+    qv_t(u64) offsets; /* reading position of records 0, stride, ... */
+} file_bin_index_t;
+
+static inline file_bin_index_t *
+file_bin_index_init(file_bin_index_t *index, uint32_t stride)
+{
+    p_clear(index, 1);
+    index->stride = MAX(stride, 1U);
+    qv_init(&index->offsets);
+    return index;
+}
+
+static inline void file_bin_index_wipe(file_bin_index_t *index)
+{
+    qv_wipe(&index->offsets);
+}
+
+/** Index the records added to a binary file since the last update.
+ *
+ * The mapping of the file is refreshed first. The current reading position
+ * of the file is preserved.
+ *
+ * \return  0 on success, a negative value otherwise.
+ */
+__must_check__
+int file_bin_index_update(file_bin_t *file, file_bin_index_t *index);
+
+/** Get a record of a binary file by its number.
+ *
+ * The current reading position of the file is moved after the record, so
+ * that the following records can be read with file_bin_get_next_record().
+ *
+ * \return  the record, LSTR_NULL_V if \p n is not indexed.
+ */
+lstr_t file_bin_get_record(file_bin_t *file, const file_bin_index_t *index,
+                           uint64_t n);
+
+/** Save an index in a file. */
+__must_check__
+int file_bin_index_save(const file_bin_t *file,
+                        const file_bin_index_t *index, const char *path);
+
+/** Load an index saved by file_bin_index_save().
+ *
+ * The index is checked against \p file; it can then be updated with
+ * file_bin_index_update() if the file grew since it was saved.
+ *
+ * \param[in]  file   The binary file, opened for reading.
+ * \param[in]  path   The path of the saved index.
+ * \param[out] index  The index, to be wiped by the caller on success.
+ */
+__must_check__
+int file_bin_index_load(const file_bin_t *file, const char *path,
+                        file_bin_index_t *index);
+
 /* }}} */
 
 /** Close a previously opened or created file_bin.
@@ -42,8 +42,19 @@ enum log_file_flags {
 
     /* Force a rotation when opening the log_file_t. */
     LOG_FILE_FORCE_ROTATE = (1U << 4),
+
+    /* Compress the data while writing it, as a sequence of independent gzip
+     * members of LOG_FILE_GZ_FRAME_SIZE uncompressed bytes at most. The
+     * files are named after the extension followed by ".gz", and are
+     * readable with zcat. Only text log files can be streamed, this flag
+     * falls back on LOG_FILE_COMPRESS for file_bin log files. */
+    LOG_FILE_COMPRESS_STREAM = (1U << 5),
 };
 
+/* A gzip member is written each time this amount of data is pending, and
+ * on flush, rotation and close. */
+#define LOG_FILE_GZ_FRAME_SIZE  (1 << 20)
+
 enum log_file_event {
     LOG_FILE_CREATE, /* just after a new file creation */
     LOG_FILE_CLOSE,  /* called after file_close is called */
@@ -84,6 +95,11 @@ typedef struct log_file_t {
     /* Flags. */
     bool disable_rotation : 1;
     bool is_file_bin      : 1;
+    bool group_commit     : 1;
+
+    /* Group commit of file_bin files, see log_file_set_group_commit. */
+    file_bin_gc_sync_t gc_sync;
+    size_t             gc_max_pending;
 
     /* Event callback */
     log_file_cb_f *on_event;
@@ -91,6 +107,7 @@ typedef struct log_file_t {
 
     /* Internal usage. */
     qh_t(u64) files_being_compressed;
+    sb_t gz_pending; /* data of the gzip member being built */
     int refcnt;
 } log_file_t;
 
@@ -127,7 +144,26 @@ log_file_set_file_cb(log_file_t *file, log_file_cb_f *on_event,
                      void *priv);
 void log_file_set_mode(log_file_t *file, uint32_t mode);
 
+/** Write the file_bin log files in group commit mode.
+ *
+ * The records are written by batches from a dedicated thread, see
+ * file_bin_start_group_commit. log_file_flush() then waits until the
+ * records are written (and synced, depending on \p sync). Must be called
+ * before log_file_open().
+ */
+void log_file_set_group_commit(log_file_t *file, file_bin_gc_sync_t sync,
+                               size_t max_pending);
+
 int log_fwrite(log_file_t *log_file, const void *data, size_t len);
+
+/** Write a record in a file_bin log file, and get notified when durable.
+ *
+ * In group commit mode, \p cb is called from the writer thread once the
+ * batch of the record is written. Otherwise, the file is synced and \p cb
+ * is called before returning. \p cb is only called when 0 is returned.
+ */
+int log_fwrite_cb(log_file_t *log_file, const void *data, size_t len,
+                  file_bin_gc_cb_f *cb, data_t priv);
 int log_fwritev(log_file_t *log_file, struct iovec *iov, size_t iovlen);
 int log_fprintf(log_file_t *log_file, const char *format, ...)
     __attr_printf__(2, 3)  __attr_nonnull__((1, 2));
@@ -190,6 +190,7 @@ typedef struct httpd_qinfo_t httpd_qinfo_t;
 typedef struct httpd_cfg_t          httpd_cfg_t;
 typedef struct httpd_trigger_node_t httpd_trigger_node_t;
 typedef struct httpd_trigger_t      httpd_trigger_t;
+typedef struct httpd_rcache_t       httpd_rcache_t;
 
 qm_kvec_t(http_path, lstr_t, httpd_trigger_node_t * nonnull,
           qhash_lstr_hash, qhash_lstr_equal);
@@ -238,6 +239,7 @@ typedef struct httpd_http2_ctx_t httpd_http2_ctx_t;
     uint16_t           queries_done;                                         \
     unsigned           max_queries;                                          \
     int                chunk_length;                                         \
+    int                hdrs_lines; /* LFs seen while scanning headers */     \
                                                                              \
     dlist_t            query_list;                                           \
     outbuf_t           ob;                                                   \
@@ -342,6 +344,10 @@ struct httpd_trigger_t {
                                    const iop_struct_t * nullable st,
                                    const void * nullable exn,
                                    http_code_t * nonnull code);
+
+    /* Opt-in cache of the responses, see #httpd_reply_cached(). It is
+     * deleted with the trigger. */
+    httpd_rcache_t * nullable rcache;
 };
 
 struct httpd_trigger_node_t {
@@ -385,6 +391,36 @@ void httpd_cfg_set_ssl_ctx(httpd_cfg_t *nonnull cfg, SSL_CTX *nullable ctx);
 
 el_t nullable httpd_listen(sockunion_t * nonnull su, httpd_cfg_t * nonnull);
 void httpd_unlisten(el_t nullable * nonnull ev);
+
+/** Fork workers listening on the same address.
+ *
+ * Each worker is a forked process, with its own event loop, that listens
+ * to \p su on its own SO_REUSEPORT socket: the kernel balances the
+ * incoming connections between the workers. Where SO_REUSEPORT is not
+ * supported, and for unix sockets, the workers share a single listening
+ * socket, polled with EPOLLEXCLUSIVE so that a connection wakes up a single
+ * worker.
+ *
+ * The sockets are bound before forking, so that binding errors are
+ * reported to the caller; a 0 port in \p su is replaced by the port picked
+ * by the system.
+ *
+ * \param[in]  su          the address to listen to.
+ * \param[in]  cfg         the configuration of the workers.
+ * \param[in]  nb_workers  the number of workers to fork.
+ * \param[in]  pin_cpus    whether the worker \c i must be bound to the CPU
+ *                         \c i modulo the number of CPUs.
+ * \param[out] pids        the pids of the forked workers, in the caller.
+ * \param[out] ev          the listener of the worker, in the workers. It
+ *                         must be released with httpd_unlisten().
+ *
+ * \return -1 on error (the workers forked so far are in \p pids), 0 in the
+ *         caller and the index of the worker, starting at 1, in the
+ *         workers.
+ */
+int httpd_fork_workers(sockunion_t * nonnull su, httpd_cfg_t * nonnull cfg,
+                       int nb_workers, bool pin_cpus,
+                       qv_t(i32) * nonnull pids, el_t nullable * nonnull ev);
 httpd_t * nonnull httpd_spawn(int fd, httpd_cfg_t * nonnull);
 
 /** gently close an httpd connection.
@@ -531,6 +567,7 @@ struct httpd_qinfo_t {
     bool                chunked       : 1;                                   \
     bool                conn_close    : 1;                                   \
     bool                status_sent   : 1;                                   \
+    bool                rcache_gzip   : 1;                                   \
                                                                              \
     uint16_t            answer_code;                                         \
     uint16_t            http_version;                                        \
@@ -545,6 +582,7 @@ struct httpd_qinfo_t {
     int                 ready_threshold;                                     \
                                                                              \
     sb_t                payload;                                             \
+    lstr_t              rcache_key;                                          \
     outbuf_t           * nullable ob;                                        \
     httpd_qinfo_t      * nullable qinfo;                                     \
     void               * nullable priv;                                      \
@@ -725,11 +763,54 @@ void httpd_reject_(httpd_query_t * nonnull q, int code,
     httpd_reject_(q, HTTP_CODE_##code, fmt, ##__VA_ARGS__)
 void httpd_reject_unauthorized(httpd_query_t * nonnull q, lstr_t auth_realm);
 
+/*---- responses cache ----*/
+
+/** Cache of the responses of an httpd trigger.
+ *
+ * Triggers whose body only depends on the query path and vars (metrics
+ * pages, WSDL or OpenAPI documents, ...) can opt in by setting
+ * httpd_trigger_t#rcache, and by answering with #httpd_reply_cached().
+ *
+ * The GET queries on such a trigger are looked up in the cache, keyed by
+ * their path and vars, before the trigger callback is called: hits are
+ * answered right away, without calling it. The body is stored along with
+ * a gzip variant, sent to the clients accepting it, and both are sent
+ * without being copied.
+ *
+ * Entries expire after \p ttl seconds, and can be invalidated explicitly
+ * with #httpd_rcache_invalidate().
+ */
+typedef struct httpd_rcache_stats_t {
+    uint64_t hits;
+    uint64_t misses;
+    double   hit_ratio;
+    int      entries;
+    size_t   memory;
+} httpd_rcache_stats_t;
+
+httpd_rcache_t * nonnull httpd_rcache_new(int ttl, size_t memory_max);
+void httpd_rcache_delete(httpd_rcache_t * nullable * nonnull rcp);
+
+/** Drop the cached responses of \p path, or all of them if \p path is
+ * LSTR_NULL_V. */
+void httpd_rcache_invalidate(httpd_rcache_t * nonnull rc, lstr_t path);
+void httpd_rcache_get_stats(const httpd_rcache_t * nonnull rc,
+                            httpd_rcache_stats_t * nonnull stats);
+
+/** Reply a 200 with \p body, and store it in the cache of the trigger.
+ *
+ * When the trigger has no cache, the body is simply sent.
+ */
+void httpd_reply_cached(httpd_query_t * nonnull q, lstr_t ctype,
+                        lstr_t body);
+
 
 /*---- http-srv-static.c ----*/
 void httpd_reply_make_index(httpd_query_t * nonnull q, int dirfd, bool head);
 void httpd_reply_file(httpd_query_t * nonnull q, int dirfd,
                       const char * nonnull file, bool head);
+/** Close the files kept open by httpd_reply_file(). */
+void httpd_file_cache_wipe(void);
 
 httpd_trigger_t * nonnull
 httpd_trigger__static_dir_new(const char * nonnull path);
@@ -815,6 +896,7 @@ typedef struct http2c_ctx_t http2c_ctx_t;
     uint8_t       state;                                                     \
     uint16_t      queries;                                                   \
     int           chunk_length;                                              \
+    int           hdrs_lines; /* LFs seen while scanning headers */          \
     unsigned      max_queries;                                               \
     unsigned      received_hdr_length;                                       \
     unsigned      received_body_length;                                      \
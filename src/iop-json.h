@@ -349,6 +349,93 @@ int  iop_jlex_write_error_buf(iop_json_lex_t * nonnull ll,
                               char * nonnull buf, int len);
 
 
+/* }}} */
+/* {{{ Streaming JSon parsing */
+
+/** Incremental JSon unpacker.
+ *
+ * This unpacker is meant for documents containing a huge array of objects,
+ * such as bulk REST uploads. It is fed with chunks of the document as they
+ * are received (see iop_junpack_stream_feed()), and unpacks the elements of
+ * one repeated field of the top-level object one by one, giving each of them
+ * to a callback. Only the element being received is kept in memory.
+ *
+ * The rest of the document is unpacked at the end
+ * (t_iop_junpack_stream_end()), the streamed field being left empty.
+ *
+ * The document is split in elements with a lightweight structural scanner
+ * which understands strings and nesting, but not the extended syntax of the
+ * IOP JSon unpacker: the streamed array must contain objects ({ ... }) and
+ * must not contain comments.
+ */
+typedef struct iop_junpack_stream_t iop_junpack_stream_t;
+
+/** Callback called for each element of the streamed field.
+ *
+ * \param[in] priv   The private data given to iop_junpack_stream_new().
+ * \param[in] fdesc  The descriptor of the streamed field.
+ * \param[in] elem   The unpacked element, allocated on the t_pool(); it is
+ *                   only valid during the call.
+ *
+ * \return A negative value to abort the unpacking.
+ */
+typedef int (iop_junpack_stream_elem_f)(void * nullable priv,
+                                        const iop_field_t * nonnull fdesc,
+                                        const void * nonnull elem);
+
+/** Create an incremental JSon unpacker.
+ *
+ * \param[in]  iop_env   The IOP environment.
+ * \param[in]  st        The IOP structure description of the document.
+ * \param[in]  field     The name of the repeated field of \p st whose
+ *                       elements are streamed. It must be a field of
+ *                       structures, unions or classes.
+ * \param[in]  flags     Unpacker flags to use (see iop_jlex_set_flags).
+ * \param[in]  max_size  Maximum size of the data kept in memory (the
+ *                       element being received, and the document without
+ *                       the streamed field), 0 for no limit.
+ * \param[in]  on_elem   Callback called for each element.
+ * \param[in]  priv      Private data given to \p on_elem.
+ * \param[out] err       NULL or the buffer to use to write textual error.
+ *
+ * \return NULL if \p field is not a valid field to stream.
+ */
+iop_junpack_stream_t * nullable
+iop_junpack_stream_new(const iop_env_t * nonnull iop_env,
+                       const iop_struct_t * nonnull st, lstr_t field,
+                       int flags, size_t max_size,
+                       iop_junpack_stream_elem_f * nonnull on_elem,
+                       void * nullable priv, sb_t * nullable err);
+
+void iop_junpack_stream_delete(iop_junpack_stream_t * nullable * nonnull js);
+
+/** Feed the incremental JSon unpacker with a chunk of the document.
+ *
+ * The callback is called for each element of the streamed field completed
+ * by this chunk.
+ *
+ * \return 0 on success, a negative value if the document is invalid, if the
+ *         maximum size is reached or if the callback failed. The unpacker
+ *         cannot be used anymore after an error.
+ */
+int iop_junpack_stream_feed(iop_junpack_stream_t * nonnull js, pstream_t ps,
+                            sb_t * nullable err);
+
+/** Finish the incremental unpacking.
+ *
+ * \param[in]  js   The incremental JSon unpacker.
+ * \param[out] out  Pointer on the unpacked IOP structure, allocated on the
+ *                  t_pool(). The streamed field is empty.
+ * \param[out] err  NULL or the buffer to use to write textual error.
+ *
+ * \return 0 on success, a negative value if the document is incomplete or
+ *         invalid.
+ */
+__must_check__
+int t_iop_junpack_stream_end(iop_junpack_stream_t * nonnull js,
+                             void * nullable * nonnull out,
+                             sb_t * nullable err);
+
 /* }}} */
 /* {{{ Generating JSon */
 
@@ -431,6 +518,9 @@ typedef int (iop_jpack_writecb_f)(void * nonnull priv,
  *
  * This function packs an IOP structure into (strict) JSon format.
  *
+ * The output is buffered internally and given to \p writecb by chunks of a
+ * few kilobytes.
+ *
  * \param[in] st       IOP structure description.
  * \param[in] value    Pointer on the IOP structure to pack.
  * \param[in] writecb  Callback to call when writing (like iop_sb_write).
@@ -490,15 +580,17 @@ static inline int iop_sb_write(void * nonnull _b, const void * nonnull buf,
 }
 
 /** Pack an IOP C structure to IOP-JSon in a sb_t.
+ *
+ * This is equivalent to iop_jpack() with iop_sb_write(), but the JSon is
+ * directly appended to the sb_t instead of going through a callback.
+ *
+ * To pack into an outbuf_t, use this function on the sb_t returned by
+ * outbuf_sb_start().
  *
  * See iop_jpack().
  */
-static inline int
-iop_sb_jpack(sb_t * nonnull sb, const iop_struct_t * nonnull st,
-             const void * nonnull value, unsigned flags)
-{
-    return iop_jpack(st, value, &iop_sb_write, sb, flags);
-}
+int iop_sb_jpack(sb_t * nonnull sb, const iop_struct_t * nonnull st,
+                 const void * nonnull value, unsigned flags);
 
 /** Dump IOP structures in JSon format using e_trace */
 #ifndef NDEBUG
@@ -94,9 +94,7 @@ __ic_get_current_rpc_desc(const ichannel_t * nullable ic, uint64_t slot)
 {
 #ifndef __cplusplus
     if (ic_slot_is_http(slot)) {
-        ichttp_query_t *iq = ichttp_slot_to_query(slot);
-
-        return iq->cbe->fun;
+        return ichttp_slot_get_cbe(slot)->fun;
     }
 #endif
     return ic->desc;
@@ -113,9 +111,7 @@ __ic_get_current_rpc_cmd(const ichannel_t * nullable ic, uint64_t slot)
 {
 #ifndef __cplusplus
     if (ic_slot_is_http(slot)) {
-        ichttp_query_t *iq = ichttp_slot_to_query(slot);
-
-        return iq->cbe->cmd;
+        return ichttp_slot_get_cbe(slot)->cmd;
     }
 #endif
     return ic->cmd;
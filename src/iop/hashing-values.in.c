@@ -263,19 +263,29 @@ F(__iop_hash)(struct iop_hash_ctx *ctx, const iop_struct_t *st,
             }
             break;
           case IOP_T_I64:
-            for (int i = 0; i < n; i++) {
-                F(iop_hash_update_i64)(ctx, ((int64_t *)r)[i]);
-            }
-            break;
           case IOP_T_U64:
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+            /* 64-bits values are hashed as little endian words, which is
+             * their in-memory representation: hash the array at once. */
+            if (n) {
+                F(iop_hash_update)(ctx, r, n * sizeof(uint64_t));
+            }
+#else
             for (int i = 0; i < n; i++) {
                 F(iop_hash_update_i64)(ctx, ((uint64_t *)r)[i]);
             }
+#endif
             break;
           case IOP_T_DOUBLE:
+#if __FLOAT_WORD_ORDER == __LITTLE_ENDIAN
+            if (n) {
+                F(iop_hash_update)(ctx, r, n * sizeof(double));
+            }
+#else
             for (int i = 0; i < n; i++) {
                 iop_hash_update_dbl(ctx, ((double *)r)[i]);
             }
+#endif
             break;
           case IOP_T_UNION:
           case IOP_T_STRUCT: {
@@ -127,6 +127,19 @@ static inline bool iop_opt_field_isset(iop_type_t type, const void *v)
     }
 }
 
+/** Tells whether values of a struct can be copied with a single memcpy and
+ * compared with a single memcmp.
+ *
+ * This is computed by iopc: the struct has no pointers (no strings, arrays,
+ * optional or reference fields, classes or unions), and no padding.
+ */
+static inline bool iop_struct_is_flat(const iop_struct_t *st)
+{
+    unsigned st_flags = st->flags;
+
+    return TST_BIT(&st_flags, IOP_STRUCT_IS_FLAT);
+}
+
 static inline bool
 iop_scalar_equals(const iop_field_t *f, const void *v1, const void *v2, int n)
 {
@@ -435,6 +435,8 @@ enum iop_struct_flags_t {
     IOP_STRUCT_IS_SNMP_OBJ,     /**< is it a snmpObj? */
     IOP_STRUCT_IS_SNMP_TBL,     /**< is it a snmpTbl? */
     IOP_STRUCT_IS_SNMP_PARAM,   /**< does it have @snmpParam? */
+    IOP_STRUCT_IS_FLAT,         /**< only inlined scalar fields without
+                                 * padding: memcpy/memcmp can be used */
 };
 
 /*}}}*/
@@ -62,9 +62,9 @@
  * The header format is at least composed of 12 bytes encoded as three words
  * of four bytes in little endian.
  *
- *     Flags   8 bits reserved for Flags. Defined flags      ┌─────┬───┬─┬─┬─┐
- *             are:                                          │  0  │ D │C│B│A│
- *               - A (IC_MSG_HAS_FD): the IC embed a         └─────┴───┴─┴─┴─┘
+ *     Flags   8 bits reserved for Flags. Defined flags    ┌─┬─┬─┬───┬─┬─┬─┐
+ *             are:                                        │0│F│E│ D │C│B│A│
+ *               - A (IC_MSG_HAS_FD): the IC embed a       └─┴─┴─┴───┴─┴─┴─┘
  *                 file descriptor (Unix sockets only),
  *               - B (IC_MSG_HAS_HDR): the payload starts with an IC header,
  *               - C (IC_MSG_IS_TRACED): the IC is traced,
@@ -72,6 +72,11 @@
  *                 priority (in the sense of EV_PRIORITY) are sent first; this
  *                 field propagate the priority such that high priority
  *                 responses are also sent first (but not parsed first).
+ *               - E (IC_MSG_IS_COMPRESSED): the payload is compressed (see
+ *                 1.6); it MUST NOT be set unless the remote peer announced
+ *                 the Z flag in its version message.
+ *               - F (IC_MSG_IN_MEMFD): the payload is stored in the embedded
+ *                 file descriptor (see 1.7); requires A.
  *
  *     Reserved  Depends on the Command.
  *
@@ -184,9 +189,9 @@
  * │                           0x80000000                          │ = Command
  * ├───────────────────────────────────────────────────────────────┤
  * │                        Data length = 4 or 8                   │
- * ├───────────────────────────────┬─┬─┬───────────────────────────┤
- * │          Version = 1          │T│U│        Reserved           │ } 2x16LE
- * ├───────────────────────────────┴─┴─┴───────────────────────────┤
+ * ├───────────────────────────────┬─┬─┬─┬─────────────────────────┤
+ * │          Version = 1          │T│U│Z│        Reserved         │ } 2x16LE
+ * ├───────────────────────────────┴─┴─┴─┴─────────────────────────┤
  * │          User version (if flag U is set)                      │ } 32LE
  * └───────────────────────────────────────────────────────────────┘
  *
@@ -206,12 +211,55 @@
  *
  *     U             Indicates that a User version field is present.
  *
+ *     Z             Indicates that the peer accepts compressed messages
+ *                   (see 1.6). Each peer decides on its own whether it
+ *                   compresses the messages it sends.
+ *
  *     Reserved      MUST be set to 0, reserved for future use.
  *
  *     User version  Optional version provided by the user for higher level
  *                   compatibility check. This field is present when the flag
  *                   U is set and Data length equals 8.
  *
+ * 1.6  Compressed messages
+ * ------------------------
+ *
+ * When the E flag (IC_MSG_IS_COMPRESSED) is set, the Data length is the
+ * length of the compressed payload, which is laid out as follows:
+ *
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * ┌───────────────────────────────────────────────────────────────┐
+ * │                     Uncompressed length                       │ } 32LE
+ * ├───────────────────────────────────────────────────────────────┤
+ * │ LZO1X stream...                                               │
+ * └───────────────────────────────────────────────────────────────┘
+ *
+ * The receiver inflates the payload and then processes the message as if
+ * it was received uncompressed. Only payloads larger than
+ * IC_MSG_COMPRESS_MIN_LEN are compressed, and only when it actually shrinks
+ * them.
+ *
+ * 1.7  Payloads in a memfd
+ * ------------------------
+ *
+ * On Unix sockets, when the F flag (IC_MSG_IN_MEMFD) is set, the payload is
+ * not streamed on the socket but stored in the sealed memfd passed along
+ * the message. Data length is then 4 and the payload is:
+ *
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * ┌───────────────────────────────────────────────────────────────┐
+ * │                      Real payload length                      │ } 32LE
+ * └───────────────────────────────────────────────────────────────┘
+ *
+ * The memfd MUST be sealed with F_SEAL_SHRINK, F_SEAL_GROW and F_SEAL_WRITE
+ * before being sent; the receiver drops the connection otherwise. It reads
+ * the real payload from the memfd and then processes the message as if it
+ * was received on the socket. Since there is no version
+ * handshake on Unix sockets, this is only used when explicitly enabled (see
+ * ichannel_t.memfd_replies).
+ *
  * 2  IChannel connection establishment
  * ====================================
  *
@@ -283,6 +331,10 @@
  *
  * Version 1 introduces Version messages and TLS cryptography (see 1.5.3).
  *
+ * Compressed messages (see 1.6) are an extension of version 1 negotiated
+ * through the Z flag of the version message: peers that do not know about
+ * it never receive any compressed message.
+ *
  * This is the last version: all this documentation applies to Version 1.
  */
 
@@ -304,6 +356,7 @@ qh_k64_t(ic_replies);
 typedef struct ichannel_t    ichannel_t;
 typedef struct ic_msg_t      ic_msg_t;
 typedef struct ic_hook_ctx_t ic_hook_ctx_t;
+typedef struct thr_queue_t   thr_queue_t;
 
 typedef enum ic_event_t {
     IC_EVT_CONNECTED,
@@ -322,6 +375,8 @@ typedef enum ic_event_t {
 #define IC_MSG_VERSION_DLEN_MIN     4
 #define IC_MSG_VERSION_DLEN_MAX     8
 #define IC_PKT_MAX              65536
+#define IC_PKT_BATCH                8
+#define IC_READ_MAX             (1 << 20)
 
 #define IC_ID_MAX               BITMASK_LE(uint32_t, 30)
 #define IC_MSG_SLOT_MASK        (0xffffffU)
@@ -331,9 +386,18 @@ typedef enum ic_event_t {
 #define IC_MSG_PRIORITY_SHIFT   27
 #define IC_MSG_PRIORITY_MASK    (BITMASK_LT(uint32_t,                        \
                                             2) << IC_MSG_PRIORITY_SHIFT)
+#define IC_MSG_IS_COMPRESSED    (1U << 29)
+#define IC_MSG_IN_MEMFD         (1U << 30)
+
+/* Payloads smaller than this are never compressed. */
+#define IC_MSG_COMPRESS_MIN_LEN  (4 << 10)
+
+/* Replies smaller than this are never sent in a memfd. */
+#define IC_MSG_MEMFD_MIN_LEN     (1 << 20)
 
 #define IC_SC_VERSION_TLS  (1U << 15)
 #define IC_SC_VERSION_UV   (1U << 14)
+#define IC_SC_VERSION_ZIP  (1U << 13)
 
 #define IC_PROXY_MAGIC_CB       ((ic_msg_cb_f *)-1)
 
@@ -375,6 +439,9 @@ struct ic_msg_t {
     bool          trace      :  1; /**< Activate tracing for this message. */
     bool          canceled   :  1; /**< Is the query canceled ? */
     ev_priority_t priority   :  2; /**< Priority of the message. */
+    bool          in_memfd   :  1; /**< Whether the payload may be (before
+                                        packing) or is (after) stored in a
+                                        memfd, see IC_MSG_IN_MEMFD. */
     int32_t  cmd;                  /**< automatically filled by ic_query/reply
                                         */
     uint32_t slot;                 /**< automatically filled by ic_query/reply
@@ -577,6 +644,27 @@ struct ichannel_t {
      */
     const qm_t(ic_cbs) *nullable impl;
 
+    /** Optional serial thread queue on which the RPC implementations of
+     * this IC are run.
+     *
+     * By default, the implementations are called from the event loop, right
+     * after the query is unpacked. When this queue is set, the unpacked
+     * query is handed over to the queue instead, so that the implementations
+     * of a busy proxy can be spread over several cores by sharding its ICs
+     * over several queues (thr_queue_create()). The queue being serial, the
+     * queries of an IC are still processed in order.
+     *
+     * Implementations run this way MUST NOT use the ichannel_t they are given
+     * except to reply to the query with ic_reply/ic_throw/ic_reply_err; the
+     * replies are then packed on the queue and sent from the event loop.
+     * Any other IC call (queries, proxying…) has to be posted to
+     * thr_queue_main_g.
+     *
+     * Queries that carry a file descriptor, proxied RPCs, RPCs with a
+     * pre-hook and local ICs are always processed in the event loop.
+     */
+    thr_queue_t *nullable impl_queue;
+
     /** Mandatory IOP environment for the IC.
      */
     const iop_env_t *nonnull iop_env;
@@ -636,6 +724,23 @@ struct ichannel_t {
      */
     bool tls_required :  1;
 
+    /** Whether the messages sent on this IC should be compressed when the
+     * remote peer supports it. Ignored on Unix sockets.
+     *
+     * Default is false.
+     */
+    bool compress     :  1;
+
+    /** Whether the replies larger than IC_MSG_MEMFD_MIN_LEN sent on this IC
+     * are packed in a memfd passed along the message instead of being
+     * streamed on the socket. This saves the intermediate buffer and the
+     * socket copies. Ignored on non Unix sockets; both peers must support
+     * IC_MSG_IN_MEMFD.
+     *
+     * Default is false.
+     */
+    bool memfd_replies : 1;
+
     /* }}} */
     /* {{{ Life-cycle attributes */
 
@@ -716,6 +821,10 @@ struct ichannel_t {
      */
     bool is_connected :  1;
 
+    /** Whether the remote peer accepts compressed messages.
+     */
+    bool peer_compress : 1;
+
     /** Next slot ID to try for messages slots allocation.
      */
     unsigned nextslot;
@@ -812,6 +921,14 @@ struct ichannel_t {
      */
     int iov_total_len;
 
+    /** Size of the next read, between IC_PKT_MAX and IC_READ_MAX.
+     *
+     * It is doubled when a read fills the buffer and halved when a read
+     * uses less than a quarter of it, so that busy channels drain their
+     * socket in fewer syscalls.
+     */
+    int read_size;
+
     /** Internal stack of file descriptors wrapped in the current message.
      */
     qv_t(i32) fds;
@@ -824,6 +941,33 @@ struct ichannel_t {
      */
     sb_t rbuf;
 
+    /** Statistics about the compressed messages, for ic_get_state.
+     *
+     * The lengths are the payload lengths of the compressed messages only,
+     * before and after compression. The times are the wall-clock time spent
+     * in the compression and decompression routines.
+     */
+    struct {
+        uint64_t raw_out;
+        uint64_t zip_out;
+        uint64_t out_ns;
+        uint64_t raw_in;
+        uint64_t zip_in;
+        uint64_t in_ns;
+    } zstats;
+
+    /** Counters of syscalls and messages, for ic_get_state.
+     *
+     * The syscalls/messages ratios tell how well the reads and writes are
+     * batched on the IC; failed (EAGAIN) syscalls are accounted too.
+     */
+    struct {
+        uint64_t read_calls;
+        uint64_t write_calls;
+        uint64_t msgs_in;
+        uint64_t msgs_out;
+    } iostats;
+
     /** TLS context, if any.
      */
     SSL *nullable ssl;
@@ -59,6 +59,33 @@ http_iop_msg_t *http_iop_msg_new(int len)
 
 GENERIC_DELETE(http_iop_msg_t, http_iop_msg);
 
+qvector_t(http_iop_msg, http_iop_msg_t *);
+
+/* A batch query, that carries several messages. */
+typedef struct http_iop_batch_t {
+    httpc_query_t query;
+    qv_t(http_iop_msg) msgs;
+} http_iop_batch_t;
+
+static http_iop_batch_t *http_iop_batch_init(http_iop_batch_t *batch)
+{
+    p_clear(batch, 1);
+    httpc_query_init(&batch->query);
+    qv_init(&batch->msgs);
+
+    return batch;
+}
+
+GENERIC_NEW(http_iop_batch_t, http_iop_batch);
+
+static void http_iop_batch_wipe(http_iop_batch_t *batch)
+{
+    httpc_query_wipe(&batch->query);
+    qv_deep_wipe(&batch->msgs, http_iop_msg_delete);
+}
+
+GENERIC_DELETE(http_iop_batch_t, http_iop_batch);
+
 static http_iop_channel_remote_t *
 http_iop_channel_remote_init(http_iop_channel_remote_t *remote)
 {
@@ -83,6 +110,7 @@ static http_iop_channel_t *http_iop_channel_init(http_iop_channel_t *channel)
     p_clear(channel, 1);
     qv_init(&channel->remotes);
     htlist_init(&channel->queries_waiting_conn);
+    htlist_init(&channel->batch_msgs);
 
     return channel;
 }
@@ -102,6 +130,9 @@ static void http_iop_channel_wipe(http_iop_channel_t *channel)
     htlist_deep_clear(&channel->queries_waiting_conn, http_iop_msg_t, link,
                       http_iop_msg_delete);
     el_unregister(&channel->queries_conn_timeout_el);
+    htlist_deep_clear(&channel->batch_msgs, http_iop_msg_t, link,
+                      http_iop_msg_delete);
+    el_unregister(&channel->batch_el);
 }
 
 DO_DELETE(http_iop_channel_t, http_iop_channel);
@@ -439,6 +470,275 @@ static void http_iop_start_msg(http_iop_channel_t *channel,
     httpc_query_done(&msg->query);
 }
 
+static void http_iop_send_msg(http_iop_channel_t *channel,
+                              http_iop_msg_t *msg, void *args)
+{
+    http_iop_channel_remote_t *remote;
+    httpc_t *httpc;
+
+    if (http_iop_get_ready_remote(channel, true, &remote, &httpc) < 0) {
+        logger_trace(&_G.logger, 1,
+                     "no connection ready, query `%*pM` will wait for "
+                     "connection", LSTR_FMT_ARG(msg->rpc->name));
+        if (!msg->args) {
+            msg->args = mp_iop_dup_desc_flags_sz(NULL, msg->rpc->args, args,
+                                                 0, NULL);
+        }
+        htlist_add_tail(&channel->queries_waiting_conn, &msg->link);
+        if (!channel->queries_conn_timeout_el) {
+            http_iop_register_timeout_check(
+                channel, channel->connection_timeout_msec);
+        }
+        return;
+    }
+
+    http_iop_start_msg(channel, remote, httpc, msg, args);
+}
+
+/* }}} */
+/* {{{ HTTP IOP Batches */
+
+/* Unpack the reply of a message of a batch, given the HTTP code of the
+ * call. */
+static ic_status_t t_http_iop_batch_unpack(http_iop_msg_t *msg, int code,
+                                           pstream_t val, void **res,
+                                           void **exn)
+{
+    const iop_struct_t *st;
+    void **dest;
+    SB_1k(err);
+
+    if (code == HTTP_CODE_ACCEPTED) {
+        /* Asynchronous RPC. */
+        return IC_MSG_OK;
+    }
+    if (http_code_is_successful(code)) {
+        st = msg->rpc->result;
+        dest = res;
+    } else
+    if (code == HTTP_CODE_INTERNAL_SERVER_ERROR && ps_peekc(val) == '{') {
+        st = msg->rpc->exn;
+        dest = exn;
+    } else {
+        logger_error(&_G.logger, "query `%*pM` rejected by server (code %d): "
+                     "%*pM", LSTR_FMT_ARG(msg->rpc->name), code,
+                     PS_FMT_ARG(&val));
+        return IC_MSG_INVALID;
+    }
+
+    if (t_iop_junpack_ptr_ps(msg->iop_env, &val, st, dest, 0, &err) < 0) {
+        logger_error(&_G.logger, "cannot unpack result of query `%*pM`: "
+                     "%*pM", LSTR_FMT_ARG(msg->rpc->name), SB_FMT_ARG(&err));
+        *dest = NULL;
+        return IC_MSG_INVALID;
+    }
+    return dest == exn ? IC_MSG_EXN : IC_MSG_OK;
+}
+
+/* Split the replies of a batch query by message; the replies are given in
+ * their completion order, as [id, code, value] arrays. */
+static int t_http_iop_batch_split(http_iop_batch_t *batch, pstream_t ps,
+                                  pstream_t *vals, int *codes)
+{
+    qv_t(pstream) replies;
+
+    t_qv_init(&replies, batch->msgs.len);
+    RETHROW(__ichttp_json_split_array(ps, &replies));
+
+    tab_for_each_entry(reply, &replies) {
+        qv_t(pstream) fields;
+        int id;
+
+        t_qv_init(&fields, 3);
+        if (__ichttp_json_split_array(reply, &fields) < 0
+        ||  fields.len != 3)
+        {
+            return -1;
+        }
+        id = ps_geti(&fields.tab[0]);
+        if (id < 0 || id >= batch->msgs.len || vals[id].s) {
+            return -1;
+        }
+        codes[id] = ps_geti(&fields.tab[1]);
+        vals[id] = fields.tab[2];
+    }
+    return 0;
+}
+
+static void
+http_iop_on_batch_done(httpc_query_t *http_query, httpc_status_t httpc_status)
+{
+    t_scope;
+    http_iop_batch_t *batch;
+    opt_http_code_t http_code = OPT_NONE;
+    ic_status_t ic_status;
+    pstream_t *vals;
+    int *codes;
+
+    batch = container_of(http_query, http_iop_batch_t, query);
+
+    logger_trace(&_G.logger, 1, "batch of %d queries finished (%d)",
+                 batch->msgs.len, httpc_status);
+    vals = t_new(pstream_t, batch->msgs.len);
+    codes = t_new(int, batch->msgs.len);
+
+    ic_status = ic_status_from_httpc_status(httpc_status);
+    if (http_query->qinfo) {
+        logger_trace(&_G.logger, 3, "payload: `%*pM`",
+                     SB_FMT_ARG(&http_query->payload));
+        OPT_SET(http_code, http_query->qinfo->code);
+
+        if (!http_code_is_successful(http_query->qinfo->code)) {
+            logger_error(&_G.logger, "batch of %d queries rejected by "
+                         "server (code %d): %*pM", batch->msgs.len,
+                         http_query->qinfo->code,
+                         SB_FMT_ARG(&http_query->payload));
+            ic_status = IC_MSG_INVALID;
+        } else
+        if (ic_status == IC_MSG_OK
+        &&  t_http_iop_batch_split(batch, ps_initsb(&http_query->payload),
+                                   vals, codes) < 0)
+        {
+            logger_error(&_G.logger, "invalid reply from server for a batch "
+                         "of %d queries", batch->msgs.len);
+            ic_status = IC_MSG_INVALID;
+        }
+    }
+
+    tab_for_each_pos(pos, &batch->msgs) {
+        http_iop_msg_t *msg = batch->msgs.tab[pos];
+        ic_status_t status = ic_status;
+        opt_http_code_t code = http_code;
+        void *res = NULL;
+        void *exn = NULL;
+
+        if (status == IC_MSG_OK) {
+            if (vals[pos].s) {
+                OPT_SET(code, codes[pos]);
+                status = t_http_iop_batch_unpack(msg, codes[pos], vals[pos],
+                                                 &res, &exn);
+            } else {
+                /* The server did not answer this query. */
+                status = IC_MSG_SERVER_ERROR;
+            }
+        }
+        msg->cb(msg, status, code, res, exn);
+    }
+
+    http_iop_batch_delete(&batch);
+}
+
+static void http_iop_start_batch(http_iop_channel_t *channel,
+                                 http_iop_channel_remote_t *remote,
+                                 httpc_t *httpc, htlist_t *msgs, int len)
+{
+    http_iop_batch_t *batch = http_iop_batch_new();
+    SB_1k(sb);
+    SB_8k(query_data);
+    outbuf_t *ob;
+
+    if (htlist_is_empty(&channel->queries_waiting_conn)) {
+        el_unregister(&channel->queries_conn_timeout_el);
+    }
+
+    qv_grow(&batch->msgs, len);
+    sb_addc(&query_data, '[');
+    while (!htlist_is_empty(msgs)) {
+        http_iop_msg_t *msg = htlist_pop_entry(msgs, http_iop_msg_t, link);
+
+        msg->iop_env = channel->iop_env;
+        if (batch->msgs.len) {
+            sb_addc(&query_data, ',');
+        }
+        sb_addf(&query_data, "[\"%*pM/%*pM\",",
+                LSTR_FMT_ARG(msg->iface_alias->name),
+                LSTR_FMT_ARG(msg->rpc->name));
+        iop_sb_jpack(&query_data, msg->rpc->args, msg->args,
+                     IOP_JPACK_MINIMAL);
+        sb_addc(&query_data, ']');
+        qv_append(&batch->msgs, msg);
+    }
+    sb_addc(&query_data, ']');
+
+    if (channel->response_max_size) {
+        httpc_bufferize(&batch->query,
+                        MIN((uint64_t)channel->response_max_size * len,
+                            INT32_MAX));
+    }
+    batch->query.on_done = http_iop_on_batch_done;
+    httpc_query_attach(&batch->query, httpc);
+    if (channel->encode_url) {
+        sb_add_urlencode(&sb, remote->base_path.s, remote->base_path.len);
+        sb_adds(&sb, "/batch");
+    } else {
+        sb_addf(&sb, "/%*pM/batch", LSTR_FMT_ARG(remote->base_path));
+    }
+
+    httpc_query_start_flags(&batch->query, HTTP_METHOD_POST,
+                            remote->pool.host, LSTR_SB_V(&sb), false);
+    if (channel->user.len && channel->password.len) {
+        httpc_query_hdrs_add_auth(&batch->query, channel->user,
+                                  channel->password);
+    }
+
+    ob = httpc_get_ob(&batch->query);
+    ob_adds(ob, "Content-Type: application/json\r\n");
+    httpc_query_hdrs_done(&batch->query, -1, false);
+    ob_addsb(ob, &query_data);
+
+    logger_trace(&_G.logger, 1, "batch of %d queries: `%*pM`", len,
+                 SB_FMT_ARG(&query_data));
+    httpc_query_done(&batch->query);
+}
+
+/* Send the queries coalesced since the last flush. A lone query, or queries
+ * that find no ready connection, go through the per-query path, which
+ * knows how to wait for a connection. */
+static void http_iop_batch_flush(http_iop_channel_t *channel)
+{
+    http_iop_channel_remote_t *remote;
+    httpc_t *httpc;
+    htlist_t msgs;
+    int len = channel->batch_len;
+
+    el_unregister(&channel->batch_el);
+    htlist_move(&msgs, &channel->batch_msgs);
+    channel->batch_len = 0;
+
+    if (len > 1
+    &&  http_iop_get_ready_remote(channel, true, &remote, &httpc) >= 0)
+    {
+        http_iop_start_batch(channel, remote, httpc, &msgs, len);
+        return;
+    }
+
+    while (!htlist_is_empty(&msgs)) {
+        http_iop_msg_t *msg = htlist_pop_entry(&msgs, http_iop_msg_t, link);
+
+        http_iop_send_msg(channel, msg, msg->args);
+    }
+}
+
+static void http_iop_batch_on_before(el_t el, data_t data)
+{
+    http_iop_batch_flush(data.ptr);
+}
+
+static void http_iop_batch_add(http_iop_channel_t *channel,
+                               http_iop_msg_t *msg, void *args)
+{
+    msg->args = mp_iop_dup_desc_flags_sz(NULL, msg->rpc->args, args, 0,
+                                         NULL);
+    htlist_add_tail(&channel->batch_msgs, &msg->link);
+    if (++channel->batch_len >= channel->batch_max) {
+        http_iop_batch_flush(channel);
+    } else
+    if (!channel->batch_el) {
+        channel->batch_el = el_before_register(&http_iop_batch_on_before,
+                                               channel);
+    }
+}
+
 /* }}} */
 /* {{{ HTTP IOP Public functions */
 
@@ -455,6 +755,7 @@ http_iop_channel_create(const http_iop_channel_cfg_t *cfg, sb_t *err)
                                               10 * 1000);
     res->response_max_size = OPT_DEFVAL(cfg->response_max_size, 1 << 20);
     res->encode_url = OPT_DEFVAL(cfg->encode_url, true);
+    res->batch_max = OPT_DEFVAL(cfg->batch_max, 0);
     res->name = lstr_dup(cfg->name);
     res->user = lstr_dup(cfg->user);
     res->password = lstr_dup(cfg->password);
@@ -514,6 +815,11 @@ void http_iop_channel_close_clients(http_iop_channel_t *channel)
 
 void http_iop_channel_cancel_messages(http_iop_channel_t *channel)
 {
+    el_unregister(&channel->batch_el);
+    channel->batch_len = 0;
+    htlist_splice_tail(&channel->queries_waiting_conn,
+                       &channel->batch_msgs);
+    htlist_init(&channel->batch_msgs);
     while (!htlist_is_empty(&channel->queries_waiting_conn)) {
         http_iop_msg_t *msg;
 
@@ -530,9 +836,6 @@ void http_iop_channel_cancel_messages(http_iop_channel_t *channel)
 void http_iop_query_(http_iop_channel_t *channel, http_iop_msg_t *msg,
                      void *args)
 {
-    http_iop_channel_remote_t *remote;
-    httpc_t *httpc;
-
 #ifndef NDEBUG
     /* If that crashes, one of the IC_MSG_ABORT callback on wipe reenqueues
      * directly in that channel which is forbidden, fix the code.
@@ -543,23 +846,12 @@ void http_iop_query_(http_iop_channel_t *channel, http_iop_msg_t *msg,
     if (timeval_is_eq0(msg->query_time)) {
         lp_gettv(&msg->query_time);
     }
-    if (http_iop_get_ready_remote(channel, true, &remote, &httpc) < 0) {
-        logger_trace(&_G.logger, 1,
-                     "no connection ready, query `%*pM` will wait for "
-                     "connection", LSTR_FMT_ARG(msg->rpc->name));
-        if (!msg->args) {
-            msg->args = mp_iop_dup_desc_flags_sz(NULL, msg->rpc->args, args,
-                                                 0, NULL);
-        }
-        htlist_add_tail(&channel->queries_waiting_conn, &msg->link);
-        if (!channel->queries_conn_timeout_el) {
-            http_iop_register_timeout_check(
-                channel, channel->connection_timeout_msec);
-        }
+    if (channel->batch_max > 1 && !msg->user.len && !msg->args) {
+        http_iop_batch_add(channel, msg, args);
         return;
     }
 
-    http_iop_start_msg(channel, remote, httpc, msg, args);
+    http_iop_send_msg(channel, msg, args);
 }
 
 /* }}} */
@@ -28,10 +28,21 @@ void ichttp_cb_wipe(ichttp_cb_t *rpc)
     lstr_wipe(&rpc->name_uri);
     lstr_wipe(&rpc->name_res);
     lstr_wipe(&rpc->name_exn);
+    lstr_wipe(&rpc->stream_field);
 }
 
 static void ichttp_query_wipe(ichttp_query_t *q)
 {
+    if (q->stream_hdr) {
+        /* Release the context of the pre-hook of a streamed query that was
+         * not answered by the RPC. */
+        if (!q->iop_answered) {
+            ic_query_do_post_hook(NULL, IC_MSG_ABORT,
+                                  ichttp_query_to_slot(q), NULL, NULL);
+        }
+        p_delete(&q->stream_hdr);
+    }
+    iop_junpack_stream_delete(&q->jstream);
     ichttp_cb_delete(&q->cbe);
 }
 
@@ -74,6 +85,20 @@ static int t_parse_json(ichttp_query_t *iq, ichttp_cb_t *cbe, void **vout)
     return res;
 }
 
+static int t_parse_json_stream(ichttp_query_t *iq, void **vout)
+{
+    SB_1k(err);
+
+    *vout = NULL;
+    if (t_iop_junpack_stream_end(iq->jstream, vout, &err) < 0) {
+        __ichttp_err_ctx_set(LSTR_SB_V(&err));
+        httpd_reject(obj_vcast(httpd_query, iq), BAD_REQUEST, "%s", err.data);
+        __ichttp_err_ctx_clear();
+        return -1;
+    }
+    return 0;
+}
+
 static int t_parse_soap(ichttp_query_t *iq,
                         ichttp_cb_t **cbout, void **vout)
 {
@@ -149,6 +174,15 @@ int __t_ichttp_query_on_done_stage1(httpd_query_t *q, ichttp_cb_t **cbe,
     int                  res;
 
     *soap = false;
+
+    if (iq->jstream) {
+        /* The RPC was found and the elements of the streamed field were
+         * unpacked while the query was received. */
+        *cbe = iq->cbe;
+        iq->json = true;
+        return t_parse_json_stream(iq, value);
+    }
+
     ps_skipstr(&url, "/");
 
     if (ps_len(&url)) {
@@ -188,49 +222,83 @@ int __t_ichttp_query_on_done_stage1(httpd_query_t *q, ichttp_cb_t **cbe,
     return 0;
 }
 
-void __t_ichttp_query_on_done_stage2(httpd_query_t *q, ichttp_cb_t *cbe,
-                                     void *value)
+static void ichttp_batch_call_done(ichttp_batch_call_t *call, int code,
+                                   lstr_t val);
+
+/* Answer an asynchronous RPC. */
+static void ichttp_reply_accepted(httpd_query_t *q, uint64_t slot)
 {
-    ichttp_query_t      *iq  = obj_vcast(ichttp_query, q);
+    if (ichttp_slot_is_batch_call(slot)) {
+        ichttp_batch_call_done(ichttp_slot_to_batch_call(slot),
+                               HTTP_CODE_ACCEPTED, LSTR("null"));
+    } else {
+        httpd_reply_202accepted(q);
+    }
+}
+
+/* Get the IC header of a query: the one set on the query, or a simple
+ * header with the basic authentication of the HTTP query. */
+static ic__hdr__t *t_ichttp_query_get_hdr(ichttp_query_t *iq,
+                                          pstream_t *login)
+{
+    httpd_query_t       *q   = obj_vcast(httpd_query, iq);
     httpd_trigger__ic_t *tcb = container_of(iq->trig_cb, httpd_trigger__ic_t,
                                             cb);
-    ic__hdr__t   default_hdr = IOP_UNION_VA(ic__hdr, simple,
-       .kind = LSTR_OPT(tcb->auth_kind),
-       .payload = q->received_body_length,
-       .source = LSTR("webservice"),
-       .workspace_id = OPT_NONE,
+    ic__hdr__t *hdr;
+    pstream_t   pw;
+
+    p_clear(login, 1);
+    if (iq->ic_hdr) {
+        /* FIXME in case the pre_hook modifies the header on the t_stack, and
+         * that iq->ic_hdr (that is not handled by this library) has a
+         * longer lifetime, it will be left with dandling pointers. It has no
+         * bad consequences for our usages, but a rework of the way the header
+         * is handled by this library would be needed to make things properly.
+         */
+        return iq->ic_hdr;
+    }
+
+    hdr = t_iop_new(ic__hdr);
+    *hdr = IOP_UNION_VA(ic__hdr, simple,
+        .kind = LSTR_OPT(tcb->auth_kind),
+        .payload = q->received_body_length,
+        .source = LSTR("webservice"),
+        .workspace_id = OPT_NONE,
     );
+    if (t_httpd_qinfo_get_basic_auth(q->qinfo, login, &pw) == 0) {
+        hdr->simple.login    = LSTR_PS_V(login);
+        hdr->simple.password = LSTR_PS_V(&pw);
+    }
+    hdr->simple.host = httpd_get_peer_address(q->owner);
+    return hdr;
+}
+
+/* Run the RPC of a query, or of a call of a batch query, answered on
+ * slot. */
+static void t_ichttp_call(ichttp_query_t *iq, uint64_t slot,
+                          ichttp_cb_t *cbe, void *value)
+{
+    httpd_query_t       *q   = obj_vcast(httpd_query, iq);
     ic_cb_entry_t       *e;
 
-    pstream_t   login, pw;
-    uint64_t    slot = ichttp_query_to_slot(iq);
+    pstream_t   login;
     ichannel_t *pxy;
     ic__hdr__t *pxy_hdr = NULL;
     bool force_pxy_hdr = false;
     bool hdr_modified = false;
     ic__hdr__t          *hdr;
-    ichttp_query_t *ic_q = obj_vcast(ichttp_query, q);
     ic_msg_t *msg;
 
-    if (ic_q && ic_q->ic_hdr) {
-        /* FIXME in case the pre_hook modifies the header on the t_stack, and
-         * that ic_q->ic_hdr (that is not handled by this library) has a
-         * longer lifetime, it will be left with dandling pointers. It has no
-         * bad consequences for our usages, but a rework of the way the header
-         * is handled by this library would be needed to make things properly.
-         */
-        hdr = ic_q->ic_hdr;
-    } else {
-        hdr = &default_hdr;
-
-        if (t_httpd_qinfo_get_basic_auth(q->qinfo, &login, &pw) == 0) {
-            hdr->simple.login    = LSTR_PS_V(&login);
-            hdr->simple.password = LSTR_PS_V(&pw);
-        }
-        hdr->simple.host = httpd_get_peer_address(q->owner);
-    }
-
+    hdr = t_ichttp_query_get_hdr(iq, &login);
     e = &cbe->e;
+    if (iq->stream_hdr && !ichttp_slot_is_batch_call(slot)) {
+        /* The pre-hook was run when the streamed query started. */
+        hdr = iq->stream_hdr;
+        hdr_modified = iq->stream_hdr_modified;
+        if (IOP_UNION_IS(ic__hdr, hdr, simple)) {
+            hdr->simple.payload = q->received_body_length;
+        }
+    } else
     if (t_ic_query_do_pre_hook(NULL, slot, e, hdr, &hdr_modified) < 0) {
         return;
     }
@@ -246,7 +314,7 @@ void __t_ichttp_query_on_done_stage2(httpd_query_t *q, ichttp_cb_t *cbe,
             (*e->u.iws_cb.cb)(NULL, slot, value, hdr);
         }
         if (cbe->fun->async)
-            httpd_reply_202accepted(q);
+            ichttp_reply_accepted(q, slot);
 
         t_unseal();
         return;
@@ -314,10 +382,291 @@ void __t_ichttp_query_on_done_stage2(httpd_query_t *q, ichttp_cb_t *cbe,
     __ic_bpack(msg, cbe->fun->args, value);
     __ic_query(pxy, msg);
     if (msg->async) {
-        httpd_reply_202accepted(q);
+        ichttp_reply_accepted(q, slot);
+    }
+}
+
+void __t_ichttp_query_on_done_stage2(httpd_query_t *q, ichttp_cb_t *cbe,
+                                     void *value)
+{
+    ichttp_query_t *iq = obj_vcast(ichttp_query, q);
+
+    t_ichttp_call(iq, ichttp_query_to_slot(iq), cbe, value);
+}
+
+/* {{{ Batches */
+
+int __ichttp_json_split_array(pstream_t ps, qv_t(pstream) *elems)
+{
+    const char *start;
+    bool in_str = false;
+    int depth = 0;
+
+    ps_trim(&ps);
+    if (ps_skipc(&ps, '[') < 0) {
+        return -1;
+    }
+    ps_skipspaces(&ps);
+    if (ps_skipc(&ps, ']') == 0) {
+        return ps_done(&ps) ? 0 : -1;
+    }
+
+    for (start = ps.s; !ps_done(&ps); __ps_skip(&ps, 1)) {
+        pstream_t elem;
+
+        if (in_str) {
+            if (*ps.s == '\\') {
+                /* Skip the escaped character. */
+                RETHROW(ps_skip(&ps, 1));
+                if (ps_done(&ps)) {
+                    return -1;
+                }
+            } else
+            if (*ps.s == '"') {
+                in_str = false;
+            }
+            continue;
+        }
+
+        switch (*ps.s) {
+          case '"':
+            in_str = true;
+            break;
+
+          case '[': case '{':
+            depth++;
+            break;
+
+          case ']': case '}':
+            if (depth-- > 0) {
+                break;
+            }
+            if (*ps.s != ']') {
+                return -1;
+            }
+            elem = ps_initptr(start, ps.s);
+            ps_trim(&elem);
+            qv_append(elems, elem);
+            __ps_skip(&ps, 1);
+            ps_trim(&ps);
+            return ps_done(&ps) ? 0 : -1;
+
+          case ',':
+            if (depth == 0) {
+                elem = ps_initptr(start, ps.s);
+                ps_trim(&elem);
+                qv_append(elems, elem);
+                start = ps.s + 1;
+            }
+            break;
+        }
+    }
+    return -1;
+}
+
+/* Append a reply to the JSON array of the replies of a batch query. */
+static void ichttp_batch_write(ichttp_query_t *iq, int id, int code,
+                               lstr_t val)
+{
+    httpd_query_t *q = obj_vcast(httpd_query, iq);
+    outbuf_t *ob = httpd_get_ob(q);
+    int oblen = ob->length;
+
+    httpd_reply_chunk_start(q, ob);
+    if (iq->batch_replies++) {
+        ob_addc(ob, ',');
     }
+    ob_addf(ob, "[%d,%d,", id, code);
+    ob_add(ob, val.s, val.len);
+    ob_addc(ob, ']');
+    httpd_reply_chunk_done(q, ob);
+    iq->batch_res_size += ob->length - oblen;
 }
 
+static void ichttp_batch_add_err(sb_t *buf, lstr_t err)
+{
+    sb_addc(buf, '"');
+    sb_add_slashes(buf, err.s, err.len, "\"\n\r\t", "\"nrt");
+    sb_addc(buf, '"');
+}
+
+static void ichttp_batch_write_err(ichttp_query_t *iq, int id, int code,
+                                   lstr_t err)
+{
+    SB_1k(buf);
+
+    ichttp_batch_add_err(&buf, err);
+    ichttp_batch_write(iq, id, code, LSTR_SB_V(&buf));
+}
+
+/* Release a pending call of a batch query, and close the array of replies
+ * once all the calls are answered. */
+static void ichttp_batch_release(ichttp_query_t *iq)
+{
+    httpd_query_t *q = obj_vcast(httpd_query, iq);
+    httpd_trigger__ic_t *tcb;
+    outbuf_t *ob;
+
+    if (--iq->batch_pending > 0) {
+        return;
+    }
+
+    ob = httpd_get_ob(q);
+    httpd_reply_chunk_start(q, ob);
+    ob_addc(ob, ']');
+    httpd_reply_chunk_done(q, ob);
+
+    tcb = container_of(iq->trig_cb, httpd_trigger__ic_t, cb);
+    if (tcb->on_reply) {
+        (*tcb->on_reply)(tcb, iq, iq->batch_res_size + 2, HTTP_CODE_OK);
+    }
+    httpd_reply_done(q);
+}
+
+static void ichttp_batch_call_done(ichttp_batch_call_t *call, int code,
+                                   lstr_t val)
+{
+    ichttp_query_t *iq = call->iq;
+
+    ichttp_batch_write(iq, call->id, code, val);
+    ichttp_cb_delete(&call->cbe);
+    p_delete(&call);
+    ichttp_batch_release(iq);
+}
+
+/* Unpack and run a call of a batch query; the calls that cannot be run are
+ * answered right away. */
+static void t_ichttp_batch_run_call(ichttp_query_t *iq, int id,
+                                    pstream_t ps)
+{
+    httpd_trigger__ic_t *tcb = container_of(iq->trig_cb, httpd_trigger__ic_t,
+                                            cb);
+    ichttp_batch_call_t *call;
+    qv_t(pstream) elems;
+    ichttp_cb_t *cbe;
+    pstream_t uri;
+    void *value = NULL;
+    int pos;
+    SB_1k(err);
+
+    t_qv_init(&elems, 2);
+    if (__ichttp_json_split_array(ps, &elems) < 0 || elems.len != 2) {
+        ichttp_batch_write_err(iq, id, HTTP_CODE_BAD_REQUEST,
+                               LSTR("a call must be an array of an RPC URI "
+                                    "and its arguments"));
+        return;
+    }
+
+    uri = elems.tab[0];
+    if (ps_skipc(&uri, '"') < 0 || ps_shrink(&uri, 1) < 0
+    ||  uri.s_end[0] != '"')
+    {
+        ichttp_batch_write_err(iq, id, HTTP_CODE_BAD_REQUEST,
+                               LSTR("the RPC URI must be a string"));
+        return;
+    }
+    pos = qm_find(ichttp_cbs, &tcb->impl, &LSTR_PS_V(&uri));
+    if (pos < 0) {
+        ichttp_batch_write_err(iq, id, HTTP_CODE_NOT_FOUND,
+                               LSTR("unknown RPC"));
+        return;
+    }
+    cbe = tcb->impl.values[pos];
+    if (cbe->on_stream_elem) {
+        ichttp_batch_write_err(iq, id, HTTP_CODE_BAD_REQUEST,
+                               LSTR("streamed RPCs cannot be batched"));
+        return;
+    }
+
+    if (t_iop_junpack_ptr_ps(tcb->iop_env, &elems.tab[1], cbe->fun->args,
+                             &value, tcb->unpack_flags, &err) < 0)
+    {
+        ichttp_batch_write_err(iq, id, HTTP_CODE_BAD_REQUEST,
+                               LSTR_SB_V(&err));
+        return;
+    }
+
+    call = p_new(ichttp_batch_call_t, 1);
+    call->iq  = iq;
+    call->cbe = ichttp_cb_retain(cbe);
+    call->id  = id;
+    iq->batch_pending++;
+    t_ichttp_call(iq, ichttp_batch_call_to_slot(call), call->cbe, value);
+}
+
+static bool ichttp_query_is_batch(httpd_trigger__ic_t *tcb,
+                                  ichttp_query_t *iq)
+{
+    pstream_t url = iq->qinfo->query;
+
+    if (!tcb->batch_max) {
+        return false;
+    }
+    ps_skipstr(&url, "/");
+    return ps_strequal(&url, "batch");
+}
+
+static void t_ichttp_batch_run(ichttp_query_t *iq)
+{
+    httpd_query_t       *q   = obj_vcast(httpd_query, iq);
+    httpd_trigger__ic_t *tcb = container_of(iq->trig_cb, httpd_trigger__ic_t,
+                                            cb);
+    qv_t(pstream) calls;
+    outbuf_t *ob;
+
+    if (!is_ctype_json(q->qinfo)) {
+        httpd_reject(q, NOT_ACCEPTABLE,
+                     "Content-Type must be application/json");
+        return;
+    }
+    t_qv_init(&calls, 16);
+    if (__ichttp_json_split_array(ps_initsb(&iq->payload), &calls) < 0) {
+        httpd_reject(q, BAD_REQUEST, "a batch must be an array of calls");
+        return;
+    }
+    if (calls.len > (int)tcb->batch_max) {
+        httpd_reject(q, BAD_REQUEST, "too many calls in batch (max %u)",
+                     tcb->batch_max);
+        return;
+    }
+
+    iq->json = true;
+    ob = httpd_reply_hdrs_start(q, HTTP_CODE_OK, true);
+    ob_adds(ob, "Content-Type: application/json; charset=utf-8\r\n");
+    httpd_reply_hdrs_done(q, -1, true);
+    httpd_reply_chunk_start(q, ob);
+    ob_addc(ob, '[');
+    httpd_reply_chunk_done(q, ob);
+
+    /* Hold the query while the calls are run, some of them may be
+     * answered synchronously. */
+    iq->batch_pending = 1;
+    tab_for_each_pos(pos, &calls) {
+        t_ichttp_batch_run_call(iq, pos, calls.tab[pos]);
+    }
+    ichttp_batch_release(iq);
+}
+
+static void ichttp_batch_reply(uint64_t slot, int cmd,
+                               const iop_struct_t *st, const void *v)
+{
+    ichttp_batch_call_t *call = ichttp_slot_to_batch_call(slot);
+    httpd_trigger__ic_t *tcb = container_of(call->iq->trig_cb,
+                                            httpd_trigger__ic_t, cb);
+    SB_1k(buf);
+
+    if (v) {
+        iop_sb_jpack(&buf, st, v, tcb->jpack_flags);
+    } else {
+        sb_adds(&buf, "{}");
+    }
+    ichttp_batch_call_done(call, cmd == IC_MSG_OK ?
+                           HTTP_CODE_OK : HTTP_CODE_INTERNAL_SERVER_ERROR,
+                           LSTR_SB_V(&buf));
+}
+
+/* }}} */
+
 static void ichttp_query_on_done(httpd_query_t *q)
 {
     t_scope;
@@ -329,6 +678,13 @@ static void ichttp_query_on_done(httpd_query_t *q)
     ichttp_cb_t    *cbe = NULL;
     void           *value = NULL;
 
+    if (ichttp_query_is_batch(container_of(iq->trig_cb, httpd_trigger__ic_t,
+                                           cb), iq))
+    {
+        t_ichttp_batch_run(iq);
+        return;
+    }
+
     res = __t_ichttp_query_on_done_stage1(q, &cbe, &value, &soap);
     if (unlikely(res < 0))
         return;
@@ -348,6 +704,89 @@ static void httpd_trigger__ic_destroy(httpd_trigger_t *tcb)
     p_delete(&cb);
 }
 
+static int ichttp_query_on_stream_elem(void *priv,
+                                       const iop_field_t *fdesc,
+                                       const void *elem)
+{
+    ichttp_query_t *iq = priv;
+
+    return (*iq->cbe->on_stream_elem)(ichttp_query_to_slot(iq), elem);
+}
+
+static void ichttp_query_on_data_stream(httpd_query_t *q, pstream_t ps)
+{
+    ichttp_query_t *iq = obj_vcast(ichttp_query, q);
+    SB_1k(err);
+
+    if (iop_junpack_stream_feed(iq->jstream, ps, &err) < 0
+    &&  !q->answered)
+    {
+        httpd_reject(q, BAD_REQUEST, "%s", err.data);
+    }
+}
+
+/* Set up the streamed unpacking of the query if the targeted RPC has a
+ * streamed field, see ichttp_register_stream(). */
+static bool ichttp_query_start_stream(httpd_trigger__ic_t *tcb,
+                                      ichttp_query_t *iq)
+{
+    t_scope;
+    pstream_t url = iq->qinfo->query;
+    pstream_t login;
+    ic__hdr__t *hdr;
+    const char *url_s;
+    ichttp_cb_t *cbe;
+    lstr_t s;
+    int pos;
+
+    if (!is_ctype_json(iq->qinfo)) {
+        return false;
+    }
+
+    ps_skipstr(&url, "/");
+    url_s = url.s;
+    if (ps_skip_uptochr(&url, '/') < 0) {
+        return false;
+    }
+    __ps_skip(&url, 1);
+    if (ps_skip_uptochr(&url, '/') < 0) {
+        s = LSTR_INIT_V(url_s, url.s_end - url_s);
+    } else {
+        s = LSTR_INIT_V(url_s, url.s - url_s);
+    }
+    pos = qm_find(ichttp_cbs, &tcb->impl, &s);
+    if (pos < 0 || !tcb->impl.values[pos]->on_stream_elem) {
+        return false;
+    }
+    cbe = tcb->impl.values[pos];
+
+    /* The elements are handed to the RPC while the query is received, so
+     * it must be authenticated by the pre-hook first. */
+    hdr = t_ichttp_query_get_hdr(iq, &login);
+    if (t_ic_query_do_pre_hook(NULL, ichttp_query_to_slot(iq), &cbe->e, hdr,
+                               &iq->stream_hdr_modified) < 0)
+    {
+        if (!iq->answered) {
+            httpd_reject(obj_vcast(httpd_query, iq), FORBIDDEN,
+                         "query rejected");
+        }
+        return true;
+    }
+    iq->stream_hdr = iop_dup(ic__hdr, hdr);
+
+    iq->jstream = iop_junpack_stream_new(tcb->iop_env, cbe->fun->args,
+                                         cbe->stream_field, tcb->unpack_flags,
+                                         tcb->query_max_size,
+                                         &ichttp_query_on_stream_elem, iq,
+                                         NULL);
+    if (!iq->jstream) {
+        return false;
+    }
+    iq->cbe = ichttp_cb_retain(cbe);
+    iq->on_data = &ichttp_query_on_data_stream;
+    return true;
+}
+
 static void httpd_trigger__ic_cb(httpd_trigger_t *tcb, httpd_query_t *q,
                                  const httpd_qinfo_t *req)
 {
@@ -355,6 +794,9 @@ static void httpd_trigger__ic_cb(httpd_trigger_t *tcb, httpd_query_t *q,
 
     q->on_done = ichttp_query_on_done;
     q->qinfo   = httpd_qinfo_dup(req);
+    if (ichttp_query_start_stream(cb, obj_vcast(ichttp_query, q))) {
+        return;
+    }
     httpd_bufferize(q, cb->query_max_size);
 }
 
@@ -404,6 +846,38 @@ ichttp_register_function(httpd_trigger__ic_t *tcb,
     return cb;
 }
 
+int ichttp_register_stream(httpd_trigger__ic_t *tcb, lstr_t rpc_uri,
+                           lstr_t field, ichttp_stream_elem_f *on_elem)
+{
+    const iop_field_t *fdesc;
+    ichttp_cb_t *cbe;
+    int pos;
+
+    pos = qm_find(ichttp_cbs, &tcb->impl, &rpc_uri);
+    if (pos < 0) {
+        return e_error("cannot stream `%*pM`: unknown RPC",
+                       LSTR_FMT_ARG(rpc_uri));
+    }
+    cbe = tcb->impl.values[pos];
+
+    if (cbe->e.cb_type != IC_CB_NORMAL && cbe->e.cb_type != IC_CB_WS_SHARED)
+    {
+        return e_error("cannot stream `%*pM`: RPC is not implemented "
+                       "locally", LSTR_FMT_ARG(rpc_uri));
+    }
+    if (iop_field_find_by_name(cbe->fun->args, field, NULL, &fdesc) < 0
+    ||  fdesc->repeat != IOP_R_REPEATED
+    ||  (fdesc->type != IOP_T_STRUCT && fdesc->type != IOP_T_UNION))
+    {
+        return e_error("cannot stream `%*pM`: `%*pM` is not an array of "
+                       "objects", LSTR_FMT_ARG(rpc_uri), LSTR_FMT_ARG(field));
+    }
+
+    lstr_copy(&cbe->stream_field, field);
+    cbe->on_stream_elem = on_elem;
+    return 0;
+}
+
 ichttp_cb_t *
 __ichttp_register(httpd_trigger__ic_t *tcb, const iop_iface_alias_t *alias,
                   const iop_rpc_t *fun, int32_t cmd, const ic_cb_entry_t *cb)
@@ -530,6 +1004,10 @@ __ichttp_reply(uint64_t slot, int cmd, const iop_struct_t *st, const void *v)
     size_t oblen;
 
     ic_query_do_post_hook(NULL, cmd, slot, st, v);
+    if (ichttp_slot_is_batch_call(slot)) {
+        ichttp_batch_reply(slot, cmd, st, v);
+        return;
+    }
     gzenc = httpd_qinfo_accept_enc_get(q->qinfo);
     tcb = container_of(iq->trig_cb, httpd_trigger__ic_t, cb);
 
@@ -585,7 +1063,7 @@ __ichttp_reply(uint64_t slot, int cmd, const iop_struct_t *st, const void *v)
 
         t_sb_init(&buf, BUFSIZ);
         if (iq->json) {
-            iop_jpack(st, v, iop_sb_write, &buf, tcb->jpack_flags);
+            iop_sb_jpack(&buf, st, v, tcb->jpack_flags);
             iq->iop_answered = true;
         } else {
             ichttp_serialize_soap(&buf, iq, cmd, st, v);
@@ -593,7 +1071,7 @@ __ichttp_reply(uint64_t slot, int cmd, const iop_struct_t *st, const void *v)
         sb_add_compressed(out, buf.data, buf.len, Z_BEST_COMPRESSION, is_gzip);
     } else
     if (iq->json) {
-        iop_jpack(st, v, iop_sb_write, out, tcb->jpack_flags);
+        iop_sb_jpack(out, st, v, tcb->jpack_flags);
         iq->iop_answered = true;
     } else {
         ichttp_serialize_soap(out, iq, cmd, st, v);
@@ -667,6 +1145,13 @@ static void __ichttp_reject(uint64_t slot, ichttp_query_t *iq,
     sb_addvf(&err, fmt, ap);
     va_end(ap);
 
+    if (ichttp_slot_is_batch_call(slot)) {
+        SB_1k(buf);
+
+        ichttp_batch_add_err(&buf, LSTR_SB_V(&err));
+        ichttp_batch_call_done(ichttp_slot_to_batch_call(slot), rest_code,
+                               LSTR_SB_V(&buf));
+    } else
     if (iq->json) {
         /* In REST, INTERNAL_SERVER_ERROR is reserved for IOP exceptions
          * (cf. __ichttp_reply). */
@@ -717,7 +1202,7 @@ void __ichttp_reply_err(uint64_t slot, int err, const lstr_t *err_str)
 void __ichttp_proxify(uint64_t slot, int cmd, const void *data, int dlen)
 {
     ichttp_query_t  *iq  = ichttp_slot_to_query(slot);
-    const iop_rpc_t *rpc = iq->cbe->fun;
+    const iop_rpc_t *rpc = ichttp_slot_get_cbe(slot)->fun;
     const iop_struct_t *st;
     pstream_t ps;
     void *v;
@@ -761,7 +1246,7 @@ void __ichttp_forward_reply(ichannel_t *pxy_ic, uint64_t slot, int cmd,
                             const void *res, const void *exn)
 {
     ichttp_query_t  *iq  = ichttp_slot_to_query(slot);
-    const iop_rpc_t *rpc = iq->cbe->fun;
+    const iop_rpc_t *rpc = ichttp_slot_get_cbe(slot)->fun;
     const iop_struct_t *st;
     const void *v = (cmd == IC_MSG_OK) ? res : exn;
     sb_t *buf  = &pxy_ic->rbuf;
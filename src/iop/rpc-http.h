@@ -52,6 +52,29 @@
  *
  * At the client side, this api enables the calling code to call HTTP RPCs and
  * consume their responses (in JSON format).
+ *
+ *
+ * Batches: when httpd_trigger__ic_t#batch_max is set, several RPCs can be
+ * called with a single JSON query on the "batch" URL of the trigger (e.g.
+ * http[s]://api.example.com/v1/batch). The payload is an array of calls,
+ * each call being an array with the URI of the RPC and its arguments:
+ *  <code>
+ *    [ [ "iface/rpc1", { "a": 1 } ], [ "iface/rpc2", { "b": "c" } ] ]
+ *  </code>
+ * The calls are run concurrently and their replies are streamed back in a
+ * chunked JSON array as soon as they complete, so in no particular order.
+ * Each reply is an array with the index of the call in the query, the HTTP
+ * code the call would have had on its own, and the result, the exception
+ * or the error message of the call:
+ *  <code>
+ *    [ [ 1, 200, { "d": 2 } ], [ 0, 404, "unknown RPC" ] ]
+ *  </code>
+ * Asynchronous RPCs are answered with a 202 code and a null value.
+ * Streamed RPCs (see ichttp_register_stream()) cannot be batched.
+ *
+ * At the client side, http_iop_channel_cfg_t#batch_max enables the
+ * coalescing of the queries issued in the same event loop iteration into
+ * such batches.
  */
 
 /* {{{ Server-side rpc-http */
@@ -60,6 +83,18 @@
 /* HTTP Queries                                                           */
 /**************************************************************************/
 
+/** Callback receiving the elements of a streamed field of RPC arguments.
+ *
+ * See ichttp_register_stream().
+ *
+ * \param[in] slot  The slot of the HTTP query.
+ * \param[in] elem  The unpacked element, allocated on the t_pool() and only
+ *                  valid during the call.
+ *
+ * \return A negative value to reject the query.
+ */
+typedef int (ichttp_stream_elem_f)(uint64_t slot, const void * nonnull elem);
+
 typedef struct ichttp_cb_t {
     int              refcnt;
     int32_t          cmd;
@@ -69,6 +104,10 @@ typedef struct ichttp_cb_t {
     lstr_t           name_uri;
     lstr_t           name_res;
     lstr_t           name_exn;
+
+    /* Streamed field of the arguments, see ichttp_register_stream(). */
+    lstr_t           stream_field;
+    ichttp_stream_elem_f * nullable on_stream_elem;
 } ichttp_cb_t;
 GENERIC_INIT(ichttp_cb_t, ichttp_cb);
 void ichttp_cb_wipe(ichttp_cb_t * nonnull rpc);
@@ -78,7 +117,13 @@ DO_REFCNT(ichttp_cb_t, ichttp_cb);
     HTTPD_QUERY_FIELDS(pfx);                                                 \
     ichttp_cb_t * nonnull cbe;                                               \
     ic__hdr__t * nullable ic_hdr;                                            \
+    iop_junpack_stream_t * nullable jstream;                                 \
+    ic__hdr__t * nullable stream_hdr;                                        \
+    bool   stream_hdr_modified;                                              \
     size_t iop_res_size;                                                     \
+    int    batch_pending;                                                    \
+    int    batch_replies;                                                    \
+    size_t batch_res_size;                                                   \
     bool   json;                                                             \
     bool   iop_answered
 
@@ -108,6 +153,9 @@ typedef struct httpd_trigger__ic_t {
     unsigned                 jpack_flags;
     unsigned                 unpack_flags;
 
+    /* Maximum number of calls of a batch query, 0 disables batches. */
+    unsigned                 batch_max;
+
     void (* nonnull on_reply)(const struct httpd_trigger__ic_t * nonnull,
                               const ichttp_query_t * nonnull, size_t res_size,
                               http_code_t res_code);
@@ -138,10 +186,50 @@ void httpd_trigger__ic_set_public(httpd_trigger__ic_t * nonnull tcb)
     tcb->jpack_flags  |= IOP_JPACK_SKIP_PRIVATE;
 }
 
+/** \brief internal do not use directly, or know what you're doing.
+ *
+ * A call of a batch query. Its slot is the one of a query with the
+ * ICHTTP_SLOT_BATCH_CALL bit set, which is always clear for queries since
+ * they are at least 8 bytes aligned.
+ */
+typedef struct ichttp_batch_call_t {
+    ichttp_query_t * nonnull iq;
+    ichttp_cb_t    * nonnull cbe;
+    int id;
+} ichttp_batch_call_t;
+
+#define ICHTTP_SLOT_BATCH_CALL  UINT64_C(1)
+
+/** \brief internal do not use directly, or know what you're doing. */
+static inline bool ichttp_slot_is_batch_call(uint64_t slot)
+{
+    return ic_slot_is_http(slot) && (slot & ICHTTP_SLOT_BATCH_CALL);
+}
+
+/** \brief internal do not use directly, or know what you're doing. */
+static inline ichttp_batch_call_t * nonnull
+ichttp_slot_to_batch_call(uint64_t slot)
+{
+    assert (ichttp_slot_is_batch_call(slot));
+    return (ichttp_batch_call_t *)((uintptr_t)(slot & ~ICHTTP_SLOT_BATCH_CALL)
+                                   << 2);
+}
+
+/** \brief internal do not use directly, or know what you're doing. */
+static inline uint64_t
+ichttp_batch_call_to_slot(ichttp_batch_call_t * nonnull call)
+{
+    return IC_SLOT_FOREIGN_HTTP | ((uintptr_t)call >> 2)
+         | ICHTTP_SLOT_BATCH_CALL;
+}
+
 /** \brief internal do not use directly, or know what you're doing. */
 static inline ichttp_query_t * nonnull ichttp_slot_to_query(uint64_t slot)
 {
     assert (ic_slot_is_http(slot));
+    if (slot & ICHTTP_SLOT_BATCH_CALL) {
+        return ichttp_slot_to_batch_call(slot)->iq;
+    }
     return (ichttp_query_t *)((uintptr_t)slot << 2);
 }
 
@@ -151,6 +239,27 @@ static inline uint64_t ichttp_query_to_slot(ichttp_query_t * nonnull iq)
     return IC_SLOT_FOREIGN_HTTP | ((uintptr_t)iq >> 2);
 }
 
+/** \brief internal do not use directly, or know what you're doing.
+ *
+ * Get the RPC called with a slot, for queries and batch calls.
+ */
+static inline ichttp_cb_t * nonnull ichttp_slot_get_cbe(uint64_t slot)
+{
+    if (ichttp_slot_is_batch_call(slot)) {
+        return ichttp_slot_to_batch_call(slot)->cbe;
+    }
+    return ichttp_slot_to_query(slot)->cbe;
+}
+
+/** \brief internal do not use directly, or know what you're doing.
+ *
+ * Split a JSON array into its elements, without parsing them.
+ *
+ * \return -1 if \p ps is not a (well bracketed) array.
+ */
+int __ichttp_json_split_array(pstream_t ps,
+                              qv_t(pstream) * nonnull elems);
+
 /** \brief internal do not use directly, or know what you're doing. */
 void __ichttp_reply(uint64_t slot, int cmd, const iop_struct_t * nonnull,
                     const void * nonnull);
@@ -181,6 +290,37 @@ void __t_ichttp_query_on_done_stage2(httpd_query_t * nonnull q,
                                      ichttp_cb_t * nonnull cbe,
                                      void * nullable value);
 
+/** Stream the elements of a repeated field of the arguments of an RPC.
+ *
+ * By default, the whole payload of a query is buffered before being
+ * unpacked. Once this function is called for a registered RPC, the JSon
+ * queries for this RPC are unpacked while they are received: each element
+ * of the field \p field is unpacked as soon as it is complete and given to
+ * \p on_elem, so that huge uploads do not have to be kept in memory.
+ *
+ * The RPC implementation is then called as usual once the whole query is
+ * received, with the streamed field left empty.
+ *
+ * The query_max_size of the trigger then limits the size of each element
+ * (and of the rest of the arguments) instead of the size of the whole
+ * payload.
+ *
+ * SOAP queries are not streamed.
+ *
+ * \param[in] tcb       The trigger on which the RPC is registered.
+ * \param[in] rpc_uri   The URI of the RPC relative to the trigger
+ *                      ("<interface alias>/<rpc name>").
+ * \param[in] field     The name of the streamed field of the arguments. It
+ *                      must be an array of structures, unions or classes.
+ * \param[in] on_elem   The callback called for each element.
+ *
+ * \return -1 if the RPC or the field is not found, or if the RPC is not
+ *         implemented locally.
+ */
+int ichttp_register_stream(httpd_trigger__ic_t * nonnull tcb, lstr_t rpc_uri,
+                           lstr_t field,
+                           ichttp_stream_elem_f * nonnull on_elem);
+
 /** \brief internal do not use directly, or know what you're doing. */
 ichttp_cb_t * nonnull
 __ichttp_register(httpd_trigger__ic_t * nonnull tcb,
@@ -659,6 +799,17 @@ struct http_iop_channel_t {
     uint32_t response_max_size;
     bool     encode_url;
 
+    /** Queries coalesced in the next batch query.
+     *
+     * When batch_max is greater than 1, the queries fired during an
+     * event loop iteration are sent together on the "batch" URL of the
+     * remote, by groups of at most batch_max queries.
+     */
+    uint32_t batch_max;
+    uint32_t batch_len;
+    htlist_t batch_msgs;
+    el_t     batch_el;
+
     on_connection_error_f on_connection_error_cb;
     on_ready_f            on_ready_cb;
 
@@ -729,6 +880,15 @@ typedef struct http_iop_channel_cfg_t {
      */
     opt_bool_t encode_url;
 
+    /** Maximum number of queries sent in a single batch query.
+     *
+     * The remote must accept batches (see httpd_trigger__ic_t#batch_max),
+     * queries with a specific authentication are never batched.
+     *
+     * Default is 0, queries are not batched.
+     */
+    opt_u32_t batch_max;
+
     /** User used for authentification.
      *
      * Leave empty to disable authentication.
@@ -114,7 +114,9 @@ xpack_value(sb_t *sb, const iop_struct_t *desc, const iop_field_t *f,
         if (isinf(d)) {
             sb_adds(sb, d < 0 ? "-INF" : "INF");
         } else {
-            sb_addf(sb, "%.17g", d);
+            char buf[DTOA_SHORTEST_LEN];
+
+            sb_add(sb, buf, dtoa_shortest(buf, d));
         }
         break;
       case IOP_T_BOOL:
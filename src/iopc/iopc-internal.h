@@ -726,6 +726,8 @@ typedef struct iopc_struct_t {
     bool       resolved_inheritance  : 1;
     bool       checked_constraints  : 1;
     bool       has_constraints      : 1;
+    bool       checked_flat         : 1;
+    bool       is_flat              : 1;    /**< see IOP_STRUCT_IS_FLAT     */
     bool       has_fields_attrs     : 1;    /**< st.fields_attrs existence  */
     bool       is_abstract          : 1;
     bool       is_local             : 1;
@@ -694,6 +694,40 @@ extern int log_stderr_handler_teefd_g;
  */
 log_handler_f * nonnull log_set_handler(log_handler_f * nonnull handler);
 
+/* }}} */
+/* Asynchronous writes {{{ */
+
+/** What to do when the asynchronous log queues are full. */
+typedef enum log_async_policy_t {
+    /** Drop the message; the number of dropped messages is logged later. */
+    LOG_ASYNC_DROP,
+    /** Wait for the logging thread to make some room. */
+    LOG_ASYNC_BLOCK,
+} log_async_policy_t;
+
+/** Make the default handlers write their messages from a dedicated thread.
+ *
+ * The messages are still formatted by the calling thread (their arguments
+ * may not outlive the call), but instead of being written on stderr (and
+ * \ref log_stderr_handler_teefd_g) synchronously, they are pushed in a
+ * per-thread wait-free queue. A logging thread gathers them and writes them
+ * in batches.
+ *
+ * Messages of level LOG_CRIT or worse are still written synchronously,
+ * after the pending messages were flushed.
+ *
+ * \param[in] max_pending  Maximum amount of bytes waiting to be written.
+ * \param[in] policy       What to do when \p max_pending is reached.
+ * \return -1 if the logging thread could not be created, 0 otherwise.
+ */
+int log_start_async(size_t max_pending, log_async_policy_t policy);
+
+/** Flush the pending messages and stop the logging thread.
+ *
+ * The default handlers write synchronously again after this call.
+ */
+void log_stop_async(void);
+
 /* }}} */
 /* Log buffer {{{ */
 
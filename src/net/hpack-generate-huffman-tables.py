@@ -22,7 +22,9 @@ HPACK algorithm (of RFC-7541) as c arrays in autogenerated c files. The script
 accepts as parameter the text of RFC-7541 which can be shortened to the
 appendix section. For encoding, it generates the char-to-huffman-string
 mapping. For decoding, it generates the decoder's state-transition table
-based on input chunks of 1 or 2 or 4 bits at a time. This script is meant to
+based on input chunks of 1 or 2 or 4 bits at a time. For fast decoding, it
+generates a table giving the (up to two) symbols coded at the start of every
+window of 11 bits. This script is meant to
 generate the '.c' files during the build step and accepts as parameter
 a preamble text that '#include's a common '.h' file. For example:
 
@@ -56,6 +58,15 @@ extern const hpack_huffcode_t hpack_huffcode_tab_g[256 + 1];
 
 // 16 is compatible with input chunks of 4 bits.
 extern const hpack_huffdec_trans_t hpack_huffdec_trans_tab_g[256][16];
+
+// Type definition of the fast decoder's table.
+typedef struct hpack_huffdec_fast_t {
+    uint8_t sym[2];
+    uint8_t len1;
+    uint8_t len2;
+} hpack_huffdec_fast_t;
+
+extern const hpack_huffdec_fast_t hpack_huffdec_fast_tab_g[1 << 11];
 ========================================================================
 
 See 'options' for further details on command line paramters.
@@ -83,6 +94,9 @@ DEF_ENCODE_TABLE_NAME = 'hpack_huffcode_tab_g'
 DEF_DECODE_ELEM_T = 'const hpack_huffdec_trans_t'
 DEF_DECODE_TABLE_NAME = 'hpack_huffdec_trans_tab_g'
 DEF_CHUNKBITS = 4
+DEF_FAST_DECODE_ELEM_T = 'const hpack_huffdec_fast_t'
+DEF_FAST_DECODE_TABLE_NAME = 'hpack_huffdec_fast_tab_g'
+DEF_WINDOWBITS = 11
 
 
 HuffManCodeTable = list[tuple[int, int, int, str]]
@@ -335,6 +349,57 @@ def gen_table_for_decoding(rfc_fn: str, out_fn: Optional[str], hdr_lines: str,
         print(content, end='')
 
 
+def get_huffman_fast_table_as_c_array(rfc_fn: str, tbl_elem_t: str,
+                                      tbl_name: str, window_bits: int) -> str:
+    """ For every window of bits, give the symbols whose codes fit in it,
+    starting from its first bit (at most two as the shortest codes are 5-bit
+    long), and the cumulated code lengths. A 0 length means that the code of
+    the first symbol does not fit in the window. """
+    tree = get_huffman_tree(get_huffman_code_table_from(rfc_fn))
+    lines = []
+
+    for window in range(2 ** window_bits):
+        window_str = format(window, '0{}b'.format(window_bits))
+        syms, lens, node, depth = [], [], tree, 0
+
+        for bit in (int(ch) for ch in window_str):
+            node = cast(Tree, node[bit])
+            depth += 1
+            if node['sym'] is not None:
+                assert node['sym'] != HUFFMAN_EOS
+                syms.append(cast(int, node['sym']))
+                lens.append(depth)
+                node = tree
+                if len(syms) == 2:
+                    break
+
+        syms += [0] * (2 - len(syms))
+        lens += [0] * (2 - len(lens))
+        lines.append("/* %s */ {{%3d, %3d}, %2d, %2d}" %
+                     (window_str, syms[0], syms[1], lens[0], lens[1]))
+
+    content = "{\n  " + ",\n  ".join(lines) + "\n}"
+    array_dec = "{} {}[1 << {}] = {};".format(
+        tbl_elem_t, tbl_name, window_bits, content)
+    return array_dec
+
+
+def gen_table_for_fast_decoding(rfc_fn: str, out_fn: Optional[str],
+                                hdr_lines: str, tbl_elem_t: str,
+                                tbl_name: str, window_bits: int) -> None:
+    head = HDR_AUTOGENERATED
+    license_comment = get_license_as_c_comment()
+    c_array_dec = get_huffman_fast_table_as_c_array(rfc_fn, tbl_elem_t,
+                                                    tbl_name, window_bits)
+    content = '\n'.join(
+        [head, license_comment, '', hdr_lines, '', c_array_dec, ''])
+    if out_fn:
+        with open(out_fn, 'w') as f:
+            f.write(content)
+    else:
+        print(content, end='')
+
+
 def options(args: list[str]) -> argparse.Namespace:
     op = argparse.ArgumentParser(
         description=("Generate static Huffman encoding and decoding tables of"
@@ -364,6 +429,20 @@ def options(args: list[str]) -> argparse.Namespace:
                     dest='name', default=DEF_DECODE_TABLE_NAME)
     sp.add_argument('-c', '--chunkbits', type=int, choices=[1, 2, 4],
                     default=DEF_CHUNKBITS)
+    sp = subparsers.add_parser('for-fast-decoding',
+                               help='Generate fast decoding table')
+    sp.add_argument('-r', '--rfc', help="rfc 7541 file",
+                    required=True, dest='rfc_fn')
+    sp.add_argument('-o', '--out', help="output file", dest='out_fn',
+                    default=None)
+    sp.add_argument('-H', '--header', help="header lines", dest='hdr_lines',
+                    default=DEF_HDR_LINES)
+    sp.add_argument('-t', '--elem-type', help="type of table element",
+                    dest='elem_t', default=DEF_FAST_DECODE_ELEM_T)
+    sp.add_argument('-n', '--name', help="name of table variable",
+                    dest='name', default=DEF_FAST_DECODE_TABLE_NAME)
+    sp.add_argument('-w', '--windowbits', type=int, choices=range(8, 13),
+                    default=DEF_WINDOWBITS)
     return op.parse_args(args)
 
 
@@ -380,6 +459,10 @@ def main(args: list[str]) -> None:
         gen_table_for_decoding(
             opts.rfc_fn, none_if_minus(opts.out_fn), opts.hdr_lines,
             opts.elem_t, opts.name, opts.chunkbits)
+    elif opts.action == 'for-fast-decoding':
+        gen_table_for_fast_decoding(
+            opts.rfc_fn, none_if_minus(opts.out_fn), opts.hdr_lines,
+            opts.elem_t, opts.name, opts.windowbits)
 
 
 if __name__ == '__main__':
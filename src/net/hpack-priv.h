@@ -52,6 +52,27 @@ typedef struct hpack_huffdec_trans_t {
 /* Huffman state-transition table based on 4-bit chunks (i.e., nibbles) */
 extern const hpack_huffdec_trans_t hpack_huffdec_trans_tab_g[256][16];
 
+/* Fast Huffman decoder's table entries */
+/* The fast decoder always starts from a code boundary, and looks up the
+ * next HPACK_HUFFDEC_FAST_BITS bits of input: the entry gives the (up to
+ * two) symbols whose codes fit in this window. The codes longer than the
+ * window are rare and decoded by a slow path.
+ */
+#define HPACK_HUFFDEC_FAST_BITS  11
+
+typedef struct hpack_huffdec_fast_t {
+    /* decoded symbols */
+    uint8_t sym[2];
+    /* bit length of the code of sym[0], 0 if it does not fit */
+    uint8_t len1;
+    /* bit length of the codes of sym[0] and sym[1], 0 if sym[1] does not
+     * fit */
+    uint8_t len2;
+} hpack_huffdec_fast_t;
+
+extern const hpack_huffdec_fast_t
+hpack_huffdec_fast_tab_g[1 << HPACK_HUFFDEC_FAST_BITS];
+
 /** Return the length of the huffman-coded version of \p str */
 static inline size_t hpack_get_huffman_len(lstr_t str)
 {
@@ -73,33 +73,85 @@ int hpack_encode_huffman(lstr_t str, void *out_, int len)
 #undef OUTPUT_BYTE
 }
 
-int hpack_decode_huffman(lstr_t str, void *out_)
+/* Decode a symbol whose code is longer than HPACK_HUFFDEC_FAST_BITS from the
+ * \p nbits low bits of \p bits: the codes that long are rare, so just look
+ * them up in the encoding table. EOS is not a valid symbol here. */
+static int hpack_decode_huffman_long(uint64_t bits, int nbits, int *bitlen)
 {
-    uint8_t *out = (uint8_t *)out_;
-    uint8_t state;
-    const hpack_huffdec_trans_t *trans = NULL;
-
-    if (unlikely(str.len == 0)) {
-        return 0;
+    for (int sym = 0; sym < 256; sym++) {
+        const hpack_huffcode_t *code = &hpack_huffcode_tab_g[sym];
+        int len = code->bitlen;
+
+        if (len > HPACK_HUFFDEC_FAST_BITS && len <= nbits
+        &&  ((bits >> (nbits - len)) & BITMASK_LT(uint64_t, len))
+            == code->codeword)
+        {
+            *bitlen = len;
+            return sym;
+        }
     }
-    state = 0;
-    for (int i = 0; i != str.len; i++) {
-        uint8_t b = str.s[i];
-        uint8_t nibbles[2];
-
-        nibbles[0] = b >> 4;
-        nibbles[1] = b & 0xF;
+    return -1;
+}
 
-        for (int n = 0; n < 2; n++) {
-            trans = &hpack_huffdec_trans_tab_g[state][nibbles[n]];
-            THROW_ERR_IF(trans->error);
-            if (trans->emitter) {
-                *(out)++ = trans->sym;
+int hpack_decode_huffman(lstr_t str, void *out_)
+{
+    uint8_t *out = (uint8_t *)out_;
+    const uint8_t *in = (const uint8_t *)str.s;
+    const uint8_t *in_end = in + str.len;
+    /* the next bits to decode are the nbits low bits of bits, MSB first */
+    uint64_t bits = 0;
+    int nbits = 0;
+
+    for (;;) {
+        const hpack_huffdec_fast_t *ent;
+        unsigned window;
+        int sym;
+        int len;
+
+        while (nbits <= 56 && in < in_end) {
+            bits = (bits << 8) | *in++;
+            nbits += 8;
+        }
+        if (likely(nbits >= HPACK_HUFFDEC_FAST_BITS)) {
+            window = bits >> (nbits - HPACK_HUFFDEC_FAST_BITS);
+        } else
+        if (nbits > 0) {
+            /* pad the last bits with ones, as the padding */
+            window = (bits << (HPACK_HUFFDEC_FAST_BITS - nbits))
+                   | BITMASK_LT(uint32_t, HPACK_HUFFDEC_FAST_BITS - nbits);
+        } else {
+            break;
+        }
+        ent = &hpack_huffdec_fast_tab_g[window &
+                                        BITMASK_LT(uint32_t,
+                                                   HPACK_HUFFDEC_FAST_BITS)];
+        if (likely(ent->len1)) {
+            if (unlikely(ent->len1 > nbits)) {
+                /* only the padding is left */
+                break;
             }
-            state = trans->state;
+            *out++ = ent->sym[0];
+            if (ent->len2 && ent->len2 <= nbits) {
+                *out++ = ent->sym[1];
+                nbits -= ent->len2;
+            } else {
+                nbits -= ent->len1;
+            }
+            continue;
+        }
+        sym = hpack_decode_huffman_long(bits, nbits, &len);
+        if (sym < 0) {
+            /* only the padding is left, or an invalid code (EOS) */
+            break;
         }
+        *out++ = sym;
+        nbits -= len;
     }
-    THROW_ERR_UNLESS(trans->final);
+
+    /* the padding is the (strict) prefix of EOS: at most 7 bits set */
+    THROW_ERR_IF(nbits > 7);
+    THROW_ERR_UNLESS((bits & BITMASK_LT(uint64_t, nbits))
+                     == BITMASK_LT(uint64_t, nbits));
     return out - (uint8_t *)out_;
 }
 
@@ -639,8 +691,6 @@ int hpack_enc_dtbl_find_hdr(hpack_enc_dtbl_t *dtbl, uint16_t key_id,
 
 static void hpack_dec_dtbl_ent_wipe(hpack_dec_dtbl_entry_t *e)
 {
-    lstr_wipe(&e->key);
-    lstr_wipe(&e->val);
 }
 
 RING_FUNCTIONS(hpack_dec_dtbl_entry_t, hpack_dec_dtbl,
@@ -655,6 +705,7 @@ hpack_dec_dtbl_t *hpack_dec_dtbl_init(hpack_dec_dtbl_t *dtbl)
 void hpack_dec_dtbl_wipe(hpack_dec_dtbl_t *dtbl)
 {
     hpack_dec_dtbl_ring_wipe(&dtbl->entries);
+    p_delete(&dtbl->buf);
 }
 
 static void hpack_dec_dtbl_evict_last_entry(hpack_dec_dtbl_t *dtbl)
@@ -668,8 +719,6 @@ static void hpack_dec_dtbl_evict_last_entry(hpack_dec_dtbl_t *dtbl)
     }
     assert(dtbl->tbl_size >= (uint32_t)HPACK_HDR_SIZE(e.key.len, e.val.len));
     dtbl->tbl_size -= HPACK_HDR_SIZE(e.key.len, e.val.len);
-    lstr_wipe(&e.key);
-    lstr_wipe(&e.val);
 }
 
 static void hpack_dec_dtbl_resize(hpack_dec_dtbl_t *dtbl)
@@ -680,13 +729,38 @@ static void hpack_dec_dtbl_resize(hpack_dec_dtbl_t *dtbl)
     }
 }
 
+/* Grow the strings buffer to twice the max size of the table, moving the
+ * entries at its start. The max size is negotiated once, so it is rare. */
+static void hpack_dec_dtbl_grow_buf(hpack_dec_dtbl_t *dtbl)
+{
+    uint32_t size = 2 * dtbl->tbl_size_max;
+    char *buf = p_new(char, size);
+    uint32_t pos = 0;
+
+    for (int i = dtbl->entries.len; i-- > 0; ) {
+        hpack_dec_dtbl_entry_t *e = hpack_dec_dtbl_get_ent(dtbl, i);
+
+        p_copy(buf + pos, e->key.s, e->key.len);
+        e->key = LSTR_DATA_V(buf + pos, e->key.len);
+        pos += e->key.len;
+        p_copy(buf + pos, e->val.s, e->val.len);
+        e->val = LSTR_DATA_V(buf + pos, e->val.len);
+        pos += e->val.len;
+    }
+    p_delete(&dtbl->buf);
+    dtbl->buf      = buf;
+    dtbl->buf_size = size;
+    dtbl->buf_wpos = pos;
+}
+
+/* The strings are copied in the buffer of the table: they must not point
+ * into it, as they could be overwritten by the evictions. */
 void hpack_dec_dtbl_add_hdr(hpack_dec_dtbl_t *dtbl, lstr_t key, lstr_t val)
 {
     uint32_t e_sz = HPACK_HDR_SIZE(key.len, val.len);
-    hpack_dec_dtbl_entry_t e = {
-        .key = key,
-        .val = val,
-    };
+    uint32_t len = key.len + val.len;
+    hpack_dec_dtbl_entry_t e;
+    char *p;
 
     /*XXX: a big-sized entry may evict all entries without being added to the
      * dtbl */
@@ -694,10 +768,27 @@ void hpack_dec_dtbl_add_hdr(hpack_dec_dtbl_t *dtbl, lstr_t key, lstr_t val)
         hpack_dec_dtbl_evict_last_entry(dtbl);
     }
     if (e_sz > dtbl->tbl_size_limit) {
-        lstr_wipe(&key);
-        lstr_wipe(&val);
         return;
     }
+    if (unlikely(dtbl->buf_size < 2 * dtbl->tbl_size_max)) {
+        hpack_dec_dtbl_grow_buf(dtbl);
+    }
+
+    /* The live strings use at most tbl_size_max - len bytes: when the
+     * buffer wraps, the oldest one starts after tbl_size_max, so the new
+     * strings never overlap live ones. */
+    if (!dtbl->entries.len
+    ||  dtbl->buf_wpos + len > dtbl->buf_size)
+    {
+        dtbl->buf_wpos = 0;
+    }
+    p = dtbl->buf + dtbl->buf_wpos;
+    p_copy(p, key.s, key.len);
+    p_copy(p + key.len, val.s, val.len);
+    dtbl->buf_wpos += len;
+
+    e.key = LSTR_DATA_V(p, key.len);
+    e.val = LSTR_DATA_V(p + key.len, val.len);
     hpack_dec_dtbl_ring_unshift(&dtbl->entries, e);
     dtbl->tbl_size += e_sz;
 }
@@ -1008,7 +1099,6 @@ int hpack_decoder_write_hdr(hpack_dec_dtbl_t *dtbl, hpack_xhdr_t *xhdr,
                             byte *out_, int *keylen)
 {
     byte *out = out_;
-    hpack_dec_dtbl_entry_t *ent = NULL;
     lstr_t key;
     lstr_t val;
     int len;
@@ -1034,7 +1124,7 @@ int hpack_decoder_write_hdr(hpack_dec_dtbl_t *dtbl, hpack_xhdr_t *xhdr,
             val = hpack_stbl_g[idx].val;
         } else {
             int idx_ = idx - HPACK_STBL_IDX_MAX - 1;
-            ent = hpack_dec_dtbl_get_ent(dtbl, idx_);
+            hpack_dec_dtbl_entry_t *ent = hpack_dec_dtbl_get_ent(dtbl, idx_);
 
             key = ent->key;
             val = ent->val;
@@ -1063,15 +1153,10 @@ int hpack_decoder_write_hdr(hpack_dec_dtbl_t *dtbl, hpack_xhdr_t *xhdr,
     *out++ = '\n';
     if (xhdr->flags & XHDR_ADD_DTBL) {
         assert(xhdr->flags & XHDR_NEW_VAL);
-        if (xhdr->flags & XHDR_NEW_KEY) {
-            key = lstr_dup(key);
-        } else if (ent) {
-            /* new entry in the dyn. table with the same key, old entry loses
-             * ownership of the string buffer. */
-            ent->key = lstr_dupc(key);
-        }
-        val = lstr_dup(val);
-        hpack_dec_dtbl_add_hdr(dtbl, key, val);
+        /* Add the copies written in out: an indexed key may belong to an
+         * entry evicted by this very insertion. */
+        hpack_dec_dtbl_add_hdr(dtbl, LSTR_DATA_V(out_, key.len),
+                               LSTR_DATA_V(out_ + key.len + 2, val.len));
     }
     *keylen = key.len;
     return out - out_;
@@ -113,6 +113,14 @@ typedef struct hpack_dec_dtbl_t {
 
     /* ring buffer to hold the dtbl's entries */
     hpack_dec_dtbl_ring_t entries;
+
+    /* The keys and values of the entries point into this buffer of twice
+     * tbl_size_max bytes, used as a ring: an entry that does not fit at its
+     * end is stored at its start, so that strings are never split, and
+     * entries never need their own allocations. */
+    char    *buf;
+    uint32_t buf_size;
+    uint32_t buf_wpos;
 } hpack_dec_dtbl_t;
 
 hpack_dec_dtbl_t *hpack_dec_dtbl_init(hpack_dec_dtbl_t *dtbl);
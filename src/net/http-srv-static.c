@@ -17,6 +17,7 @@
 /***************************************************************************/
 
 #include <lib-common/datetime.h>
+#include <lib-common/hash.h>
 #include <lib-common/http.h>
 
 static void mime_put_http_ctype(outbuf_t *ob, const char *path)
@@ -151,35 +152,107 @@ void httpd_reply_make_index(httpd_query_t *q, int dfd, bool head)
     }
 }
 
+/* {{{ Open files cache */
+
+/* The regular files served are kept open in a small direct-mapped cache,
+ * and their fd is dup()ed for each reply. A cached file is checked again
+ * once per second, so that a replaced file is not served for more than a
+ * second after its replacement.
+ */
+#define HTTPD_FILE_CACHE_SIZE  64
+
+typedef struct httpd_file_cache_entry_t {
+    lstr_t      path;
+    int         dfd;
+    int         fd;
+    time_t      checked;
+    struct stat st;
+} httpd_file_cache_entry_t;
+
+static struct {
+    httpd_file_cache_entry_t entries[HTTPD_FILE_CACHE_SIZE];
+} httpd_file_cache_g;
+
+static void httpd_file_cache_entry_wipe(httpd_file_cache_entry_t *e)
+{
+    if (e->path.s) {
+        lstr_wipe(&e->path);
+        close(e->fd);
+    }
+}
+
+void httpd_file_cache_wipe(void)
+{
+    carray_for_each_ptr(e, httpd_file_cache_g.entries) {
+        httpd_file_cache_entry_wipe(e);
+    }
+}
+
+/* Open a file to serve, through the cache for regular files. */
+static int httpd_file_open(int dfd, const char *file, struct stat *st)
+{
+    int len = strlen(file);
+    uint32_t h = mem_hash32(file, len) ^ dfd;
+    httpd_file_cache_entry_t *e;
+    struct stat cur;
+    time_t now = lp_getsec();
+    int fd;
+
+    e = &httpd_file_cache_g.entries[h % HTTPD_FILE_CACHE_SIZE];
+    if (e->path.s && e->dfd == dfd && lstr_equal(e->path, LSTR_INIT_V(file,
+                                                                      len)))
+    {
+        if (e->checked == now
+        ||  (fstatat(dfd, file, &cur, 0) == 0 && cur.st_ino == e->st.st_ino
+        &&   cur.st_dev == e->st.st_dev && cur.st_size == e->st.st_size
+        &&   cur.st_mtime == e->st.st_mtime))
+        {
+            e->checked = now;
+            *st = e->st;
+            return dup(e->fd);
+        }
+        httpd_file_cache_entry_wipe(e);
+    }
+
+    fd = RETHROW(openat(dfd, file, O_RDONLY | O_CLOEXEC));
+    if (fstat(fd, st)) {
+        PROTECT_ERRNO(close(fd));
+        return -1;
+    }
+    if (S_ISREG(st->st_mode)) {
+        httpd_file_cache_entry_wipe(e);
+        e->path    = lstr_dups(file, len);
+        e->dfd     = dfd;
+        e->fd      = dup(fd);
+        e->checked = now;
+        e->st      = *st;
+        if (e->fd < 0) {
+            lstr_wipe(&e->path);
+        }
+    }
+    return fd;
+}
+
+/* }}} */
+
 void httpd_reply_file(httpd_query_t *q, int dfd, const char *file, bool head)
 {
-    int fd = openat(dfd, file, O_RDONLY);
     struct stat st;
+    int fd = httpd_file_open(dfd, file, &st);
     outbuf_t *ob;
-    void *map = NULL;
 
     if (fd < 0)
         goto ret404;
 
-    if (fstat(fd, &st))
-        goto ret404;
     if (S_ISDIR(st.st_mode)) {
         if (file[strlen(file) - 1] != '/')
             goto ret404;
         httpd_reply_make_index(q, fd, head);
+        close(fd);
         return;
     }
     if (!S_ISREG(st.st_mode))
         goto ret404;
-    if (!head && st.st_size > (16 << 10)) {
-        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
-        if (map == MAP_FAILED) {
-            httpd_reject(q, INTERNAL_SERVER_ERROR, "mmap failed: %m");
-            close(fd);
-            return;
-        }
-        madvise(map, st.st_size, MADV_SEQUENTIAL);
-    }
 
     ob = httpd_reply_hdrs_start(q, HTTP_CODE_OK, false);
     httpd_put_date_hdr(ob, "Last-Modified", st.st_mtime);
@@ -193,14 +266,13 @@ void httpd_reply_file(httpd_query_t *q, int dfd, const char *file, bool head)
     mime_put_http_ctype(ob, file);
     httpd_reply_hdrs_done(q, st.st_size, false);
     if (!head) {
-        if (map) {
-            ob_add_memmap(ob, map, st.st_size);
-        } else {
-            ob_xread(ob, fd, st.st_size);
-        }
+        /* Large files are sent with sendfile(2) once the headers are out.
+         */
+        IGNORE(ob_add_file_range(ob, fd, 0, st.st_size, true));
+        fd = -1;
     }
     httpd_reply_done(q);
-    close(fd);
+    p_close(&fd);
     return;
 
   ret404:
@@ -16,6 +16,7 @@
 /*                                                                         */
 /***************************************************************************/
 
+#include <sched.h>
 #include <sys/file.h>
 #include <lib-common/unix.h>
 #include <lib-common/datetime.h>
@@ -28,9 +29,17 @@
 #include <lib-common/core/core.iop.h>
 
 #include <lib-common/file.h>
+#include <lib-common/zlib-wrapper.h>
 
 #include <openssl/ssl.h>
 
+#ifdef __SSE2__
+#   pragma push_macro("__leaf")
+#   undef __leaf
+#   include <x86intrin.h>
+#   pragma pop_macro("__leaf")
+#endif
+
 #include "httptokens.h"
 
 static struct {
@@ -85,6 +94,7 @@ static void httpd_trigger_destroy(httpd_trigger_t *cb, unsigned delta)
     cb->refcnt -= delta;
     if (cb->refcnt == 0) {
         lstr_wipe(&cb->auth_realm);
+        httpd_rcache_delete(&cb->rcache);
         if (cb->destroy) {
             cb->destroy(cb);
         } else {
@@ -234,6 +244,55 @@ static inline int http_getline(pstream_t *ps, unsigned max_len,
     return __ps_skip_upto(ps, p + 2);
 }
 
+/* Look for the "\r\n\r\n" that ends the headers in s[start, len), and
+ * count the lines seen on the way in *lines.
+ *
+ * The end of the headers is checked backward from each LF, so that the scan
+ * can be resumed where it stopped once more data is received: nothing is
+ * scanned twice. LFs are searched 16 bytes at a time.
+ *
+ * Returns the offset of the "\r\n\r\n", or -1 if it is not there yet.
+ */
+static ALWAYS_INLINE int
+http_scan_hdrs_end(const byte *s, int start, int len, int *lines)
+{
+#define HTTP_IS_HDRS_END(s, pos)                                             \
+    ((pos) >= 3 && (s)[(pos) - 1] == '\r' && (s)[(pos) - 2] == '\n'          \
+     && (s)[(pos) - 3] == '\r')
+
+    int i = start;
+
+#ifdef __SSE2__
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i  v = _mm_loadu_si128((const __m128i *)(s + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, lf));
+
+        while (mask) {
+            int pos = i + bsf32(mask);
+
+            (*lines)++;
+            if (HTTP_IS_HDRS_END(s, pos)) {
+                return pos - 3;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (s[i] == '\n') {
+            (*lines)++;
+            if (HTTP_IS_HDRS_END(s, i)) {
+                return i - 3;
+            }
+        }
+    }
+    return -1;
+#undef HTTP_IS_HDRS_END
+}
+
 /* rfc 2616, §3.3.1: Full Date */
 static char const * const days[7] = {
     "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat",
@@ -662,6 +721,7 @@ static void httpd_query_wipe(httpd_query_t *q)
     }
     httpd_qinfo_delete(&q->qinfo);
     sb_wipe(&q->payload);
+    lstr_wipe(&q->rcache_key);
     httpd_query_detach(q);
 }
 
@@ -937,6 +997,253 @@ void httpd_reject_unauthorized(httpd_query_t *q, lstr_t auth_realm)
     httpd_reply_done(q);
 }
 
+/*---- responses cache ----*/
+
+/* Bodies smaller than that are not worth compressing. */
+#define HTTPD_RCACHE_GZIP_MIN  256
+
+/* The entries are refcounted: the outbuf chunks sending them keep them
+ * alive after they are evicted from the cache. */
+typedef struct httpd_rcache_entry_t {
+    int    refcnt;
+    time_t expiry;
+    lstr_t key;
+    lstr_t ctype;
+    sb_t   body;
+    sb_t   gzbody;
+} httpd_rcache_entry_t;
+
+qm_kvec_t(httpd_rcache, lstr_t, httpd_rcache_entry_t * nonnull,
+          qhash_lstr_hash, qhash_lstr_equal);
+
+struct httpd_rcache_t {
+    int      ttl;
+    size_t   memory_max;
+    size_t   memory;
+    uint64_t hits;
+    uint64_t misses;
+    qm_t(httpd_rcache) entries;
+};
+
+static httpd_rcache_entry_t *
+httpd_rcache_entry_new(lstr_t ctype, lstr_t body)
+{
+    httpd_rcache_entry_t *e = p_new(httpd_rcache_entry_t, 1);
+
+    e->refcnt = 1;
+    e->ctype  = lstr_dup(ctype);
+    sb_init(&e->body);
+    sb_init(&e->gzbody);
+    sb_add_lstr(&e->body, body);
+
+    /* The body is compressed once and for all, so compress it hard; keep
+     * the gzip variant only when it saves something. */
+    if (body.len >= HTTPD_RCACHE_GZIP_MIN) {
+        if (sb_add_compressed(&e->gzbody, body.s, body.len,
+                              Z_BEST_COMPRESSION, true) < 0
+        ||  e->gzbody.len >= body.len)
+        {
+            sb_wipe(&e->gzbody);
+        }
+    }
+    return e;
+}
+
+static httpd_rcache_entry_t *
+httpd_rcache_entry_retain(httpd_rcache_entry_t *e)
+{
+    e->refcnt++;
+    return e;
+}
+
+static void httpd_rcache_entry_release(void *priv)
+{
+    httpd_rcache_entry_t *e = priv;
+
+    assert (e->refcnt > 0);
+    if (--e->refcnt == 0) {
+        lstr_wipe(&e->key);
+        lstr_wipe(&e->ctype);
+        sb_wipe(&e->body);
+        sb_wipe(&e->gzbody);
+        p_delete(&e);
+    }
+}
+
+static size_t httpd_rcache_entry_size(const httpd_rcache_entry_t *e)
+{
+    return sizeof(*e) + e->key.len + e->ctype.len + e->body.size
+         + e->gzbody.size;
+}
+
+httpd_rcache_t *httpd_rcache_new(int ttl, size_t memory_max)
+{
+    httpd_rcache_t *rc = p_new(httpd_rcache_t, 1);
+
+    rc->ttl        = ttl;
+    rc->memory_max = memory_max;
+    qm_init(httpd_rcache, &rc->entries);
+    return rc;
+}
+
+static void httpd_rcache_del_at(httpd_rcache_t *rc, int pos)
+{
+    httpd_rcache_entry_t *e = rc->entries.values[pos];
+
+    rc->memory -= httpd_rcache_entry_size(e);
+    qm_del_at(httpd_rcache, &rc->entries, pos);
+    httpd_rcache_entry_release(e);
+}
+
+void httpd_rcache_delete(httpd_rcache_t **rcp)
+{
+    httpd_rcache_t *rc = *rcp;
+
+    if (rc) {
+        httpd_rcache_invalidate(rc, LSTR_NULL_V);
+        qm_wipe(httpd_rcache, &rc->entries);
+        p_delete(rcp);
+    }
+}
+
+/* The keys are "<path>?<vars>". */
+void httpd_rcache_invalidate(httpd_rcache_t *rc, lstr_t path)
+{
+    qm_for_each_pos(httpd_rcache, pos, &rc->entries) {
+        lstr_t key = rc->entries.keys[pos];
+
+        if (!path.s || (key.len > path.len && key.s[path.len] == '?'
+                        && lstr_startswith(key, path)))
+        {
+            httpd_rcache_del_at(rc, pos);
+        }
+    }
+}
+
+void httpd_rcache_get_stats(const httpd_rcache_t *rc,
+                            httpd_rcache_stats_t *stats)
+{
+    uint64_t total = rc->hits + rc->misses;
+
+    p_clear(stats, 1);
+    stats->hits      = rc->hits;
+    stats->misses    = rc->misses;
+    stats->hit_ratio = total ? (double)rc->hits / total : 0.;
+    stats->entries   = qm_len(httpd_rcache, &rc->entries);
+    stats->memory    = rc->memory;
+}
+
+static void httpd_rcache_purge_expired(httpd_rcache_t *rc, time_t now)
+{
+    qm_for_each_pos(httpd_rcache, pos, &rc->entries) {
+        if (rc->entries.values[pos]->expiry <= now) {
+            httpd_rcache_del_at(rc, pos);
+        }
+    }
+}
+
+/* Takes the ownership of e->key. */
+static void httpd_rcache_store(httpd_rcache_t *rc, httpd_rcache_entry_t *e)
+{
+    time_t now = lp_getsec();
+    size_t size = httpd_rcache_entry_size(e);
+    int pos;
+
+    /* Another query on the same key may have been answered meanwhile. */
+    if ((pos = qm_find(httpd_rcache, &rc->entries, &e->key)) >= 0) {
+        httpd_rcache_del_at(rc, pos);
+    }
+    if (rc->memory + size > rc->memory_max) {
+        httpd_rcache_purge_expired(rc, now);
+        if (rc->memory + size > rc->memory_max) {
+            logger_trace(&_G.logger, 1, "response of `%*pM` is too large "
+                         "to be cached", LSTR_FMT_ARG(e->key));
+            return;
+        }
+    }
+
+    e->expiry   = now + rc->ttl;
+    rc->memory += size;
+    qm_add(httpd_rcache, &rc->entries, &e->key,
+           httpd_rcache_entry_retain(e));
+}
+
+static void httpd_rcache_reply(httpd_query_t *q, httpd_rcache_entry_t *e,
+                               bool gzip)
+{
+    const sb_t *body = gzip && e->gzbody.len ? &e->gzbody : &e->body;
+    outbuf_t *ob = httpd_reply_hdrs_start(q, HTTP_CODE_OK, false);
+
+    ob_addf(ob, "Content-Type: %*pM\r\n", LSTR_FMT_ARG(e->ctype));
+    if (e->gzbody.len) {
+        ob_adds(ob, "Vary: Accept-Encoding\r\n");
+        if (body == &e->gzbody) {
+            ob_adds(ob, "Content-Encoding: gzip\r\n");
+        }
+    }
+    httpd_reply_hdrs_done(q, body->len, false);
+
+    if (q->owner && q->owner->http2_ctx) {
+        /* http2 streams do not support outbuf chunks */
+        ob_add(ob, body->data, body->len);
+    } else {
+        ob_add_memchunk_shared(ob, body->data, body->len,
+                               &httpd_rcache_entry_release,
+                               httpd_rcache_entry_retain(e));
+    }
+    httpd_reply_done(q);
+}
+
+/* Answer q from the cache if possible, otherwise remember its key so that
+ * httpd_reply_cached() can store the response. */
+static bool httpd_rcache_lookup(httpd_rcache_t *rc, httpd_query_t *q,
+                                const httpd_qinfo_t *req)
+{
+    t_scope;
+    pstream_t path = ps_initptr(req->prefix.s, req->query.s_end);
+    lstr_t key = t_lstr_fmt("%*pM?%*pM", PS_FMT_ARG(&path),
+                            PS_FMT_ARG(&req->vars));
+    bool gzip = httpd_qinfo_accept_enc_get(req) & HTTPD_ACCEPT_ENC_GZIP;
+    int pos = qm_find(httpd_rcache, &rc->entries, &key);
+
+    if (pos >= 0 && rc->entries.values[pos]->expiry <= lp_getsec()) {
+        httpd_rcache_del_at(rc, pos);
+        pos = -1;
+    }
+    if (pos < 0) {
+        rc->misses++;
+        q->rcache_key  = lstr_dup(key);
+        q->rcache_gzip = gzip;
+        return false;
+    }
+
+    rc->hits++;
+    httpd_rcache_reply(q, rc->entries.values[pos], gzip);
+    return true;
+}
+
+void httpd_reply_cached(httpd_query_t *q, lstr_t ctype, lstr_t body)
+{
+    httpd_rcache_t *rc = q->trig_cb ? q->trig_cb->rcache : NULL;
+    httpd_rcache_entry_t *e;
+
+    if (!rc || !q->rcache_key.s) {
+        outbuf_t *ob = httpd_reply_hdrs_start(q, HTTP_CODE_OK, false);
+
+        ob_addf(ob, "Content-Type: %*pM\r\n", LSTR_FMT_ARG(ctype));
+        httpd_reply_hdrs_done(q, body.len, false);
+        ob_add(ob, body.s, body.len);
+        httpd_reply_done(q);
+        return;
+    }
+
+    e = httpd_rcache_entry_new(ctype, body);
+    lstr_transfer(&e->key, &q->rcache_key);
+    httpd_rcache_store(rc, e);
+    httpd_rcache_reply(q, e, q->rcache_gzip);
+    httpd_rcache_entry_release(e);
+}
+
 static void httpc_set_sni(SSL *ssl, const lstr_t tls_server_name)
 {
     t_scope;
@@ -1229,18 +1536,20 @@ static void httpd_do_trace(httpd_t *w, httpd_query_t *q, httpd_qinfo_t *req);
 static int httpd_parse_idle(httpd_t *w, pstream_t *ps)
 {
     t_scope;
-    size_t start = w->chunk_length > 4 ? w->chunk_length - 4 : 0;
     httpd_qinfo_t req;
     const uint8_t *p;
     pstream_t buf;
     int clen = -1;
+    int end;
     bool chunked = false;
     httpd_query_t *q;
     qv_t(qhdr) hdrs;
     httpd_trigger_t *cb = NULL;
     struct timeval now;
 
-    if ((p = memmem(ps->s + start, ps_len(ps) - start, "\r\n\r\n", 4)) == NULL) {
+    end = http_scan_hdrs_end(ps->b, w->chunk_length, ps_len(ps),
+                             &w->hdrs_lines);
+    if (end < 0) {
         if (ps_len(ps) > w->cfg->header_size_max) {
             q = httpd_query_create(w, NULL);
             httpd_reject(q, FORBIDDEN, "Headers exceed %d octets",
@@ -1250,6 +1559,7 @@ static int httpd_parse_idle(httpd_t *w, pstream_t *ps)
         w->chunk_length = ps_len(ps);
         return PARSE_MISSING_DATA;
     }
+    p = ps->b + end;
 
     if (--w->max_queries == 0) {
         w->connection_close = true;
@@ -1296,7 +1606,10 @@ static int httpd_parse_idle(httpd_t *w, pstream_t *ps)
     lp_gettv(&now);
     q->query_sec  = now.tv_sec;
     q->query_usec = now.tv_usec;
-    t_qv_init(&hdrs, 64);
+    /* Besides the headers, there are the request line and the empty line
+     * that ends the headers. */
+    t_qv_init(&hdrs, MAX(w->hdrs_lines - 2, 1));
+    w->hdrs_lines = 0;
 
     while (!ps_done(&buf)) {
         http_qhdr_t *qhdr = qv_growlen(&hdrs, 1);
@@ -2037,6 +2350,11 @@ static void httpd_do_any(httpd_t *w, httpd_query_t *q, httpd_qinfo_t *req)
             (*cb->auth)(cb, q, user, pw);
         }
         if (likely(!q->answered)) {
+            if (cb->rcache && req->method == HTTP_METHOD_GET
+            &&  httpd_rcache_lookup(cb->rcache, q, req))
+            {
+                return;
+            }
             (*cb->cb)(cb, q, req);
         }
     } else {
@@ -2248,6 +2566,107 @@ el_t httpd_listen(sockunion_t *su, httpd_cfg_t *cfg)
                           httpd_cfg_retain(cfg));
 }
 
+static int httpd_listen_fd(const sockunion_t *su, bool reuse_port)
+{
+    int proto = su->family == AF_UNIX ? 0 : IPPROTO_TCP;
+    int fd = RETHROW(socket(su->family, SOCK_STREAM, proto));
+    int v = 1;
+
+    if ((reuse_port
+         && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &v, sizeof(v)) < 0)
+    ||  bindx(fd, su, 1, SOCK_STREAM, proto, O_NONBLOCK) < 0
+    ||  listenx(fd, su, 1, SOCK_STREAM, proto, O_NONBLOCK) < 0)
+    {
+        PROTECT_ERRNO(p_close(&fd));
+        return -1;
+    }
+    return fd;
+}
+
+static void httpd_worker_pin_cpu(int worker)
+{
+    long nb_cpus = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(worker % nb_cpus, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        logger_warning(&_G.logger, "cannot bind worker %d to CPU %ld: %m",
+                       worker + 1, worker % nb_cpus);
+    }
+}
+
+int httpd_fork_workers(sockunion_t *su, httpd_cfg_t *cfg, int nb_workers,
+                       bool pin_cpus, qv_t(i32) *pids, el_t *ev)
+{
+    int *fds = p_alloca(int, nb_workers);
+    int nb_fds = 0;
+    /* Binding a unix socket unlinks its path first: binding one socket
+     * per worker would leave only the last one reachable. */
+    bool shared = su->family == AF_UNIX;
+    int res = 0;
+
+    assert (nb_workers > 0);
+    *ev = NULL;
+
+    fds[0] = httpd_listen_fd(su, !shared);
+    if (fds[0] < 0 && !shared && errno == ENOPROTOOPT) {
+        logger_notice(&_G.logger, "SO_REUSEPORT is not supported, the "
+                      "workers share their listening socket");
+        fds[0] = httpd_listen_fd(su, false);
+        shared = true;
+    }
+    if (fds[0] < 0) {
+        return -1;
+    }
+    nb_fds = 1;
+    if (su->family != AF_UNIX && sockunion_getport(su) == 0) {
+        sockunion_setport(su, getsockport(fds[0], su->family));
+    }
+    for (; !shared && nb_fds < nb_workers; nb_fds++) {
+        fds[nb_fds] = httpd_listen_fd(su, true);
+        if (fds[nb_fds] < 0) {
+            res = -1;
+            goto end;
+        }
+    }
+
+    for (int i = 0; i < nb_workers; i++) {
+        pid_t pid = ifork();
+
+        if (pid < 0) {
+            res = -1;
+            break;
+        }
+        if (pid == 0) {
+            int fd = fds[shared ? 0 : i];
+
+            for (int j = 0; j < nb_fds; j++) {
+                if (fds[j] != fd) {
+                    close(fds[j]);
+                }
+            }
+            if (pin_cpus) {
+                httpd_worker_pin_cpu(i);
+            }
+            *ev = el_fd_register(fd, true, POLLIN, httpd_on_accept,
+                                 httpd_cfg_retain(cfg));
+            if (shared && el_fd_set_exclusive(*ev) < 0) {
+                logger_warning(&_G.logger, "worker %d: exclusive wake-ups "
+                               "are not supported: %m", i + 1);
+            }
+            return i + 1;
+        }
+        qv_append(pids, pid);
+    }
+
+  end:
+    for (int j = 0; j < nb_fds; j++) {
+        close(fds[j]);
+    }
+    return res;
+}
+
 static void http2_close_servers(httpd_cfg_t *cfg);
 
 void httpd_unlisten(el_t *ev)
@@ -2405,14 +2824,13 @@ static inline void httpc_qinfo_delete(httpc_qinfo_t **infop)
 static int httpc_parse_idle(httpc_t *w, pstream_t *ps)
 {
     t_scope;
-    size_t start = w->chunk_length > 4 ? w->chunk_length - 4 : 0;
     httpc_qinfo_t req;
     const uint8_t *p;
     pstream_t buf;
     qv_t(qhdr) hdrs;
     httpc_query_t *q;
     bool chunked = false, conn_close = false;
-    int clen = -1, res;
+    int clen = -1, res, end;
 
     if (ps_len(ps) > 0 && dlist_is_empty(&w->query_list)) {
         logger_trace(&_G.logger, 0, "UHOH spurious data from the HTTP "
@@ -2420,13 +2838,16 @@ static int httpc_parse_idle(httpc_t *w, pstream_t *ps)
         return PARSE_ERROR;
     }
 
-    if ((p = memmem(ps->s + start, ps_len(ps) - start, "\r\n\r\n", 4)) == NULL) {
+    end = http_scan_hdrs_end(ps->b, w->chunk_length, ps_len(ps),
+                             &w->hdrs_lines);
+    if (end < 0) {
         if (ps_len(ps) > w->cfg->header_size_max) {
             return PARSE_ERROR;
         }
         w->chunk_length = ps_len(ps);
         return PARSE_MISSING_DATA;
     }
+    p = ps->b + end;
 
     http_zlib_reset(w);
     req.hdrs_ps = ps_initptr(ps->s, p + 4);
@@ -2437,7 +2858,8 @@ static int httpc_parse_idle(httpc_t *w, pstream_t *ps)
 
     buf = __ps_get_ps_upto(ps, p + 2);
     __ps_skip_upto(ps, p + 4);
-    t_qv_init(&hdrs, 64);
+    t_qv_init(&hdrs, MAX(w->hdrs_lines - 2, 1));
+    w->hdrs_lines = 0;
 
     while (!ps_done(&buf)) {
         http_qhdr_t *qhdr = qv_growlen(&hdrs, 1);
@@ -2532,6 +2954,7 @@ static int httpc_parse_idle(httpc_t *w, pstream_t *ps)
 
     if (req.code >= 100 && req.code < 200) {
         w->state = HTTP_PARSER_IDLE;
+        w->chunk_length = 0;
 
         /* rfc 2616: §10.1: A client MUST be prepared to accept one or more
          * 1xx status responses prior to a regular response.
@@ -7621,6 +8044,7 @@ static void http2c_ctx_open_stream(http2c_ctx_t *ctx, httpc_query_t *q)
     ctx->httpc_status = HTTPC_STATUS_INVALID;
     httpc->state = HTTP_PARSER_IDLE;
     httpc->chunk_length = 0;
+    httpc->hdrs_lines = 0;
     sb_reset(&httpc->ibuf);
 
     chunk = ps_initsb(&httpc->ob.sb);
@@ -7911,6 +8335,7 @@ static int http_initialize(void *arg)
 static int http_shutdown(void)
 {
     p_delete(&_G.ssl_keylog_file_path);
+    httpd_file_cache_wipe();
 
     return 0;
 }
@@ -8392,6 +8817,7 @@ Z_GROUP_EXPORT(httpc_http2) {
 enum zhttpd_flags {
     ZHTTPD_QUERY_DONT_QUIT = (1 << 0),
     ZHTTPD_NO_ANSWER       = (1 << 1),
+    ZHTTPD_CACHED          = (1 << 2),
 };
 
 static struct {
@@ -8401,9 +8827,15 @@ static struct {
     sb_t read_buf;
     httpd_query_t *pending_query;
     httpd_cfg_t *cfg;
+    httpd_trigger_t *trigger;
     int flags;
     bool got_io_error;
     bool cleanup_needed;
+
+    /* Parameters of the ZHTTPD_CACHED mode. */
+    lstr_t cached_body;
+    int rcache_ttl;
+    size_t rcache_memory_max;
 } zhttpd_g;
 
 static void zhttpd_query_quit(void)
@@ -8436,6 +8868,10 @@ static void zhttpd_query_on_done(httpd_query_t *q)
         zhttpd_g.pending_query = obj_retain(q);
         return;
     }
+    if (zhttpd_g.flags & ZHTTPD_CACHED) {
+        httpd_reply_cached(q, LSTR("text/plain"), zhttpd_g.cached_body);
+        return;
+    }
 
     ob = httpd_reply_hdrs_start(q, HTTP_CODE_OK, false);
     ob_adds(ob, "Content-Type: text/plain\r\n");
@@ -8530,7 +8966,12 @@ static int zhttpd_setup(const lstr_t *query, int flags)
 
     trigger = httpd_trigger_new();
     trigger->cb = &zhttpd_query_hook;
+    if (flags & ZHTTPD_CACHED) {
+        trigger->rcache = httpd_rcache_new(zhttpd_g.rcache_ttl,
+                                           zhttpd_g.rcache_memory_max);
+    }
     httpd_trigger_register(zhttpd_g.cfg, GET, "zchk", trigger);
+    zhttpd_g.trigger = trigger;
 
     zhttpd_g.httpd_el = httpd_listen(&su, zhttpd_g.cfg);
     Z_ASSERT_P(zhttpd_g.httpd_el);
@@ -8566,7 +9007,197 @@ static int zhttpd_setup(const lstr_t *query, int flags)
     Z_HELPER_END;
 }
 
+/* Query a worker forked by httpd_fork_workers() on a new connection each
+ * time. */
+static int zhttpd_workers_query(const sockunion_t *su, int nb_queries)
+{
+    t_scope;
+    int proto = su->family == AF_UNIX ? 0 : IPPROTO_TCP;
+    lstr_t query = LSTR(
+        "GET /zchk HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Connection: close\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n");
+    t_SB_1k(buf);
+
+    for (int i = 0; i < nb_queries; i++) {
+        int fd = connectx(-1, su, 1, SOCK_STREAM, proto, 0);
+        int res;
+
+        Z_ASSERT_N(fd, "cannot connect: %m");
+        sb_reset(&buf);
+        res = xwrite(fd, query.s, query.len);
+        while (res >= 0 && (res = sb_read(&buf, fd, 0)) > 0) {
+            continue;
+        }
+        p_close(&fd);
+        Z_ASSERT_N(res);
+        Z_ASSERT(lstr_startswith(LSTR_SB_V(&buf), LSTR("HTTP/1.1 200 OK")));
+        Z_ASSERT(lstr_endswith(LSTR_SB_V(&buf), LSTR("\r\n\r\nZHTTPD OK")));
+    }
+
+    Z_HELPER_END;
+}
+
+static int zhttpd_check_workers(sockunion_t *su, int nb_workers)
+{
+    httpd_cfg_t *cfg;
+    httpd_trigger_t *trigger;
+    qv_t(i32) pids;
+    el_t ev;
+    int nb_pids;
+    int res;
+
+    zhttpd_cleanup();
+    zhttpd_g.flags = 0;
+
+    cfg = httpd_cfg_new();
+    trigger = httpd_trigger_new();
+    trigger->cb = &zhttpd_query_hook;
+    httpd_trigger_register(cfg, GET, "zchk", trigger);
+
+    qv_init(&pids);
+    res = httpd_fork_workers(su, cfg, nb_workers, false, &pids, &ev);
+    if (res > 0) {
+        /* Serve until killed, or for a while if the test died. */
+        for (int i = 0; i < 60; i++) {
+            el_loop_timeout(1000);
+        }
+        _exit(0);
+    }
+    if (res == 0) {
+        res = zhttpd_workers_query(su, 4 * nb_workers);
+    }
+
+    tab_for_each_entry(pid, &pids) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    nb_pids = pids.len;
+    qv_wipe(&pids);
+    httpd_trigger_unregister(cfg, GET, "zchk");
+    httpd_cfg_delete(&cfg);
+
+    Z_ASSERT_N(res, "%m");
+    Z_ASSERT_NULL(ev);
+    Z_ASSERT_EQ(nb_pids, nb_workers);
+    Z_HELPER_END;
+}
+
+/* Reference of http_scan_hdrs_end(), scanning the whole buffer at once,
+ * byte per byte. */
+static int z_scan_hdrs_end_ref(const byte *s, int len, int *lines)
+{
+    for (int i = 0; i < len; i++) {
+        if (s[i] == '\n') {
+            (*lines)++;
+            if (i >= 3 && !memcmp(s + i - 3, "\r\n\r\n", 4)) {
+                return i - 3;
+            }
+        }
+    }
+    return -1;
+}
+
+/* Scan buf as received in two reads split at every offset, and as received
+ * byte per byte, resuming the scan where it stopped like the parsers do. */
+static int z_check_scan_hdrs_end(lstr_t buf)
+{
+    const byte *s = (const byte *)buf.s;
+    int lines_ref = 0;
+    int end_ref = z_scan_hdrs_end_ref(s, buf.len, &lines_ref);
+    int lines = 0;
+    int end = -1;
+
+    for (int cut = 0; cut <= buf.len; cut++) {
+        lines = 0;
+        end = http_scan_hdrs_end(s, 0, cut, &lines);
+        if (end < 0) {
+            end = http_scan_hdrs_end(s, cut, buf.len, &lines);
+        }
+        Z_ASSERT_EQ(end, end_ref, "split at %d", cut);
+        Z_ASSERT_EQ(lines, lines_ref, "split at %d", cut);
+    }
+
+    lines = 0;
+    end = -1;
+    for (int len = 1; end < 0 && len <= buf.len; len++) {
+        end = http_scan_hdrs_end(s, len - 1, len, &lines);
+    }
+    Z_ASSERT_EQ(end, end_ref);
+    Z_ASSERT_EQ(lines, lines_ref);
+
+    Z_HELPER_END;
+}
+
+static void zhttpd_set_rcache(lstr_t body, int ttl, size_t memory_max)
+{
+    zhttpd_g.cached_body       = body;
+    zhttpd_g.rcache_ttl        = ttl;
+    zhttpd_g.rcache_memory_max = memory_max;
+}
+
+/* Consume the next reply of ps, and check that it carries body, gzipped
+ * or not. */
+static int zhttpd_check_cached_reply(pstream_t *ps, lstr_t body, bool gzip)
+{
+    t_scope;
+    pstream_t hdrs;
+    pstream_t data;
+    pstream_t tmp;
+    int clen;
+
+    Z_ASSERT_N(ps_skip_after_str(ps, "HTTP/1.1 200 OK\r\n"));
+    Z_ASSERT_N(ps_get_ps_upto_str_and_skip(ps, "\r\n\r\n", &hdrs));
+
+    tmp = hdrs;
+    Z_ASSERT_N(ps_skip_after_str(&tmp, "Content-Length: "));
+    clen = ps_geti(&tmp);
+    Z_ASSERT_N(clen);
+    Z_ASSERT_N(ps_get_ps(ps, clen, &data));
+
+    tmp = hdrs;
+    if (gzip) {
+        t_SB(sb, body.len);
+
+        Z_ASSERT_N(ps_skip_after_str(&tmp, "Content-Encoding: gzip\r\n"));
+        tmp = hdrs;
+        Z_ASSERT_N(ps_skip_after_str(&tmp, "Vary: Accept-Encoding\r\n"));
+        Z_ASSERT_LT(clen, body.len);
+        Z_ASSERT_N(sb_add_uncompressed(&sb, data.s, ps_len(&data)));
+        Z_ASSERT_LSTREQUAL(LSTR_SB_V(&sb), body);
+    } else {
+        Z_ASSERT_NEG(ps_skip_after_str(&tmp, "Content-Encoding:"));
+        Z_ASSERT_LSTREQUAL(LSTR_PS_V(&data), body);
+    }
+
+    Z_HELPER_END;
+}
+
 Z_GROUP_EXPORT(httpd) {
+    Z_TEST(scan_hdrs_end, "test the scan of the end of the headers")
+    {
+        t_scope;
+        const char pad[] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+
+        /* Move the "\r\n\r\n" across the 16 bytes blocks of the vectorized
+         * scan, after lines looking like it. */
+        for (int i = 0; i < countof(pad); i++) {
+            lstr_t buf = t_lstr_fmt("GET / HTTP/1.1\r\n"
+                                    "X-Pad: %*pM\r\n"
+                                    "X-Lf: a\nb\n\r\r\n"
+                                    "Host: 127.0.0.1\r\n"
+                                    "\r\n"
+                                    "body\r\n\r\n", i, pad);
+            lstr_t hdrs = LSTR_INIT_V(buf.s, buf.len - strlen("body\r\n\r\n"));
+            lstr_t partial = LSTR_INIT_V(hdrs.s, hdrs.len - 2);
+
+            Z_HELPER_RUN(z_check_scan_hdrs_end(buf), "pad %d", i);
+            Z_HELPER_RUN(z_check_scan_hdrs_end(hdrs), "pad %d", i);
+            Z_HELPER_RUN(z_check_scan_hdrs_end(partial), "pad %d", i);
+        }
+    } Z_TEST_END;
     Z_TEST(simple_query, "test a simple query")
     {
         lstr_t query = LSTR(
@@ -8658,6 +9289,282 @@ Z_GROUP_EXPORT(httpd) {
         zhttpd_cleanup();
     } Z_TEST_END;
 
+    Z_TEST(rcache, "test the responses cache of a trigger")
+    {
+        httpd_rcache_stats_t stats;
+        pstream_t ps;
+        lstr_t query = LSTR(
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+
+        zhttpd_set_rcache(LSTR("ZHTTPD OK"), 60, 1 << 20);
+        Z_HELPER_RUN(zhttpd_setup(&query, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+
+        /* The second query is answered from the cache. */
+        ps = ps_initsb(&zhttpd_g.read_buf);
+        for (int i = 0; i < 2; i++) {
+            Z_ASSERT_N(ps_skip_after_str(&ps, "HTTP/1.1 200 OK"));
+            Z_ASSERT_N(ps_skip_after_str(&ps, "\r\n\r\nZHTTPD OK"));
+        }
+        Z_ASSERT(ps_done(&ps));
+
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.hits, 1U);
+        Z_ASSERT_EQ(stats.misses, 1U);
+        Z_ASSERT_EQ(stats.entries, 1);
+        Z_ASSERT_GT(stats.memory, 0U);
+
+        httpd_rcache_invalidate(zhttpd_g.trigger->rcache, LSTR("/zch"));
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.entries, 1);
+        httpd_rcache_invalidate(zhttpd_g.trigger->rcache, LSTR("/zchk"));
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.entries, 0);
+        Z_ASSERT_EQ(stats.memory, 0U);
+
+        zhttpd_cleanup();
+    } Z_TEST_END;
+
+    Z_TEST(rcache_large, "test the responses cache with a large body")
+    {
+        t_scope;
+        httpd_rcache_stats_t stats;
+        pstream_t ps;
+        lstr_t query = LSTR(
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+        t_SB(body, 2 * OUTBUF_CHUNK_MIN_SIZE + 64);
+
+        /* Larger than OUTBUF_CHUNK_MIN_SIZE, so that the cached body is
+         * sent as a shared outbuf chunk instead of being copied. */
+        for (int i = 0; body.len < 2 * OUTBUF_CHUNK_MIN_SIZE; i++) {
+            sb_addf(&body, "line %d\n", i);
+        }
+        sb_adds(&body, "ZHTTPD OK");
+
+        zhttpd_set_rcache(LSTR_SB_V(&body), 60, 1 << 20);
+        Z_HELPER_RUN(zhttpd_setup(&query, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+
+        ps = ps_initsb(&zhttpd_g.read_buf);
+        for (int i = 0; i < 2; i++) {
+            Z_HELPER_RUN(zhttpd_check_cached_reply(&ps, LSTR_SB_V(&body),
+                                                   false));
+        }
+        Z_ASSERT(ps_done(&ps));
+
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.hits, 1U);
+        Z_ASSERT_EQ(stats.misses, 1U);
+        Z_ASSERT_EQ(stats.entries, 1);
+        Z_ASSERT_GT(stats.memory, (size_t)body.len);
+
+        zhttpd_cleanup();
+    } Z_TEST_END;
+
+    Z_TEST(rcache_gzip, "test the gzip variant of the responses cache")
+    {
+        t_scope;
+        httpd_rcache_stats_t stats;
+        pstream_t ps;
+        lstr_t query = LSTR(
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Accept-Encoding: gzip\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Accept-Encoding: gzip, deflate\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+        t_SB_1k(body);
+
+        while (body.len < 4 * HTTPD_RCACHE_GZIP_MIN) {
+            sb_adds(&body, "ZHTTPD OK\n");
+        }
+
+        zhttpd_set_rcache(LSTR_SB_V(&body), 60, 1 << 20);
+        Z_HELPER_RUN(zhttpd_setup(&query, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+
+        /* The same entry serves both the gzipped and the plain body. */
+        ps = ps_initsb(&zhttpd_g.read_buf);
+        Z_HELPER_RUN(zhttpd_check_cached_reply(&ps, LSTR_SB_V(&body), true));
+        Z_HELPER_RUN(zhttpd_check_cached_reply(&ps, LSTR_SB_V(&body), true));
+        Z_HELPER_RUN(zhttpd_check_cached_reply(&ps, LSTR_SB_V(&body),
+                                               false));
+        Z_ASSERT(ps_done(&ps));
+
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.hits, 2U);
+        Z_ASSERT_EQ(stats.misses, 1U);
+        Z_ASSERT_EQ(stats.entries, 1);
+
+        zhttpd_cleanup();
+    } Z_TEST_END;
+
+    Z_TEST(rcache_expiry, "test the expiry of the responses cache entries")
+    {
+        httpd_rcache_stats_t stats;
+        pstream_t ps;
+        lstr_t query = LSTR(
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk?a=1 HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+
+        /* With a null TTL, the entries are expired as soon as stored. */
+        zhttpd_set_rcache(LSTR("ZHTTPD OK"), 0, 1 << 20);
+        Z_HELPER_RUN(zhttpd_setup(&query, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+
+        ps = ps_initsb(&zhttpd_g.read_buf);
+        for (int i = 0; i < 2; i++) {
+            Z_HELPER_RUN(zhttpd_check_cached_reply(&ps, LSTR("ZHTTPD OK"),
+                                                   false));
+        }
+        Z_ASSERT(ps_done(&ps));
+
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.hits, 0U);
+        Z_ASSERT_EQ(stats.misses, 2U);
+        Z_ASSERT_EQ(stats.entries, 1);
+
+        zhttpd_cleanup();
+    } Z_TEST_END;
+
+    Z_TEST(rcache_memory_max, "test the memory bound of the responses cache")
+    {
+        httpd_rcache_stats_t stats;
+        pstream_t ps;
+        size_t entry_size;
+        lstr_t query_a = LSTR(
+            "GET /zchk/a HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+        lstr_t query_aba = LSTR(
+            "GET /zchk/a HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk/b HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk/a HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+        lstr_t query_ab = LSTR(
+            "GET /zchk/a HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "GET /zchk/b HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+
+        /* Both entries have the same size, get it. */
+        zhttpd_set_rcache(LSTR("ZHTTPD OK"), 60, 1 << 20);
+        Z_HELPER_RUN(zhttpd_setup(&query_a, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.entries, 1);
+        entry_size = stats.memory;
+        Z_ASSERT_GT(entry_size, 0U);
+
+        /* Only one entry fits: the live entry is kept, and the response
+         * of /zchk/b is not cached. */
+        zhttpd_set_rcache(LSTR("ZHTTPD OK"), 60, entry_size + entry_size / 2);
+        Z_HELPER_RUN(zhttpd_setup(&query_aba, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+
+        ps = ps_initsb(&zhttpd_g.read_buf);
+        for (int i = 0; i < 3; i++) {
+            Z_HELPER_RUN(zhttpd_check_cached_reply(&ps, LSTR("ZHTTPD OK"),
+                                                   false));
+        }
+        Z_ASSERT(ps_done(&ps));
+
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.hits, 1U);
+        Z_ASSERT_EQ(stats.misses, 2U);
+        Z_ASSERT_EQ(stats.entries, 1);
+        Z_ASSERT_EQ(stats.memory, entry_size);
+        httpd_rcache_invalidate(zhttpd_g.trigger->rcache, LSTR("/zchk/b"));
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.entries, 1);
+
+        /* Expired entries are evicted to make room for the new ones. */
+        zhttpd_set_rcache(LSTR("ZHTTPD OK"), 0, entry_size + entry_size / 2);
+        Z_HELPER_RUN(zhttpd_setup(&query_ab, ZHTTPD_QUERY_DONT_QUIT |
+                                  ZHTTPD_CACHED));
+
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.misses, 2U);
+        Z_ASSERT_EQ(stats.entries, 1);
+        Z_ASSERT_EQ(stats.memory, entry_size);
+        httpd_rcache_invalidate(zhttpd_g.trigger->rcache, LSTR("/zchk/a"));
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.entries, 1);
+        httpd_rcache_invalidate(zhttpd_g.trigger->rcache, LSTR("/zchk/b"));
+        httpd_rcache_get_stats(zhttpd_g.trigger->rcache, &stats);
+        Z_ASSERT_EQ(stats.entries, 0);
+
+        zhttpd_cleanup();
+    } Z_TEST_END;
+
+    Z_TEST(fork_workers, "test httpd_fork_workers")
+    {
+        sockunion_t su;
+
+        Z_ASSERT_N(addr_resolve("test", LSTR("127.0.0.1:1"), &su));
+        sockunion_setport(&su, 0);
+        Z_HELPER_RUN(zhttpd_check_workers(&su, 3));
+        Z_ASSERT_NE(sockunion_getport(&su), 0);
+    } Z_TEST_END;
+
+    Z_TEST(fork_workers_unix, "test httpd_fork_workers on a unix socket")
+    {
+        sockunion_t su = { .family = AF_UNIX };
+
+        /* The workers share the socket, bound once. */
+        snprintf(su.sunix.sun_path, sizeof(su.sunix.sun_path),
+                 "%*pM/httpd.sock", LSTR_FMT_ARG(z_tmpdir_g));
+        Z_HELPER_RUN(zhttpd_check_workers(&su, 3));
+    } Z_TEST_END;
+
     zhttpd_cleanup();
 } Z_GROUP_END;
 
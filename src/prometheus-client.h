@@ -53,6 +53,12 @@ union qm_prom_metric_t;
     qv_t(cstr) label_values;                                                 \
     pfx##_t * nullable parent;                                               \
                                                                              \
+    /** Label pairs formatted for the text exposition.                       \
+     *                                                                       \
+     * Built on the first scrape of the child, as they never change.         \
+     */                                                                      \
+    lstr_t exposition_labels;                                                \
+                                                                             \
     /** Spinlock used for threaded access.                                   \
      *                                                                       \
      * It is used for both parent and children metrics, when thread-safe     \
@@ -66,8 +72,14 @@ union qm_prom_metric_t;
      *    which is the case in most of our code (but atomic doubles are      \
      *    slightly better in case of high concurrency). The bench tool       \
      *    bench/threaded-operations-bench demonstrates that.                 \
+     *                                                                       \
+     * When the lock of an observable metric is found contended by an        \
+     * update, per-thread shards are allocated, and the following updates    \
+     * are done in the shard of the thread, under its own lock. The shards   \
+     * are added to the value fields of the metric when it is collected.     \
      */                                                                      \
     spinlock_t lock;                                                         \
+    struct prom_metric_shard_t * nullable shards;                            \
                                                                              \
     /* Common fields */                                                      \
     dlist_t siblings_list;                                                   \
@@ -135,6 +147,15 @@ union qm_prom_metric_t;
      * This operation is NOT thread-safe.                                    \
      */                                                                      \
     void (*clear)(type_t *self);                                             \
+                                                                             \
+    /** Add the updates kept in the per-thread shards to the value fields.   \
+     *                                                                       \
+     * The value fields of a metric updated concurrently can only be read    \
+     * directly after that; this is done when the metrics are scraped.       \
+     *                                                                       \
+     * This operation is thread-safe.                                        \
+     */                                                                      \
+    void (*collect)(type_t *self);                                           \
 
 /** Base class for all prometheus metric. */
 OBJ_CLASS(prom_metric, object, PROM_METRIC_FIELDS, PROM_METRIC_METHODS);
@@ -176,7 +197,9 @@ prom_metric_t *prom_metric_new(const object_class_t *cls,
     /** Metric value.                                                        \
      *                                                                       \
      * You can safely directy modify it in non multi-threaded environments.  \
-     * If you need thread safety, use the provided helpers.                  \
+     * If you need thread safety, use the provided helpers: the concurrent   \
+     * updates are only reflected in this field after a call to collect()    \
+     * or get_value().                                                       \
      */                                                                      \
     double value;                                                            \
 
@@ -367,7 +390,8 @@ OBJ_CLASS(prom_gauge, prom_simple_value_metric,
      *                                                                       \
      * These fields MUST NOT be modified manually; always use the provided   \
      * observe() method.                                                     \
-     * They are only set in observable metrics.                              \
+     * They are only set in observable metrics, and the concurrent           \
+     * observations are only reflected after a call to collect().            \
      */                                                                      \
     double count;                                                            \
     double sum;                                                              \
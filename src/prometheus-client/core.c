@@ -21,6 +21,8 @@
 logger_t prom_logger_g = LOGGER_INIT_INHERITS(NULL, "prometheus");
 
 dlist_t prom_collector_g;
+pthread_mutex_t prom_collector_lock_g = PTHREAD_MUTEX_INITIALIZER;
+prom_histogram_t *prom_scrape_duration_g;
 
 
 static int prometheus_client_initialize(void *arg)
@@ -31,6 +33,12 @@ static int prometheus_client_initialize(void *arg)
 
 static int prometheus_client_shutdown(void)
 {
+    /* The self-metric is deleted with the others: forget it first, so that
+     * a scrape still running does not observe it. */
+    pthread_mutex_lock(&prom_collector_lock_g);
+    prom_scrape_duration_g = NULL;
+    pthread_mutex_unlock(&prom_collector_lock_g);
+
     dlist_for_each_entry(prom_metric_t, metric, &prom_collector_g,
                          siblings_list)
     {
@@ -17,6 +17,8 @@
 /***************************************************************************/
 
 #include <lib-common/http.h>
+#include <lib-common/thr.h>
+#include <lib-common/zlib-wrapper.h>
 
 #include "priv.h"
 
@@ -28,6 +30,12 @@ static struct {
 
     el_t httpd;
     httpd_cfg_t *httpd_cfg;
+
+    /* Serial queue compressing the replies, out of the rendering thread */
+    thr_queue_t *deflate_queue;
+
+    /* Jobs of the running scrapes: rendering, compression and sending */
+    thr_syn_t scrapes;
 } prom_http_g = {
 #define _G  prom_http_g
     .logger = LOGGER_INIT_INHERITS(&prom_logger_g, "http"),
@@ -35,21 +43,172 @@ static struct {
 
 /* {{{ "metrics/" query */
 
+/* The exposition is rendered on a worker thread, and sent in chunks of
+ * about this size (before compression) as it is rendered. */
+#define METRICS_CHUNK_SIZE  (64 << 10)
+
+typedef struct metrics_scrape_t {
+    thr_job_t job;
+    httpd_query_t *q;
+    prom_histogram_timer_ctx_t timer;
+
+    /* Compression of the reply, when accepted by the scraper */
+    bool gzip;
+    z_stream zs;
+    sb_t zbuf;
+} metrics_scrape_t;
+
+typedef struct metrics_chunk_t {
+    thr_job_t job;
+    httpd_query_t *q;
+    metrics_scrape_t *scrape;
+    char *data;
+    int len;
+    bool last;
+} metrics_chunk_t;
+
+/* Runs on the main thread. */
+static void metrics_chunk_send(thr_job_t *job, thr_syn_t *syn)
+{
+    metrics_chunk_t *chunk = container_of(job, metrics_chunk_t, job);
+    httpd_query_t *q = chunk->q;
+
+    if (chunk->len) {
+        outbuf_t *ob = httpd_get_ob(q);
+
+        httpd_reply_chunk_start(q, ob);
+        ob_add_memchunk(ob, chunk->data, chunk->len, false);
+        httpd_reply_chunk_done(q, ob);
+    } else {
+        p_delete(&chunk->data);
+    }
+
+    if (chunk->last) {
+        httpd_reply_done(q);
+        obj_release(&q);
+    }
+    p_delete(&chunk);
+}
+
+static void metrics_scrape_send(metrics_scrape_t *scrape, sb_t *buf,
+                                bool last)
+{
+    metrics_chunk_t *chunk;
+
+    if (!buf->len && !last) {
+        return;
+    }
+
+    chunk = p_new(metrics_chunk_t, 1);
+    chunk->job.run = &metrics_chunk_send;
+    chunk->q = scrape->q;
+    chunk->data = sb_detach(buf, &chunk->len);
+    chunk->last = last;
+    thr_syn_queue(&_G.scrapes, thr_queue_main_g, &chunk->job);
+}
+
+/* Runs on the deflate queue. The last chunk releases the scrape. */
+static void metrics_chunk_deflate(thr_job_t *job, thr_syn_t *syn)
+{
+    metrics_chunk_t *chunk = container_of(job, metrics_chunk_t, job);
+    metrics_scrape_t *scrape = chunk->scrape;
+
+    /* deflate() cannot fail on a valid stream */
+    IGNORE(sb_add_deflate(&scrape->zbuf, &scrape->zs, chunk->data,
+                          chunk->len, chunk->last ? Z_FINISH : Z_NO_FLUSH));
+    metrics_scrape_send(scrape, &scrape->zbuf, chunk->last);
+
+    if (chunk->last) {
+        IGNORE(deflateEnd(&scrape->zs));
+        sb_wipe(&scrape->zbuf);
+        p_delete(&scrape);
+    }
+    p_delete(&chunk->data);
+    p_delete(&chunk);
+}
+
+static void metrics_scrape_deflate(metrics_scrape_t *scrape, sb_t *buf,
+                                   bool last)
+{
+    metrics_chunk_t *chunk = p_new(metrics_chunk_t, 1);
+
+    chunk->job.run = &metrics_chunk_deflate;
+    chunk->scrape = scrape;
+    chunk->data = sb_detach(buf, &chunk->len);
+    chunk->last = last;
+    thr_syn_queue(&_G.scrapes, _G.deflate_queue, &chunk->job);
+}
+
+/* Called on the rendering thread: the text is only moved out, it is
+ * compressed on the deflate queue. */
+static void metrics_scrape_on_chunk(sb_t *out, void *priv)
+{
+    metrics_scrape_t *scrape = priv;
+
+    if (scrape->gzip) {
+        metrics_scrape_deflate(scrape, out, false);
+    } else {
+        metrics_scrape_send(scrape, out, false);
+    }
+}
+
+/* Runs on a worker thread. */
+static void metrics_scrape_run(thr_job_t *job, thr_syn_t *syn)
+{
+    metrics_scrape_t *scrape = container_of(job, metrics_scrape_t, job);
+    sb_t out;
+
+    sb_init(&out);
+    prom_collector_bridge_chunked(&prom_collector_g, &out,
+                                  METRICS_CHUNK_SIZE,
+                                  &metrics_scrape_on_chunk, scrape);
+
+    /* Observe the duration of the rendering */
+    pthread_mutex_lock(&prom_collector_lock_g);
+    if (prom_scrape_duration_g) {
+        scrape->timer.histogram = prom_scrape_duration_g;
+        prom_histogram_timer_finish(&scrape->timer);
+    }
+    pthread_mutex_unlock(&prom_collector_lock_g);
+
+    if (scrape->gzip) {
+        /* The deflate queue releases the scrape after its last chunk. */
+        metrics_scrape_deflate(scrape, &out, true);
+    } else {
+        metrics_scrape_send(scrape, &out, true);
+        sb_wipe(&scrape->zbuf);
+        p_delete(&scrape);
+    }
+    sb_wipe(&out);
+}
+
 static void metrics_query_on_done(httpd_query_t *q)
 {
-    SB_8k(buf);
+    metrics_scrape_t *scrape = p_new(metrics_scrape_t, 1);
     outbuf_t *ob;
 
+    scrape->job.run = &metrics_scrape_run;
+    scrape->q = obj_retain(q);
+    scrape->timer = prom_histogram_timer_start(NULL);
+    sb_init(&scrape->zbuf);
+    if (httpd_qinfo_accept_enc_get(q->qinfo) & HTTPD_ACCEPT_ENC_GZIP) {
+        scrape->gzip = deflateInit2(&scrape->zs, Z_DEFAULT_COMPRESSION,
+                                    Z_DEFLATED, MAX_WBITS + 16,
+                                    MAX_MEM_LEVEL,
+                                    Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
     /* Send request headers */
     ob = httpd_reply_hdrs_start(q, HTTP_CODE_OK, true);
     ob_adds(ob, "Content-Type: text/plain; version=0.0.4\n");
-    httpd_reply_hdrs_done(q, -1, false);
-
-    /* Reply with metrics data */
-    prom_collector_bridge(&prom_collector_g, &buf);
-    ob_addsb(ob, &buf);
+    if (scrape->gzip) {
+        ob_adds(ob, "Content-Encoding: gzip\n");
+        ob_adds(ob, "Vary: Accept-Encoding\n");
+    }
+    httpd_reply_hdrs_done(q, -1, true);
 
-    httpd_reply_done(q);
+    /* Reply with metrics data, rendered on a worker thread */
+    thr_syn_schedule(&_G.scrapes, &scrape->job);
 }
 
 static void metrics_query_hook(httpd_trigger_t *tcb, struct httpd_query_t *q,
@@ -70,6 +229,7 @@ int prom_http_start_server(const core__httpd_cfg__t *cfg,
     sockunion_t su;
     lstr_t addr = cfg->bind_addr;
     httpd_trigger_t *trigger;
+    prom_histogram_t *scrape_duration;
 
     if (_G.httpd) {
         if (err) {
@@ -82,6 +242,20 @@ int prom_http_start_server(const core__httpd_cfg__t *cfg,
     RETHROW(addr_resolve2("prometheus HTTP server", addr, 0, 0, &su,
                           &host, &_G.listen_port, err));
 
+    /* Register the self-metric on the duration of the scrapes. It is
+     * observed by the worker threads rendering the scrapes, under
+     * prom_collector_lock_g. */
+    if (!prom_scrape_duration_g) {
+        scrape_duration = prom_histogram_new(
+            "prometheus_client_scrape_duration_seconds",
+            "Duration of the rendering of the metrics for a scrape");
+        prom_histogram_set_exponential_buckets(scrape_duration, 0.001, 2,
+                                               12);
+        pthread_mutex_lock(&prom_collector_lock_g);
+        prom_scrape_duration_g = scrape_duration;
+        pthread_mutex_unlock(&prom_collector_lock_g);
+    }
+
     /* Start HTTP server */
     _G.httpd_cfg = httpd_cfg_new();
     httpd_cfg_from_iop(_G.httpd_cfg, cfg);
@@ -129,6 +303,8 @@ void prom_http_get_infos(lstr_t * nullable host, in_port_t * nullable port,
 
 static int prometheus_client_http_initialize(void *arg)
 {
+    _G.deflate_queue = thr_queue_create();
+    thr_syn_init(&_G.scrapes);
     return 0;
 }
 
@@ -139,14 +315,22 @@ static void prometheus_client_http_on_term(int signo)
 
 static int prometheus_client_http_shutdown(void)
 {
+    /* Wait for the running scrapes; their chunks are sent by the main
+     * queue, which is drained while waiting. */
+    thr_syn_wait(&_G.scrapes);
+
     lstr_wipe(&_G.listen_host);
     httpd_unlisten(&_G.httpd);
     httpd_cfg_delete(&_G.httpd_cfg);
+    thr_queue_destroy(_G.deflate_queue, true);
+    _G.deflate_queue = NULL;
+    thr_syn_wipe(&_G.scrapes);
     return 0;
 }
 
 MODULE_BEGIN(prometheus_client_http)
     MODULE_DEPENDS_ON(http);
+    MODULE_DEPENDS_ON(thr);
     MODULE_IMPLEMENTS_INT(on_term, &prometheus_client_http_on_term);
 MODULE_END()
 
@@ -61,6 +61,122 @@ qv_lstr_equal(const qhash_t *qh,
 
 qm_kptr_ckey_t(prom_metric, qv_t(cstr), prom_metric_t *,
                qv_lstr_hash, qv_lstr_equal);
+qvector_t(prom_metric, prom_metric_t *);
+
+/* }}} */
+/* {{{ Per-thread shards */
+
+/* Number of shards of a contended metric; the threads are spread on the
+ * shards in a round-robin fashion. */
+#define PROM_METRIC_SHARDS  32
+
+typedef struct prom_metric_shard_t {
+    spinlock_t lock;
+    double value; /* value of a simple value metric, or histogram count */
+    double sum;
+    double *bucket_counts;
+} __attribute__((aligned(CACHE_LINE_SIZE))) prom_metric_shard_t;
+
+static __thread int prom_metric_shard_id_g = -1;
+static atomic_uint prom_metric_next_shard_id_g;
+
+/* Get the shard of the current thread, allocating the shards of the metric
+ * if needed. */
+static prom_metric_shard_t *
+prom_metric_get_shard(prom_metric_t *self, int nb_buckets)
+{
+    prom_metric_shard_t *shards;
+
+    if (unlikely(prom_metric_shard_id_g < 0)) {
+        prom_metric_shard_id_g = atomic_fetch_add(
+            &prom_metric_next_shard_id_g, 1) % PROM_METRIC_SHARDS;
+    }
+
+    shards = __atomic_load_n(&self->shards, __ATOMIC_ACQUIRE);
+    if (unlikely(!shards)) {
+        spin_lock(&self->lock);
+        shards = self->shards;
+        if (!shards) {
+            shards = p_new(prom_metric_shard_t, PROM_METRIC_SHARDS);
+            for (int i = 0; nb_buckets && i < PROM_METRIC_SHARDS; i++) {
+                shards[i].bucket_counts = p_new(double, nb_buckets);
+            }
+            __atomic_store_n(&self->shards, shards, __ATOMIC_RELEASE);
+        }
+        spin_unlock(&self->lock);
+    }
+
+    return &shards[prom_metric_shard_id_g];
+}
+
+/* Add the values of the shards to the given fields, and reset them. Must
+ * be called with the lock of the metric held. */
+static void prom_metric_collect_shards(prom_metric_t *self, double *value,
+                                       double *sum, double *bucket_counts,
+                                       int nb_buckets)
+{
+    if (!self->shards) {
+        return;
+    }
+
+    for (int i = 0; i < PROM_METRIC_SHARDS; i++) {
+        prom_metric_shard_t *shard = &self->shards[i];
+
+        spin_lock(&shard->lock);
+        *value += shard->value;
+        shard->value = 0;
+        if (sum) {
+            *sum += shard->sum;
+            shard->sum = 0;
+        }
+        for (int j = 0; j < nb_buckets; j++) {
+            bucket_counts[j] += shard->bucket_counts[j];
+            shard->bucket_counts[j] = 0;
+        }
+        spin_unlock(&shard->lock);
+    }
+}
+
+static void prom_metric_delete_shards(prom_metric_t *self)
+{
+    if (!self->shards) {
+        return;
+    }
+    for (int i = 0; i < PROM_METRIC_SHARDS; i++) {
+        p_delete(&self->shards[i].bucket_counts);
+    }
+    p_delete(&self->shards);
+}
+
+/* }}} */
+/* {{{ Children lookup cache */
+
+/* Per-thread cache of the children returned by the labels() method, so that
+ * the lookup of an existing child does not take the lock of its parent.
+ *
+ * The entries are invalidated by bumping the generation each time a metric
+ * is destroyed.
+ */
+#define PROM_LABELS_CACHE_SIZE  64
+
+typedef struct prom_labels_cache_entry_t {
+    const prom_metric_t *parent;
+    prom_metric_t *child;
+    uint32_t hash;
+    unsigned gen;
+} prom_labels_cache_entry_t;
+
+static __thread prom_labels_cache_entry_t
+    prom_labels_cache_g[PROM_LABELS_CACHE_SIZE];
+static atomic_uint prom_labels_cache_gen_g;
+
+static prom_labels_cache_entry_t *
+prom_labels_cache_entry(const prom_metric_t *parent, uint32_t hash)
+{
+    uint32_t pos = hash ^ ((uintptr_t)parent / sizeof(prom_metric_t));
+
+    return &prom_labels_cache_g[pos % PROM_LABELS_CACHE_SIZE];
+}
 
 /* }}} */
 /* {{{ base metric classes */
@@ -72,17 +188,43 @@ static prom_metric_t *prom_metric_init(prom_metric_t *self)
     return self;
 }
 
+/* The exposition is rendered on a worker thread, which takes references on
+ * the parent metrics with the lock of the collector held: their reference
+ * counter is only updated with that lock held. The reference counter of the
+ * children is only updated with the lock of their parent held. */
+static void prom_metric_release(prom_metric_t *self, bool *destroyed)
+{
+    if (self->parent) {
+        super_call(prom_metric, self, release, destroyed);
+        return;
+    }
+
+    pthread_mutex_lock(&prom_collector_lock_g);
+    super_call(prom_metric, self, release, destroyed);
+    pthread_mutex_unlock(&prom_collector_lock_g);
+}
+
 static void prom_metric_wipe(prom_metric_t *self)
 {
-    /* Remove self from parent's children. */
+    /* Invalidate the children lookup caches */
+    atomic_fetch_add(&prom_labels_cache_gen_g, 1);
+
+    /* Remove self from parent's children (called with the lock of the
+     * parent held), unless it was already removed and replaced by another
+     * child while it was being rendered. */
     if (self->parent) {
-        qm_del_key(prom_metric, self->parent->children_by_labels,
-                   &self->label_values);
+        qm_t(prom_metric) *children = self->parent->children_by_labels;
+        int pos = qm_find(prom_metric, children, &self->label_values);
+
+        if (pos >= 0 && children->values[pos] == self) {
+            qm_del_at(prom_metric, children, pos);
+        }
     }
 
     /* Wipe */
     lstr_wipe(&self->name);
     lstr_wipe(&self->documentation);
+    lstr_wipe(&self->exposition_labels);
 
 #define cstr_wipe(str)  p_delete((char **)str)
     qv_deep_wipe(&self->label_names, cstr_wipe);
@@ -94,6 +236,7 @@ static void prom_metric_wipe(prom_metric_t *self)
 
     qm_deep_delete(prom_metric, &self->children_by_labels, IGNORE,
                    obj_delete);
+    prom_metric_delete_shards(self);
 }
 
 int prom_metric_check_name(lstr_t name)
@@ -188,7 +331,9 @@ static void prom_metric_register(prom_metric_t *self)
     }
 
     /* Register */
+    pthread_mutex_lock(&prom_collector_lock_g);
     dlist_add_tail(&prom_collector_g, &self->siblings_list);
+    pthread_mutex_unlock(&prom_collector_lock_g);
     if (self->label_names.len) {
         self->children_by_labels = qm_new(prom_metric, 0);
     }
@@ -203,7 +348,9 @@ static void prom_metric_unregister(prom_metric_t *self)
     }
 
     /* Unregister */
+    pthread_mutex_lock(&prom_collector_lock_g);
     dlist_remove(&self->siblings_list);
+    pthread_mutex_unlock(&prom_collector_lock_g);
 }
 
 static void prom_metric_check_labels(prom_metric_t *self, const char *func,
@@ -224,9 +371,19 @@ static void prom_metric_check_labels(prom_metric_t *self, const char *func,
 static prom_metric_t *
 (prom_metric_labels)(prom_metric_t *self, const qv_t(cstr) *label_values)
 {
+    uint32_t hash = qv_lstr_hash(NULL, label_values);
+    prom_labels_cache_entry_t *entry = prom_labels_cache_entry(self, hash);
+    unsigned gen = atomic_load(&prom_labels_cache_gen_g);
     uint32_t pos;
     prom_metric_t *child;
 
+    /* Lookup in the cache of the thread */
+    if (entry->parent == self && entry->hash == hash && entry->gen == gen
+    &&  qv_lstr_equal(NULL, &entry->child->label_values, label_values))
+    {
+        return entry->child;
+    }
+
     /* Consistency checks */
     prom_metric_check_labels(self, "labels", label_values);
 
@@ -237,7 +394,7 @@ static prom_metric_t *
     if (pos & QHASH_COLLISION) {
         child = self->children_by_labels->values[pos ^ QHASH_COLLISION];
         spin_unlock(&self->lock);
-        return child;
+        goto end;
     }
 
     /* Create child */
@@ -255,6 +412,13 @@ static prom_metric_t *
 
     spin_unlock(&self->lock);
 
+  end:
+    *entry = (prom_labels_cache_entry_t){
+        .parent = self,
+        .child = child,
+        .hash = hash,
+        .gen = gen,
+    };
     return child;
 }
 
@@ -266,11 +430,15 @@ static void
     /* Consistency checks */
     prom_metric_check_labels(self, "labels", label_values);
 
-    /* Remove child */
+    /* Remove child. It is unlinked right away as a scrape may still hold
+     * a reference on it. */
+    spin_lock(&self->lock);
     pos = qm_del_key(prom_metric, self->children_by_labels, label_values);
     if (pos >= 0) {
+        dlist_remove(&self->children_by_labels->values[pos]->siblings_list);
         obj_delete(&self->children_by_labels->values[pos]);
     }
+    spin_unlock(&self->lock);
 }
 
 static void prom_metric_clear(prom_metric_t *self)
@@ -281,17 +449,30 @@ static void prom_metric_clear(prom_metric_t *self)
     }
 
     /* Clear */
+    spin_lock(&self->lock);
+    dlist_for_each_entry(prom_metric_t, child, &self->children_list,
+                         siblings_list)
+    {
+        dlist_remove(&child->siblings_list);
+    }
     qm_deep_clear(prom_metric, self->children_by_labels, IGNORE, obj_delete);
+    spin_unlock(&self->lock);
+}
+
+static void prom_metric_collect(prom_metric_t *self)
+{
 }
 
 OBJ_VTABLE(prom_metric)
     prom_metric.init        = prom_metric_init;
     prom_metric.wipe        = prom_metric_wipe;
+    prom_metric.release     = prom_metric_release;
     prom_metric.do_register = prom_metric_register;
     prom_metric.unregister  = prom_metric_unregister;
     prom_metric.labels      = prom_metric_labels;
     prom_metric.remove      = prom_metric_remove;
     prom_metric.clear       = prom_metric_clear;
+    prom_metric.collect     = prom_metric_collect;
 OBJ_VTABLE_END()
 
 
@@ -324,9 +505,30 @@ prom_metric_t *prom_metric_new(const object_class_t *cls,
 
 static void
 simple_value_metric_add(prom_simple_value_metric_t *self, double to_add)
+{
+    prom_metric_shard_t *shard;
+
+    /* Update the value directly until the lock is found contended. */
+    if (!__atomic_load_n(&self->shards, __ATOMIC_RELAXED)
+    &&  spin_trylock(&self->lock))
+    {
+        self->value += to_add;
+        spin_unlock(&self->lock);
+        return;
+    }
+
+    shard = prom_metric_get_shard(obj_vcast(prom_metric, self), 0);
+    spin_lock(&shard->lock);
+    shard->value += to_add;
+    spin_unlock(&shard->lock);
+}
+
+static void
+prom_simple_value_metric_collect(prom_simple_value_metric_t *self)
 {
     spin_lock(&self->lock);
-    self->value += to_add;
+    prom_metric_collect_shards(obj_vcast(prom_metric, self), &self->value,
+                               NULL, NULL, 0);
     spin_unlock(&self->lock);
 }
 
@@ -336,6 +538,8 @@ prom_simple_value_metric_get_value(prom_simple_value_metric_t *self)
     double res;
 
     spin_lock(&self->lock);
+    prom_metric_collect_shards(obj_vcast(prom_metric, self), &self->value,
+                               NULL, NULL, 0);
     res = self->value;
     spin_unlock(&self->lock);
 
@@ -343,6 +547,7 @@ prom_simple_value_metric_get_value(prom_simple_value_metric_t *self)
 }
 
 OBJ_VTABLE(prom_simple_value_metric)
+    prom_simple_value_metric.collect   = prom_simple_value_metric_collect;
     prom_simple_value_metric.get_value = prom_simple_value_metric_get_value;
 OBJ_VTABLE_END()
 
@@ -403,6 +608,9 @@ static void prom_gauge_set(prom_gauge_t *self, double value)
 {
     if (expect(is_metric_observable(&self->super.super))) {
         spin_lock(&self->lock);
+        /* Drop the pending updates of the shards. */
+        prom_metric_collect_shards(obj_vcast(prom_metric, self),
+                                   &self->value, NULL, NULL, 0);
         self->value = value;
         spin_unlock(&self->lock);
     }
@@ -551,14 +759,36 @@ static prom_histogram_t *
     child = obj_vcast(prom_histogram, child_metric);
 
     /* Create the buckets counts if the child was just created */
-    if (!child->bucket_counts) {
-        child->nb_buckets = self->nb_buckets;
-        child->bucket_counts = p_new(double, self->nb_buckets);
+    if (unlikely(!__atomic_load_n(&child->bucket_counts, __ATOMIC_ACQUIRE)))
+    {
+        spin_lock(&child->lock);
+        if (!child->bucket_counts) {
+            child->nb_buckets = self->nb_buckets;
+            __atomic_store_n(&child->bucket_counts,
+                             p_new(double, self->nb_buckets),
+                             __ATOMIC_RELEASE);
+        }
+        spin_unlock(&child->lock);
     }
 
     return child;
 }
 
+static void prom_histogram_add(const prom_histogram_t *parent,
+                               double *count, double *sum,
+                               double *bucket_counts, double value)
+{
+    (*count)++;
+    *sum += value;
+
+    for (int i = parent->nb_buckets; i-- > 0;) {
+        if (value > parent->bucket_upper_bounds[i]) {
+            break;
+        }
+        bucket_counts[i]++;
+    }
+}
+
 static void prom_histogram_observe(prom_histogram_t *self, double value)
 {
     prom_histogram_t *parent = self->parent ?: self;
@@ -572,18 +802,34 @@ static void prom_histogram_observe(prom_histogram_t *self, double value)
                           "histogram buckets were not initialized");
     }
 
-    spin_lock(&self->lock);
-
-    self->count++;
-    self->sum += value;
-
-    for (int i = self->nb_buckets; i-- > 0;) {
-        if (value > parent->bucket_upper_bounds[i]) {
-            break;
-        }
-        self->bucket_counts[i]++;
+    /* Update the fields directly until the lock is found contended. */
+    if (!__atomic_load_n(&self->shards, __ATOMIC_RELAXED)
+    &&  spin_trylock(&self->lock))
+    {
+        prom_histogram_add(parent, &self->count, &self->sum,
+                           self->bucket_counts, value);
+        spin_unlock(&self->lock);
+    } else {
+        prom_metric_shard_t *shard;
+
+        shard = prom_metric_get_shard(obj_vcast(prom_metric, self),
+                                      self->nb_buckets);
+        spin_lock(&shard->lock);
+        prom_histogram_add(parent, &shard->value, &shard->sum,
+                           shard->bucket_counts, value);
+        spin_unlock(&shard->lock);
     }
+}
 
+static void prom_histogram_collect(prom_histogram_t *self)
+{
+    if (!self->bucket_counts) {
+        return;
+    }
+    spin_lock(&self->lock);
+    prom_metric_collect_shards(obj_vcast(prom_metric, self), &self->count,
+                               &self->sum, self->bucket_counts,
+                               self->nb_buckets);
     spin_unlock(&self->lock);
 }
 
@@ -593,6 +839,7 @@ OBJ_VTABLE(prom_histogram)
     prom_histogram.set_buckets = prom_histogram_set_buckets;
     prom_histogram.labels      = prom_histogram_labels;
     prom_histogram.observe     = prom_histogram_observe;
+    prom_histogram.collect     = prom_histogram_collect;
 OBJ_VTABLE_END()
 
 
@@ -622,54 +869,101 @@ void prom_histogram_timer_finish(prom_histogram_timer_ctx_t *ctx)
 /* }}} */
 /* {{{ Bridge function for exposition in text format */
 
-static void bridge_simple_value(prom_simple_value_metric_t *metric, sb_t *out)
+typedef struct prom_bridge_t {
+    sb_t *out;
+    int chunk_size;
+    prom_bridge_chunk_f *on_chunk;
+    void *priv;
+
+    /* Last two characters of the text already passed to on_chunk */
+    char tail[2];
+} prom_bridge_t;
+
+/* Pass the rendered text to the chunk callback if it is large enough.
+ *
+ * It is only called right before rendering a sample, so the text remaining
+ * at the end is never empty if there was a sample.
+ */
+static void bridge_flush_chunk(prom_bridge_t *bridge)
 {
-    lstr_t name = metric->parent ? metric->parent->name : metric->name;
+    sb_t *out = bridge->out;
 
-    sb_add_lstr(out, name);
+    if (bridge->on_chunk && out->len >= bridge->chunk_size) {
+        bridge->tail[0] = out->data[out->len - 2];
+        bridge->tail[1] = out->data[out->len - 1];
+        (*bridge->on_chunk)(out, bridge->priv);
+        sb_reset(out);
+    }
+}
 
-    if (metric->label_values.len) {
-        sb_addc(out, '{');
-        for (int i = 0; i < metric->label_values.len; i++) {
-            const char *label_name = metric->parent->label_names.tab[i];
-            const char *label_value = metric->label_values.tab[i];
+static bool bridge_ends_with_empty_line(const prom_bridge_t *bridge)
+{
+    const sb_t *out = bridge->out;
+    char last = out->len >= 1 ? out->data[out->len - 1] : bridge->tail[1];
+    char prev;
 
-            if (i > 0) {
-                sb_addc(out, ',');
-            }
-            sb_addf(out, "%s=\"", label_name);
-            sb_adds_slashes(out, label_value, "\\\n", "\\n");
-            sb_addc(out, '"');
-        }
-        sb_addc(out, '}');
+    if (out->len >= 2) {
+        prev = out->data[out->len - 2];
+    } else {
+        prev = out->len ? bridge->tail[1] : bridge->tail[0];
     }
 
-    sb_addf(out, " %g\n", metric->value);
+    return last == '\n' && prev == '\n';
 }
 
-static void bridge_histogram(prom_histogram_t *metric, sb_t *out)
+/* Get the label pairs of a child metric, formatted once for all. Must be
+ * called with the lock of the metric held. */
+static lstr_t bridge_get_labels(prom_metric_t *metric)
 {
-    SB_1k(label_names);
-    prom_histogram_t *parent = metric->parent ?: metric;
+    SB_1k(labels);
+
+    if (!metric->label_values.len || metric->exposition_labels.s) {
+        return metric->exposition_labels;
+    }
 
-    /* Build a buffer containing label names */
     for (int i = 0; i < metric->label_values.len; i++) {
         const char *label_name = metric->parent->label_names.tab[i];
         const char *label_value = metric->label_values.tab[i];
 
         if (i > 0) {
-            sb_addc(&label_names, ',');
+            sb_addc(&labels, ',');
         }
-        sb_addf(&label_names, "%s=\"", label_name);
-        sb_adds_slashes(&label_names, label_value, "\\\n", "\\n");
-        sb_addc(&label_names, '"');
+        sb_adds(&labels, label_name);
+        sb_adds(&labels, "=\"");
+        sb_adds_slashes(&labels, label_value, "\\\n", "\\n");
+        sb_addc(&labels, '"');
+    }
+    metric->exposition_labels = lstr_dup(LSTR_SB_V(&labels));
+
+    return metric->exposition_labels;
+}
+
+static void bridge_simple_value(prom_simple_value_metric_t *metric,
+                                lstr_t labels, sb_t *out)
+{
+    lstr_t name = metric->parent ? metric->parent->name : metric->name;
+
+    sb_add_lstr(out, name);
+    if (labels.len) {
+        sb_addc(out, '{');
+        sb_add_lstr(out, labels);
+        sb_addc(out, '}');
     }
 
+    sb_addf(out, " %g\n", metric->value);
+}
+
+static void bridge_histogram(prom_histogram_t *metric, lstr_t labels,
+                             sb_t *out)
+{
+    prom_histogram_t *parent = metric->parent ?: metric;
+
     /* Add the line for each bucket */
     for (int i = 0; i < metric->nb_buckets; i++) {
         sb_add_lstr(out, parent->name);
-        sb_addf(out, "_bucket{%*pM", SB_FMT_ARG(&label_names));
-        if (metric->label_values.len) {
+        sb_adds(out, "_bucket{");
+        sb_add_lstr(out, labels);
+        if (labels.len) {
             sb_addc(out, ',');
         }
         sb_addf(out, "le=\"%g\"} %g\n",
@@ -679,8 +973,9 @@ static void bridge_histogram(prom_histogram_t *metric, sb_t *out)
 
     /* Add the line for the "+Inf" bucket */
     sb_add_lstr(out, parent->name);
-    sb_addf(out, "_bucket{%*pM", SB_FMT_ARG(&label_names));
-    if (metric->label_values.len) {
+    sb_adds(out, "_bucket{");
+    sb_add_lstr(out, labels);
+    if (labels.len) {
         sb_addc(out, ',');
     }
     sb_addf(out, "le=\"+Inf\"} %g\n", metric->count);
@@ -688,50 +983,61 @@ static void bridge_histogram(prom_histogram_t *metric, sb_t *out)
     /* Add the sum line */
     sb_add_lstr(out, parent->name);
     sb_adds(out, "_sum");
-    if (metric->label_values.len) {
-        sb_addf(out, "{%*pM}", SB_FMT_ARG(&label_names));
+    if (labels.len) {
+        sb_addf(out, "{%*pM}", LSTR_FMT_ARG(labels));
     }
     sb_addf(out, " %g\n", metric->sum);
 
     /* Add the count line */
     sb_add_lstr(out, parent->name);
     sb_adds(out, "_count");
-    if (metric->label_values.len) {
-        sb_addf(out, "{%*pM}", SB_FMT_ARG(&label_names));
+    if (labels.len) {
+        sb_addf(out, "{%*pM}", LSTR_FMT_ARG(labels));
     }
     sb_addf(out, " %g\n", metric->count);
 
     sb_addc(out, '\n');
 }
 
+/* Must be called with the lock of the metric held. */
 static void bridge_sample(prom_metric_t *metric, sb_t *out)
 {
     prom_simple_value_metric_t *simple_value;
+    lstr_t labels = bridge_get_labels(metric);
 
     simple_value = obj_dynvcast(prom_simple_value_metric, metric);
     if (simple_value) {
-        bridge_simple_value(simple_value, out);
+        prom_metric_collect_shards(metric, &simple_value->value,
+                                   NULL, NULL, 0);
+        bridge_simple_value(simple_value, labels, out);
     } else {
-        bridge_histogram(obj_vcast(prom_histogram, metric), out);
+        prom_histogram_t *histogram = obj_vcast(prom_histogram, metric);
+
+        prom_metric_collect_shards(metric, &histogram->count,
+                                   &histogram->sum, histogram->bucket_counts,
+                                   histogram->nb_buckets);
+        bridge_histogram(histogram, labels, out);
     }
 }
 
-static void prom_collector_bridge_metric(prom_metric_t *metric, sb_t *out)
+/* Called without any lock held, with references on the metric and on its
+ * children. */
+static void prom_collector_bridge_metric(prom_metric_t *metric,
+                                         const qv_t(prom_metric) *children,
+                                         prom_bridge_t *bridge)
 {
+    sb_t *out = bridge->out;
     lstr_t metric_type = LSTR_NULL_V;
 
     /* Skip metrics without samples */
-    if (metric->label_names.len
-    &&  !qm_len(prom_metric, metric->children_by_labels))
-    {
+    if (metric->label_names.len && !children->len) {
         return;
     }
 
+    bridge_flush_chunk(bridge);
+
     /* Ensure there is an empty line between each metric */
-    if (out->len >= 2
-    &&  (out->data[out->len - 1] != '\n'
-      || out->data[out->len - 2] != '\n'))
-    {
+    if (!bridge_ends_with_empty_line(bridge)) {
         sb_adds(out, "\n");
     }
 
@@ -760,11 +1066,12 @@ static void prom_collector_bridge_metric(prom_metric_t *metric, sb_t *out)
 
     /* Add values */
     if (is_metric_observable(metric)) {
+        spin_lock(&metric->lock);
         bridge_sample(metric, out);
+        spin_unlock(&metric->lock);
     } else {
-        dlist_for_each_entry(prom_metric_t, child, &metric->children_list,
-                             siblings_list)
-        {
+        tab_for_each_entry(child, children) {
+            bridge_flush_chunk(bridge);
             spin_lock(&child->lock);
             bridge_sample(child, out);
             spin_unlock(&child->lock);
@@ -772,17 +1079,87 @@ static void prom_collector_bridge_metric(prom_metric_t *metric, sb_t *out)
     }
 }
 
-void prom_collector_bridge(const dlist_t *collector, sb_t *out)
+/* The metrics and their children are rendered out of the collector and
+ * parent locks: the locks are only held to take references on them, so that
+ * a long scrape does not block their registration, lookup or removal. */
+static void prom_collector_bridge_all(const dlist_t *collector,
+                                      prom_bridge_t *bridge)
 {
+    sb_t *out = bridge->out;
+    qv_t(prom_metric) metrics;
+    qv_t(prom_metric) children;
+
+    /* Nothing before the first metric, it needs no separator */
+    bridge->tail[0] = bridge->tail[1] = '\n';
+
+    qv_init(&metrics);
+    qv_init(&children);
+
+    pthread_mutex_lock(&prom_collector_lock_g);
     dlist_for_each_entry(prom_metric_t, metric, collector, siblings_list) {
+        obj_retain(metric);
+        qv_append(&metrics, metric);
+    }
+    pthread_mutex_unlock(&prom_collector_lock_g);
+
+    tab_for_each_entry(metric, &metrics) {
+        qv_clear(&children);
         spin_lock(&metric->lock);
-        prom_collector_bridge_metric(metric, out);
+        dlist_for_each_entry(prom_metric_t, child, &metric->children_list,
+                             siblings_list)
+        {
+            obj_retain(child);
+            qv_append(&children, child);
+        }
+        spin_unlock(&metric->lock);
+
+        prom_collector_bridge_metric(metric, &children, bridge);
+
+        spin_lock(&metric->lock);
+        tab_for_each_ptr(child, &children) {
+            obj_release(child);
+        }
         spin_unlock(&metric->lock);
     }
 
+    /* Takes the collector lock, see prom_metric_release(). */
+    tab_for_each_ptr(metric, &metrics) {
+        obj_release(metric);
+    }
+    qv_wipe(&children);
+    qv_wipe(&metrics);
+
     if (out->len && out->data[out->len - 1] == '\n') {
         sb_shrink(out, 1);
     }
 }
 
+void prom_collector_bridge(const dlist_t *collector, sb_t *out)
+{
+    prom_bridge_t bridge = {
+        .out = out,
+    };
+
+    prom_collector_bridge_all(collector, &bridge);
+}
+
+void prom_collector_bridge_chunked(const dlist_t *collector, sb_t *out,
+                                   int chunk_size,
+                                   prom_bridge_chunk_f *on_chunk,
+                                   void *priv)
+{
+    prom_bridge_t bridge = {
+        .out        = out,
+        .chunk_size = MAX(chunk_size, 2),
+        .on_chunk   = on_chunk,
+        .priv       = priv,
+    };
+
+    prom_collector_bridge_all(collector, &bridge);
+    if (out->len) {
+        (*on_chunk)(out, priv);
+        sb_reset(out);
+    }
+}
+
 /* }}} */
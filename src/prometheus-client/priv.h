@@ -19,6 +19,8 @@
 #ifndef PROMETHEUS_CLIENT_PRIV_H
 #define PROMETHEUS_CLIENT_PRIV_H
 
+#include <pthread.h>
+
 #include <lib-common/prometheus-client.h>
 #include <lib-common/log.h>
 
@@ -35,6 +37,22 @@ extern logger_t prom_logger_g;
  */
 extern dlist_t prom_collector_g;
 
+/** Lock of the collector.
+ *
+ * Held when metrics are registered in or unregistered from the collector,
+ * and when the reference counter of a registered metric is updated. The
+ * exposition, rendered on a worker thread, only holds it while it takes
+ * references on the registered metrics.
+ */
+extern pthread_mutex_t prom_collector_lock_g;
+
+/** Self-metric on the duration of the scrapes.
+ *
+ * It is registered when the HTTP server is started. Protected by
+ * prom_collector_lock_g.
+ */
+extern prom_histogram_t * nullable prom_scrape_duration_g;
+
 /** Validate the name of a metric.
  *
  * Exposed for tests.
@@ -56,6 +74,24 @@ int prom_metric_check_label_name(const char *label_name);
  */
 void prom_collector_bridge(const dlist_t *collector, sb_t *out);
 
+/** Callback of prom_collector_bridge_chunked().
+ *
+ * It consumes the text rendered in \p out, which is reset after the call.
+ */
+typedef void (prom_bridge_chunk_f)(sb_t *out, void *priv);
+
+/** Chunked variant of prom_collector_bridge().
+ *
+ * The text is rendered in \p out, and passed to \p on_chunk each time it is
+ * larger than \p chunk_size bytes, and once at the end for the remaining
+ * text. The concatenation of the chunks is the output of
+ * prom_collector_bridge().
+ */
+void prom_collector_bridge_chunked(const dlist_t *collector, sb_t *out,
+                                   int chunk_size,
+                                   prom_bridge_chunk_f *on_chunk,
+                                   void *priv);
+
 /** Module for HTTP server for scraping. */
 MODULE_DECLARE(prometheus_client_http);
 
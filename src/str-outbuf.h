@@ -85,6 +85,8 @@ enum outbuf_on_wipe {
     OUTBUF_DO_NOTHING,
     OUTBUF_DO_FREE,
     OUTBUF_DO_MUNMAP,
+    OUTBUF_DO_CLOSE,
+    OUTBUF_DO_RELEASE,
 };
 
 typedef struct outbuf_chunk_t {
@@ -93,6 +95,15 @@ typedef struct outbuf_chunk_t {
     int       offset;
     int       sb_leading;
     int       on_wipe;
+    /* File range chunks have no data in memory: their bytes are the ones
+     * of file_fd starting at file_off, sent with sendfile(2). */
+    bool      is_file;
+    int       file_fd;
+    off_t     file_off;
+    /* Shared chunks do not own their data: on_release(release_priv) is
+     * called when they are wiped. */
+    void    (* nullable on_release)(void * nullable priv);
+    void     * nullable release_priv;
     union {
         const void    * nonnull p;
         const uint8_t * nonnull b;
@@ -179,6 +190,33 @@ void ob_add_memchunk(outbuf_t * nonnull ob, const void * nonnull ptr,
     }
 }
 
+/** adds a shared memory block (\p ptr, \p len) to the chunks of \p ob.
+ *
+ * The memory is not copied: \p release is called with \p priv once \p ob
+ * does not reference it anymore, typically to drop a reference on the
+ * object that owns the memory. Small blocks are copied and released at
+ * once.
+ */
+static inline
+void ob_add_memchunk_shared(outbuf_t * nonnull ob, const void * nonnull ptr,
+                            int len, void (* nonnull release)(void * nullable),
+                            void * nullable priv)
+{
+    if (len <= OUTBUF_CHUNK_MIN_SIZE) {
+        ob_add(ob, ptr, len);
+        (*release)(priv);
+    } else {
+        outbuf_chunk_t *obc = p_new(outbuf_chunk_t, 1);
+
+        obc->u.p          = ptr;
+        obc->length       = len;
+        obc->on_wipe      = OUTBUF_DO_RELEASE;
+        obc->on_release   = release;
+        obc->release_priv = priv;
+        ob_add_chunk(ob, obc);
+    }
+}
+
 static inline void ob_add_memmap(outbuf_t * nonnull ob, void * nonnull map,
                                  int len)
 {
@@ -198,6 +236,20 @@ static inline void ob_add_memmap(outbuf_t * nonnull ob, void * nonnull map,
 int ob_add_file(outbuf_t * nonnull ob, const char * nonnull file, int size)
     __leaf;
 
+/** adds the range [\p off, \p off + \p len) of the file \p fd to \p ob.
+ *
+ * Large ranges are not read: ob_write() sends them from the page cache with
+ * sendfile(2), or through a small bounce buffer when a custom writer (e.g.
+ * TLS) is used. Small ranges are read right away.
+ *
+ * \param own_fd: if true the ownership of \p fd is transfered to \p ob,
+ *                even on error.
+ *
+ * XXX: the file must not be truncated before the range is consumed.
+ */
+int ob_add_file_range(outbuf_t * nonnull ob, int fd, off_t off, int len,
+                      bool own_fd) __leaf;
+
 #if __has_feature(nullability)
 #pragma GCC diagnostic pop
 #endif
@@ -51,6 +51,43 @@ ssize_t sb_add_compressed(sb_t * nonnull out, const void * nonnull data,
 #define ob_add_compressed(ob, data, dlen, level, do_gzip)  \
     OB_WRAP(sb_add_compressed, ob, data, dlen, level, do_gzip)
 
+/** Add data compressed with a deflate stream in the string buffer.
+ *
+ * Unlike sb_add_compressed(), the stream is kept between the calls, which
+ * allows to compress data produced piece by piece. It must be initialized
+ * with deflateInit2() (with 16 added to the window bits for gzip), and
+ * released with deflateEnd() once the last call is done with Z_FINISH.
+ *
+ * @param out     output buffer
+ * @param stream  the deflate stream
+ * @param data    source data
+ * @param dlen    size of the data pointed by @p data.
+ * @param flush   Z_NO_FLUSH to let zlib buffer the data, Z_SYNC_FLUSH to
+ *                output all of it, or Z_FINISH to end the stream.
+ *
+ * @return amount of data written in the buffer (which may be 0 with
+ * Z_NO_FLUSH) or a negative zlib error in case of error.
+ */
+ssize_t sb_add_deflate(sb_t * nonnull out, z_stream * nonnull stream,
+                       const void * nonnull data, size_t dlen, int flush);
+
+/** Add uncompressed data in the string buffer.
+ *
+ * Takes the zlib or gzip compressed chunk of data pointed by @p data and
+ * @p dlen and add it uncompressed in the sb_t @p out. The format is
+ * detected from the header. Concatenated gzip members, as produced by
+ * appending to a gzip file, are all uncompressed.
+ *
+ * @param out     output buffer
+ * @param data    compressed data
+ * @param dlen    size of the data pointed by @p data.
+ *
+ * @return amount of data written in the buffer or a negative zlib error in
+ * case of error (Z_DATA_ERROR for truncated data).
+ */
+ssize_t sb_add_uncompressed(sb_t * nonnull out, const void * nonnull data,
+                            size_t dlen);
+
 #if __has_feature(nullability)
 #pragma GCC diagnostic pop
 #endif
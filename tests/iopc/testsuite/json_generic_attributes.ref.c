@@ -253,7 +253,7 @@ const iop_struct_t json_generic_attributes__test__s = {
     .ranges_len = countof(iop__ranges__2) / 2,
     .fields_len = countof(json_generic_attributes__test__desc_fields),
     .size       = sizeof(json_generic_attributes__test__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &json_generic_attributes__test__s_desc_attrs,
 };
 iop_struct_t const * const json_generic_attributes__test__sp = &json_generic_attributes__test__s;
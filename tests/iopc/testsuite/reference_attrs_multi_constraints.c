@@ -173,7 +173,7 @@ const iop_struct_t attrs_multi_constraints__test__s = {
     .ranges_len = countof(iop__ranges__1) / 2,
     .fields_len = countof(attrs_multi_constraints__test__desc_fields),
     .size       = sizeof(attrs_multi_constraints__test__t),
-    .flags      = 3,
+    .flags      = 131,
     .fields_attrs = attrs_multi_constraints__test__desc_fields_attrs,
 };
 iop_struct_t const * const attrs_multi_constraints__test__sp = &attrs_multi_constraints__test__s;
@@ -276,7 +276,7 @@ const iop_struct_t attrs_multi_constraints__test2__s = {
     .ranges_len = countof(iop__ranges__2) / 2,
     .fields_len = countof(attrs_multi_constraints__test2__desc_fields),
     .size       = sizeof(attrs_multi_constraints__test2__t),
-    .flags      = 3,
+    .flags      = 131,
     .fields_attrs = attrs_multi_constraints__test2__desc_fields_attrs,
 };
 iop_struct_t const * const attrs_multi_constraints__test2__sp = &attrs_multi_constraints__test2__s;
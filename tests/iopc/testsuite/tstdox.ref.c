@@ -236,6 +236,7 @@ const iop_struct_t tstdox__my_struct_a__s = {
     .ranges_len = countof(iop__ranges__3) / 2,
     .fields_len = countof(tstdox__my_struct_a__desc_fields),
     .size       = sizeof(tstdox__my_struct_a__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_struct_a__sp = &tstdox__my_struct_a__s;
 
@@ -310,7 +311,7 @@ const iop_struct_t tstdox__my_struct_b__s = {
     .ranges_len = countof(iop__ranges__4) / 2,
     .fields_len = countof(tstdox__my_struct_b__desc_fields),
     .size       = sizeof(tstdox__my_struct_b__t),
-    .flags      = 3,
+    .flags      = 131,
     .fields_attrs = tstdox__my_struct_b__desc_fields_attrs,
 };
 iop_struct_t const * const tstdox__my_struct_b__sp = &tstdox__my_struct_b__s;
@@ -438,7 +439,7 @@ const iop_struct_t tstdox__my_struct_aa__s = {
     .ranges_len = countof(iop__ranges__3) / 2,
     .fields_len = countof(tstdox__my_struct_aa__desc_fields),
     .size       = sizeof(tstdox__my_struct_aa__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_struct_aa__s_desc_attrs,
     .fields_attrs = tstdox__my_struct_aa__desc_fields_attrs,
 };
@@ -507,7 +508,7 @@ const iop_struct_t tstdox__my_struct_ab__s = {
     .ranges_len = countof(iop__ranges__3) / 2,
     .fields_len = countof(tstdox__my_struct_ab__desc_fields),
     .size       = sizeof(tstdox__my_struct_ab__t),
-    .flags      = 1,
+    .flags      = 129,
     .fields_attrs = tstdox__my_struct_ab__desc_fields_attrs,
 };
 iop_struct_t const * const tstdox__my_struct_ab__sp = &tstdox__my_struct_ab__s;
@@ -538,7 +539,7 @@ const iop_struct_t tstdox__my_struct_ac__s = {
     .ranges_len = countof(iop__ranges__3) / 2,
     .fields_len = countof(tstdox__my_struct_a__desc_fields),
     .size       = sizeof(tstdox__my_struct_ac__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_struct_ac__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_struct_ac__sp = &tstdox__my_struct_ac__s;
@@ -569,7 +570,7 @@ const iop_struct_t tstdox__my_struct_ba__s = {
     .ranges_len = countof(iop__ranges__4) / 2,
     .fields_len = countof(tstdox__my_struct_b__desc_fields),
     .size       = sizeof(tstdox__my_struct_ba__t),
-    .flags      = 3,
+    .flags      = 131,
     .st_attrs   = &tstdox__my_struct_ba__s_desc_attrs,
     .fields_attrs = tstdox__my_struct_b__desc_fields_attrs,
 };
@@ -649,7 +650,7 @@ const iop_struct_t tstdox__my_struct_bb__s = {
     .ranges_len = countof(iop__ranges__4) / 2,
     .fields_len = countof(tstdox__my_struct_bb__desc_fields),
     .size       = sizeof(tstdox__my_struct_bb__t),
-    .flags      = 3,
+    .flags      = 131,
     .fields_attrs = tstdox__my_struct_bb__desc_fields_attrs,
 };
 iop_struct_t const * const tstdox__my_struct_bb__sp = &tstdox__my_struct_bb__s;
@@ -705,7 +706,7 @@ const iop_struct_t tstdox__sort_field__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__sort_field__desc_fields),
     .size       = sizeof(tstdox__sort_field__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__sort_field__s_desc_attrs,
     .fields_attrs = tstdox__sort_field__desc_fields_attrs,
 };
@@ -980,7 +981,7 @@ const iop_struct_t tstdox__my_iface_a__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__4) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_a_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_a_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_a_args__s_desc_attrs,
     .fields_attrs = tstdox__my_iface_a__fun_a_args__desc_fields_attrs,
 };
@@ -1064,7 +1065,7 @@ const iop_struct_t tstdox__my_iface_a__fun_a_res__s = {
     .ranges_len = countof(iop__ranges__4) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_a_res__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_a_res__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_a_res__s_desc_attrs,
     .fields_attrs = tstdox__my_iface_a__fun_a_res__desc_fields_attrs,
 };
@@ -1108,7 +1109,7 @@ const iop_struct_t tstdox__my_iface_a__fun_aa_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_aa_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_aa_args__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_aa_args__sp = &tstdox__my_iface_a__fun_aa_args__s;
@@ -1148,7 +1149,7 @@ const iop_struct_t tstdox__my_iface_a__fun_aa_res__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_res__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_aa_res__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_aa_res__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_aa_res__sp = &tstdox__my_iface_a__fun_aa_res__s;
@@ -1179,7 +1180,7 @@ const iop_struct_t tstdox__my_iface_a__fun_b_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_b_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_b_args__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_b_args__sp = &tstdox__my_iface_a__fun_b_args__s;
@@ -1190,7 +1191,7 @@ const iop_struct_t tstdox__my_iface_a__fun_bal1_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_b_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_b_args__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_bal1_args__sp = &tstdox__my_iface_a__fun_bal1_args__s;
@@ -1201,7 +1202,7 @@ const iop_struct_t tstdox__my_iface_a__fun_bal2_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_b_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_b_args__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_bal2_args__sp = &tstdox__my_iface_a__fun_bal2_args__s;
@@ -1226,7 +1227,7 @@ const iop_struct_t tstdox__my_iface_a__fun_c_res__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_res__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_c_res__t),
-    .flags      = 1,
+    .flags      = 129,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_c_res__sp = &tstdox__my_iface_a__fun_c_res__s;
 
@@ -1256,7 +1257,7 @@ const iop_struct_t tstdox__my_iface_a__fun_d_res__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_aa_res__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_d_res__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstdox__my_iface_a__fun_d_res__s_desc_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_d_res__sp = &tstdox__my_iface_a__fun_d_res__s;
@@ -1298,7 +1299,7 @@ const iop_struct_t tstdox__my_iface_a__fun_e_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_e_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_e_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .fields_attrs = tstdox__my_iface_a__fun_e_args__desc_fields_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_e_args__sp = &tstdox__my_iface_a__fun_e_args__s;
@@ -1309,7 +1310,7 @@ const iop_struct_t tstdox__my_iface_a__fun_e1_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_e_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_e_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .fields_attrs = tstdox__my_iface_a__fun_e_args__desc_fields_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_e1_args__sp = &tstdox__my_iface_a__fun_e1_args__s;
@@ -1320,7 +1321,7 @@ const iop_struct_t tstdox__my_iface_a__fun_e2_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_a__fun_e_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_a__fun_e_args__t),
-    .flags      = 1,
+    .flags      = 129,
     .fields_attrs = tstdox__my_iface_a__fun_e_args__desc_fields_attrs,
 };
 iop_struct_t const * const tstdox__my_iface_a__fun_e2_args__sp = &tstdox__my_iface_a__fun_e2_args__s;
@@ -1601,6 +1602,7 @@ const iop_struct_t tstdox__my_iface_b__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_b__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_b__fun_a_args__sp = &tstdox__my_iface_b__fun_a_args__s;
 
@@ -1625,6 +1627,7 @@ const iop_struct_t tstdox__my_iface_b__fun_b_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_b_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_b__fun_b_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_b__fun_b_args__sp = &tstdox__my_iface_b__fun_b_args__s;
 
@@ -1665,6 +1668,7 @@ const iop_struct_t tstdox__my_iface_c__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_c__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_c__fun_a_args__sp = &tstdox__my_iface_c__fun_a_args__s;
 const iop_struct_t tstdox__my_iface_c__fun_a2_args__s = {
@@ -1674,6 +1678,7 @@ const iop_struct_t tstdox__my_iface_c__fun_a2_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_c__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_c__fun_a2_args__sp = &tstdox__my_iface_c__fun_a2_args__s;
 
@@ -1689,6 +1694,7 @@ const iop_struct_t tstdox__my_iface_c__fun_b_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_b_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_c__fun_b_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_c__fun_b_args__sp = &tstdox__my_iface_c__fun_b_args__s;
 
@@ -1759,6 +1765,7 @@ const iop_struct_t tstdox__my_iface_d__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_d__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_d__fun_a_args__sp = &tstdox__my_iface_d__fun_a_args__s;
 
@@ -1774,6 +1781,7 @@ const iop_struct_t tstdox__my_iface_d__fun_b_args__s = {
     .ranges_len = countof(iop__ranges__5) / 2,
     .fields_len = countof(tstdox__my_iface_b__fun_b_args__desc_fields),
     .size       = sizeof(tstdox__my_iface_d__fun_b_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstdox__my_iface_d__fun_b_args__sp = &tstdox__my_iface_d__fun_b_args__s;
 
@@ -378,6 +378,7 @@ const iop_struct_t tstgen__my_iface_a__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__6) / 2,
     .fields_len = countof(tstgen__my_iface_a__fun_a_args__desc_fields),
     .size       = sizeof(tstgen__my_iface_a__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstgen__my_iface_a__fun_a_args__sp = &tstgen__my_iface_a__fun_a_args__s;
 
@@ -808,7 +808,7 @@ const iop_struct_t tstjson__my_struct_c__s = {
     .ranges_len = countof(iop__ranges__7) / 2,
     .fields_len = countof(tstjson__my_struct_c__desc_fields),
     .size       = sizeof(tstjson__my_struct_c__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstjson__my_struct_c__s_desc_attrs,
     .fields_attrs = tstjson__my_struct_c__desc_fields_attrs,
 };
@@ -2169,7 +2169,7 @@ const iop_struct_t tstjson__my_iface_a__fun_j_res__s = {
     .ranges_len = countof(iop__ranges__7) / 2,
     .fields_len = countof(tstjson__my_iface_a__fun_j_res__desc_fields),
     .size       = sizeof(tstjson__my_iface_a__fun_j_res__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstjson__my_iface_a__fun_j_res__s_desc_attrs,
     .fields_attrs = tstjson__my_iface_a__fun_j_res__desc_fields_attrs,
 };
@@ -2227,7 +2227,7 @@ const iop_struct_t tstjson__my_iface_a__fun_j_exn__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_a__fun_j_exn__desc_fields),
     .size       = sizeof(tstjson__my_iface_a__fun_j_exn__t),
-    .flags      = 1,
+    .flags      = 129,
     .st_attrs   = &tstjson__my_iface_a__fun_j_exn__s_desc_attrs,
     .fields_attrs = tstjson__my_iface_a__fun_j_exn__desc_fields_attrs,
 };
@@ -2290,6 +2290,7 @@ const iop_struct_t tstjson__my_iface_a__fun_k_res__s = {
     .ranges_len = countof(iop__ranges__7) / 2,
     .fields_len = countof(tstjson__my_iface_a__fun_k_res__desc_fields),
     .size       = sizeof(tstjson__my_iface_a__fun_k_res__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_a__fun_k_res__sp = &tstjson__my_iface_a__fun_k_res__s;
 
@@ -2335,6 +2336,7 @@ const iop_struct_t tstjson__my_iface_a__fun_l_args__s = {
     .ranges_len = countof(iop__ranges__4) / 2,
     .fields_len = countof(tstjson__my_iface_a__fun_l_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_a__fun_l_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_a__fun_l_args__sp = &tstjson__my_iface_a__fun_l_args__s;
 
@@ -2359,6 +2361,7 @@ const iop_struct_t tstjson__my_iface_a__fun_async_args__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_a__fun_async_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_a__fun_async_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_a__fun_async_args__sp = &tstjson__my_iface_a__fun_async_args__s;
 
@@ -2625,6 +2628,7 @@ const iop_struct_t tstjson__my_iface_b__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_b__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_b__fun_a_args__sp = &tstjson__my_iface_b__fun_a_args__s;
 const iop_struct_t tstjson__my_iface_b__function_a_args__s = {
@@ -2634,6 +2638,7 @@ const iop_struct_t tstjson__my_iface_b__function_a_args__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_b__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_b__function_a_args__sp = &tstjson__my_iface_b__function_a_args__s;
 
@@ -2649,6 +2654,7 @@ const iop_struct_t tstjson__my_iface_b__fun_a_res__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_b__fun_a_res__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_b__fun_a_res__sp = &tstjson__my_iface_b__fun_a_res__s;
 const iop_struct_t tstjson__my_iface_b__function_a_res__s = {
@@ -2658,6 +2664,7 @@ const iop_struct_t tstjson__my_iface_b__function_a_res__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_b__fun_a_res__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_b__function_a_res__sp = &tstjson__my_iface_b__function_a_res__s;
 
@@ -2718,6 +2725,7 @@ const iop_struct_t tstjson__my_iface_c__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_c__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_c__fun_a_args__sp = &tstjson__my_iface_c__fun_a_args__s;
 
@@ -2733,6 +2741,7 @@ const iop_struct_t tstjson__my_iface_c__fun_a_res__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_c__fun_a_res__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_c__fun_a_res__sp = &tstjson__my_iface_c__fun_a_res__s;
 
@@ -2766,6 +2775,7 @@ const iop_struct_t tstjson__my_iface_d__fun_a_args__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_d__fun_a_args__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_d__fun_a_args__sp = &tstjson__my_iface_d__fun_a_args__s;
 
@@ -2781,6 +2791,7 @@ const iop_struct_t tstjson__my_iface_d__fun_a_res__s = {
     .ranges_len = countof(iop__ranges__9) / 2,
     .fields_len = countof(tstjson__my_iface_b__fun_a_args__desc_fields),
     .size       = sizeof(tstjson__my_iface_d__fun_a_res__t),
+    .flags      = 128,
 };
 iop_struct_t const * const tstjson__my_iface_d__fun_a_res__sp = &tstjson__my_iface_d__fun_a_res__s;
 
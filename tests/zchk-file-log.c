@@ -21,6 +21,7 @@
 #include <lib-common/datetime.h>
 #include <lib-common/el.h>
 #include <lib-common/file-log.h>
+#include <lib-common/zlib-wrapper.h>
 #include <lib-common/z.h>
 
 struct {
@@ -256,4 +257,52 @@ Z_GROUP_EXPORT(file_log)
 
         Z_HELPER_RUN(z_check_file_permission(path.s, 0640u));
     } Z_TEST_END;
+
+    Z_TEST(file_log_compress_stream, "check streamed compression") {
+        t_scope;
+        lstr_t path = t_lstr_fmt("%*pMtmp_log_gz", LSTR_FMT_ARG(z_tmpdir_g));
+        log_file_t *log_file;
+        lstr_t content;
+        glob_t globbuf;
+        SB_1k(expected);
+        SB_1k(res);
+
+        for (int i = 0; i < 2; i++) {
+            log_file = log_file_new(path.s, LOG_FILE_COMPRESS_STREAM);
+            Z_ASSERT_N(log_file_open(log_file, false));
+
+            /* More than one gzip member. */
+            for (int j = 0; expected.len < 3 * LOG_FILE_GZ_FRAME_SIZE; j++) {
+                lstr_t line = t_lstr_fmt("line %d of run %d\n", j, i);
+
+                sb_add_lstr(&expected, line);
+                Z_ASSERT_N(log_fwrite(log_file, line.s, line.len));
+            }
+
+            /* Failed transactions are rewound. */
+            Z_ASSERT_NEG(log_fwrite_transaction(log_file, ^int (void) {
+                log_fprintf(log_file, "rewound line\n");
+                return -1;
+            }));
+            Z_ASSERT_N(log_fwrite_transaction(log_file, ^int (void) {
+                return log_fprintf(log_file, "committed line\n");
+            }));
+            sb_adds(&expected, "committed line\n");
+
+            Z_ASSERT_N(log_file_close(&log_file));
+        }
+
+        /* Both runs appended to the same file, readable at once. */
+        Z_ASSERT_ZERO(glob(t_fmt("%s_????????_??????.log.gz", path.s), 0,
+                           NULL, &globbuf));
+        Z_ASSERT_EQ(globbuf.gl_pathc, 1u);
+        Z_ASSERT_N(lstr_init_from_file(&content, globbuf.gl_pathv[0],
+                                       PROT_READ, MAP_SHARED));
+        Z_ASSERT_LT(content.len, expected.len / 4);
+        Z_ASSERT_N(sb_add_uncompressed(&res, content.s, content.len));
+        Z_ASSERT_LSTREQUAL(LSTR_SB_V(&res), LSTR_SB_V(&expected));
+        lstr_wipe(&content);
+        unlink(globbuf.gl_pathv[0]);
+        globfree(&globbuf);
+    } Z_TEST_END;
 } Z_GROUP_END
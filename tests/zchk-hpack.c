@@ -223,6 +223,21 @@ static int z_hpack_dec_dtbl_size_test(hpack_dec_dtbl_t *dtbl, int len,
     Z_HELPER_END;
 }
 
+/* Value of the i-th header of hpack_dtbl_wrap: its size varies with i and
+ * its bytes differ from the ones of its neighbours, so that an overwritten
+ * string is detected. */
+static lstr_t z_hpack_dtbl_wrap_val(int i)
+{
+    int len = 2 * (i % 61);
+    char *s = t_new_raw(char, len + 1);
+
+    for (int k = 0; k < len; k++) {
+        s[k] = 'a' + (i + k) % 26;
+    }
+    s[len] = '\0';
+    return LSTR_DATA_V(s, len);
+}
+
 Z_GROUP_EXPORT(hpack_tables) {
 #define HPACK_STBL_SEARCH(exp_idx, k, v)                                               \
     Z_HELPER_RUN(                                                            \
@@ -540,6 +555,31 @@ Z_GROUP_EXPORT(hpack_tables) {
 #undef HPACK_DTBL_INSERT
 #undef HPACK_DTBL_SZCHCK
     } Z_TEST_END;
+
+    Z_TEST(hpack_dtbl_wrap, "strings of the decoder's DTBL wrap around") {
+        t_scope;
+        hpack_dec_dtbl_t dtbl;
+
+        hpack_dec_dtbl_init(&dtbl);
+        hpack_dec_dtbl_init_settings(&dtbl, 256);
+
+        /* Insert entries of various sizes, so that the strings buffer
+         * wraps at various offsets, and check that the live entries are
+         * never overwritten. */
+        for (int i = 0; i < 1000; i++) {
+            hpack_dec_dtbl_add_hdr(&dtbl, t_lstr_fmt("key-%d", i),
+                                   z_hpack_dtbl_wrap_val(i));
+            for (int j = 0; j < dtbl.entries.len; j++) {
+                hpack_dec_dtbl_entry_t *e = hpack_dec_dtbl_get_ent(&dtbl, j);
+
+                Z_ASSERT_LSTREQUAL(e->key, t_lstr_fmt("key-%d", i - j));
+                Z_ASSERT_LSTREQUAL(e->val, z_hpack_dtbl_wrap_val(i - j));
+            }
+            Z_ASSERT_LE(dtbl.tbl_size, 256U);
+        }
+
+        hpack_dec_dtbl_wipe(&dtbl);
+    } Z_TEST_END;
 } Z_GROUP_END;
 
 /* }}} */
@@ -22,6 +22,7 @@
 #include <lib-common/iop-rpc.h>
 #include <lib-common/core/core.iop.h>
 #include <lib-common/datetime.h>
+#include <lib-common/thr.h>
 
 #include "iop/tstiop_rpc.iop.h"
 
@@ -38,12 +39,21 @@ static struct {
     core__log_level__t  level;
     ctx_t               ctx;
     int echo_rpc_answered;
+    int echo_rpc_answered_off_main;
+    int echo_rpc_cb_called;
+    pthread_t main_thread;
     bool reply_callback_called;
     bool reply_callback_called_synchronously;
     bool sub_query_called;
     bool sub_query_called_synchronously;
     bool reply_status_is_abort;
     uint32_t last_user_version;
+    bool spawned_compress;
+    const qm_t(ic_cbs) *spawned_impl;
+
+    /* Calls of the hooks and of the RPCs of the HTTP queries, in order */
+    sb_t http_trace;
+    el_t http_el;
 } z_iop_rpc_g;
 #define _G  z_iop_rpc_g
 
@@ -174,6 +184,7 @@ static void IOP_RPC_CB(core__core, log, set_logger_level)
 
 typedef struct echo_ctx_t {
     int received;
+    int rank;
     bool has_answer;
 } echo_ctx_t;
 
@@ -184,12 +195,101 @@ static void IOP_RPC_CB(tstiop_rpc__rpc, test, echo)
     assert (res != NULL);
     ctx->has_answer = true;
     ctx->received = res->i;
+    ctx->rank = _G.echo_rpc_cb_called++;
 }
 
 static void IOP_RPC_IMPL(tstiop_rpc__rpc, test, echo)
 {
     ic_reply(ic, slot, tstiop_rpc__rpc, test, echo, arg->i);
     _G.echo_rpc_answered++;
+    if (!pthread_equal(pthread_self(), _G.main_thread)) {
+        _G.echo_rpc_answered_off_main++;
+    }
+}
+
+typedef struct echo_data_ctx_t {
+    lstr_t received;
+    bool has_answer;
+} echo_data_ctx_t;
+
+static void IOP_RPC_CB(tstiop_rpc__rpc, test, echo_data)
+{
+    echo_data_ctx_t *ctx = *acast(echo_data_ctx_t *, msg->priv);
+
+    assert (res != NULL);
+    ctx->has_answer = true;
+    lstr_copy(&ctx->received, res->data);
+}
+
+static void IOP_RPC_IMPL(tstiop_rpc__rpc, test, echo_data)
+{
+    ic_reply(ic, slot, tstiop_rpc__rpc, test, echo_data, arg->data);
+}
+
+static void IOP_RPC_IMPL(tstiop_rpc__rpc, test, upload)
+{
+    sb_addf(&_G.http_trace, "rpc:%d:%d:%*pM:%d;", arg->count,
+            arg->elems.len, LSTR_FMT_ARG(hdr->simple.login),
+            hdr->simple.payload);
+    ic_reply(ic, slot, tstiop_rpc__rpc, test, upload, arg->count);
+}
+
+/* Echo on an HTTP server; negative integers are refused. */
+static void z_ichttp_echo(IOP_RPC_IMPL_ARGS(tstiop_rpc__rpc, test, echo))
+{
+    sb_addf(&_G.http_trace, "echo:%d:%d;", arg->i,
+            ichttp_slot_is_batch_call(slot));
+    if (arg->i < 0) {
+        ic_reply_err(ic, slot, IC_MSG_UNIMPLEMENTED);
+        return;
+    }
+    ic_reply(ic, slot, tstiop_rpc__rpc, test, echo, arg->i);
+}
+
+typedef struct z_http_echo_t {
+    bool        has_answer;
+    ic_status_t status;
+    int         code;
+    int         received;
+} z_http_echo_t;
+
+static void
+z_http_iop_echo_cb(IOP_HTTP_RPC_CB_ARGS(tstiop_rpc__rpc, test, echo))
+{
+    z_http_echo_t *echo = *acast(z_http_echo_t *, msg->priv);
+
+    echo->has_answer = true;
+    echo->status = status;
+    echo->code = OPT_DEFVAL(http_code, 0);
+    echo->received = res ? res->i : INT_MIN;
+}
+
+static int z_ichttp_on_upload_elem(uint64_t slot, const void *elem)
+{
+    const tstiop_rpc__elem__t *e = elem;
+
+    sb_addf(&_G.http_trace, "elem:%d;", e->i);
+    return 0;
+}
+
+/* Only the queries of "user" with the right password are accepted. */
+static void z_ichttp_pre_hook(ichannel_t *ic, uint64_t slot, ic__hdr__t *hdr,
+                              data_t arg, bool *hdr_modified)
+{
+    sb_adds(&_G.http_trace, "pre;");
+    if (hdr && IOP_UNION_IS(ic__hdr, hdr, simple)
+    &&  lstr_equal(hdr->simple.login, LSTR("user"))
+    &&  lstr_equal(hdr->simple.password, LSTR("pass")))
+    {
+        ic_hook_ctx_new(slot, 0);
+    }
+}
+
+static void z_ichttp_post_hook(ichannel_t *ic, ic_status_t status,
+                               ic_hook_ctx_t *ctx, data_t arg,
+                               const iop_struct_t *st, const void *value)
+{
+    sb_addf(&_G.http_trace, "post:%d;", status);
 }
 
 /* }}} */
@@ -219,7 +319,8 @@ static int z_ic_on_accept(el_t ev, int fd)
     _G.ic_spawned = ic_new();
     _G.ic_spawned->iop_env = _G.iop_env;
     _G.ic_spawned->on_event = &dummy_on_event;
-    _G.ic_spawned->impl = &ic_no_impl;
+    _G.ic_spawned->impl = _G.spawned_impl ?: &ic_no_impl;
+    _G.ic_spawned->compress = _G.spawned_compress;
     _G.ic_spawned->do_el_unref = true;
     _G.ic_spawned->no_autodel = true;
     _G.ic_spawned->auto_reconn = false;
@@ -254,6 +355,105 @@ z_connect_ics_and_wait(ichannel_t *ic_client, const sockunion_t *su)
     Z_HELPER_END;
 }
 
+/* Send on the raw Unix socket fd an echoData query whose payload is stored
+ * in a memfd, as a peer with memfd_replies would do. */
+static int z_ic_send_memfd_query(int fd, uint32_t slot, lstr_t data,
+                                 bool sealed)
+{
+    t_scope;
+    IOP_RPC_T(tstiop_rpc__rpc, test, echo_data, args) arg = { .data = data };
+    const iop_rpc_t *rpc = IOP_RPC(tstiop_rpc__rpc, test, echo_data);
+    lstr_t payload = t_iop_bpack_struct(rpc->args, &arg);
+    char cbuf[CMSG_SPACE(sizeof(int))]
+        __attribute__((aligned(alignof(struct cmsghdr))));
+    struct cmsghdr *cmsg = (struct cmsghdr *)cbuf;
+    byte hdr[IC_MSG_HDR_LEN + 4];
+    struct iovec iov = MAKE_IOVEC(hdr, sizeof(hdr));
+    struct msghdr msgh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = cbuf,
+        .msg_controllen = sizeof(cbuf),
+    };
+    int memfd;
+
+    memfd = memfd_create("z-ic-payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    Z_ASSERT_N(memfd);
+    Z_ASSERT_N(xwrite(memfd, payload.s, payload.len));
+    if (sealed) {
+        Z_ASSERT_N(fcntl(memfd, F_ADD_SEALS,
+                         F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE));
+    }
+
+    put_unaligned_le32(hdr, slot | IC_MSG_HAS_FD | IC_MSG_IN_MEMFD);
+    put_unaligned_le32(hdr + IC_MSG_CMD_OFFSET,
+                       IOP_RPC_CMD(tstiop_rpc__rpc, test, echo_data));
+    put_unaligned_le32(hdr + IC_MSG_DLEN_OFFSET, 4);
+    put_unaligned_le32(hdr + IC_MSG_HDR_LEN, payload.len);
+
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+    Z_ASSERT_EQ(sendmsg(fd, &msgh, 0), ssizeof(hdr));
+
+    /* The sender keeps its descriptor, hence the seals. */
+    p_close(&memfd);
+    Z_HELPER_END;
+}
+
+/* Send the headers of a JSon query on the "upload" RPC of an HTTP server,
+ * the caller then writes the body. */
+static int z_ichttp_upload_start(in_port_t port, const char *auth, int clen,
+                                 int *fd)
+{
+    t_scope;
+    sockunion_t su;
+    lstr_t query;
+
+    Z_ASSERT_N(addr_resolve("ichttp", LSTR("127.0.0.1:1"), &su));
+    sockunion_setport(&su, port);
+    *fd = connectx(-1, &su, 1, SOCK_STREAM, IPPROTO_TCP, 0);
+    Z_ASSERT_N(*fd);
+
+    query = t_lstr_fmt("POST /iop/test/upload HTTP/1.1\r\n"
+                       "Host: 127.0.0.1\r\n"
+                       "Authorization: Basic %s\r\n"
+                       "Content-Type: application/json\r\n"
+                       "Content-Length: %d\r\n"
+                       "Connection: close\r\n"
+                       "\r\n", auth, clen);
+    Z_ASSERT_N(xwrite(*fd, query.s, query.len));
+    Z_HELPER_END;
+}
+
+static int z_ichttp_on_reply(el_t el, int fd, short events, data_t priv)
+{
+    int res = sb_read(priv.ptr, fd, 0);
+
+    if (res <= 0 && !(res < 0 && ERR_RW_RETRIABLE(errno))) {
+        el_unregister(&_G.http_el);
+    }
+    return 0;
+}
+
+/* Read the reply of an HTTP query until the server closes the
+ * connection. */
+static int z_ichttp_read_reply(int fd, sb_t *reply)
+{
+    Z_ASSERT_N(fd_set_features(fd, O_NONBLOCK));
+    _G.http_el = el_fd_register(fd, true, POLLIN, &z_ichttp_on_reply,
+                                reply);
+    for (int i = 0; _G.http_el && i < 1000; i++) {
+        el_loop_timeout(10);
+    }
+    if (_G.http_el) {
+        el_unregister(&_G.http_el);
+        Z_ASSERT(false, "timeout while reading the reply");
+    }
+    Z_HELPER_END;
+}
+
 /* }}} */
 /* {{{ Tests */
 
@@ -394,6 +594,230 @@ Z_GROUP_EXPORT(iop_rpc)
         }
     } Z_TEST_END;
 
+    Z_TEST(ic_impl_queue, "iop-rpc: implementations run on a thr queue") {
+        int sv[2];
+        ichannel_t *ic1 = ic_new();
+        ichannel_t *ic2 = ic_new();
+        qm_t(ic_cbs) impl = QM_INIT(ic_cbs, impl);
+        echo_ctx_t ctx[256];
+        time_t start_ts;
+
+        MODULE_REQUIRE(thr);
+        ic1->no_autodel = ic2->no_autodel = true;
+        ic1->iop_env = ic2->iop_env = _G.iop_env;
+        ic1->on_event = ic2->on_event = dummy_on_event;
+
+        Z_ASSERT_N(socketpairx(AF_UNIX, SOCK_STREAM, 0, O_NONBLOCK, sv));
+        ic_spawn(ic1, sv[0], NULL);
+        ic_spawn(ic2, sv[1], NULL);
+
+        ic_register(&impl, tstiop_rpc__rpc, test, echo);
+        ic2->impl = &impl;
+        ic2->impl_queue = thr_queue_create();
+
+        _G.main_thread = pthread_self();
+        _G.echo_rpc_answered = 0;
+        _G.echo_rpc_answered_off_main = 0;
+        _G.echo_rpc_cb_called = 0;
+        p_clear(ctx, countof(ctx));
+
+        for (int i = 0; i < countof(ctx); i++) {
+            ic_query2(ic1, ic_msg(echo_ctx_t *, &ctx[i]),
+                      tstiop_rpc__rpc, test, echo, i);
+        }
+        start_ts = lp_getsec();
+        while (_G.echo_rpc_cb_called < countof(ctx)
+           &&  lp_getsec() - start_ts <= 2)
+        {
+            el_loop_timeout(100);
+        }
+
+        /* The implementation ran out of the event loop, and the queries of
+         * the IC were processed in order. */
+        Z_ASSERT_EQ(_G.echo_rpc_answered, countof(ctx));
+        Z_ASSERT_EQ(_G.echo_rpc_answered_off_main, countof(ctx));
+        for (int i = 0; i < countof(ctx); i++) {
+            Z_ASSERT(ctx[i].has_answer, "no answer for query %d", i);
+            Z_ASSERT_EQ(ctx[i].received, i);
+            Z_ASSERT_EQ(ctx[i].rank, i);
+        }
+
+        thr_queue_destroy(ic2->impl_queue, true);
+        ic2->impl_queue = NULL;
+        ic_unregister(&impl, tstiop_rpc__rpc, test, echo);
+        qm_wipe(ic_cbs, &impl);
+        ic_delete(&ic1);
+        ic_delete(&ic2);
+        MODULE_RELEASE(thr);
+    } Z_TEST_END;
+
+    Z_TEST(ic_memfd_replies, "iop-rpc: large replies in a memfd") {
+        t_scope;
+        int sv[2];
+        ichannel_t *ic1 = ic_new();
+        ichannel_t *ic2 = ic_new();
+        qm_t(ic_cbs) impl = QM_INIT(ic_cbs, impl);
+        echo_data_ctx_t ctx;
+        lstr_t data;
+        time_t start_ts;
+
+        ic1->no_autodel = ic2->no_autodel = true;
+        ic1->iop_env = ic2->iop_env = _G.iop_env;
+        ic1->on_event = ic2->on_event = dummy_on_event;
+
+        Z_ASSERT_N(socketpairx(AF_UNIX, SOCK_STREAM, 0, O_NONBLOCK, sv));
+        ic_spawn(ic1, sv[0], NULL);
+        ic_spawn(ic2, sv[1], NULL);
+
+        ic_register(&impl, tstiop_rpc__rpc, test, echo_data);
+        ic2->impl = &impl;
+        ic2->memfd_replies = true;
+
+        /* Small replies are streamed on the socket, large ones go through a
+         * memfd; both must be received unchanged. */
+        for (int len = 16; len <= 4 * IC_MSG_MEMFD_MIN_LEN; len *= 64) {
+            data = LSTR_INIT_V(t_new_raw(char, len), len);
+            for (int i = 0; i < len; i++) {
+                data.v[i] = i * 7;
+            }
+
+            p_clear(&ctx, 1);
+            ic_query2(ic1, ic_msg(echo_data_ctx_t *, &ctx),
+                      tstiop_rpc__rpc, test, echo_data, data);
+            start_ts = lp_getsec();
+            while (!ctx.has_answer && lp_getsec() - start_ts <= 2) {
+                el_loop_timeout(100);
+            }
+            Z_ASSERT(ctx.has_answer, "no answer for length %d", len);
+            Z_ASSERT_LSTREQUAL(ctx.received, data);
+            Z_ASSERT(ic1->is_connected);
+            Z_ASSERT_NEG(ic1->current_fd);
+            lstr_wipe(&ctx.received);
+        }
+
+        ic_unregister(&impl, tstiop_rpc__rpc, test, echo_data);
+        qm_wipe(ic_cbs, &impl);
+        ic_delete(&ic1);
+        ic_delete(&ic2);
+    } Z_TEST_END;
+
+    Z_TEST(ic_memfd_seals, "iop-rpc: memfd payloads must be sealed") {
+        int sv[2];
+        ichannel_t *ic = ic_new();
+        qm_t(ic_cbs) impl = QM_INIT(ic_cbs, impl);
+        byte hdr[IC_MSG_HDR_LEN];
+        time_t start_ts;
+
+        ic->no_autodel = true;
+        ic->iop_env = _G.iop_env;
+        ic->on_event = dummy_on_event;
+
+        Z_ASSERT_N(socketpairx(AF_UNIX, SOCK_STREAM, 0, O_NONBLOCK, sv));
+        ic_spawn(ic, sv[1], NULL);
+        ic_register(&impl, tstiop_rpc__rpc, test, echo_data);
+        ic->impl = &impl;
+
+        /* A sealed memfd is read and the query is answered. */
+        Z_HELPER_RUN(z_ic_send_memfd_query(sv[0], 1, LSTR("sealed"), true));
+        start_ts = lp_getsec();
+        while (read(sv[0], hdr, sizeof(hdr)) != sizeof(hdr)
+           &&  lp_getsec() - start_ts <= 2)
+        {
+            el_loop_timeout(100);
+        }
+        Z_ASSERT_EQ(get_unaligned_le32(hdr) & IC_MSG_SLOT_MASK, 1U);
+        Z_ASSERT_EQ((int)get_unaligned_le32(hdr + IC_MSG_CMD_OFFSET),
+                    IC_MSG_OK);
+        Z_ASSERT(ic->is_connected);
+
+        /* The peer could truncate or modify an unsealed memfd while it is
+         * read: the connection is dropped. */
+        Z_HELPER_RUN(z_ic_send_memfd_query(sv[0], 2, LSTR("unsealed"),
+                                           false));
+        start_ts = lp_getsec();
+        while (ic->is_connected && lp_getsec() - start_ts <= 2) {
+            el_loop_timeout(100);
+        }
+        Z_ASSERT(!ic->is_connected);
+        Z_ASSERT_NEG(ic->current_fd);
+
+        ic_unregister(&impl, tstiop_rpc__rpc, test, echo_data);
+        qm_wipe(ic_cbs, &impl);
+        ic_delete(&ic);
+        p_close(&sv[0]);
+    } Z_TEST_END;
+
+    Z_TEST(ic_seqpacket_batch, "iop-rpc: batched reads and writes") {
+        t_scope;
+        int sv[2];
+        ichannel_t *ic1 = ic_new();
+        ichannel_t *ic2 = ic_new();
+        qm_t(ic_cbs) impl = QM_INIT(ic_cbs, impl);
+        echo_ctx_t ctx[1024];
+        echo_data_ctx_t data_ctx;
+        lstr_t data;
+        time_t start_ts;
+
+        ic1->no_autodel = ic2->no_autodel = true;
+        ic1->iop_env = ic2->iop_env = _G.iop_env;
+        ic1->on_event = ic2->on_event = dummy_on_event;
+
+        Z_ASSERT_N(socketpairx(AF_UNIX, SOCK_SEQPACKET, 0, O_NONBLOCK, sv));
+        ic_spawn(ic1, sv[0], NULL);
+        ic_spawn(ic2, sv[1], NULL);
+        Z_ASSERT(ic1->is_seqpacket && ic2->is_seqpacket);
+
+        ic_register(&impl, tstiop_rpc__rpc, test, echo);
+        ic_register(&impl, tstiop_rpc__rpc, test, echo_data);
+        ic2->impl = &impl;
+
+        /* A storm of small queries is read by batches of packets. */
+        _G.echo_rpc_cb_called = 0;
+        p_clear(ctx, countof(ctx));
+        for (int i = 0; i < countof(ctx); i++) {
+            ic_query2(ic1, ic_msg(echo_ctx_t *, &ctx[i]),
+                      tstiop_rpc__rpc, test, echo, i);
+        }
+        start_ts = lp_getsec();
+        while (_G.echo_rpc_cb_called < countof(ctx)
+           &&  lp_getsec() - start_ts <= 2)
+        {
+            el_loop_timeout(100);
+        }
+        for (int i = 0; i < countof(ctx); i++) {
+            Z_ASSERT(ctx[i].has_answer, "no answer for query %d", i);
+            Z_ASSERT_EQ(ctx[i].received, i);
+        }
+        Z_ASSERT_EQ(ic2->iostats.msgs_in, countof(ctx));
+        Z_ASSERT_LT(ic2->iostats.read_calls, ic2->iostats.msgs_in);
+        Z_ASSERT_LT(ic2->iostats.write_calls, ic2->iostats.msgs_out);
+
+        /* Messages larger than a packet are split and sent by batches. */
+        for (int len = 16; len <= 16 * IC_PKT_MAX; len *= 16) {
+            data = LSTR_INIT_V(t_new_raw(char, len), len);
+            for (int i = 0; i < len; i++) {
+                data.v[i] = i * 7;
+            }
+
+            p_clear(&data_ctx, 1);
+            ic_query2(ic1, ic_msg(echo_data_ctx_t *, &data_ctx),
+                      tstiop_rpc__rpc, test, echo_data, data);
+            start_ts = lp_getsec();
+            while (!data_ctx.has_answer && lp_getsec() - start_ts <= 2) {
+                el_loop_timeout(100);
+            }
+            Z_ASSERT(data_ctx.has_answer, "no answer for length %d", len);
+            Z_ASSERT_LSTREQUAL(data_ctx.received, data);
+            lstr_wipe(&data_ctx.received);
+        }
+
+        ic_unregister(&impl, tstiop_rpc__rpc, test, echo);
+        ic_unregister(&impl, tstiop_rpc__rpc, test, echo_data);
+        qm_wipe(ic_cbs, &impl);
+        ic_delete(&ic1);
+        ic_delete(&ic2);
+    } Z_TEST_END;
+
     Z_TEST(ic_local_async, "iop-rpc: ic local async") {
         ichannel_t ic;
         qm_t(ic_cbs) impl = QM_INIT(ic_cbs, impl);
@@ -507,6 +931,276 @@ Z_GROUP_EXPORT(iop_rpc)
         el_unregister(&server_ev);
     } Z_TEST_END;
 
+    Z_TEST(ic_compression, "iop-rpc: compressed messages") {
+        t_scope;
+        el_t server_ev;
+        ichannel_t ic_client;
+        qm_t(ic_cbs) impl = QM_INIT(ic_cbs, impl);
+        echo_data_ctx_t ctx;
+        t_SB(sb, 64 << 10);
+        time_t start_ts;
+        int port;
+        sockunion_t su = {
+            .sin = {
+                .sin_family = AF_INET,
+                .sin_addr = { .s_addr = htonl(INADDR_LOOPBACK) },
+            }
+        };
+
+        ic_register(&impl, tstiop_rpc__rpc, test, echo_data);
+        _G.spawned_impl = &impl;
+        _G.spawned_compress = true;
+
+        server_ev = ic_listento(&su, SOCK_STREAM, IPPROTO_TCP,
+                                &z_ic_on_accept);
+        Z_ASSERT_P(server_ev);
+
+        port = getsockport(el_fd_get_fd(server_ev), AF_INET);
+        sockunion_setport(&su, port);
+
+        Z_HELPER_RUN(z_connect_ics_and_wait(&ic_client, &su));
+        Z_ASSERT(_G.ic_spawned->peer_compress);
+        Z_ASSERT(ic_client.peer_compress);
+        ic_client.compress = true;
+
+        /* Small payloads are never compressed. */
+        p_clear(&ctx, 1);
+        ic_query2(&ic_client, ic_msg(echo_data_ctx_t *, &ctx),
+                  tstiop_rpc__rpc, test, echo_data, LSTR("small"));
+        start_ts = lp_getsec();
+        while (!ctx.has_answer && lp_getsec() - start_ts <= 2) {
+            el_loop_timeout(100);
+        }
+        Z_ASSERT(ctx.has_answer);
+        Z_ASSERT_LSTREQUAL(ctx.received, LSTR("small"));
+        Z_ASSERT_ZERO(ic_client.zstats.raw_out);
+        Z_ASSERT_ZERO(ic_client.zstats.raw_in);
+        lstr_wipe(&ctx.received);
+
+        /* A highly redundant payload is compressed both ways. */
+        while (sb.len < 64 << 10) {
+            sb_addf(&sb, "compressed ichannel payload %d; ", sb.len % 7);
+        }
+        p_clear(&ctx, 1);
+        ic_query2(&ic_client, ic_msg(echo_data_ctx_t *, &ctx),
+                  tstiop_rpc__rpc, test, echo_data, LSTR_SB_V(&sb));
+        start_ts = lp_getsec();
+        while (!ctx.has_answer && lp_getsec() - start_ts <= 2) {
+            el_loop_timeout(100);
+        }
+        Z_ASSERT(ctx.has_answer);
+        Z_ASSERT_LSTREQUAL(ctx.received, LSTR_SB_V(&sb));
+        lstr_wipe(&ctx.received);
+
+        Z_ASSERT_GE(ic_client.zstats.raw_out, (uint64_t)sb.len);
+        Z_ASSERT_LT(ic_client.zstats.zip_out, ic_client.zstats.raw_out / 4);
+        Z_ASSERT_EQ(_G.ic_spawned->zstats.raw_in, ic_client.zstats.raw_out);
+        Z_ASSERT_EQ(_G.ic_spawned->zstats.zip_in, ic_client.zstats.zip_out);
+        Z_ASSERT_EQ(ic_client.zstats.raw_in,
+                    _G.ic_spawned->zstats.raw_out);
+        Z_ASSERT_GE(ic_client.zstats.raw_in, (uint64_t)sb.len);
+
+        ic_wipe(&ic_client);
+        ic_delete(&_G.ic_spawned);
+        el_unregister(&server_ev);
+        _G.spawned_impl = NULL;
+        _G.spawned_compress = false;
+        ic_unregister(&impl, tstiop_rpc__rpc, test, echo_data);
+        qm_wipe(ic_cbs, &impl);
+    } Z_TEST_END;
+
+    Z_TEST(ichttp_stream, "iop-rpc-http: streamed query elements") {
+        t_scope;
+        httpd_trigger__ic_t *tcb;
+        httpd_cfg_t *cfg;
+        sockunion_t su;
+        el_t server;
+        in_port_t port;
+        lstr_t body1 = LSTR("{\"count\":3,\"elems\":[{\"i\":0},{\"i\":1},");
+        lstr_t body2 = LSTR("{\"i\":2}]}");
+        int clen = body1.len + body2.len;
+        int fd;
+        SB_1k(reply);
+
+        MODULE_REQUIRE(http);
+        sb_init(&_G.http_trace);
+
+        cfg = httpd_cfg_new();
+        tcb = httpd_trigger__ic_new(_G.iop_env, &tstiop_rpc__rpc__mod,
+                                    "http://example.com/tstiop_rpc",
+                                    1 << 20);
+        httpd_trigger_register(cfg, POST, "iop", &tcb->cb);
+        ichttp_register_pre_post_hook(tcb, tstiop_rpc__rpc, test, upload,
+                                      &z_ichttp_pre_hook,
+                                      &z_ichttp_post_hook,
+                                      (data_t){ }, (data_t){ });
+        Z_ASSERT_N(ichttp_register_stream(tcb, LSTR("test/upload"),
+                                          LSTR("elems"),
+                                          &z_ichttp_on_upload_elem));
+
+        Z_ASSERT_N(addr_resolve("ichttp", LSTR("127.0.0.1:1"), &su));
+        sockunion_setport(&su, 0);
+        Z_ASSERT_P((server = httpd_listen(&su, cfg)));
+        httpd_cfg_delete(&cfg);
+        port = getsockport(el_fd_get_fd(server), AF_INET);
+
+        /* The pre-hook checks the query before its first element, and the
+         * elements are handed over as soon as they are received. */
+        Z_HELPER_RUN(z_ichttp_upload_start(port, "dXNlcjpwYXNz", clen,
+                                           &fd));
+        Z_ASSERT_N(xwrite(fd, body1.s, body1.len));
+        for (int i = 0; i < 100 && !strstr(_G.http_trace.data, "elem:1;");
+             i++)
+        {
+            el_loop_timeout(10);
+        }
+        Z_ASSERT_STREQUAL(_G.http_trace.data, "pre;elem:0;elem:1;");
+
+        /* The RPC gets the header checked by the pre-hook, with the length
+         * of the whole body, and the post-hook is called with its reply. */
+        Z_ASSERT_N(xwrite(fd, body2.s, body2.len));
+        Z_HELPER_RUN(z_ichttp_read_reply(fd, &reply));
+        Z_ASSERT_STREQUAL(_G.http_trace.data,
+                          t_fmt("pre;elem:0;elem:1;elem:2;"
+                                "rpc:3:0:user:%d;post:%d;", clen,
+                                IC_MSG_OK));
+        Z_ASSERT(lstr_startswith(LSTR_SB_V(&reply),
+                                 LSTR("HTTP/1.1 200 OK\r\n")));
+        Z_ASSERT_P(strstr(reply.data, "{\"count\":3}"), "%*pM",
+                   SB_FMT_ARG(&reply));
+
+        /* Queries rejected by the pre-hook are not streamed. */
+        sb_reset(&_G.http_trace);
+        sb_reset(&reply);
+        Z_HELPER_RUN(z_ichttp_upload_start(port, "dXNlcjpiYWQ=", clen,
+                                           &fd));
+        Z_ASSERT_N(xwrite(fd, body1.s, body1.len));
+        Z_ASSERT_N(xwrite(fd, body2.s, body2.len));
+        Z_HELPER_RUN(z_ichttp_read_reply(fd, &reply));
+        Z_ASSERT_STREQUAL(_G.http_trace.data, "pre;");
+        Z_ASSERT(lstr_startswith(LSTR_SB_V(&reply),
+                                 LSTR("HTTP/1.1 403 ")));
+
+        httpd_unlisten(&server);
+        sb_wipe(&_G.http_trace);
+        MODULE_RELEASE(http);
+    } Z_TEST_END;
+
+    Z_TEST(http_iop_batch, "iop-rpc-http: batched queries") {
+        t_scope;
+        httpd_trigger__ic_t *tcb;
+        httpd_cfg_t *httpd_cfg;
+        core__httpc_cfg__t httpc_cfg;
+        http_iop_channel_cfg_t cfg;
+        http_iop_channel_t *channel;
+        lstr_t url;
+        sockunion_t su;
+        el_t server;
+        z_http_echo_t echo[4];
+        int values[] = { 0, 1, -1, 2 };
+        SB_1k(err);
+
+        MODULE_REQUIRE(http);
+        sb_init(&_G.http_trace);
+        p_clear(echo, countof(echo));
+
+        httpd_cfg = httpd_cfg_new();
+        tcb = httpd_trigger__ic_new(_G.iop_env, &tstiop_rpc__rpc__mod,
+                                    "http://example.com/tstiop_rpc",
+                                    1 << 20);
+        tcb->batch_max = 8;
+        httpd_trigger_register(httpd_cfg, POST, "iop", &tcb->cb);
+        ichttp_register_(tcb, tstiop_rpc__rpc, test, echo, &z_ichttp_echo);
+
+        Z_ASSERT_N(addr_resolve("ichttp", LSTR("127.0.0.1:1"), &su));
+        sockunion_setport(&su, 0);
+        Z_ASSERT_P((server = httpd_listen(&su, httpd_cfg)));
+        httpd_cfg_delete(&httpd_cfg);
+
+        iop_init(core__httpc_cfg, &httpc_cfg);
+        url = t_lstr_fmt("http://127.0.0.1:%d/iop",
+                         getsockport(el_fd_get_fd(server), AF_INET));
+        cfg = (http_iop_channel_cfg_t){
+            .name      = LSTR("z-batch"),
+            .urls      = IOP_TYPED_ARRAY(lstr, &url, 1),
+            .iop_env   = _G.iop_env,
+            .iop_cfg   = &httpc_cfg,
+            .batch_max = OPT(3),
+        };
+        Z_ASSERT_P((channel = http_iop_channel_create(&cfg, &err)),
+                   "%*pM", SB_FMT_ARG(&err));
+
+        /* A lone query is not batched; it opens the connection. */
+        http_iop_query_cb(channel, http_iop_msg(z_http_echo_t *, &echo[0]),
+                          &z_http_iop_echo_cb, tstiop_rpc__rpc, test, echo,
+                          .i = values[0]);
+        for (int i = 0; i < 100 && !echo[0].has_answer; i++) {
+            el_loop_timeout(10);
+        }
+        Z_ASSERT(echo[0].has_answer);
+        Z_ASSERT_EQ(echo[0].status, IC_MSG_OK);
+        Z_ASSERT_EQ(echo[0].received, values[0]);
+
+        /* The next ones fill a batch, which is sent as soon as it is
+         * full. The calls are run in order, and each callback gets the
+         * result of its own query, including the refused one. */
+        for (int i = 1; i < countof(echo); i++) {
+            http_iop_query_cb(channel,
+                              http_iop_msg(z_http_echo_t *, &echo[i]),
+                              &z_http_iop_echo_cb, tstiop_rpc__rpc, test,
+                              echo, .i = values[i]);
+        }
+        Z_ASSERT_ZERO(channel->batch_len);
+        for (int i = 0; i < 100 && !echo[countof(echo) - 1].has_answer;
+             i++)
+        {
+            el_loop_timeout(10);
+        }
+        Z_ASSERT_STREQUAL(_G.http_trace.data,
+                          "echo:0:0;echo:1:1;echo:-1:1;echo:2:1;");
+        for (int i = 1; i < countof(echo); i++) {
+            Z_ASSERT(echo[i].has_answer, "query %d", i);
+            if (values[i] < 0) {
+                Z_ASSERT_EQ(echo[i].status, IC_MSG_INVALID);
+                Z_ASSERT_EQ(echo[i].code, HTTP_CODE_NOT_FOUND);
+            } else {
+                Z_ASSERT_EQ(echo[i].status, IC_MSG_OK);
+                Z_ASSERT_EQ(echo[i].code, HTTP_CODE_OK);
+                Z_ASSERT_EQ(echo[i].received, values[i]);
+            }
+        }
+
+        http_iop_channel_delete(&channel);
+        httpd_unlisten(&server);
+        sb_wipe(&_G.http_trace);
+        MODULE_RELEASE(http);
+    } Z_TEST_END;
+
+    Z_TEST(ichttp_batch_split, "iop-rpc-http: split of batch arrays") {
+        t_scope;
+        qv_t(pstream) elems;
+
+        t_qv_init(&elems, 4);
+        Z_ASSERT_N(__ichttp_json_split_array(ps_initstr(" [ ] "), &elems));
+        Z_ASSERT_EQ(elems.len, 0);
+
+        Z_ASSERT_N(__ichttp_json_split_array(ps_initstr(
+            "[[\"iface/f\", {\"i\": 1}], [\"iface/f\",{\"s\":\"],\\\"\"}] ]"),
+            &elems));
+        Z_ASSERT_EQ(elems.len, 2);
+        Z_ASSERT_LSTREQUAL(LSTR_PS_V(&elems.tab[0]),
+                           LSTR("[\"iface/f\", {\"i\": 1}]"));
+        Z_ASSERT_LSTREQUAL(LSTR_PS_V(&elems.tab[1]),
+                           LSTR("[\"iface/f\",{\"s\":\"],\\\"\"}]"));
+
+        qv_clear(&elems);
+        Z_ASSERT_NEG(__ichttp_json_split_array(ps_initstr("[1, 2"), &elems));
+        Z_ASSERT_NEG(__ichttp_json_split_array(ps_initstr("[1}"), &elems));
+        Z_ASSERT_NEG(__ichttp_json_split_array(ps_initstr("[1] 2"),
+                                               &elems));
+        Z_ASSERT_NEG(__ichttp_json_split_array(ps_initstr("{}"), &elems));
+    } Z_TEST_END;
+
     MODULE_RELEASE(ic);
     iop_env_delete(&_G.iop_env);
 } Z_GROUP_END;
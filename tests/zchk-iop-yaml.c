@@ -1053,12 +1053,12 @@ Z_GROUP_EXPORT(iop_yaml)
         TST(&tstiop__struct_with_child_class__s,
             "myClass:\n"
             "  i: 1\n"
-            "  d: 3.1000000000000041",
+            "  d: 3.100000000000004",
             NULL);
         TST(&tstiop__struct_with_child_inherit_typedef__s,
             "myClass:\n"
             "  i: 1\n"
-            "  d: 3.1000000000000041",
+            "  d: 3.100000000000004",
             NULL);
 
         /* unpacking a remote typedef class should work */
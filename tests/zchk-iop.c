@@ -1616,6 +1616,66 @@ static int z_check_static_field_type(const iop_struct_t *st,
     Z_HELPER_END;
 }
 
+/* }}} */
+/* {{{ iop_junpack_stream */
+
+static int z_iop_junpack_stream_on_elem(void *priv, const iop_field_t *fdesc,
+                                        const void *elem)
+{
+    qv_t(i32) *vals = priv;
+    const tstiop__my_struct_b__t *sb = elem;
+
+    if (!sb->a.has_field || sb->b.len != sb->a.v) {
+        return -1;
+    }
+    if (sb->a.v == 666) {
+        /* Reject this element. */
+        return -1;
+    }
+    qv_append(vals, sb->a.v);
+    return 0;
+}
+
+/* Feed the streaming unpacker by chunks of the given size, and check the
+ * streamed elements and the final value. */
+static int z_iop_junpack_stream(lstr_t json, int chunk_size, int nb_elems)
+{
+    t_scope;
+    iop_junpack_stream_t *js;
+    tstiop__my_struct_f__t *sf = NULL;
+    qv_t(i32) vals;
+    pstream_t ps = ps_initlstr(&json);
+    SB_1k(err);
+
+    qv_init(&vals);
+    js = iop_junpack_stream_new(_G.iop_env, &tstiop__my_struct_f__s,
+                                LSTR("c"), 0, 0,
+                                &z_iop_junpack_stream_on_elem, &vals, &err);
+    Z_ASSERT_P(js, "%*pM", SB_FMT_ARG(&err));
+
+    while (!ps_done(&ps)) {
+        pstream_t chunk = __ps_get_ps(&ps, MIN(chunk_size, ps_len(&ps)));
+
+        Z_ASSERT_N(iop_junpack_stream_feed(js, chunk, &err),
+                   "%*pM", SB_FMT_ARG(&err));
+    }
+    Z_ASSERT_N(t_iop_junpack_stream_end(js, (void **)&sf, &err),
+               "%*pM", SB_FMT_ARG(&err));
+
+    Z_ASSERT_EQ(vals.len, nb_elems);
+    tab_enumerate(i, v, &vals) {
+        Z_ASSERT_EQ(v, i);
+    }
+    Z_ASSERT_EQ(sf->a.len, 2);
+    Z_ASSERT_LSTREQUAL(sf->a.tab[0], LSTR("fo\"o"));
+    Z_ASSERT_LSTREQUAL(sf->a.tab[1], LSTR("b[a]r"));
+    Z_ASSERT_EQ(sf->c.len, 0);
+
+    iop_junpack_stream_delete(&js);
+    qv_wipe(&vals);
+    Z_HELPER_END;
+}
+
 /* }}} */
 
 /* }}} */
@@ -2931,6 +2991,189 @@ Z_GROUP_EXPORT(iop)
         Z_ASSERT_STREQUAL(sb.data, json_sn_strint);
     } Z_TEST_END
     /* }}} */
+    Z_TEST(json_lexer_fast_paths, "test JSON lexer string/integer paths") { /* {{{ */
+        t_scope;
+        tstiop__my_struct_n__t sn;
+        tstiop__my_struct_a_opt__t sa;
+
+        /* Integers around the limits of the decimal fast path. */
+        sn = (tstiop__my_struct_n__t){
+            .u = 999999999999999999ull,
+            .i = -999999999999999999ll,
+        };
+        Z_HELPER_RUN(iop_json_test_json(&tstiop__my_struct_n__s,
+                                        "{ u: 999999999999999999, "
+                                        "i: -999999999999999999 }",
+                                        &sn, "18 digits"));
+        sn = (tstiop__my_struct_n__t){
+            .u = 18446744073709551615ull,
+            .i = -1000000000000000000ll,
+        };
+        Z_HELPER_RUN(iop_json_test_json(&tstiop__my_struct_n__s,
+                                        "{ u: 18446744073709551615, "
+                                        "i: -1000000000000000000 }",
+                                        &sn, "19+ digits"));
+        sn = (tstiop__my_struct_n__t){ .u = 8, .i = 0 };
+        Z_HELPER_RUN(iop_json_test_json(&tstiop__my_struct_n__s,
+                                        "{ u: 010, i: -0 }",
+                                        &sn, "octal and zero"));
+        sn = (tstiop__my_struct_n__t){ .u = 2048, .i = -12 };
+        Z_HELPER_RUN(iop_json_test_json(&tstiop__my_struct_n__s,
+                                        "{ u: 2K, i: -10-2 }",
+                                        &sn, "suffix and expression"));
+        Z_HELPER_RUN(iop_json_test_unpack(&tstiop__my_struct_n__s,
+                                          "{ u: 12.5, i: 0 }", 0, false,
+                                          "double in integer field"));
+
+        /* Strings with escapes and terminators on both sides of 16-bytes
+         * block boundaries. */
+        iop_init(tstiop__my_struct_a_opt, &sa);
+        sa.j = LSTR("0123456789abcde\"0123456789abcdef"
+                    "0123456789abcdef0123456789abcde\\");
+        Z_HELPER_RUN(iop_json_test_json(&tstiop__my_struct_a_opt__s,
+                                        "{ j: \"0123456789abcde\\\"0123456789"
+                                        "abcdef0123456789abcdef0123456789"
+                                        "abcde\\\\\" }",
+                                        &sa, "escapes"));
+        sa.j = LSTR("0123456789abcdef0123456789abcde");
+        Z_HELPER_RUN(iop_json_test_json(&tstiop__my_struct_a_opt__s,
+                                        "{ j: \"0123456789abcdef0123456789"
+                                        "abcde\" }",
+                                        &sa, "no escape"));
+        Z_HELPER_RUN(iop_json_test_unpack(&tstiop__my_struct_a_opt__s,
+                                          "{ j: \"0123456789abcdef0123\n"
+                                          "456789abcde\" }", 0, false,
+                                          "newline in string"));
+        Z_HELPER_RUN(iop_json_test_unpack(&tstiop__my_struct_a_opt__s,
+                                          "{ j: \"0123456789abcdef0123456789",
+                                          0, false, "unclosed string"));
+    } Z_TEST_END
+    /* }}} */
+    Z_TEST(json_jpack_buffered, "test JSON packer output buffering") { /* {{{ */
+        t_scope;
+        tstiop__my_struct_f__t sf;
+        tstiop__my_struct_a_opt__t sa;
+        lstr_t *strs = t_new(lstr_t, 2000);
+        double doubles[] = {
+            0., -0., 1., -1., 42., 0.5, -1e-300, 1e300, 123456789012345.,
+            9007199254740991., 9007199254740992., -9007199254740992.,
+            1e17, 3.14159265, 0.1, 1. / 3, 5e-324, 1.7976931348623157e308,
+        };
+        SB_1k(direct);
+        SB_1k(cb);
+
+        /* Output much bigger than the staging buffer, with tokens crossing
+         * its boundaries. */
+        for (int i = 0; i < 2000; i++) {
+            strs[i] = t_lstr_fmt("%*pM string number %d with a ünicode char",
+                                 i % 64, "0123456789abcdef0123456789abcdef"
+                                 "0123456789abcdef0123456789abcdef", i);
+        }
+        iop_init(tstiop__my_struct_f, &sf);
+        sf.a = IOP_TYPED_ARRAY(lstr, strs, 2000);
+
+        Z_ASSERT_N(iop_sb_jpack(&direct, &tstiop__my_struct_f__s, &sf, 0));
+        Z_ASSERT_N(iop_jpack(&tstiop__my_struct_f__s, &sf, &iop_sb_write,
+                             &cb, 0));
+        Z_ASSERT_GT(direct.len, 64 << 10);
+        Z_ASSERT_LSTREQUAL(LSTR_SB_V(&direct), LSTR_SB_V(&cb));
+
+        /* Doubles must be packed with the shortest digits reading back to
+         * the same value. */
+        carray_for_each_entry(d, doubles) {
+            char buf[DTOA_SHORTEST_LEN];
+            double res;
+
+            iop_init(tstiop__my_struct_a_opt, &sa);
+            OPT_SET(sa.m, d);
+            sb_reset(&direct);
+            Z_ASSERT_N(iop_sb_jpack(&direct, &tstiop__my_struct_a_opt__s,
+                                    &sa, IOP_JPACK_MINIMAL));
+            dtoa_shortest(buf, d);
+            Z_ASSERT_STREQUAL(direct.data, t_fmt("{\"m\":%s}", buf));
+            res = strtod(buf, NULL);
+            Z_ASSERT(memcmp(&res, &d, sizeof(d)) == 0, "%s", buf);
+        }
+    } Z_TEST_END
+    /* }}} */
+    Z_TEST(json_stream, "test incremental JSON unpacking") { /* {{{ */
+        t_scope;
+        SB_1k(json);
+        SB_1k(err);
+        iop_junpack_stream_t *js;
+        tstiop__my_struct_f__t *sf = NULL;
+
+        sb_adds(&json, "{\n  c: [\n");
+        for (int i = 0; i < 100; i++) {
+            sb_addf(&json, "    { \"a\": %d, \"b\": [", i);
+            for (int j = 0; j < i; j++) {
+                sb_addf(&json, "%s%d", j ? ", " : "", j);
+            }
+            sb_adds(&json, "] },\n");
+        }
+        sb_adds(&json, "  ],\n  'a' = [ \"fo\\\"o\", 'b[a]r' ];\n}\n");
+
+        Z_HELPER_RUN(z_iop_junpack_stream(LSTR_SB_V(&json), 1, 100));
+        Z_HELPER_RUN(z_iop_junpack_stream(LSTR_SB_V(&json), 7, 100));
+        Z_HELPER_RUN(z_iop_junpack_stream(LSTR_SB_V(&json), 4096, 100));
+
+        /* Field absent */
+        Z_HELPER_RUN(z_iop_junpack_stream(LSTR("{ a: [ \"fo\\\"o\", "
+                                               "\"b[a]r\" ] }"), 3, 0));
+
+        /* Invalid fields */
+        Z_ASSERT_NULL(iop_junpack_stream_new(_G.iop_env,
+                                             &tstiop__my_struct_f__s,
+                                             LSTR("a"), 0, 0,
+                                             &z_iop_junpack_stream_on_elem,
+                                             NULL, NULL));
+        Z_ASSERT_NULL(iop_junpack_stream_new(_G.iop_env,
+                                             &tstiop__my_struct_f__s,
+                                             LSTR("z"), 0, 0,
+                                             &z_iop_junpack_stream_on_elem,
+                                             NULL, NULL));
+
+        /* Errors: invalid element, rejected element, maximum size,
+         * truncated document. */
+        {
+            qv_t(i32) vals;
+            const char *invalid[] = {
+                "{ c: [ { a: 0, b: [] }, { a: 1, b: [ 0 ], d: 1 } ] }",
+                "{ c: [ { a: 666, b: [] } ] }",
+                "{ c: [ { a: 0, b: [] }, { a: 1, b: [ 0 ] }, ",
+            };
+
+            qv_init(&vals);
+            carray_for_each_entry(doc, invalid) {
+                js = iop_junpack_stream_new(_G.iop_env,
+                                            &tstiop__my_struct_f__s,
+                                            LSTR("c"), 0, 0,
+                                            &z_iop_junpack_stream_on_elem,
+                                            &vals, NULL);
+                Z_ASSERT_P(js);
+                sb_reset(&err);
+                if (iop_junpack_stream_feed(js, ps_initstr(doc), &err) >= 0)
+                {
+                    Z_ASSERT_NEG(t_iop_junpack_stream_end(js, (void **)&sf,
+                                                          &err), "%s", doc);
+                }
+                Z_ASSERT(err.len, "%s", doc);
+                iop_junpack_stream_delete(&js);
+            }
+
+            js = iop_junpack_stream_new(_G.iop_env, &tstiop__my_struct_f__s,
+                                        LSTR("c"), 0, 32,
+                                        &z_iop_junpack_stream_on_elem,
+                                        &vals, NULL);
+            Z_ASSERT_N(iop_junpack_stream_feed(js, ps_initstr("{ c: ["),
+                                               NULL));
+            Z_ASSERT_NEG(iop_junpack_stream_feed(js, ps_initstr(
+                "{ a: 10, b: [ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 ] }"), NULL));
+            iop_junpack_stream_delete(&js);
+            qv_wipe(&vals);
+        }
+    } Z_TEST_END
+    /* }}} */
     Z_TEST(json_big_bytes, "test JSON packing big bytes fields") { /* {{{ */
         SB_1k(sb);
         tstiop__my_struct_a_opt__t sn;
@@ -4681,6 +4924,95 @@ Z_GROUP_EXPORT(iop)
 #undef ADD_PARAM
 #undef SORT_AND_CHECK
 
+    } Z_TEST_END;
+    /* }}} */
+    Z_TEST(iop_msort_large, "test IOP sorting of large arrays") { /* {{{ */
+        t_scope;
+        qv_t(my_struct_a_opt) vec;
+        qv_t(iop_sort) params;
+        int len = 5000;
+
+        t_qv_init(&vec, len);
+        t_qv_init(&params, 2);
+
+#define ADD_PARAM(_field, _flags)  do {                                      \
+        qv_append(&params, ((iop_sort_t){                                    \
+            .field_path = LSTR(_field),                                      \
+            .flags = _flags,                                                 \
+        }));                                                                 \
+    } while (0)
+
+        for (int i = 0; i < len; i++) {
+            tstiop__my_struct_a_opt__t *v = qv_growlen(&vec, 1);
+
+            iop_init(tstiop__my_struct_a_opt, v);
+            if (i % 7) {
+                OPT_SET(v->a, rand() % 100 - 50);
+            }
+            OPT_SET(v->g, (int64_t)rand() * (rand() % 2 ? 1 : -1));
+            if (i % 13) {
+                OPT_SET(v->m, (rand() % 2000 - 1000) / 7.);
+            } else {
+                /* -0.0 and +0.0 are equal. */
+                OPT_SET(v->m, i % 2 ? -0. : 0.);
+            }
+            OPT_SET(v->p, i);
+        }
+
+        /* Sort on a signed integer, using the position as second key. */
+        ADD_PARAM("a", IOP_SORT_REVERSE | IOP_SORT_NULL_FIRST);
+        ADD_PARAM("p", 0);
+        Z_ASSERT_N(iop_msort(_G.iop_env, tstiop__my_struct_a_opt, vec.tab,
+                             vec.len, &params, NULL));
+        for (int i = 0; i < len / 7 + 1; i++) {
+            Z_ASSERT(!OPT_ISSET(vec.tab[i].a), "%d", i);
+        }
+        for (int i = 1; i < len; i++) {
+            const tstiop__my_struct_a_opt__t *prev = &vec.tab[i - 1];
+            const tstiop__my_struct_a_opt__t *cur = &vec.tab[i];
+
+            if (!OPT_ISSET(cur->a)) {
+                Z_ASSERT(!OPT_ISSET(prev->a));
+                Z_ASSERT_LT(OPT_VAL(prev->p), OPT_VAL(cur->p));
+                continue;
+            }
+            if (OPT_ISSET(prev->a)) {
+                Z_ASSERT_GE(OPT_VAL(prev->a), OPT_VAL(cur->a));
+                if (OPT_VAL(prev->a) == OPT_VAL(cur->a)) {
+                    Z_ASSERT_LT(OPT_VAL(prev->p), OPT_VAL(cur->p));
+                }
+            }
+        }
+
+        /* Sort on a signed 64 bits integer. */
+        qv_clear(&params);
+        ADD_PARAM("g", 0);
+        Z_ASSERT_N(iop_msort(_G.iop_env, tstiop__my_struct_a_opt, vec.tab,
+                             vec.len, &params, NULL));
+        for (int i = 1; i < len; i++) {
+            Z_ASSERT_LE(OPT_VAL(vec.tab[i - 1].g), OPT_VAL(vec.tab[i].g));
+        }
+
+        /* Sort on a double; the sort is stable. */
+        qv_clear(&params);
+        ADD_PARAM("p", 0);
+        Z_ASSERT_N(iop_msort(_G.iop_env, tstiop__my_struct_a_opt, vec.tab,
+                             vec.len, &params, NULL));
+        qv_clear(&params);
+        ADD_PARAM("m", 0);
+        Z_ASSERT_N(iop_msort(_G.iop_env, tstiop__my_struct_a_opt, vec.tab,
+                             vec.len, &params, NULL));
+        for (int i = 1; i < len; i++) {
+            const tstiop__my_struct_a_opt__t *prev = &vec.tab[i - 1];
+            const tstiop__my_struct_a_opt__t *cur = &vec.tab[i];
+
+            Z_ASSERT_LE(OPT_VAL(prev->m), OPT_VAL(cur->m));
+            if (OPT_VAL(prev->m) == OPT_VAL(cur->m)) {
+                Z_ASSERT_LT(OPT_VAL(prev->p), OPT_VAL(cur->p));
+            }
+        }
+
+#undef ADD_PARAM
     } Z_TEST_END;
     /* }}} */
     Z_TEST(iop_msort_class_array, "test IOP multi sorting on a class array") { /* {{{ */
@@ -4840,6 +5172,45 @@ Z_GROUP_EXPORT(iop)
 
     } Z_TEST_END;
     /* }}} */
+    Z_TEST(iop_filter_large, "test IOP filtering of large arrays") { /* {{{ */
+        t_scope;
+        int len = 100000;
+        int len_mono = len;
+        int len_thr = len;
+        int v3 = 3;
+        int v7 = 7;
+        void *values[] = { &v3, &v7 };
+        tstiop__filtered_struct__t *vec_mono;
+        tstiop__filtered_struct__t *vec_thr;
+
+        vec_mono = t_new_raw(tstiop__filtered_struct__t, len);
+        for (int i = 0; i < len; i++) {
+            iop_init(tstiop__filtered_struct, &vec_mono[i]);
+            vec_mono[i].a = i % 10;
+            vec_mono[i].b = i;
+        }
+        vec_thr = t_dup(vec_mono, len);
+
+        Z_ASSERT_N(iop_filter(_G.iop_env, &tstiop__filtered_struct__s,
+                              vec_mono, &len_mono, LSTR("a"), values,
+                              countof(values), 0, NULL));
+
+        MODULE_REQUIRE(thr);
+        Z_ASSERT_N(iop_filter(_G.iop_env, &tstiop__filtered_struct__s,
+                              vec_thr, &len_thr, LSTR("a"), values,
+                              countof(values), 0, NULL));
+        MODULE_RELEASE(thr);
+
+        Z_ASSERT_EQ(len_mono, len / 5);
+        Z_ASSERT_EQ(len_thr, len / 5);
+        for (int i = 0; i < len_mono; i++) {
+            uint32_t b = i / 2 * 10 + (i % 2 ? 7 : 3);
+
+            Z_ASSERT_EQ(vec_mono[i].b, b);
+            Z_ASSERT_EQ(vec_thr[i].b, vec_mono[i].b);
+        }
+    } Z_TEST_END;
+    /* }}} */
     Z_TEST(iop_filter_class, "test IOP classes filtering") { /* {{{ */
         t_scope;
         tstiop__my_class2__t *first;
@@ -7977,6 +8348,68 @@ Z_GROUP_EXPORT(iop)
         Z_ASSERT_NULL(res);
     } Z_TEST_END;
     /* }}} */
+    Z_TEST(flat_structs, "test the flat structs fast paths") { /* {{{ */
+        t_scope;
+        unsigned flags;
+        tstiop__flat_struct__t tab[3];
+        tstiop__flat_struct__t opt;
+        tstiop__flat_container__t fc;
+        tstiop__flat_container__t *res;
+        uint8_t buf1[20], buf2[20];
+
+        flags = tstiop__flat_struct__s.flags;
+        Z_ASSERT(TST_BIT(&flags, IOP_STRUCT_IS_FLAT));
+        flags = tstiop__flat_struct_nested__s.flags;
+        Z_ASSERT(TST_BIT(&flags, IOP_STRUCT_IS_FLAT));
+        flags = tstiop__my_struct_n__s.flags;
+        Z_ASSERT(TST_BIT(&flags, IOP_STRUCT_IS_FLAT));
+        flags = tstiop__padded_struct__s.flags;
+        Z_ASSERT(!TST_BIT(&flags, IOP_STRUCT_IS_FLAT));
+        flags = tstiop__flat_container__s.flags;
+        Z_ASSERT(!TST_BIT(&flags, IOP_STRUCT_IS_FLAT));
+        flags = tstiop__my_struct_b__s.flags;
+        Z_ASSERT(!TST_BIT(&flags, IOP_STRUCT_IS_FLAT));
+
+        carray_for_each_pos(i, tab) {
+            iop_init(tstiop__flat_struct, &tab[i]);
+            tab[i].i = -i;
+            tab[i].d = i / 3.;
+            tab[i].e = i;
+            tab[i].u = 2 * i;
+        }
+        iop_init(tstiop__flat_struct, &opt);
+        opt.i = 42;
+        iop_init(tstiop__flat_container, &fc);
+        fc.tab = IOP_TYPED_ARRAY(tstiop__flat_struct, tab, countof(tab));
+        fc.nested.st = tab[1];
+        fc.nested.u = 12;
+        fc.opt = &opt;
+        fc.s = LSTR("foo");
+
+        res = t_iop_dup(tstiop__flat_container, &fc);
+        Z_ASSERT(res->tab.tab != fc.tab.tab);
+        Z_ASSERT(res->opt != fc.opt);
+        Z_ASSERT_IOPEQUAL(tstiop__flat_container, res, &fc);
+        iop_hash_sha1(&tstiop__flat_container__s, &fc, buf1, 0);
+        iop_hash_sha1(&tstiop__flat_container__s, res, buf2, 0);
+        Z_ASSERT_EQUAL(buf1, sizeof(buf1), buf2, sizeof(buf2));
+
+        res->tab.tab[2].d = -0.;
+        Z_ASSERT(!iop_equals(tstiop__flat_container, res, &fc));
+        iop_hash_sha1(&tstiop__flat_container__s, res, buf2, 0);
+        Z_ASSERT(memcmp(buf1, buf2, sizeof(buf1)) != 0);
+        res->tab.tab[2] = tab[2];
+        Z_ASSERT(iop_equals(tstiop__flat_container, res, &fc));
+
+        res->nested.st.u++;
+        Z_ASSERT(!iop_equals(tstiop__flat_container, res, &fc));
+        res->nested.st.u--;
+        res->opt->e++;
+        Z_ASSERT(!iop_equals(tstiop__flat_container, res, &fc));
+        res->opt = NULL;
+        Z_ASSERT(!iop_equals(tstiop__flat_container, res, &fc));
+    } Z_TEST_END;
+    /* }}} */
     Z_TEST(nr_58558, "avoid leak when copying an IOP with no value") { /* {{{ */
         tstiop__my_struct_c__t st;
         tstiop__my_struct_c__t *p;
@@ -236,6 +236,58 @@ Z_GROUP_EXPORT(iprintf) {
         T(PRIx128, PRIx128_FMT_ARG(MAKE128(0xdeadbeef, UINT64_MAX)),
           "deadbeefffffffffffffffff");
 
+#undef T
+    } Z_TEST_END;
+
+    Z_TEST(preparsed, "pre-parsed formats match the regular ones") {
+        t_scope;
+        char ref[128];
+        char res[128];
+        int ref_len;
+        int res_len;
+        SB_1k(sb);
+
+#define T(_fmt, ...)                                                          \
+        do {                                                                 \
+            errno = ENOENT;                                                  \
+            ref_len = isnprintf(ref, sizeof(ref), _fmt, ##__VA_ARGS__);      \
+            for (int size = 0; size <= ref_len + 1; size++) {                \
+                memset(res, 'x', sizeof(res));                               \
+                errno = ENOENT;                                              \
+                res_len = isnprintf_lit(res, size, _fmt, ##__VA_ARGS__);     \
+                Z_ASSERT_EQ(res_len, ref_len, "format: `%s'", _fmt);         \
+                if (size) {                                                  \
+                    Z_ASSERT_STREQUAL(res, t_fmt("%.*s", size - 1, ref),     \
+                                      "format: `%s'", _fmt);                 \
+                }                                                            \
+            }                                                                \
+            sb_reset(&sb);                                                   \
+            errno = ENOENT;                                                  \
+            sb_addf_lit(&sb, _fmt, ##__VA_ARGS__);                           \
+            Z_ASSERT_STREQUAL(sb.data, ref, "format: `%s'", _fmt);           \
+        } while (0)
+
+        T("no conversion");
+        T("%%|a%%b%%%d", 3);
+        T("%d|%c|%lld|%d|%d|%u|%d|", 1178096605, 'A', 33612345678LL, -5, 0,
+          1u, INT_MIN);
+        T("%s[%d]: {%*pM} ", "prog", 1234, 3, "abcdef");
+        T("%*pX-%*px", 2, "ab", 2, "cd");
+        T("%.*s|%s|%s", 3, "abcdef", (const char *)NULL, "x");
+        T("%5d|%-5d|%05d|%5d|%05d|%-5d", 42, 42, 42, -42, -42, -42);
+        T("%x|%X|%08x|%lx|%llX|%hhx|%hx|%hhd|%hd", 0xabcu, 0xabcu, 0xdeadu,
+          0xfffffffffUL, 0xabcdefULL, 0x1ff, 0x1ffff, 200, 70000);
+        T("%zu|%zd|%jd|%td|%lu|%ld", (size_t)12, (ssize_t)-3, (intmax_t)-9,
+          (ptrdiff_t)4, ULONG_MAX, LONG_MIN);
+        T("%m|%20m|%-4c|%c", 'q', 'r');
+        T("%g %f %.3e %10.2f %Lg", 1.5, -2.25, 12345.678, 3.14159,
+          (long double)2.5);
+        T("%+d|% d|%.3d|%#x|%o|%#o|%'d|%*d|%-*d|%.*d", 5, 5, 5, 255, 8, 8,
+          1234567, 6, 7, 6, 7, 4, 9);
+        T("%p|%p", (void *)0x1234, NULL);
+        T("%10s|%-10s|%.2s", "ab", "cd", "efgh");
+        T("%*pMtrailing %pL", 3, "123", &LSTR_IMMED_V("lstr"));
+
 #undef T
     } Z_TEST_END;
 } Z_GROUP_END
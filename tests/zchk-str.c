@@ -23,6 +23,7 @@
 #include <lib-common/http.h>
 #include <lib-common/str-buf-pp.h>
 #include <lib-common/unix.h>
+#include <lib-common/zlib-wrapper.h>
 #include <lib-common/z.h>
 
 /* {{{ str */
@@ -88,6 +89,410 @@ static int z_memtoxll_ext(bool str, bool sgn, const char *p, int len,
     Z_HELPER_END;
 }
 
+/* {{{ Vectorized quoting loops */
+
+typedef void (z_quoting_f)(sb_t *out, const void *data, int len, int arg);
+
+static void z_quoting_b64(sb_t *out, const void *data, int len, int width)
+{
+    sb_add_b64(out, data, len, width);
+}
+
+static void z_quoting_b64url(sb_t *out, const void *data, int len,
+                             int width)
+{
+    sb_add_b64url(out, data, len, width);
+}
+
+/* Encode the data by chunks of varying sizes. */
+static void z_quoting_b64_update(sb_t *out, const void *data, int len,
+                                 int width)
+{
+    sb_b64_ctx_t ctx;
+
+    sb_add_b64_start(out, len, width, &ctx);
+    for (int pos = 0; pos < len; ) {
+        int chunk = MIN(len - pos, (pos * 7 + 13) % 100);
+
+        sb_add_b64_update(out, (const byte *)data + pos, chunk, &ctx);
+        pos += chunk;
+    }
+    sb_add_b64_finish(out, &ctx);
+}
+
+static void z_quoting_unb64(sb_t *out, const void *data, int len, int url)
+{
+    int res = url ? sb_add_unb64url(out, data, len)
+                  : sb_add_unb64(out, data, len);
+
+    sb_addf(out, "|%d", res);
+}
+
+static void z_quoting_hex(sb_t *out, const void *data, int len, int arg)
+{
+    sb_add_hex(out, data, len);
+}
+
+static void z_quoting_unhex(sb_t *out, const void *data, int len, int arg)
+{
+    sb_addf(out, "|%d", sb_add_unhex(out, data, len));
+}
+
+static void z_quoting_urlencode(sb_t *out, const void *data, int len,
+                                int arg)
+{
+    sb_add_urlencode(out, data, len);
+}
+
+static void z_quoting_xmlescape(sb_t *out, const void *data, int len,
+                                int arg)
+{
+    sb_add_xmlescape(out, data, len);
+}
+
+static void z_quoting_csvescape(sb_t *out, const void *data, int len,
+                                int sep)
+{
+    sb_add_csvescape(out, sep, data, len);
+}
+
+/* Check that the vectorized loops give the same result as the scalar
+ * ones. */
+static int z_check_quoting_simd(const char *name, z_quoting_f *f,
+                                const void *data, int len, int arg)
+{
+    SB_1k(ref);
+    SB_1k(res);
+
+    sb_quoting_set_simd(SB_QUOTING_SIMD_NONE);
+    sb_adds(&ref, "prefix");
+    (*f)(&ref, data, len, arg);
+
+    for (int simd = SB_QUOTING_SIMD_SSSE3; simd <= SB_QUOTING_SIMD_AVX2;
+         simd++)
+    {
+        if (sb_quoting_set_simd(simd) != (sb_quoting_simd_t)simd) {
+            break;
+        }
+        sb_set_lstr(&res, LSTR("prefix"));
+        (*f)(&res, data, len, arg);
+        Z_ASSERT(lstr_equal(LSTR_SB_V(&ref), LSTR_SB_V(&res)),
+                 "%s of %d bytes (arg %d) differs with simd level %d",
+                 name, len, arg, simd);
+    }
+
+    Z_HELPER_END;
+}
+
+/* Fill the buffer with random bytes, or with text made of characters that
+ * do not need escaping and a few ones that do. */
+static void z_quoting_fill(byte *data, int len, bool text)
+{
+    static const char plain[] = "abcdefXYZ0123456789-_.";
+    static const char special[] = "azAZ09-_.~ \"&'<>\t\r\n,;%\x01\x7f\x80\xff";
+
+    for (int i = 0; i < len; i++) {
+        if (!text) {
+            data[i] = rand();
+        } else
+        if (rand() % 64) {
+            data[i] = plain[rand() % (countof(plain) - 1)];
+        } else {
+            data[i] = special[rand() % (countof(special) - 1)];
+        }
+    }
+}
+
+static int z_check_quoting_simd_data(const byte *data, int len)
+{
+    static int widths[] = { 0, -1, 4, 7, 76 };
+    SB_1k(enc);
+
+    carray_for_each_entry(width, widths) {
+        Z_HELPER_RUN(z_check_quoting_simd("b64", &z_quoting_b64,
+                                          data, len, width));
+        Z_HELPER_RUN(z_check_quoting_simd("b64url", &z_quoting_b64url,
+                                          data, len, width));
+        Z_HELPER_RUN(z_check_quoting_simd("b64 update",
+                                          &z_quoting_b64_update,
+                                          data, len, width));
+
+        for (int url = 0; url < 2; url++) {
+            sb_reset(&enc);
+            if (url) {
+                sb_add_b64url(&enc, data, len, width);
+            } else {
+                sb_add_b64(&enc, data, len, width);
+            }
+            Z_HELPER_RUN(z_check_quoting_simd("unb64", &z_quoting_unb64,
+                                              enc.data, enc.len, url));
+            Z_HELPER_RUN(z_check_quoting_simd("unb64", &z_quoting_unb64,
+                                              enc.data, enc.len, !url));
+            if (enc.len) {
+                enc.data[rand() % enc.len] = "=*-_ +/A"[rand() % 8];
+                Z_HELPER_RUN(z_check_quoting_simd("unb64", &z_quoting_unb64,
+                                                  enc.data, enc.len, url));
+            }
+        }
+    }
+
+    Z_HELPER_RUN(z_check_quoting_simd("hex", &z_quoting_hex,
+                                      data, len, 0));
+    sb_reset(&enc);
+    sb_add_hex(&enc, data, len);
+    for (int i = 0; i < enc.len; i += 3) {
+        enc.data[i] = tolower(enc.data[i]);
+    }
+    Z_HELPER_RUN(z_check_quoting_simd("unhex", &z_quoting_unhex,
+                                      enc.data, enc.len, 0));
+    if (enc.len) {
+        enc.data[rand() % enc.len] = "gG:/@`\x80 "[rand() % 8];
+        Z_HELPER_RUN(z_check_quoting_simd("unhex", &z_quoting_unhex,
+                                          enc.data, enc.len, 0));
+    }
+
+    Z_HELPER_RUN(z_check_quoting_simd("urlencode", &z_quoting_urlencode,
+                                      data, len, 0));
+    Z_HELPER_RUN(z_check_quoting_simd("xmlescape", &z_quoting_xmlescape,
+                                      data, len, 0));
+    Z_HELPER_RUN(z_check_quoting_simd("csvescape", &z_quoting_csvescape,
+                                      data, len, ','));
+    Z_HELPER_RUN(z_check_quoting_simd("csvescape", &z_quoting_csvescape,
+                                      data, len, '\t'));
+
+    Z_HELPER_END;
+}
+
+/* }}} */
+
+/* {{{ Vectorized UTF-8 loops */
+
+typedef void (z_utf8_f)(sb_t *out, const char *s, int len, int arg);
+
+static void z_utf8_strnlen(sb_t *out, const char *s, int len, int arg)
+{
+    sb_addf(out, "%zd|%td", utf8_strnlen(s, len),
+            utf8_skip_valid(s, s + len) - s);
+}
+
+static void z_utf8_from_latin1(sb_t *out, const char *s, int len, int arg)
+{
+    sb_conv_from_latin1(out, s, len);
+}
+
+static void z_utf8_tolower(sb_t *out, const char *s, int len, int arg)
+{
+    sb_addf(out, "|%d", sb_add_utf8_tolower(out, s, len));
+}
+
+static void z_utf8_toupper(sb_t *out, const char *s, int len, int arg)
+{
+    sb_addf(out, "|%d", sb_add_utf8_toupper(out, s, len));
+}
+
+static void z_utf8_normalize(sb_t *out, const char *s, int len, int ci)
+{
+    sb_addf(out, "|%d", sb_normalize_utf8(out, s, len, ci));
+}
+
+/* Compare s with its prefixes and with variants differing by one
+ * character. */
+static void z_utf8_cmp(sb_t *out, const char *s, int len, int strip)
+{
+    char *s2 = p_dupz(s, len);
+
+    for (int i = 0; i < 5; i++) {
+        int len2 = len;
+
+        switch (i) {
+          case 1: len2 = len / 2; break;
+          case 2: if (len) s2[len / 3] = toupper(s2[len / 3]); break;
+          case 3: if (len) s2[len / 2] = 'z'; break;
+          case 4: if (len) s2[len - 1] = ' '; break;
+        }
+        sb_addf(out, "%d %d %d %d %d %d|",
+                utf8_strcmp(s, len, s2, len2, strip),
+                utf8_strcmp(s2, len2, s, len, strip),
+                utf8_stricmp(s, len, s2, len2, strip),
+                utf8_stricmp(s2, len2, s, len, strip),
+                utf8_str_startswith(s, len, s2, len2),
+                utf8_str_istartswith(s, len, s2, len2));
+    }
+    p_delete(&s2);
+}
+
+static void z_utf8_to_latin1(sb_t *out, const char *s, int len, int rep)
+{
+    sb_addf(out, "|%d", sb_conv_to_latin1(out, s, len, rep));
+}
+
+static void z_utf8_to_ucs2(sb_t *out, const char *s, int len, int be)
+{
+    sb_addf(out, "|%d", be ? sb_conv_to_ucs2be(out, s, len)
+                           : sb_conv_to_ucs2le(out, s, len));
+}
+
+static void z_utf8_to_gsm(sb_t *out, const char *s, int len, int plan)
+{
+    sb_conv_to_gsm(out, s, len);
+    sb_addc(out, '|');
+    sb_conv_to_gsm_hex(out, s, len);
+    sb_addf(out, "|%d", sb_conv_to_gsm_isok(s, len, plan));
+}
+
+static void z_utf8_from_gsm(sb_t *out, const char *s, int len, int plan)
+{
+    sb_addf(out, "|%d", sb_conv_from_gsm_plan(out, s, len, plan));
+}
+
+/* Check that the vectorized loops give the same result as the scalar
+ * ones. */
+static int z_check_utf8_simd(const char *name, z_utf8_f *f,
+                             const char *s, int len, int arg)
+{
+    SB_1k(ref);
+    SB_1k(res);
+
+    utf8_set_simd(UTF8_SIMD_NONE);
+    sb_adds(&ref, "prefix");
+    (*f)(&ref, s, len, arg);
+
+    for (int simd = UTF8_SIMD_SSE2; simd <= UTF8_SIMD_AVX2; simd++) {
+        if (utf8_set_simd(simd) != (utf8_simd_t)simd) {
+            break;
+        }
+        sb_set_lstr(&res, LSTR("prefix"));
+        (*f)(&res, s, len, arg);
+        Z_ASSERT(lstr_equal(LSTR_SB_V(&ref), LSTR_SB_V(&res)),
+                 "%s of %d bytes (arg %d) differs with simd level %d",
+                 name, len, arg, simd);
+    }
+
+    Z_HELPER_END;
+}
+
+/* Fill the buffer with runs of ASCII text, valid UTF-8 characters and, if
+ * wanted, truncated sequences and stray bytes. */
+static int z_utf8_fill(char *s, int size, bool valid)
+{
+    static const char ascii[] = "abcdefXYZ0123 ,.;?\n\r@$_{";
+    static const char * const chars[] = {
+        "\xc3\xa9", "\xc3\x89", "\xe2\x82\xac", "\xce\xa3", "\xc8\xba",
+        "\xf0\x9f\x98\x80",
+    };
+    static const char * const invalid[] = {
+        "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\x80", "\xbf", "\xf8", "\xff",
+    };
+    int len = 0;
+
+    while (len < size - 4) {
+        const char *chr;
+
+        if (rand() % 4) {
+            for (int n = rand() % 80; n-- > 0 && len < size; ) {
+                s[len++] = ascii[rand() % (countof(ascii) - 1)];
+            }
+            continue;
+        }
+        if (!valid && rand() % 4 == 0) {
+            chr = invalid[rand() % countof(invalid)];
+        } else {
+            chr = chars[rand() % countof(chars)];
+        }
+        while (*chr) {
+            s[len++] = *chr++;
+        }
+    }
+    return len;
+}
+
+static int z_check_utf8_simd_data(const char *s, int len)
+{
+    Z_HELPER_RUN(z_check_utf8_simd("utf8_strnlen", &z_utf8_strnlen,
+                                   s, len, 0));
+    Z_HELPER_RUN(z_check_utf8_simd("from_latin1", &z_utf8_from_latin1,
+                                   s, len, 0));
+    Z_HELPER_RUN(z_check_utf8_simd("to_latin1", &z_utf8_to_latin1,
+                                   s, len, -1));
+    Z_HELPER_RUN(z_check_utf8_simd("to_latin1", &z_utf8_to_latin1,
+                                   s, len, '?'));
+    for (int be = 0; be < 2; be++) {
+        Z_HELPER_RUN(z_check_utf8_simd("to_ucs2", &z_utf8_to_ucs2,
+                                       s, len, be));
+    }
+    Z_HELPER_RUN(z_check_utf8_simd("to_gsm", &z_utf8_to_gsm,
+                                   s, len, GSM_DEFAULT_PLAN));
+    Z_HELPER_RUN(z_check_utf8_simd("to_gsm", &z_utf8_to_gsm,
+                                   s, len, GSM_EXTENSION_PLAN));
+    for (int plan = GSM_DEFAULT_PLAN; plan <= GSM_CIMD_PLAN; plan++) {
+        Z_HELPER_RUN(z_check_utf8_simd("from_gsm", &z_utf8_from_gsm,
+                                       s, len, plan));
+    }
+
+    /* The case conversions and comparisons are only checked on valid
+     * text. */
+    if (utf8_strnlen(s, len) >= 0) {
+        Z_HELPER_RUN(z_check_utf8_simd("tolower", &z_utf8_tolower,
+                                       s, len, 0));
+        Z_HELPER_RUN(z_check_utf8_simd("toupper", &z_utf8_toupper,
+                                       s, len, 0));
+        for (int ci = 0; ci < 2; ci++) {
+            Z_HELPER_RUN(z_check_utf8_simd("normalize", &z_utf8_normalize,
+                                           s, len, ci));
+        }
+        for (int strip = 0; strip < 2; strip++) {
+            Z_HELPER_RUN(z_check_utf8_simd("strcmp", &z_utf8_cmp,
+                                           s, len, strip));
+        }
+    }
+
+    Z_HELPER_END;
+}
+
+/* }}} */
+
+static ssize_t z_ob_writerv(int fd, const struct iovec *iov, int iovcnt,
+                            void *priv)
+{
+    return writev(fd, iov, iovcnt);
+}
+
+/* Send ob through a socketpair, with sendfile(2) or through the bounce
+ * buffer of the custom writers, and read what is received in out. */
+static int z_ob_send(outbuf_t *ob, bool custom_writer, sb_t *out)
+{
+    int sv[2];
+    int res = 0;
+    int err = 0;
+
+    RETHROW(socketpairx(AF_UNIX, SOCK_STREAM, 0, O_NONBLOCK, sv));
+    while (!ob_is_empty(ob)) {
+        if (custom_writer) {
+            res = ob_write_with(ob, sv[0], &z_ob_writerv, NULL);
+        } else {
+            res = ob_write(ob, sv[0]);
+        }
+        if (res < 0 && !ERR_RW_RETRIABLE(errno)) {
+            err = errno;
+            break;
+        }
+        while (sb_read(out, sv[1], 0) > 0) {
+            continue;
+        }
+    }
+    while (sb_read(out, sv[1], 0) > 0) {
+        continue;
+    }
+    p_close(&sv[0]);
+    p_close(&sv[1]);
+
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
 Z_GROUP_EXPORT(str) {
     Z_TEST(lstr_equal, "lstr_equal") {
         Z_ASSERT_LSTREQUAL(LSTR_EMPTY_V, LSTR_EMPTY_V);
@@ -178,6 +583,153 @@ Z_GROUP_EXPORT(str) {
         Z_ASSERT_STREQUAL(sb.data, "lol");
     } Z_TEST_END;
 
+    Z_TEST(sb_add_deflate, "sb_add_deflate") {
+        SB_1k(in);
+        SB_1k(out);
+        SB_1k(res);
+        z_stream zs;
+        ssize_t len;
+        uint32_t x = 42;
+
+        for (int i = 0; in.len < 256 << 10; i++) {
+            sb_addf(&in, "line %d: %x\n", i, i * 7919);
+        }
+
+        /* Compress a gzip stream piece by piece, with sync flushes */
+        p_clear(&zs, 1);
+        Z_ASSERT_EQ(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                                 MAX_WBITS + 16, MAX_MEM_LEVEL,
+                                 Z_DEFAULT_STRATEGY), Z_OK);
+        for (int pos = 0, i = 0; pos < in.len; i++) {
+            int flush = i % 10 == 5 ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+            int plen = MIN(in.len - pos, (i * 997) % (20 << 10) + 1);
+            int before = out.len;
+
+            len = sb_add_deflate(&out, &zs, in.data + pos, plen, flush);
+            Z_ASSERT_N(len);
+            Z_ASSERT_EQ(len, out.len - before);
+            Z_ASSERT_ZERO(zs.avail_in);
+            if (flush == Z_SYNC_FLUSH) {
+                /* All the input is output, up to an empty stored block */
+                Z_ASSERT_GE(out.len, 4);
+                Z_ASSERT_ZERO(memcmp(out.data + out.len - 4,
+                                     "\x00\x00\xff\xff", 4));
+            }
+            pos += plen;
+        }
+        Z_ASSERT_GT(sb_add_deflate(&out, &zs, "", 0, Z_FINISH), 0);
+        Z_ASSERT_EQ(deflateEnd(&zs), Z_OK);
+        Z_ASSERT_LT(out.len, in.len / 2);
+        Z_ASSERT_N(sb_add_uncompressed(&res, out.data, out.len));
+        Z_ASSERT_LSTREQUAL(LSTR_SB_V(&res), LSTR_SB_V(&in));
+
+        /* Errors leave the buffer untouched */
+        len = out.len;
+        Z_ASSERT_NEG(sb_add_deflate(&out, &zs, "x", 1, Z_FINISH));
+        Z_ASSERT_EQ(out.len, len);
+
+        /* Incompressible data, in a single zlib stream call: the output is
+         * larger than the input. */
+        sb_reset(&in);
+        for (int i = 0; i < 64 << 10; i++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            sb_addc(&in, x);
+        }
+        sb_reset(&out);
+        sb_reset(&res);
+        p_clear(&zs, 1);
+        Z_ASSERT_EQ(deflateInit(&zs, Z_BEST_COMPRESSION), Z_OK);
+        len = sb_add_deflate(&out, &zs, in.data, in.len, Z_FINISH);
+        Z_ASSERT_EQ(len, out.len);
+        Z_ASSERT_GT(out.len, in.len);
+        Z_ASSERT_EQ(deflateEnd(&zs), Z_OK);
+        Z_ASSERT_N(sb_add_uncompressed(&res, out.data, out.len));
+        Z_ASSERT_LSTREQUAL(LSTR_SB_V(&res), LSTR_SB_V(&in));
+    } Z_TEST_END;
+
+    Z_TEST(ob_add_file_range, "ob_add_file_range") {
+        t_scope;
+        const char *path = t_fmt("%*pM/ob_file_range",
+                                 LSTR_FMT_ARG(z_tmpdir_g));
+        t_SB(content, 200 << 10);
+        struct {
+            off_t off;
+            int   len;
+        } ranges[] = {
+            /* Small ranges are read right away */
+            { 0, 100 },
+            { 1234, 100 },
+            /* Larger ones are sent with sendfile(2), or by pieces through
+             * the bounce buffer */
+            { 0, OUTBUF_CHUNK_MIN_SIZE + 1 },
+            { 1234, 100 << 10 },
+            { 7, (200 << 10) - 7 - 4321 },
+            /* Up to the end of the file */
+            { (200 << 10) - (70 << 10), 70 << 10 },
+        };
+        int fd;
+
+        for (int i = 0; i < 200 << 10; i++) {
+            sb_addc(&content, (i * 31) ^ (i >> 8));
+        }
+        Z_ASSERT_N(xwrite_file(path, content.data, content.len));
+
+        for (int i = 0; i < countof(ranges); i++) {
+            off_t off = ranges[i].off;
+            int len = ranges[i].len;
+
+            for (int custom_writer = 0; custom_writer < 2; custom_writer++) {
+                outbuf_t ob;
+                SB_1k(out);
+                int res;
+
+                ob_init(&ob);
+                ob_adds(&ob, "head");
+                Z_ASSERT_N(fd = open(path, O_RDONLY));
+                Z_ASSERT_N(ob_add_file_range(&ob, fd, off, len, true));
+                ob_adds(&ob, "tail");
+                Z_ASSERT_EQ(ob.length, len + 8);
+
+                res = z_ob_send(&ob, custom_writer, &out);
+                ob_wipe(&ob);
+                Z_ASSERT_N(res, "range %d: %m", i);
+                Z_ASSERT_EQ(out.len, len + 8, "range %d", i);
+                Z_ASSERT(lstr_startswith(LSTR_SB_V(&out), LSTR("head")));
+                Z_ASSERT(lstr_endswith(LSTR_SB_V(&out), LSTR("tail")));
+                Z_ASSERT_LSTREQUAL(LSTR_INIT_V(out.data + 4, len),
+                                   LSTR_INIT_V(content.data + off, len),
+                                   "range %d, custom writer: %d",
+                                   i, custom_writer);
+            }
+        }
+
+        /* A range past the end of the file is detected */
+        for (int custom_writer = 0; custom_writer < 2; custom_writer++) {
+            outbuf_t ob;
+            SB_1k(out);
+            int res;
+            int err;
+
+            ob_init(&ob);
+            ob_adds(&ob, "head");
+            Z_ASSERT_N(fd = open(path, O_RDONLY));
+            Z_ASSERT_N(ob_add_file_range(&ob, fd, content.len - 1000,
+                                         20 << 10, true));
+
+            res = z_ob_send(&ob, custom_writer, &out);
+            err = errno;
+            ob_wipe(&ob);
+            Z_ASSERT_NEG(res);
+            Z_ASSERT_EQ(err, EIO);
+            Z_ASSERT_EQ(out.len, 4 + 1000);
+            Z_ASSERT_LSTREQUAL(LSTR_INIT_V(out.data + 4, 1000),
+                               LSTR_INIT_V(content.data + content.len - 1000,
+                                           1000));
+        }
+    } Z_TEST_END;
+
     Z_TEST(sb_add_urlencode, "sb_add_urlencode") {
         SB_1k(sb);
         lstr_t raw = LSTR("test32@localhost-#!$;*");
@@ -2406,6 +2958,84 @@ Z_GROUP_EXPORT(str) {
         Z_ASSERT_NEG(sb_adds_unb64url(&data_decoded, "wQA&03e="));
     } Z_TEST_END
 
+    Z_TEST(quoting_simd, "vectorized quoting loops give the same results") {
+        static byte data[3 << 20];
+
+        if (sb_quoting_set_simd(SB_QUOTING_SIMD_AVX2)
+        ==  SB_QUOTING_SIMD_NONE)
+        {
+            Z_SKIP("your CPU doesn't support ssse3");
+        }
+
+        /* Short inputs, around the sizes of the blocks */
+        for (int len = 0; len < 300; len++) {
+            for (int text = 0; text < 2; text++) {
+                z_quoting_fill(data, len, text);
+                Z_HELPER_RUN(z_check_quoting_simd_data(data, len),
+                             "len %d", len);
+            }
+        }
+
+        /* Multi-MB inputs */
+        for (int text = 0; text < 2; text++) {
+            z_quoting_fill(data, sizeof(data), text);
+            Z_HELPER_RUN(z_check_quoting_simd_data(data, sizeof(data) - 1));
+        }
+
+        sb_quoting_set_simd(SB_QUOTING_SIMD_AVX2);
+    } Z_TEST_END;
+
+    Z_TEST(utf8_simd, "vectorized UTF-8 loops give the same results") {
+        static char data[3 << 20];
+        static const char ascii[] = "abcdefXYZ0123 ,.;?\n\r@$_{";
+        SB_1k(gsm);
+        SB_1k(dec);
+
+        if (utf8_set_simd(UTF8_SIMD_AVX2) == UTF8_SIMD_NONE) {
+            Z_SKIP("your CPU doesn't support sse2");
+        }
+
+        /* Short inputs, around the sizes of the blocks */
+        for (int size = 0; size < 300; size++) {
+            for (int valid = 0; valid < 2; valid++) {
+                int len = z_utf8_fill(data, size, valid);
+
+                Z_HELPER_RUN(z_check_utf8_simd_data(data, len),
+                             "len %d", len);
+            }
+        }
+
+        /* Multi-MB inputs */
+        for (int valid = 0; valid < 2; valid++) {
+            int len = z_utf8_fill(data, sizeof(data), valid);
+
+            Z_HELPER_RUN(z_check_utf8_simd_data(data, len));
+        }
+
+        /* GSM 7 bits packing, by runs of 8 characters when possible */
+        for (int len = 0; len < 100; len++) {
+            for (int udhlen = 0; udhlen < 8; udhlen++) {
+                int gsmlen;
+
+                for (int i = 0; i < len; i++) {
+                    data[i] = ascii[rand() % (countof(ascii) - 1)];
+                }
+                data[len] = '\0';
+                sb_reset(&gsm);
+                sb_reset(&dec);
+                sb_addnc(&gsm, udhlen, 0);
+                gsmlen = sb_conv_to_gsm7(&gsm, 0, data, '.',
+                                         GSM_EXTENSION_PLAN, -1);
+                Z_ASSERT_N(gsmlen);
+                Z_ASSERT_N(sb_conv_from_gsm7(&dec, gsm.data, gsmlen,
+                                             udhlen));
+                Z_ASSERT_STREQUAL(dec.data, data, "udhlen %d", udhlen);
+            }
+        }
+
+        utf8_set_simd(UTF8_SIMD_AVX2);
+    } Z_TEST_END;
+
     Z_TEST(init_from_file, "Init lstr from a file") {
         t_scope;
         const char *path;
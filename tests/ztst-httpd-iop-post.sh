@@ -10,3 +10,7 @@ cat <<EOF | POST http://localhost:1080/iop/ -c "text/xml"
   </Body>
 </Envelope>
 EOF
+
+cat <<EOF | POST http://localhost:1080/iop/batch -c "application/json"
+[["iface/f",{"i":10}],["iface/f",{"i":11}]]
+EOF
@@ -93,6 +93,7 @@ int main(int argc, char **argv)
     _G.itcb = httpd_trigger__ic_new(iop_env, &tstiop__t__mod, SCHEMA,
                                     2 << 20);
     _G.itcb->query_max_size = 2 << 20;
+    _G.itcb->batch_max = 64;
     httpd_trigger_register(cfg, POST, "iop", &_G.itcb->cb);
     ichttp_register_(_G.itcb, tstiop__t, iface, f, f_cb);
 
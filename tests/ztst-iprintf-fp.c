@@ -4,6 +4,8 @@
  * original file name: tfformat.c
  */
 
+#include <math.h>
+
 #include <lib-common/core.h>
 
 typedef struct {
@@ -4080,6 +4082,22 @@ int main(int argc, char *argv[])
             printf("%s:%d: error: string is \"%s\", value is %g.\n",
                    __FILE__, dptr->line, buffer, d);
         }
+        /* The shortest digits must read back to the very same bits, both
+         * with strtod and its fast path. */
+        dtoa_shortest(buffer, dptr->value);
+        if (!isnan(dptr->value)) {
+            double d2 = strtod_allow_subnormal(buffer, NULL);
+
+            d = strtod(buffer, NULL);
+            if (memcmp(&d, &dptr->value, sizeof(d))
+            ||  memcmp(&d2, &dptr->value, sizeof(d)))
+            {
+                errcount++;
+                printf("%s:%d: error: shortest string is \"%s\", "
+                       "value is %.17g.\n",
+                       __FILE__, dptr->line, buffer, d);
+            }
+        }
         testcount++;
     }
 